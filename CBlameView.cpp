@@ -0,0 +1,759 @@
+/**
+ * @file
+ * @brief Incremental blame of a file at a commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CBlameView.h"
+
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <string.h>
+#include <git2.h>
+
+#include "CPackCommitReader.h"
+#include "CChangedPathIndex.h"
+
+using namespace QGitRepoViewer;
+
+/// Only so many first bytes of the file are checked for NUL to tell binary files
+#define BINARY_CHECK_SIZE 8000
+
+namespace
+{
+	/// Changed lines of a hunk of blob diff (1-based, as in unified diff)
+	struct CLineRange
+	{
+		int m_old_start;
+		int m_old_lines;
+		int m_new_start;
+		int m_new_lines;
+	};
+
+	/// Commit the lines are passed to, with the blob of the file in it
+	struct CSuspect
+	{
+		CGitOid m_commit;
+		CGitOid m_blob;
+
+		/// Line of the blamed text for each line of the blob, -1 for lines this commit doesn't carry
+		QVector<int> m_lines;
+
+		/// Header of the commit, read when it is queued
+		CCommitHeader m_header;
+		bool m_read;
+
+		CSuspect (): m_read (false)
+		{}
+	};
+
+	/**
+	 * @brief Blames lines of a file walking all parents of the commit, as git does
+	 *
+	 * Every line of the blamed text keeps its number in the version of the file being compared. Commits which
+	 * don't change the file are skipped (most of them by changed-path filters alone, the rest by the same blob
+	 * in any parent); when a commit changes it, its blob is diffed with each parent one without context in turn.
+	 * Lines unchanged against a parent are passed to that parent and renumbered into its version, lines new
+	 * against every parent are blamed on the commit. Root commit and the commit which added the file get all
+	 * lines they carry. Commits are walked newest first, lines reaching the same commit by several paths
+	 * are walked together.
+	 */
+	class CBlameJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		QString m_path;
+		QByteArray m_path_utf8;
+		CGitOid m_commit;
+		QObject* m_receiver;
+		int m_generation;
+
+		CGitRepository m_repo;
+		CPackCommitReader m_pack_reader;
+		CChangedPathIndex m_path_index;
+		bool m_started;
+
+		/// Commits still to walk, newest first
+		QList<CSuspect> m_suspects;
+		int m_remaining;
+
+		/// Commit which changed the file last was already announced
+		bool m_announced;
+		QByteArray m_text;
+
+		/// Author, time, summary and parents of the commit
+		bool readCommit (const CGitOid& _id, CCommitHeader& _header);
+
+		/// Id of the file blob in the tree of commit (null if there is no such file)
+		CGitOid pathEntry (const CGitOid& _commit);
+
+		/// Queue lines of the blob to the commit, joining them with the ones already passed to it
+		void enqueue (const CGitOid& _commit, const CGitOid& _blob, const QVector<int>& _lines);
+
+		/// Pass lines of the blob unchanged against the parent blob to the parent (none if blobs can't be diffed)
+		void passLines (const CGitOid& _parent, const CGitOid& _parent_blob, const CGitOid& _blob, QVector<int>& _lines);
+
+		/// Blame specified lines of the blamed text on the commit
+		void blame (const CGitOid& _commit, const CCommitHeader& _header, const QVector<int>& _lines, CBlameHunkList& _hunks);
+
+		/// Blame all lines the suspect carries on its commit
+		void blameRemaining (const CSuspect& _suspect, CBlameHunkList& _hunks);
+
+		/// Announce the commit which changed the file last
+		void announce (const CGitOid& _commit);
+
+		/// Start: read the blamed text; false on error
+		bool start (QString& _error);
+
+		static int hunkCb (const git_diff_delta* _delta, const git_diff_range* _range,
+						   const char* _header, size_t _header_length, void* _payload);
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of commits walked per step
+		enum { STEP_SIZE = 256 };
+
+		CBlameJob (const QString& _repo_path, const QString& _path, const CGitOid& _commit,
+				   QObject* _receiver, int _generation);
+	};
+
+	/// Count of lines in the text, the last one may lack line break
+	int countLines (const char* _data, int _size)
+	{
+		int count = 0;
+		for (const char* p = _data; (p = static_cast<const char*> (memchr (p, '\n', size_t (_data + _size - p)))); ++p)
+			++count;
+
+		if ((_size > 0) && (_data [_size - 1] != '\n'))
+			++count;
+
+		return count;
+	}
+}
+
+CBlameJob::CBlameJob (const QString& _repo_path, const QString& _path, const CGitOid& _commit,
+					  QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_path (_path),
+	m_commit (_commit),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_started (false),
+	m_remaining (0),
+	m_announced (false)
+{
+	QString path = QDir::fromNativeSeparators (_path);
+	while (path.endsWith ('/'))
+		path.chop (1);
+	m_path_utf8 = path.toUtf8 ();
+}
+
+bool
+CBlameJob::readCommit (const CGitOid& _id, CCommitHeader& _header)
+{
+	if (m_pack_reader.readHeader (_id, _header))
+		return true;
+
+	git_commit* commit = NULL;
+	if (git_commit_lookup (& commit, m_repo.handle (), _id.raw ()) != GIT_OK)
+		return false;
+
+	const git_signature* author = git_commit_author (commit);
+	if (author)
+		_header.m_author = QString::fromUtf8 (author->name) + " <" + QString::fromUtf8 (author->email) + ">";
+	_header.m_summary = QString::fromUtf8 (git_commit_message (commit)).section ('\n', 0, 0);
+	_header.m_time = uint (git_commit_time (commit));
+
+	_header.m_parents.clear ();
+	const unsigned int parent_count = git_commit_parentcount (commit);
+	for (unsigned int i = 0; i < parent_count; ++i)
+		_header.m_parents.append (CGitOid (git_commit_parent_id (commit, i)));
+
+	git_commit_free (commit);
+	return true;
+}
+
+CGitOid
+CBlameJob::pathEntry (const CGitOid& _commit)
+{
+	CGitOid result;
+
+	git_commit* commit = NULL;
+	git_tree* tree = NULL;
+	git_tree_entry* entry = NULL;
+	if ((git_commit_lookup (& commit, m_repo.handle (), _commit.raw ()) == GIT_OK)
+		&& (git_commit_tree (& tree, commit) == GIT_OK)
+		&& (git_tree_entry_bypath (& entry, tree, m_path_utf8.constData ()) == GIT_OK)
+		&& (git_tree_entry_type (entry) == GIT_OBJ_BLOB))
+		result = CGitOid (git_tree_entry_id (entry));
+
+	git_tree_entry_free (entry);
+	git_tree_free (tree);
+	git_commit_free (commit);
+	return result;
+}
+
+void
+CBlameJob::enqueue (const CGitOid& _commit, const CGitOid& _blob, const QVector<int>& _lines)
+{
+	//
+	// Same commit means the same blob, so lines passed by another path have the same numbering
+	//
+	for (QList<CSuspect>::iterator it = m_suspects.begin (); it != m_suspects.end (); ++it)
+	{
+		if (it->m_commit != _commit)
+			continue;
+
+		for (int i = 0; (i < _lines.size ()) && (i < it->m_lines.size ()); ++i)
+			if (_lines [i] >= 0)
+				it->m_lines [i] = _lines [i];
+		return;
+	}
+
+	CSuspect suspect;
+	suspect.m_commit = _commit;
+	suspect.m_blob = _blob;
+	suspect.m_lines = _lines;
+	suspect.m_read = readCommit (_commit, suspect.m_header);
+
+	int i = 0;
+	while ((i < m_suspects.size ()) && (m_suspects [i].m_header.m_time >= suspect.m_header.m_time))
+		++i;
+	m_suspects.insert (i, suspect);
+}
+
+void
+CBlameJob::announce (const CGitOid& _commit)
+{
+	if (m_announced)
+		return;
+
+	m_announced = true;
+	post (m_receiver, "startBlame", Q_ARG (int, m_generation), Q_ARG (CGitOid, _commit), Q_ARG (QByteArray, m_text));
+	m_text.clear ();
+}
+
+void
+CBlameJob::blame (const CGitOid& _commit, const CCommitHeader& _header, const QVector<int>& _lines, CBlameHunkList& _hunks)
+{
+	//
+	// Lines of the blamed text come ascending: join adjacent ones into hunks
+	//
+	for (int i = 0; i < _lines.size (); )
+	{
+		CBlameHunk hunk;
+		hunk.m_commit = _commit;
+		hunk.m_author = _header.m_author;
+		hunk.m_summary = _header.m_summary;
+		hunk.m_time = _header.m_time;
+		hunk.m_first_line = _lines [i];
+		hunk.m_line_count = 1;
+		for (++i; (i < _lines.size ()) && (_lines [i] == hunk.m_first_line + hunk.m_line_count); ++i)
+			++hunk.m_line_count;
+
+		_hunks.append (hunk);
+		m_remaining -= hunk.m_line_count;
+	}
+}
+
+void
+CBlameJob::blameRemaining (const CSuspect& _suspect, CBlameHunkList& _hunks)
+{
+	QVector<int> lines;
+	foreach (int line, _suspect.m_lines)
+		if (line >= 0)
+			lines.append (line);
+
+	qSort (lines);
+	blame (_suspect.m_commit, _suspect.m_header, lines, _hunks);
+}
+
+int
+CBlameJob::hunkCb (const git_diff_delta* _delta, const git_diff_range* _range,
+				   const char* _header, size_t _header_length, void* _payload)
+{
+	Q_UNUSED (_delta);
+	Q_UNUSED (_header);
+	Q_UNUSED (_header_length);
+
+	CLineRange range = { _range->old_start, _range->old_lines, _range->new_start, _range->new_lines };
+	static_cast<QVector<CLineRange>*> (_payload)->append (range);
+	return GIT_OK;
+}
+
+void
+CBlameJob::passLines (const CGitOid& _parent, const CGitOid& _parent_blob, const CGitOid& _blob, QVector<int>& _lines)
+{
+	//
+	// Diff without context: lines outside changed ranges are renumbered into the parent version
+	//
+	git_diff_options options = GIT_DIFF_OPTIONS_INIT;
+	options.context_lines = 0;
+
+	git_blob* old_blob = NULL;
+	git_blob* new_blob = NULL;
+	QVector<CLineRange> ranges;
+	int old_line_count = 0;
+	bool diffed = (git_blob_lookup (& old_blob, m_repo.handle (), _parent_blob.raw ()) == GIT_OK)
+				  && (git_blob_lookup (& new_blob, m_repo.handle (), _blob.raw ()) == GIT_OK);
+	if (diffed)
+	{
+		old_line_count = countLines (static_cast<const char*> (git_blob_rawcontent (old_blob)),
+									 int (git_blob_rawsize (old_blob)));
+		diffed = (git_diff_blobs (old_blob, new_blob, & options, NULL, & hunkCb, NULL, & ranges) == GIT_OK);
+	}
+	git_blob_free (old_blob);
+	git_blob_free (new_blob);
+
+	if (! diffed)
+		return;
+
+	QVector<int> parent_lines (old_line_count, -1);
+	bool passed = false;
+	int old_line = 1;
+	int new_line = 1;
+	for (int r = 0; r <= ranges.size (); ++r)
+	{
+		// Empty side of a range starts after the line it refers to; past the last range everything is unchanged
+		int new_start = _lines.size () + 1;
+		if (r < ranges.size ())
+			new_start = (ranges [r].m_new_lines > 0) ? ranges [r].m_new_start : ranges [r].m_new_start + 1;
+
+		for (; (new_line < new_start) && (new_line <= _lines.size ()) && (old_line <= old_line_count); ++new_line, ++old_line)
+		{
+			if (_lines [new_line - 1] < 0)
+				continue;
+
+			parent_lines [old_line - 1] = _lines [new_line - 1];
+			_lines [new_line - 1] = -1;
+			passed = true;
+		}
+
+		if (r < ranges.size ())
+		{
+			new_line += ranges [r].m_new_lines;
+			old_line += ranges [r].m_old_lines;
+		}
+	}
+
+	if (passed)
+		enqueue (_parent, _parent_blob, parent_lines);
+}
+
+bool
+CBlameJob::start (QString& _error)
+{
+	if (! m_repo.open (m_repo_path, true))
+	{
+		_error = m_repo.lastError ();
+		return false;
+	}
+
+	const QString git_dir = QFile::decodeName (git_repository_path (m_repo.handle ()));
+	m_pack_reader.open (git_dir + "objects");
+	m_path_index.open (git_dir);
+	m_path_index.setPath (m_path);
+
+	const CGitOid blob_id = pathEntry (m_commit);
+
+	git_blob* blob = NULL;
+	if (blob_id.isNull () || (git_blob_lookup (& blob, m_repo.handle (), blob_id.raw ()) != GIT_OK))
+	{
+		_error = QObject::tr ("There is no file %1 in commit %2").arg (m_path).arg (m_commit.toString ());
+		return false;
+	}
+
+	m_text = QByteArray (static_cast<const char*> (git_blob_rawcontent (blob)), int (git_blob_rawsize (blob)));
+	git_blob_free (blob);
+
+	if (memchr (m_text.constData (), '\0', size_t (qMin (m_text.size (), BINARY_CHECK_SIZE))))
+	{
+		_error = QObject::tr ("%1 is a binary file").arg (m_path);
+		return false;
+	}
+
+	m_remaining = countLines (m_text.constData (), m_text.size ());
+	QVector<int> lines (m_remaining);
+	for (int i = 0; i < lines.size (); ++i)
+		lines [i] = i;
+
+	enqueue (m_commit, blob_id, lines);
+	return true;
+}
+
+bool
+CBlameJob::step ()
+{
+	if (! m_started)
+	{
+		m_started = true;
+
+		QString error;
+		if (! start (error))
+		{
+			post (m_receiver, "finishBlame", Q_ARG (int, m_generation), Q_ARG (QString, error));
+			return false;
+		}
+	}
+
+	CBlameHunkList hunks;
+
+	bool broken = false;
+	for (int walked = 0; (walked < STEP_SIZE) && (m_remaining > 0) && !m_suspects.isEmpty (); ++walked)
+	{
+		CSuspect suspect = m_suspects.takeFirst ();
+		if (! suspect.m_read)
+		{
+			broken = true;
+			break;
+		}
+
+		const CCommitHeader& header = suspect.m_header;
+		if (header.m_parents.isEmpty ())
+		{
+			announce (suspect.m_commit);
+			blameRemaining (suspect, hunks);
+			continue;
+		}
+
+		//
+		// Commits which didn't touch the file: by filter alone (the same file as in the first parent),
+		// or by the same blob in any parent; all lines are passed to that parent
+		//
+		if (m_path_index.mayChange (suspect.m_commit) == CChangedPathIndex::NOT_CHANGED)
+		{
+			enqueue (header.m_parents.first (), suspect.m_blob, suspect.m_lines);
+			continue;
+		}
+
+		CGitOidVector parent_blobs;
+		int same = -1;
+		for (int i = 0; i < header.m_parents.size (); ++i)
+		{
+			parent_blobs.append (pathEntry (header.m_parents [i]));
+			if (parent_blobs.last () == suspect.m_blob)
+			{
+				same = i;
+				break;
+			}
+		}
+
+		if (same >= 0)
+		{
+			enqueue (header.m_parents [same], suspect.m_blob, suspect.m_lines);
+			continue;
+		}
+
+		//
+		// Each parent in turn takes lines unchanged against it, lines new against every parent are the commit's
+		//
+		announce (suspect.m_commit);
+		for (int i = 0; i < header.m_parents.size (); ++i)
+			if (! parent_blobs [i].isNull ())
+				passLines (header.m_parents [i], parent_blobs [i], suspect.m_blob, suspect.m_lines);
+
+		blameRemaining (suspect, hunks);
+	}
+
+	if (! hunks.isEmpty ())
+		post (m_receiver, "addBlameHunks", Q_ARG (int, m_generation), Q_ARG (CBlameHunkList, hunks));
+
+	//
+	// Walk is over when every line is blamed (or history couldn't be read further)
+	//
+	if (! broken && (m_remaining > 0) && !m_suspects.isEmpty ())
+		return true;
+
+	announce (m_commit);
+	post (m_receiver, "finishBlame", Q_ARG (int, m_generation), Q_ARG (QString, QString ()));
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CBlameView::CBlameView (QWidget* _parent):
+	QAbstractScrollArea (_parent),
+	m_cache (CACHE_LIMIT_KB),
+	m_generation (0),
+	m_loading (false)
+{
+	qRegisterMetaType<CGitOid> ("CGitOid");
+	qRegisterMetaType<CBlameHunkList> ("CBlameHunkList");
+
+	QFont font ("Monospace");
+	font.setStyleHint (QFont::TypeWriter);
+	setFont (font);
+
+	verticalScrollBar ()->setSingleStep (1);
+}
+
+CBlameView::~CBlameView ()
+{
+	cancelJob ();
+}
+
+void
+CBlameView::cancelJob ()
+{
+	if (m_job)
+	{
+		m_job->cancel ();
+		m_job.clear ();
+	}
+	++m_generation;
+	m_loading = false;
+}
+
+void
+CBlameView::setGitRepo (const QString& _repo_path)
+{
+	cancelJob ();
+	m_repo_path = _repo_path;
+	m_cache.clear ();
+	m_last_changes.clear ();
+
+	m_path.clear ();
+	m_commit = m_last_change = CGitOid ();
+	setResult (CBlameResult ());
+}
+
+QString
+CBlameView::path () const
+{
+	return m_path;
+}
+
+void
+CBlameView::showBlame (const QString& _path, const CGitOid& _commit)
+{
+	if ((_path == m_path) && (_commit == m_commit))
+		return;
+
+	cancelJob ();
+	m_path = _path;
+	m_commit = _commit;
+	m_error.clear ();
+	setWindowTitle (tr ("Blame of %1 at %2").arg (_path).arg (_commit.toString ().left (10)));
+
+	//
+	// Commit which didn't touch the file has the blame of the commit which changed it last
+	//
+	QHash<CBlameKey, CGitOid>::const_iterator iLast = m_last_changes.constFind (qMakePair (_path, _commit));
+	if (iLast != m_last_changes.constEnd ())
+	{
+		const CBlameResult* cached = m_cache.object (qMakePair (_path, iLast.value ()));
+		if (cached)
+		{
+			m_last_change = iLast.value ();
+			setResult (*cached);
+			return;
+		}
+	}
+
+	m_last_change = CGitOid ();
+	setResult (CBlameResult ());
+	if (m_repo_path.isEmpty ())
+		return;
+
+	m_loading = true;
+	m_job = CBackgroundJobPtr (new CBlameJob (m_repo_path, _path, _commit, this, m_generation));
+	m_job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+	CWorkerPool::instance ()->start (m_job);
+}
+
+void
+CBlameView::startBlame (int _generation, const CGitOid& _last_change, const QByteArray& _text)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_last_change = _last_change;
+	m_last_changes.insert (qMakePair (m_path, m_commit), _last_change);
+
+	// Another commit with the same last change was blamed already
+	const CBlameResult* cached = m_cache.object (qMakePair (m_path, _last_change));
+	if (cached)
+	{
+		cancelJob ();
+		setResult (*cached);
+		return;
+	}
+
+	CBlameResult result;
+	result.m_text = _text;
+	setResult (result);
+}
+
+void
+CBlameView::addBlameHunks (int _generation, const CBlameHunkList& _hunks)
+{
+	if (_generation == m_generation)
+		addHunks (_hunks);
+}
+
+void
+CBlameView::finishBlame (int _generation, const QString& _error)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_job.clear ();
+	m_loading = false;
+	m_error = _error;
+
+	if (_error.isEmpty () && !m_last_change.isNull ())
+		m_cache.insert (qMakePair (m_path, m_last_change), new CBlameResult (m_result),
+						qMax (1, m_result.m_text.size () / 1024));
+
+	viewport ()->update ();
+}
+
+void
+CBlameView::setResult (const CBlameResult& _result)
+{
+	m_result.m_text = _result.m_text;
+	m_result.m_hunks.clear ();
+
+	//
+	// Offsets of line starts; the last one is the end of text
+	//
+	m_line_offsets.clear ();
+	m_line_offsets.append (0);
+	const char* data = m_result.m_text.constData ();
+	for (int i = 0; i < m_result.m_text.size (); ++i)
+		if (data [i] == '\n')
+			m_line_offsets.append (i + 1);
+	if (! m_result.m_text.isEmpty () && !m_result.m_text.endsWith ('\n'))
+		m_line_offsets.append (m_result.m_text.size () + 1);
+
+	m_line_hunks.fill (-1, m_line_offsets.size () - 1);
+	addHunks (_result.m_hunks);
+
+	verticalScrollBar ()->setValue (0);
+	updateScrollBars ();
+	viewport ()->update ();
+}
+
+void
+CBlameView::addHunks (const CBlameHunkList& _hunks)
+{
+	foreach (const CBlameHunk& hunk, _hunks)
+	{
+		const int index = m_result.m_hunks.size ();
+		m_result.m_hunks.append (hunk);
+
+		const int end = qMin (hunk.m_first_line + hunk.m_line_count, m_line_hunks.size ());
+		for (int line = qMax (0, hunk.m_first_line); line < end; ++line)
+			m_line_hunks [line] = index;
+	}
+
+	if (! _hunks.isEmpty ())
+		viewport ()->update ();
+}
+
+int
+CBlameView::lineHeight () const
+{
+	return qMax (1, fontMetrics ().lineSpacing ());
+}
+
+int
+CBlameView::gutterWidth () const
+{
+	// Short id, date and author name
+	return fontMetrics ().width (QLatin1Char ('m')) * 42;
+}
+
+void
+CBlameView::updateScrollBars ()
+{
+	const int page = qMax (1, viewport ()->height () / lineHeight ());
+	verticalScrollBar ()->setPageStep (page);
+	verticalScrollBar ()->setRange (0, qMax (0, m_line_hunks.size () - page));
+
+	horizontalScrollBar ()->setPageStep (viewport ()->width ());
+	horizontalScrollBar ()->setSingleStep (fontMetrics ().width (QLatin1Char ('m')) * 4);
+	horizontalScrollBar ()->setRange (0, fontMetrics ().width (QLatin1Char ('m')) * 200);
+}
+
+void
+CBlameView::paintEvent (QPaintEvent* _event)
+{
+	QPainter painter (viewport ());
+	const int height = lineHeight ();
+	const int gutter = gutterWidth ();
+
+	if (m_line_hunks.isEmpty ())
+	{
+		painter.setPen (palette ().color (QPalette::Disabled, QPalette::Text));
+		painter.drawText (viewport ()->rect (), Qt::AlignCenter | Qt::TextWordWrap,
+						  ! m_error.isEmpty () ? m_error : (m_loading ? tr ("Loading blame...") : QString ()));
+		return;
+	}
+
+	const QRect area = _event->rect ();
+	const int first = verticalScrollBar ()->value ();
+	const int top = first + qMax (0, area.top ()) / height;
+	const int bottom = qMin (m_line_hunks.size () - 1, first + area.bottom () / height);
+	const int x = gutter + 4 - horizontalScrollBar ()->value ();
+
+	const QColor text_color = palette ().color (QPalette::Text);
+	const QColor gutter_color = palette ().color (QPalette::Disabled, QPalette::Text);
+
+	//
+	// Only visible lines are painted; commit is written on the first visible line of its hunk
+	//
+	for (int line = top; line <= bottom; ++line)
+	{
+		const int y = (line - first) * height;
+		const int hunk_index = m_line_hunks [line];
+
+		painter.setClipRect (QRect (x, y, viewport ()->width () - x, height));
+		const int begin = m_line_offsets [line];
+		const int length = qMin (m_line_offsets [line + 1] - 1 - begin, int (MAX_PAINTED_LINE));
+		painter.setPen (text_color);
+		painter.drawText (QRect (x, y, viewport ()->width (), height), Qt::AlignLeft | Qt::AlignVCenter | Qt::TextExpandTabs,
+						  QString::fromUtf8 (m_result.m_text.constData () + begin, qMax (0, length)));
+		painter.setClipping (false);
+
+		const QRect gutter_rect (0, y, gutter, height);
+		if (hunk_index < 0)
+		{
+			painter.fillRect (gutter_rect, palette ().color (QPalette::AlternateBase));
+			continue;
+		}
+
+		const CBlameHunk& hunk = m_result.m_hunks [hunk_index];
+		painter.fillRect (gutter_rect, (hunk_index & 1) ? palette ().color (QPalette::AlternateBase) : palette ().color (QPalette::Base));
+		if ((line == top) || (m_line_hunks [line - 1] != hunk_index))
+		{
+			const QString author = hunk.m_author.section (" <", 0, 0);
+			painter.setPen (gutter_color);
+			painter.drawText (gutter_rect.adjusted (2, 0, -2, 0), Qt::AlignLeft | Qt::AlignVCenter,
+							  QString ("%1 %2 %3").arg (hunk.m_commit.toString ().left (8))
+							  .arg (QDateTime::fromTime_t (hunk.m_time).toString ("yyyy-MM-dd")).arg (author));
+		}
+	}
+}
+
+void
+CBlameView::resizeEvent (QResizeEvent* _event)
+{
+	QAbstractScrollArea::resizeEvent (_event);
+	updateScrollBars ();
+}
+
+void
+CBlameView::scrollContentsBy (int _dx, int _dy)
+{
+	Q_UNUSED (_dx);
+	Q_UNUSED (_dy);
+
+	// Vertical scroll bar counts lines, not pixels
+	viewport ()->update ();
+}
@@ -0,0 +1,125 @@
+/**
+ * @file
+ * @brief Incremental blame of a file at a commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CBLAMEVIEW_H
+#define __QGITREPOVIEWER_CBLAMEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+namespace QGitRepoViewer
+{
+	/// Lines of the blamed file last changed by one commit
+	struct CBlameHunk
+	{
+		CGitOid m_commit;
+		int m_first_line;
+		int m_line_count;
+		QString m_author;
+		QString m_summary;
+		uint m_time;
+
+		CBlameHunk (): m_first_line (0), m_line_count (0), m_time (0)
+		{}
+	};
+
+	typedef QList<CBlameHunk> CBlameHunkList;
+
+	/**
+	 * @brief Shows which commit last changed each line of a file
+	 *
+	 * Blame is computed by a background job walking parents from the commit back; lines of a merge are passed
+	 * to every parent they came from, as git does. Hunks arrive mostly newest first and are painted as they
+	 * come. Commits which didn't touch the file are skipped by changed-path filters, so the result depends
+	 * only on the file, and the commit which changed it last.
+	 * Complete results are cached by this pair and reused for neighbouring commits which didn't touch the file.
+	 */
+	class CBlameView : public QAbstractScrollArea
+	{
+		Q_OBJECT
+
+		/// Blamed text and its hunks
+		struct CBlameResult
+		{
+			QByteArray m_text;
+			CBlameHunkList m_hunks;
+		};
+
+		typedef QPair<QString, CGitOid> CBlameKey;
+
+		QString m_repo_path;
+
+		/// Shown file and commit
+		QString m_path;
+		CGitOid m_commit;
+
+		/// Commit which last changed the shown file
+		CGitOid m_last_change;
+
+		CBlameResult m_result;
+		QVector<int> m_line_offsets;
+
+		/// Hunk of each line or -1 if the line is not blamed yet
+		QVector<int> m_line_hunks;
+
+		/// Complete results by file and the commit which last changed it
+		QCache<CBlameKey, CBlameResult> m_cache;
+
+		/// Commit which last changed the file, by file and blamed commit
+		QHash<CBlameKey, CGitOid> m_last_changes;
+
+		CBackgroundJobPtr m_job;
+		int m_generation;
+		bool m_loading;
+		QString m_error;
+
+		int lineHeight () const;
+		int gutterWidth () const;
+
+		void setResult (const CBlameResult& _result);
+		void addHunks (const CBlameHunkList& _hunks);
+		void updateScrollBars ();
+		void cancelJob ();
+
+	private slots:
+		/// Job found the commit which changed the file last and read its text
+		void startBlame (int _generation, const CGitOid& _last_change, const QByteArray& _text);
+		void addBlameHunks (int _generation, const CBlameHunkList& _hunks);
+		void finishBlame (int _generation, const QString& _error);
+
+	protected:
+		void paintEvent (QPaintEvent* _event);
+		void resizeEvent (QResizeEvent* _event);
+		void scrollContentsBy (int _dx, int _dy);
+
+	public:
+		/// Limit of cached text in kilobytes
+		enum { CACHE_LIMIT_KB = 64 * 1024 };
+
+		/// Longer lines are cut when painted
+		enum { MAX_PAINTED_LINE = 4096 };
+
+		explicit CBlameView (QWidget* _parent = NULL);
+		~CBlameView ();
+
+		/// Forget cached results and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Show blame of the file (path relative to repository root) at the commit
+		void showBlame (const QString& _path, const CGitOid& _commit);
+
+		QString path () const;
+	};
+}
+
+Q_DECLARE_METATYPE (QGitRepoViewer::CBlameHunkList)
+
+#endif // __QGITREPOVIEWER_CBLAMEVIEW_H
@@ -0,0 +1,399 @@
+/**
+ * @file
+ * @brief Chunked reader of blob contents implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CBlobReader.h"
+
+#include <QFile>
+
+#include <string.h>
+#include <limits.h>
+#include <zlib.h>
+#include <git2.h>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+using namespace QGitRepoViewer;
+
+/// Pack object type of blob
+#define PACK_OBJ_BLOB 3
+
+/// Loose object header "blob <decimal size>\0" is not longer
+#define MAX_LOOSE_HEADER 32
+
+namespace
+{
+	/// Control characters which are usual in text: backspace, tab, line feed, form feed, carriage return and escape
+	inline bool isTextControl (uchar _c)
+	{
+		return (_c == 8) || (_c == 9) || (_c == 10) || (_c == 12) || (_c == 13) || (_c == 27);
+	}
+
+	inline int bitCount (uint _bits)
+	{
+		_bits = _bits - ((_bits >> 1) & 0x55555555);
+		_bits = (_bits & 0x33333333) + ((_bits >> 2) & 0x33333333);
+		return int ((((_bits + (_bits >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+	}
+}
+
+CBlobReader::CBlobReader ():
+	m_repo (NULL),
+	m_zstream (new z_stream),
+	m_loose_file (NULL),
+	m_inflating (false),
+	m_blob (NULL),
+	m_size (0),
+	m_read (0)
+{
+	memset (m_zstream, 0, sizeof (z_stream));
+	if (inflateInit (m_zstream) != Z_OK)
+	{
+		delete m_zstream;
+		m_zstream = NULL;
+	}
+}
+
+CBlobReader::~CBlobReader ()
+{
+	closeBlob ();
+
+	if (m_zstream)
+	{
+		inflateEnd (m_zstream);
+		delete m_zstream;
+	}
+}
+
+bool
+CBlobReader::open (CGitRepository* _repo)
+{
+	closeBlob ();
+	m_repo = _repo;
+	if (! m_repo || !m_repo->isOpened ())
+	{
+		m_last_error = m_repo ? m_repo->lastError () : QString ();
+		return false;
+	}
+
+	m_objects_dir = QFile::decodeName (git_repository_path (m_repo->handle ())) + "objects";
+	m_packs.open (m_objects_dir);
+	return true;
+}
+
+void
+CBlobReader::closeBlob ()
+{
+	// Deleting file unmaps it
+	delete m_loose_file;
+	m_loose_file = NULL;
+	m_inflating = false;
+
+	git_blob_free (m_blob);
+	m_blob = NULL;
+
+	m_size = 0;
+	m_read = 0;
+}
+
+bool
+CBlobReader::openBlob (const CGitOid& _id)
+{
+	closeBlob ();
+	m_last_error.clear ();
+	if (! m_repo || !m_zstream)
+		return false;
+
+	//
+	// Most blobs are packed whole or loose: both are inflated as the caller reads
+	//
+	if (openPacked (_id) || openLoose (_id))
+		return true;
+
+	return openDeltified (_id);
+}
+
+bool
+CBlobReader::openPacked (const CGitOid& _id)
+{
+	int type = 0;
+	quint64 size = 0;
+	const uchar* data = NULL;
+	qint64 available = 0;
+	if (! m_packs.locateObject (_id, type, size, data, available) || (type != PACK_OBJ_BLOB))
+		return false;
+
+	inflateReset (m_zstream);
+	m_zstream->next_in = const_cast<uchar*> (data);
+	m_zstream->avail_in = uInt (qMin (quint64 (available), quint64 (UINT_MAX)));
+	m_size = qint64 (size);
+	m_inflating = true;
+	return true;
+}
+
+bool
+CBlobReader::openLoose (const CGitOid& _id)
+{
+	const QString hex = _id.toString ();
+	m_loose_file = new QFile (m_objects_dir + "/" + hex.left (2) + "/" + hex.mid (2));
+
+	const uchar* data = NULL;
+	if (m_loose_file->open (QIODevice::ReadOnly) && (m_loose_file->size () > 0))
+		data = m_loose_file->map (0, m_loose_file->size ());
+	if (! data)
+	{
+		delete m_loose_file;
+		m_loose_file = NULL;
+		return false;
+	}
+
+	inflateReset (m_zstream);
+	m_zstream->next_in = const_cast<uchar*> (data);
+	m_zstream->avail_in = uInt (qMin (m_loose_file->size (), qint64 (UINT_MAX)));
+
+	//
+	// Inflate the header byte by byte, so no byte of contents is consumed with it
+	//
+	char header [MAX_LOOSE_HEADER];
+	int header_size = 0;
+	while (header_size < MAX_LOOSE_HEADER)
+	{
+		m_zstream->next_out = reinterpret_cast<Bytef*> (header + header_size);
+		m_zstream->avail_out = 1;
+		if ((::inflate (m_zstream, Z_NO_FLUSH) != Z_OK) || (m_zstream->avail_out != 0))
+			break;
+
+		if (header [header_size++] == '\0')
+			break;
+	}
+
+	if ((header_size < 6) || (header [header_size - 1] != '\0') || (memcmp (header, "blob ", 5) != 0))
+	{
+		closeBlob ();
+		return false;
+	}
+
+	bool ok = false;
+	m_size = QByteArray (header + 5, header_size - 6).toLongLong (&ok);
+	if (! ok)
+	{
+		closeBlob ();
+		return false;
+	}
+
+	m_inflating = true;
+	return true;
+}
+
+bool
+CBlobReader::openDeltified (const CGitOid& _id)
+{
+	//
+	// Delta is applied to the whole base object: only blobs of reasonable size are restored
+	//
+	git_odb* odb = NULL;
+	size_t size = 0;
+	git_otype type = GIT_OBJ_BAD;
+	int error_code = git_repository_odb (& odb, m_repo->handle ());
+	if (error_code == GIT_OK)
+		error_code = git_odb_read_header (& size, & type, odb, _id.raw ());
+	git_odb_free (odb);
+
+	if (error_code != GIT_OK)
+	{
+		m_last_error = gitErrorString (error_code, QObject::tr ("reading blob %1").arg (_id.toString ()));
+		return false;
+	}
+
+	if (type != GIT_OBJ_BLOB)
+	{
+		m_last_error = QObject::tr ("Object %1 is not a blob").arg (_id.toString ());
+		return false;
+	}
+
+	if (size > size_t (MAX_DELTA_BLOB_SIZE))
+	{
+		m_last_error = QObject::tr ("Blob %1 of %2 bytes is stored as delta and is too big to be restored")
+					   .arg (_id.toString ()).arg (qint64 (size));
+		return false;
+	}
+
+	error_code = git_blob_lookup (& m_blob, m_repo->handle (), _id.raw ());
+	if (error_code != GIT_OK)
+	{
+		m_last_error = gitErrorString (error_code, QObject::tr ("reading blob %1").arg (_id.toString ()));
+		return false;
+	}
+
+	m_size = qint64 (git_blob_rawsize (m_blob));
+	return true;
+}
+
+qint64
+CBlobReader::size () const
+{
+	return m_size;
+}
+
+int
+CBlobReader::inflate (char* _buffer, int _max_size)
+{
+	m_zstream->next_out = reinterpret_cast<Bytef*> (_buffer);
+	m_zstream->avail_out = uInt (_max_size);
+
+	const int result = ::inflate (m_zstream, Z_NO_FLUSH);
+	const int count = _max_size - int (m_zstream->avail_out);
+	if (((result != Z_OK) && (result != Z_STREAM_END)) || ((count == 0) && (result != Z_STREAM_END)))
+	{
+		m_last_error = QObject::tr ("Blob data is corrupted");
+		return -1;
+	}
+
+	return count;
+}
+
+int
+CBlobReader::read (char* _buffer, int _max_size)
+{
+	const int wanted = int (qMin (qint64 (_max_size), m_size - m_read));
+	if (wanted <= 0)
+		return 0;
+
+	int count = 0;
+	if (m_blob)
+	{
+		memcpy (_buffer, static_cast<const char*> (git_blob_rawcontent (m_blob)) + m_read, size_t (wanted));
+		count = wanted;
+	}
+	else if (m_inflating)
+	{
+		count = inflate (_buffer, wanted);
+	}
+	else
+	{
+		return -1;
+	}
+
+	if (count > 0)
+		m_read += count;
+
+	return count;
+}
+
+QString
+CBlobReader::lastError () const
+{
+	return m_last_error;
+}
+
+bool
+CBlobReader::isBinary (const char* _data, int _size)
+{
+	int control = 0;
+	int i = 0;
+
+#ifdef __SSE2__
+	//
+	// 16 bytes at once: any NUL means binary, other control bytes are counted by masks
+	//
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i max_control = _mm_set1_epi8 (0x1f);
+	const __m128i escape = _mm_set1_epi8 (27);
+	const __m128i backspace = _mm_set1_epi8 (8);
+	const __m128i tab = _mm_set1_epi8 (9);
+	const __m128i line_feed = _mm_set1_epi8 (10);
+	const __m128i form_feed = _mm_set1_epi8 (12);
+	const __m128i carriage_return = _mm_set1_epi8 (13);
+	for (; i + 16 <= _size; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (_data + i));
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, zero)))
+			return true;
+
+		const __m128i is_control = _mm_cmpeq_epi8 (_mm_min_epu8 (bytes, max_control), bytes);
+		const __m128i is_text = _mm_or_si128 (_mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (bytes, escape),
+																			  _mm_cmpeq_epi8 (bytes, backspace)),
+															 _mm_or_si128 (_mm_cmpeq_epi8 (bytes, tab),
+																		   _mm_cmpeq_epi8 (bytes, line_feed))),
+											  _mm_or_si128 (_mm_cmpeq_epi8 (bytes, form_feed),
+															_mm_cmpeq_epi8 (bytes, carriage_return)));
+		control += bitCount (uint (_mm_movemask_epi8 (_mm_andnot_si128 (is_text, is_control))));
+	}
+#endif
+
+	for (; i < _size; ++i)
+	{
+		const uchar c = uchar (_data [i]);
+		if (c == 0)
+			return true;
+
+		if ((c < 0x20) && !isTextControl (c))
+			++control;
+	}
+
+	return (control > (_size - control) / 128);
+}
+
+const char*
+CBlobReader::findLiteral (const char* _data, int _size, const QByteArray& _literal)
+{
+	const int length = _literal.size ();
+	if (length == 0)
+		return _data;
+	if (length > _size)
+		return NULL;
+
+	const char* literal = _literal.constData ();
+	if (length == 1)
+		return static_cast<const char*> (memchr (_data, literal [0], size_t (_size)));
+
+	int i = 0;
+
+#ifdef __SSE2__
+	//
+	// Positions where both the first and the last bytes of literal match, 16 at once; only those are compared
+	//
+	const __m128i first = _mm_set1_epi8 (literal [0]);
+	const __m128i last = _mm_set1_epi8 (literal [length - 1]);
+	for (; i + length - 1 + 16 <= _size; i += 16)
+	{
+		const __m128i block_first = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (_data + i));
+		const __m128i block_last = _mm_loadu_si128 (reinterpret_cast<const __m128i*> (_data + i + length - 1));
+		uint mask = uint (_mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (first, block_first),
+														   _mm_cmpeq_epi8 (last, block_last))));
+		for (int bit = 0; mask; ++bit, mask >>= 1)
+			if ((mask & 1) && (memcmp (_data + i + bit + 1, literal + 1, size_t (length - 2)) == 0))
+				return _data + i + bit;
+	}
+#endif
+
+	for (const char* end = _data + _size - length + 1; _data + i < end; ++i)
+	{
+		const char* p = static_cast<const char*> (memchr (_data + i, literal [0], size_t (end - _data - i)));
+		if (! p)
+			return NULL;
+
+		i = int (p - _data);
+		if (memcmp (p + 1, literal + 1, size_t (length - 1)) == 0)
+			return p;
+	}
+
+	return NULL;
+}
+
+int
+CBlobReader::countLiteral (const char* _data, int _size, const QByteArray& _literal)
+{
+	if (_literal.isEmpty ())
+		return 0;
+
+	int count = 0;
+	const char* end = _data + _size;
+	for (const char* p = _data; (p = findLiteral (p, int (end - p), _literal)); p += _literal.size ())
+		++count;
+
+	return count;
+}
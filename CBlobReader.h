@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Chunked reader of blob contents interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CBLOBREADER_H
+#define __QGITREPOVIEWER_CBLOBREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "GitHelpers.h"
+#include "CPackCommitReader.h"
+
+class QFile;
+struct z_stream_s;
+struct git_blob;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Reads blob contents chunk by chunk without inflating the whole object
+	 *
+	 * Loose objects and not deltified packed blobs are memory-mapped and inflated into the caller's buffer
+	 * as it asks for more, so memory doesn't depend on blob size. Deltified blobs can only be restored
+	 * as a whole: libgit2 reads them if they are not bigger than MAX_DELTA_BLOB_SIZE.
+	 *
+	 * An instance must be used by one thread at a time.
+	 */
+	class CBlobReader
+	{
+		CGitRepository* m_repo;
+		QString m_objects_dir;
+		CPackCommitReader m_packs;
+
+		z_stream_s* m_zstream;
+
+		/// Mapped loose object file
+		QFile* m_loose_file;
+
+		/// Blob is inflated from mapped loose object or pack
+		bool m_inflating;
+
+		/// Deltified blob read by libgit2
+		git_blob* m_blob;
+
+		qint64 m_size;
+		qint64 m_read;
+		QString m_last_error;
+
+		bool openLoose (const CGitOid& _id);
+		bool openPacked (const CGitOid& _id);
+		bool openDeltified (const CGitOid& _id);
+
+		/// Inflate up to _max_size bytes
+		int inflate (char* _buffer, int _max_size);
+
+	public:
+		/// Bigger deltified blobs are not read
+		enum { MAX_DELTA_BLOB_SIZE = 64 * 1024 * 1024 };
+
+		CBlobReader ();
+		~CBlobReader ();
+
+		/// Use objects of the repository (which must outlive the reader)
+		bool open (CGitRepository* _repo);
+
+		/// Start reading the blob
+		bool openBlob (const CGitOid& _id);
+		void closeBlob ();
+
+		/// Size of the opened blob
+		qint64 size () const;
+
+		/// Read next bytes of the blob: count of read bytes, 0 at the end, -1 on error
+		int read (char* _buffer, int _max_size);
+
+		QString lastError () const;
+
+		/// Whether data looks binary: has NUL bytes or too many control ones (the heuristic of git)
+		static bool isBinary (const char* _data, int _size);
+
+		/// First occurrence of the literal in data, NULL if there is none
+		static const char* findLiteral (const char* _data, int _size, const QByteArray& _literal);
+
+		/// Count of not overlapping occurrences of the literal in data
+		static int countLiteral (const char* _data, int _size, const QByteArray& _literal);
+
+	private:
+		Q_DISABLE_COPY (CBlobReader)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CBLOBREADER_H
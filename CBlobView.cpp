@@ -0,0 +1,494 @@
+/**
+ * @file
+ * @brief Virtualized preview of file contents at a commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CBlobView.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <string.h>
+#include <limits.h>
+
+#include "CBlobReader.h"
+
+using namespace QGitRepoViewer;
+
+namespace
+{
+	/**
+	 * @brief Reads a blob chunk by chunk into a file on worker pool
+	 *
+	 * Every step inflates about CHUNK_SIZE bytes; whole lines are written and announced to the view, the tail
+	 * is kept for the next chunk. Lines longer than a chunk are broken, so memory is bounded by the chunk size.
+	 */
+	class CBlobJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		CGitOid m_blob;
+		QString m_file_path;
+		QObject* m_receiver;
+		int m_generation;
+
+		CBlobReader m_reader;
+		QFile* m_file;
+		bool m_started;
+
+		/// Read bytes not written yet (the tail of the last line)
+		QByteArray m_buffer;
+		qint64 m_written;
+
+		/// Write whole lines of the buffer (all of it at the end of blob) and announce them
+		bool flushLines (bool _last);
+
+		/// Open the blob and check its first chunk; false if nothing more is to be read
+		bool start (QString& _error);
+
+	protected:
+		bool step ();
+
+	public:
+		/// Size of blob chunk read at once
+		enum { CHUNK_SIZE = 64 * 1024 };
+
+		CBlobJob (const QString& _repo_path, const CGitOid& _blob, const QString& _file_path,
+				  QObject* _receiver, int _generation);
+		~CBlobJob ();
+	};
+}
+
+CBlobJob::CBlobJob (const QString& _repo_path, const CGitOid& _blob, const QString& _file_path,
+					QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_blob (_blob),
+	m_file_path (_file_path),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_file (NULL),
+	m_started (false),
+	m_written (0)
+{}
+
+CBlobJob::~CBlobJob ()
+{
+	delete m_file;
+}
+
+bool
+CBlobJob::flushLines (bool _last)
+{
+	int size = m_buffer.size ();
+	if (! _last)
+	{
+		size = m_buffer.lastIndexOf ('\n') + 1;
+
+		// Line longer than a chunk is broken
+		if ((size == 0) && (m_buffer.size () >= CHUNK_SIZE))
+		{
+			m_buffer.append ('\n');
+			size = m_buffer.size ();
+		}
+	}
+	else if (! m_buffer.isEmpty () && !m_buffer.endsWith ('\n'))
+	{
+		m_buffer.append ('\n');
+		size = m_buffer.size ();
+	}
+
+	if (size == 0)
+		return true;
+
+	//
+	// Count lines and the longest one
+	//
+	int line_count = 0;
+	int max_width = 0;
+	const char* data = m_buffer.constData ();
+	for (const char* line = data; line < data + size; )
+	{
+		const char* line_end = static_cast<const char*> (memchr (line, '\n', size_t (data + size - line)));
+		max_width = qMax (max_width, int (line_end - line));
+		++line_count;
+		line = line_end + 1;
+	}
+
+	// The view reads the chunk by its own handle as soon as it is announced
+	if ((m_file->write (data, size) != size) || !m_file->flush ())
+		return false;
+
+	post (m_receiver, "addBlobChunk", Q_ARG (int, m_generation), Q_ARG (qint64, m_written),
+		  Q_ARG (int, size), Q_ARG (int, line_count), Q_ARG (int, max_width));
+
+	m_written += size;
+	m_buffer.remove (0, size);
+	return true;
+}
+
+bool
+CBlobJob::start (QString& _error)
+{
+	m_file = new QFile (m_file_path);
+	if (! m_file->open (QIODevice::WriteOnly | QIODevice::Append))
+	{
+		_error = m_file->errorString ();
+		return false;
+	}
+
+	if (! m_reader.open (CGitRepository::threadRepository (m_repo_path)) || !m_reader.openBlob (m_blob))
+	{
+		_error = m_reader.lastError ();
+		return false;
+	}
+
+	//
+	// Binary blob (even of gigabytes) costs one chunk
+	//
+	m_buffer.resize (int (qMin (qint64 (CHUNK_SIZE), m_reader.size ())));
+	int size = 0;
+	while (size < m_buffer.size ())
+	{
+		const int count = m_reader.read (m_buffer.data () + size, m_buffer.size () - size);
+		if (count <= 0)
+			break;
+		size += count;
+	}
+	if (size < m_buffer.size ())
+	{
+		_error = m_reader.lastError ();
+		return false;
+	}
+
+	const bool binary = CBlobReader::isBinary (m_buffer.constData (), m_buffer.size ());
+	post (m_receiver, "startBlob", Q_ARG (int, m_generation), Q_ARG (qint64, m_reader.size ()), Q_ARG (bool, binary));
+	if (binary)
+		m_buffer.clear ();
+
+	return !binary;
+}
+
+bool
+CBlobJob::step ()
+{
+	// View removes the file of cancelled job: don't create it again
+	if (isCancelled ())
+	{
+		if (m_file)
+			m_file->remove ();
+		return false;
+	}
+
+	QString error;
+	bool more = true;
+	if (! m_started)
+	{
+		m_started = true;
+		more = start (error);
+	}
+	else
+	{
+		const int size = m_buffer.size ();
+		m_buffer.resize (size + CHUNK_SIZE);
+		const int count = m_reader.read (m_buffer.data () + size, CHUNK_SIZE);
+		m_buffer.resize (size + qMax (0, count));
+		if (count < 0)
+			error = m_reader.lastError ();
+		more = (count > 0);
+	}
+
+	if (more)
+	{
+		if (flushLines (false))
+			return true;
+
+		error = m_file->errorString ();
+	}
+	else if (error.isEmpty () && m_file && m_file->isOpen () && !flushLines (true))
+	{
+		error = m_file->errorString ();
+	}
+
+	post (m_receiver, "finishBlob", Q_ARG (int, m_generation), Q_ARG (QString, error));
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CBlobView::CBlobView (QWidget* _parent):
+	QAbstractScrollArea (_parent),
+	m_file (NULL),
+	m_chunk_cache (CACHED_CHUNKS),
+	m_line_count (0),
+	m_max_width (0),
+	m_size (0),
+	m_binary (false),
+	m_generation (0),
+	m_loading (false)
+{
+	qRegisterMetaType<qint64> ("qint64");
+
+	QFont font ("Monospace");
+	font.setStyleHint (QFont::TypeWriter);
+	setFont (font);
+
+	verticalScrollBar ()->setSingleStep (1);
+	updateScrollBars ();
+}
+
+CBlobView::~CBlobView ()
+{
+	cancelJob ();
+	delete m_file;
+}
+
+void
+CBlobView::cancelJob ()
+{
+	if (m_job)
+	{
+		m_job->cancel ();
+		m_job.clear ();
+	}
+	++m_generation;
+	m_loading = false;
+}
+
+void
+CBlobView::setGitRepo (const QString& _repo_path)
+{
+	m_repo_path = _repo_path;
+	clearBlob ();
+}
+
+void
+CBlobView::clearBlob ()
+{
+	cancelJob ();
+
+	// Running job writes by its own handle; the temporary file is removed with the last handle on POSIX
+	delete m_file;
+	m_file = NULL;
+
+	m_blob = CGitOid ();
+	m_chunks.clear ();
+	m_chunk_cache.clear ();
+	m_line_count = 0;
+	m_max_width = 0;
+	m_size = 0;
+	m_binary = false;
+	m_error.clear ();
+
+	verticalScrollBar ()->setValue (0);
+	horizontalScrollBar ()->setValue (0);
+	updateScrollBars ();
+	viewport ()->update ();
+}
+
+void
+CBlobView::showBlob (const CGitOid& _blob)
+{
+	if ((_blob == m_blob) && !_blob.isNull ())
+		return;
+
+	clearBlob ();
+	if (m_repo_path.isEmpty () || _blob.isNull ())
+		return;
+
+	m_file = new QTemporaryFile (this);
+	if (! m_file->open ())
+	{
+		delete m_file;
+		m_file = NULL;
+		return;
+	}
+
+	m_blob = _blob;
+	m_loading = true;
+	m_job = CBackgroundJobPtr (new CBlobJob (m_repo_path, _blob, m_file->fileName (), this, m_generation));
+	m_job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+	CWorkerPool::instance ()->start (m_job);
+}
+
+void
+CBlobView::startBlob (int _generation, qint64 _size, bool _binary)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_size = _size;
+	m_binary = _binary;
+	viewport ()->update ();
+}
+
+void
+CBlobView::addBlobChunk (int _generation, qint64 _offset, int _size, int _line_count, int _max_width)
+{
+	if (_generation != m_generation)
+		return;
+
+	CChunkInfo chunk;
+	chunk.m_offset = _offset;
+	chunk.m_size = _size;
+	chunk.m_first_line = m_line_count;
+	chunk.m_line_count = _line_count;
+	m_chunks.append (chunk);
+
+	m_line_count += _line_count;
+	m_max_width = qMax (m_max_width, qMin (_max_width, int (MAX_PAINTED_LINE)));
+	updateScrollBars ();
+
+	// Only repaint if the new lines are visible
+	if (chunk.m_first_line <= verticalScrollBar ()->value () + viewport ()->height () / lineHeight ())
+		viewport ()->update ();
+}
+
+void
+CBlobView::finishBlob (int _generation, const QString& _error)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_job.clear ();
+	m_loading = false;
+	m_error = _error;
+	viewport ()->update ();
+}
+
+int
+CBlobView::lineHeight () const
+{
+	return qMax (1, fontMetrics ().lineSpacing ());
+}
+
+void
+CBlobView::updateScrollBars ()
+{
+	const int page = qMax (1, viewport ()->height () / lineHeight ());
+	verticalScrollBar ()->setPageStep (page);
+	verticalScrollBar ()->setRange (0, qMax (0, m_line_count - page));
+
+	const int width = m_max_width * fontMetrics ().width (QLatin1Char ('m'));
+	horizontalScrollBar ()->setPageStep (viewport ()->width ());
+	horizontalScrollBar ()->setSingleStep (fontMetrics ().width (QLatin1Char ('m')) * 4);
+	horizontalScrollBar ()->setRange (0, qMax (0, width - viewport ()->width ()));
+}
+
+int
+CBlobView::chunkOfLine (int _line) const
+{
+	int low = 0;
+	int high = m_chunks.size ();
+	while (low < high)
+	{
+		const int middle = low + (high - low) / 2;
+		if (m_chunks [middle].m_first_line + m_chunks [middle].m_line_count <= _line)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return (low < m_chunks.size ()) ? low : -1;
+}
+
+const CBlobView::CChunkText*
+CBlobView::chunkText (int _chunk) const
+{
+	CChunkText* text = m_chunk_cache.object (_chunk);
+	if (text)
+		return text;
+
+	const CChunkInfo& chunk = m_chunks [_chunk];
+	if (! m_file || !m_file->seek (chunk.m_offset))
+		return NULL;
+
+	text = new CChunkText;
+	text->m_text = m_file->read (chunk.m_size);
+	if (text->m_text.size () != chunk.m_size)
+	{
+		delete text;
+		return NULL;
+	}
+
+	text->m_line_offsets.reserve (chunk.m_line_count + 1);
+	text->m_line_offsets.append (0);
+	const char* data = text->m_text.constData ();
+	for (int i = 0; i < chunk.m_size; ++i)
+		if (data [i] == '\n')
+			text->m_line_offsets.append (i + 1);
+
+	m_chunk_cache.insert (_chunk, text);
+	return text;
+}
+
+void
+CBlobView::paintEvent (QPaintEvent* _event)
+{
+	QPainter painter (viewport ());
+	const QRect area = _event->rect ();
+	const int height = lineHeight ();
+	const int first = verticalScrollBar ()->value ();
+	const int top = first + qMax (0, area.top ()) / height;
+	const int bottom = qMin (m_line_count - 1, first + area.bottom () / height);
+	const int x = 2 - horizontalScrollBar ()->value ();
+
+	if (m_line_count == 0)
+	{
+		QString text;
+		if (! m_error.isEmpty ())
+			text = m_error;
+		else if (m_binary)
+			text = tr ("Binary file, %n byte(s)", "", int (qMin (m_size, qint64 (INT_MAX))));
+		else if (m_loading)
+			text = tr ("Loading file...");
+		else if (! m_blob.isNull ())
+			text = tr ("Empty file");
+
+		painter.setPen (palette ().color (QPalette::Disabled, QPalette::Text));
+		painter.drawText (viewport ()->rect (), Qt::AlignCenter | Qt::TextWordWrap, text);
+		return;
+	}
+
+	//
+	// Only visible lines are read back and painted
+	//
+	painter.setPen (palette ().color (QPalette::Text));
+	int chunk_index = chunkOfLine (top);
+	for (int line = top; (line <= bottom) && (chunk_index >= 0) && (chunk_index < m_chunks.size ()); ++chunk_index)
+	{
+		const CChunkInfo& chunk = m_chunks [chunk_index];
+		const CChunkText* text = chunkText (chunk_index);
+		const int chunk_end = qMin (bottom + 1, chunk.m_first_line + chunk.m_line_count);
+		for (; line < chunk_end; ++line)
+		{
+			if (! text)
+				continue;
+
+			const int in_chunk = line - chunk.m_first_line;
+			const int begin = text->m_line_offsets [in_chunk];
+			const int end = text->m_line_offsets [in_chunk + 1] - 1;
+			const QRect rect (x, (line - first) * height, viewport ()->width () - x, height);
+			painter.drawText (rect, Qt::AlignLeft | Qt::AlignVCenter | Qt::TextExpandTabs,
+							  QString::fromUtf8 (text->m_text.constData () + begin, qMin (end - begin, int (MAX_PAINTED_LINE))));
+		}
+	}
+}
+
+void
+CBlobView::resizeEvent (QResizeEvent* _event)
+{
+	QAbstractScrollArea::resizeEvent (_event);
+	updateScrollBars ();
+}
+
+void
+CBlobView::scrollContentsBy (int _dx, int _dy)
+{
+	Q_UNUSED (_dx);
+	Q_UNUSED (_dy);
+
+	// Vertical scroll bar counts lines, not pixels
+	viewport ()->update ();
+}
@@ -0,0 +1,106 @@
+/**
+ * @file
+ * @brief Virtualized preview of file contents at a commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CBLOBVIEW_H
+#define __QGITREPOVIEWER_CBLOBVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+class QTemporaryFile;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Shows contents of a blob while it is being read
+	 *
+	 * The blob is inflated chunk by chunk on worker pool; the first chunk decides whether it is binary,
+	 * and binary blobs are not read further. Text is split into chunks of whole lines written to a temporary
+	 * file; only their offsets are kept in memory and chunks intersecting the viewport are read back for painting.
+	 */
+	class CBlobView : public QAbstractScrollArea
+	{
+		Q_OBJECT
+
+		/// Chunk of the text file
+		struct CChunkInfo
+		{
+			qint64 m_offset;
+			int m_size;
+			int m_first_line;
+			int m_line_count;
+		};
+
+		/// Chunk read back for painting: its text and the offsets of its lines
+		struct CChunkText
+		{
+			QByteArray m_text;
+			QVector<int> m_line_offsets;
+		};
+
+		QString m_repo_path;
+		CGitOid m_blob;
+
+		QTemporaryFile* m_file;
+		QVector<CChunkInfo> m_chunks;
+		mutable QCache<int, CChunkText> m_chunk_cache;
+		int m_line_count;
+		int m_max_width;
+
+		/// Size of the blob and whether it is binary, known when its first chunk is read
+		qint64 m_size;
+		bool m_binary;
+
+		CBackgroundJobPtr m_job;
+		int m_generation;
+		bool m_loading;
+		QString m_error;
+
+		int lineHeight () const;
+
+		/// Text of the chunk, read from the file if not cached
+		const CChunkText* chunkText (int _chunk) const;
+
+		/// Index of the chunk containing specified line
+		int chunkOfLine (int _line) const;
+
+		void updateScrollBars ();
+		void cancelJob ();
+
+	private slots:
+		void startBlob (int _generation, qint64 _size, bool _binary);
+		void addBlobChunk (int _generation, qint64 _offset, int _size, int _line_count, int _max_width);
+		void finishBlob (int _generation, const QString& _error);
+
+	protected:
+		void paintEvent (QPaintEvent* _event);
+		void resizeEvent (QResizeEvent* _event);
+		void scrollContentsBy (int _dx, int _dy);
+
+	public:
+		/// Count of chunks kept read for painting
+		enum { CACHED_CHUNKS = 16 };
+
+		/// Longer lines are cut when painted
+		enum { MAX_PAINTED_LINE = 4096 };
+
+		explicit CBlobView (QWidget* _parent = NULL);
+		~CBlobView ();
+
+		/// Forget the shown blob and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Start showing contents of the blob
+		void showBlob (const CGitOid& _blob);
+
+		void clearBlob ();
+	};
+}
+
+#endif // __QGITREPOVIEWER_CBLOBVIEW_H
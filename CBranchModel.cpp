@@ -12,62 +12,546 @@
 #include <QFile>
 #include <QTranslator>
 #include <QDateTime>
-#include <QMessageBox>
 #include <QIcon>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QSet>
+
+#include <algorithm>
+
+#include <git2.h>
 
 #include "GitHelpers.h"
+#include "CDiagnostics.h"
+#include "CPackCommitReader.h"
+#include "CCompareWalker.h"
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 using namespace QGitRepoViewer;
 
+namespace
+{
+	/// Enumerate repository branches on worker pool
+	class CBranchLoadJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		QObject* m_receiver;
+		int m_generation;
+
+	protected:
+		bool step ()
+		{
+			CGitRepository repo;
+			CGitBranchList branches;
+			QString error;
+
+			//
+			// Search git repository (".git" directory) in m_repo_path and recursively in its parent directories
+			//
+			if (repo.open (m_repo_path, true))
+			{
+				//
+				// Obtain the list of local git repository branches
+				//
+				// FIXME: allow remote branches to working correctly too
+				branches = repo.enumBranches (/*false*/);
+			}
+			error = repo.lastError ();
+
+			post (m_receiver, "setBranches", Q_ARG (int, m_generation), Q_ARG (CGitBranchList, branches),
+				  Q_ARG (QString, error));
+			return false;
+		}
+
+	public:
+		CBranchLoadJob (const QString& _repo_path, QObject* _receiver, int _generation):
+			m_repo_path (_repo_path), m_receiver (_receiver), m_generation (_generation)
+		{}
+	};
+
+	/// Tips shared by all CBranchTipJob-s of one branch list load
+	struct CBranchTipQueue
+	{
+		QString m_repo_path;
+
+		/// Tips which details are not cached and their next not taken index
+		CGitOidVector m_info_tips;
+		QAtomicInt m_next_info;
+
+		/// Tips compared with the tip of HEAD branch and their next not taken index
+		CGitOidVector m_count_tips;
+		CGitOid m_head_tip;
+		QAtomicInt m_next_count;
+	};
+
+	/**
+	 * @brief One of the jobs reading tip commits of branches
+	 *
+	 * Jobs take batches of tips from the shared queue: details of all tips first, as they fill the list,
+	 * then counts of commits ahead and behind HEAD branch, which walk history.
+	 */
+	class CBranchTipJob : public CBackgroundJob
+	{
+		QSharedPointer<CBranchTipQueue> m_queue;
+		QObject* m_receiver;
+		int m_generation;
+
+		CPackCommitReader m_reader;
+		bool m_reader_opened;
+
+		/// Commits of the walk are not needed, only their counts
+		enum { WALK_BATCH_SIZE = 4096 };
+
+		bool readTip (git_repository* _repo, const CGitOid& _tip, CBranchTipInfo& _info)
+		{
+			_info.m_tip = _tip;
+
+			CCommitHeader header;
+			QString author;
+			if (m_reader.readHeader (_tip, header))
+			{
+				_info.m_time = header.m_time;
+				_info.m_summary = header.m_summary;
+				author = header.m_author;
+			}
+			else
+			{
+				git_commit* commit = NULL;
+				if (git_commit_lookup (& commit, _repo, _tip.raw ()) != GIT_OK)
+					return false;
+
+				_info.m_time = uint (git_commit_time (commit));
+				_info.m_summary = QString::fromUtf8 (git_commit_message (commit)).section ('\n', 0, 0);
+				const git_signature* signature = git_commit_author (commit);
+				if (signature)
+					author = QString::fromUtf8 (signature->name);
+				git_commit_free (commit);
+			}
+
+			// Email makes the column too wide
+			_info.m_author = author.section (" <", 0, 0);
+			return true;
+		}
+
+		void readInfos (git_repository* _repo, int _first)
+		{
+			const int last = qMin (_first + int (CBranchListModel::INFO_BATCH_SIZE), m_queue->m_info_tips.size ());
+			CBranchTipInfoVector infos;
+			for (int i = _first; (i < last) && !isCancelled (); ++i)
+			{
+				CBranchTipInfo info;
+				if (readTip (_repo, m_queue->m_info_tips [i], info))
+					infos.append (info);
+			}
+
+			post (m_receiver, "addTipInfos", Q_ARG (int, m_generation), Q_ARG (CBranchTipInfoVector, infos));
+		}
+
+		void countAheadBehind (git_repository* _repo, int _first)
+		{
+			const int last = qMin (_first + int (CBranchListModel::COUNT_BATCH_SIZE), m_queue->m_count_tips.size ());
+			CGitOidVector tips;
+			QVector<int> ahead;
+			QVector<int> behind;
+			for (int i = _first; (i < last) && !isCancelled (); ++i)
+			{
+				//
+				// Pairs of tips compared before (by this list or by branch comparison) are not walked again
+				//
+				const CGitOid& tip = m_queue->m_count_tips [i];
+				CMergeBase merge_base;
+				if (! CMergeBaseCache::instance ()->find (tip, m_queue->m_head_tip, merge_base))
+				{
+					CCompareWalker walker (_repo, & m_reader);
+					walker.start (tip, m_queue->m_head_tip);
+
+					CGitOidVector commits;
+					QVector<int> sides;
+					while (! walker.atEnd () && !isCancelled ())
+					{
+						commits.clear ();
+						sides.clear ();
+						walker.next (commits, sides, WALK_BATCH_SIZE);
+					}
+
+					if (! walker.atEnd ())
+						break;
+
+					merge_base = walker.result ();
+					CMergeBaseCache::instance ()->insert (tip, m_queue->m_head_tip, merge_base);
+				}
+
+				tips.append (tip);
+				ahead.append (merge_base.m_left_only);
+				behind.append (merge_base.m_right_only);
+			}
+
+			post (m_receiver, "addAheadBehind", Q_ARG (int, m_generation), Q_ARG (CGitOidVector, tips),
+				  Q_ARG (QVector<int>, ahead), Q_ARG (QVector<int>, behind));
+		}
+
+	protected:
+		bool step ()
+		{
+			//
+			// Job may continue on another thread: its handle must be used then
+			//
+			CGitRepository* repo = CGitRepository::threadRepository (m_queue->m_repo_path);
+			if (! repo->isOpened () || isCancelled ())
+				return false;
+
+			if (! m_reader_opened)
+			{
+				m_reader.open (repo->path () + "objects");
+				m_reader_opened = true;
+			}
+
+			const int info_first = m_queue->m_next_info.fetchAndAddOrdered (CBranchListModel::INFO_BATCH_SIZE);
+			if (info_first < m_queue->m_info_tips.size ())
+			{
+				readInfos (repo->handle (), info_first);
+				return true;
+			}
+
+			const int count_first = m_queue->m_next_count.fetchAndAddOrdered (CBranchListModel::COUNT_BATCH_SIZE);
+			if (count_first >= m_queue->m_count_tips.size ())
+				return false;
+
+			countAheadBehind (repo->handle (), count_first);
+			return true;
+		}
+
+	public:
+		CBranchTipJob (const QSharedPointer<CBranchTipQueue>& _queue, QObject* _receiver, int _generation):
+			m_queue (_queue), m_receiver (_receiver), m_generation (_generation), m_reader_opened (false)
+		{}
+	};
+
+	/// Compares indices of branches by precomputed keys (greater first if descending); ties are broken by name
+	struct CBranchLess
+	{
+		const QVector<qint64>& m_keys;
+		const QStringList& m_names;
+		bool m_descending;
+
+		CBranchLess (const QVector<qint64>& _keys, const QStringList& _names, bool _descending):
+			m_keys (_keys), m_names (_names), m_descending (_descending)
+		{}
+
+		bool operator() (int _left, int _right) const
+		{
+			if (m_keys [_left] != m_keys [_right])
+				return m_descending ? (m_keys [_left] > m_keys [_right]) : (m_keys [_left] < m_keys [_right]);
+
+			return (QString::compare (m_names [_left], m_names [_right], Qt::CaseInsensitive) < 0);
+		}
+	};
+}
+
 CBranchListModel::CBranchListModel (QObject* _parent):
-	QAbstractListModel (_parent)
-{}
+	QAbstractTableModel (_parent),
+	m_sort_column (_NameColumn),
+	m_sort_order (Qt::AscendingOrder),
+	m_generation (0)
+{
+	qRegisterMetaType<CGitBranchList> ("CGitBranchList");
+	qRegisterMetaType<CBranchTipInfoVector> ("CBranchTipInfoVector");
+	qRegisterMetaType<CGitOidVector> ("CGitOidVector");
+	qRegisterMetaType<QVector<int> > ("QVector<int>");
+}
 
 CBranchListModel::~CBranchListModel ()
-{}
+{
+	cancelLoading ();
+}
+
+void
+CBranchListModel::cancelLoading ()
+{
+	if (m_load_job)
+	{
+		m_load_job->cancel ();
+		m_load_job.clear ();
+	}
+
+	foreach (const CBackgroundJobPtr& job, m_tip_jobs)
+		job->cancel ();
+	m_tip_jobs.clear ();
+}
 
 void
 CBranchListModel::showLastGitError ()
 {
 	if (m_repo.isOpened ())
+		CDiagnostics::instance ()->post (tr ("Branches"), m_repo.lastError ());
+}
+
+void
+CBranchListModel::loadFromGit (const QString& _repo_path)
+{
+	cancelLoading ();
+
+	// Details of tips of another repository are of no use
+	if (_repo_path != m_repo_path)
 	{
-		QMessageBox::critical (NULL, QCoreApplication::translate (TR_CONTEXT, "GIT error"),
-							   m_repo.lastError ());
+		m_tip_infos.clear ();
+		m_ahead_behind.clear ();
+		m_head_tip = CGitOid ();
 	}
+	m_repo_path = _repo_path;
+
+	//
+	// Clear the list while new one is being loaded
+	//
+	beginResetModel ();
+	m_branches.clear ();
+	m_tips.clear ();
+	m_order.clear ();
+	endResetModel ();
+
+	//
+	// Enumerating thousands of branches takes a while: do it on worker pool
+	//
+	++m_generation;
+	m_load_job = CBackgroundJobPtr (new CBranchLoadJob (_repo_path, this, m_generation));
+	CWorkerPool::instance ()->start (m_load_job);
 }
 
 void
-CBranchListModel::loadFromGit (const QString& _repo_path)
+CBranchListModel::setBranches (int _generation, const CGitBranchList& _branches, const QString& _error)
 {
+	if (_generation != m_generation)
+		return;
+
+	m_load_job.clear ();
+
+	if (! _error.isEmpty ())
+		CDiagnostics::instance ()->post (tr ("Branches"), _error);
+
+	//
+	// Reset model in all attached views; cached details of tips are shown and sorted at once
+	//
 	beginResetModel ();
+	m_branches = _branches;
+	m_tips.resize (m_branches.size ());
+	m_order.resize (m_branches.size ());
+	for (int i = 0; i < m_branches.size (); ++i)
+	{
+		m_tips [i] = CGitOid::fromString (m_branches [i].m_id);
+		m_order [i] = i;
+	}
+	endResetModel ();
+	reorder ();
+
+	emit loadingFinished ();
+
+	startTipLoading ();
+}
+
+void
+CBranchListModel::startTipLoading ()
+{
+	QSharedPointer<CBranchTipQueue> queue (new CBranchTipQueue);
+	queue->m_repo_path = m_repo_path;
+
+	//
+	// Details of moved tips are dropped; counts are kept only while the tip of HEAD branch stays
+	//
+	CGitOid head_tip;
+	for (int i = 0; i < m_branches.size (); ++i)
+	{
+		if (m_branches [i].m_is_head)
+			head_tip = m_tips [i];
+	}
+	if (head_tip != m_head_tip)
+		m_ahead_behind.clear ();
+	m_head_tip = head_tip;
+
+	// Several branches may point to the same commit
+	QSet<CGitOid> tips;
+	QHash<CGitOid, CBranchTipInfo> tip_infos;
+	QHash<CGitOid, QPair<int, int> > ahead_behind;
+	foreach (const CGitOid& tip, m_tips)
+	{
+		if (tips.contains (tip))
+			continue;
+		tips.insert (tip);
+
+		QHash<CGitOid, CBranchTipInfo>::const_iterator iInfo = m_tip_infos.constFind (tip);
+		if (iInfo != m_tip_infos.constEnd ())
+			tip_infos.insert (tip, iInfo.value ());
+		else
+			queue->m_info_tips.append (tip);
+
+		if (head_tip.isNull ())
+			continue;
+
+		QHash<CGitOid, QPair<int, int> >::const_iterator iCounts = m_ahead_behind.constFind (tip);
+		if (iCounts != m_ahead_behind.constEnd ())
+			ahead_behind.insert (tip, iCounts.value ());
+		else
+			queue->m_count_tips.append (tip);
+	}
+	m_tip_infos = tip_infos;
+	m_ahead_behind = ahead_behind;
+	queue->m_head_tip = head_tip;
+
+	if (queue->m_info_tips.isEmpty () && queue->m_count_tips.isEmpty ())
+		return;
 
 	//
-	// Search git repository (".git" directory) in _repo_path and recursively in its parent directories
+	// List of branches is shown while commits load: reading tips must not delay them
 	//
-	if (m_repo.open (_repo_path, true))
+	const int job_count = qMax (1, CWorkerPool::instance ()->maxThreadCount ());
+	for (int i = 0; i < job_count; ++i)
 	{
-		//
-		// Obtain the list of local git repository branches
-		//
-		m_branches.clear ();
-		// FIXME: allow remote branches to working correctly too
-		m_branches = m_repo.enumBranches (/*false*/);
-		if (! m_repo.lastError ().isEmpty ())
-			qWarning () << m_repo.lastError ();
-
-		//
-		// Free the repository object
-		//
-		m_repo.close ();
+		CBackgroundJobPtr job (new CBranchTipJob (queue, this, m_generation));
+		job->setPriority (CWorkerPool::PRIORITY_BACKGROUND);
+		m_tip_jobs.append (job);
+		CWorkerPool::instance ()->start (job);
 	}
-	else
-		qWarning () << m_repo.lastError ();
+}
 
+void
+CBranchListModel::addTipInfos (int _generation, const CBranchTipInfoVector& _infos)
+{
+	if ((_generation != m_generation) || _infos.isEmpty ())
+		return;
+
+	foreach (const CBranchTipInfo& info, _infos)
+		m_tip_infos.insert (info.m_tip, info);
+
+	emit dataChanged (index (0, _DateColumn), index (rowCount () - 1, _SummaryColumn));
+	if (m_sort_column == _DateColumn)
+		reorder ();
+}
+
+void
+CBranchListModel::addAheadBehind (int _generation, const CGitOidVector& _tips, const QVector<int>& _ahead,
+								  const QVector<int>& _behind)
+{
+	if ((_generation != m_generation) || _tips.isEmpty ())
+		return;
+
+	for (int i = 0; i < _tips.size (); ++i)
+		m_ahead_behind.insert (_tips [i], qMakePair (_ahead [i], _behind [i]));
+
+	emit dataChanged (index (0, _AheadBehindColumn), index (rowCount () - 1, _AheadBehindColumn));
+	if (m_sort_column == _AheadBehindColumn)
+		reorder ();
+}
+
+int
+CBranchListModel::branchAt (int _row) const
+{
+	return m_order [_row];
+}
+
+void
+CBranchListModel::reorder ()
+{
 	//
-	// Reset model in all attached views
+	// Branches without details yet go after others in either order; equal keys are ordered by name
 	//
-	endResetModel ();
+	QStringList names;
+	QVector<qint64> keys (m_branches.size (), 0);
+	for (int i = 0; i < m_branches.size (); ++i)
+	{
+		names.append (m_branches [i].m_shorthand_name);
+		if (m_sort_column == _DateColumn)
+		{
+			QHash<CGitOid, CBranchTipInfo>::const_iterator iInfo = m_tip_infos.constFind (m_tips [i]);
+			if (iInfo != m_tip_infos.constEnd ())
+				keys [i] = iInfo.value ().m_time;
+			else
+				keys [i] = (m_sort_order == Qt::DescendingOrder) ? -1 : Q_INT64_C (0x7FFFFFFFFFFFFFFF);
+		}
+		else if (m_sort_column == _AheadBehindColumn)
+		{
+			// More commits ahead first, then fewer commits behind
+			QHash<CGitOid, QPair<int, int> >::const_iterator iCounts = m_ahead_behind.constFind (m_tips [i]);
+			if (iCounts != m_ahead_behind.constEnd ())
+				keys [i] = (qint64 (iCounts.value ().first) << 32) - iCounts.value ().second;
+			else
+				keys [i] = (m_sort_order == Qt::DescendingOrder) ? Q_INT64_C (-0x7FFFFFFFFFFFFFFF)
+																 : Q_INT64_C (0x7FFFFFFFFFFFFFFF);
+		}
+	}
+
+	QVector<int> order (m_branches.size ());
+	for (int i = 0; i < order.size (); ++i)
+		order [i] = i;
+	const bool by_name = (m_sort_column != _DateColumn) && (m_sort_column != _AheadBehindColumn);
+	std::sort (order.begin (), order.end (), CBranchLess (keys, names, by_name ? false : (m_sort_order == Qt::DescendingOrder)));
+	if (by_name && (m_sort_order == Qt::DescendingOrder))
+		std::reverse (order.begin (), order.end ());
+
+	if (order == m_order)
+		return;
+
+	//
+	// Persistent indices (current item of combobox) stay on their branches
+	//
+	emit layoutAboutToBeChanged ();
+
+	QVector<int> new_rows (order.size ());
+	for (int row = 0; row < order.size (); ++row)
+		new_rows [order [row]] = row;
+
+	const QModelIndexList from = persistentIndexList ();
+	QModelIndexList to;
+	foreach (const QModelIndex& persistent, from)
+		to.append (index (new_rows [m_order [persistent.row ()]], persistent.column ()));
+
+	m_order = order;
+	changePersistentIndexList (from, to);
+
+	emit layoutChanged ();
+}
+
+void
+CBranchListModel::sort (int _column, Qt::SortOrder _order)
+{
+	m_sort_column = _column;
+	m_sort_order = _order;
+	reorder ();
+}
+
+int
+CBranchListModel::sortColumn () const
+{
+	return m_sort_column;
+}
+
+Qt::SortOrder
+CBranchListModel::sortOrder () const
+{
+	return m_sort_order;
+}
+
+bool
+CBranchListModel::isLoading () const
+{
+	return !m_load_job.isNull ();
+}
+
+const CGitBranch&
+CBranchListModel::branch (int _row) const
+{
+	Q_ASSERT ((_row >= 0) && (_row < m_branches.size ()));
+	return m_branches [branchAt (_row)];
+}
+
+int
+CBranchListModel::rowOf (const QString& _shorthand_name) const
+{
+	for (int row = 0; row < m_branches.size (); ++row)
+	{
+		if (m_branches [branchAt (row)].m_shorthand_name == _shorthand_name)
+			return row;
+	}
+
+	return -1;
 }
 
 bool
@@ -93,33 +577,44 @@ CBranchListModel::rowCount (const QModelIndex& _parent) const
 	return m_branches.count ();
 }
 
+int
+CBranchListModel::columnCount (const QModelIndex& _parent) const
+{
+	Q_UNUSED (_parent);
+
+	return _ColumnCount;
+}
+
 QVariant
 CBranchListModel::data (const QModelIndex& _index, int _role) const
 {
-	Q_UNUSED (_role);
-
 	if (_index.isValid ())
 	{
 		Q_ASSERT ((_index.row () >= 0) && (_index.row () < m_branches.size ()));
 
+		const int branch_index = branchAt (_index.row ());
+		const CGitBranch& branch = m_branches [branch_index];
+		QHash<CGitOid, CBranchTipInfo>::const_iterator iInfo = m_tip_infos.constFind (m_tips [branch_index]);
+		const bool has_info = (iInfo != m_tip_infos.constEnd ());
+
 		switch (_index.column ())
 		{
-			case 0:
+			case _NameColumn:
 			{
 				switch (_role)
 				{
 					case Qt::DisplayRole:
-						return m_branches [_index.row ()].m_shorthand_name;
+						return branch.m_shorthand_name;
 
 					case Qt::ToolTipRole:
 					{
 						QString tooltip;
-						if (m_branches [_index.row ()].m_is_head)
+						if (branch.m_is_head)
 						{
 							tooltip += QCoreApplication::translate (TR_CONTEXT, "Repository HEAD branch");
 							tooltip += LINEBREAK;
 						}
-						if (m_branches [_index.row ()].m_is_remote)
+						if (branch.m_is_remote)
 						{
 							tooltip += QCoreApplication::translate (TR_CONTEXT, "Remote branch");
 							tooltip += LINEBREAK;
@@ -129,25 +624,33 @@ CBranchListModel::data (const QModelIndex& _index, int _role) const
 							tooltip += QCoreApplication::translate (TR_CONTEXT, "Local branch");
 							tooltip += LINEBREAK;
 
-							if (! m_branches [_index.row ()].m_upstream_branch.isEmpty ())
+							if (! branch.m_upstream_branch.isEmpty ())
 							{
 								tooltip += QCoreApplication::translate (TR_CONTEXT, "Upstream branch name: %1")
-										   .arg (m_branches [_index.row ()].m_upstream_branch);
+										   .arg (branch.m_upstream_branch);
 								tooltip += LINEBREAK;
 							}
 						}
 
-						tooltip += QString ("Branch id is %1").arg (m_branches [_index.row ()].m_id);
+						tooltip += QString ("Branch id is %1").arg (branch.m_id);
+
+						if (has_info)
+						{
+							tooltip += LINEBREAK;
+							tooltip += QCoreApplication::translate (TR_CONTEXT, "Last commit: %1 by %2 at %3")
+									   .arg (iInfo.value ().m_summary, iInfo.value ().m_author,
+											 QDateTime::fromTime_t (iInfo.value ().m_time).toString (Qt::DefaultLocaleLongDate));
+						}
 
 						return tooltip;
 					}
 
 					case Qt::DecorationRole:
 					{
-						if (m_branches [_index.row ()].m_is_head)
+						if (branch.m_is_head)
 							return QIcon (":/qgitrepoviewer/icons/asterisk_orange.png");
 
-						if (m_branches [_index.row ()].m_is_remote)
+						if (branch.m_is_remote)
 							return QIcon (":/qgitrepoviewer/icons/remote.png");
 						else
 							return QIcon (":/qgitrepoviewer/icons/computer.png");
@@ -155,6 +658,48 @@ CBranchListModel::data (const QModelIndex& _index, int _role) const
 
 					default: break;
 				}
+
+				break;
+			}
+
+			case _DateColumn:
+			{
+				if ((_role == Qt::DisplayRole) && has_info)
+					return QDateTime::fromTime_t (iInfo.value ().m_time).toString (Qt::DefaultLocaleShortDate);
+
+				break;
+			}
+
+			case _AuthorColumn:
+			{
+				if ((_role == Qt::DisplayRole) && has_info)
+					return iInfo.value ().m_author;
+
+				break;
+			}
+
+			case _AheadBehindColumn:
+			{
+				if (_role != Qt::DisplayRole)
+					break;
+
+				if (branch.m_is_head)
+					return QCoreApplication::translate (TR_CONTEXT, "HEAD");
+
+				QHash<CGitOid, QPair<int, int> >::const_iterator iCounts = m_ahead_behind.constFind (m_tips [branch_index]);
+				if (iCounts != m_ahead_behind.constEnd ())
+					return QCoreApplication::translate (TR_CONTEXT, "%1 ahead, %2 behind")
+						   .arg (iCounts.value ().first).arg (iCounts.value ().second);
+
+				break;
+			}
+
+			case _SummaryColumn:
+			{
+				if ((_role == Qt::DisplayRole) && has_info)
+					return iInfo.value ().m_summary;
+
+				break;
 			}
 
 			default: break;
@@ -164,3 +709,32 @@ CBranchListModel::data (const QModelIndex& _index, int _role) const
 	return QVariant ();
 }
 
+QVariant
+CBranchListModel::headerData (int _section, Qt::Orientation _orientation, int _role) const
+{
+	if ((_orientation != Qt::Horizontal) || (_role != Qt::DisplayRole))
+		return QVariant ();
+
+	switch (_section)
+	{
+		case _NameColumn:
+			return QCoreApplication::translate (TR_CONTEXT, "Branch");
+
+		case _DateColumn:
+			return QCoreApplication::translate (TR_CONTEXT, "Last commit");
+
+		case _AuthorColumn:
+			return QCoreApplication::translate (TR_CONTEXT, "Author");
+
+		case _AheadBehindColumn:
+			return QCoreApplication::translate (TR_CONTEXT, "Compared to HEAD");
+
+		case _SummaryColumn:
+			return QCoreApplication::translate (TR_CONTEXT, "Summary");
+
+		default: break;
+	}
+
+	return QVariant ();
+}
+
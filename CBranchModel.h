@@ -10,33 +10,127 @@
 
 #include <QStringList>
 #include <QAbstractTableModel>
+#include <QHash>
+#include <QPair>
+#include <QVector>
 
 #include "GitHelpers.h"
+#include "CWorkerPool.h"
 
 namespace QGitRepoViewer
 {
-	/// Simple read-only list data model for viewing local branches of git SCM repository
-	class CBranchListModel : public QAbstractListModel
+	/// Details of the tip commit of a branch
+	struct CBranchTipInfo
+	{
+		CGitOid m_tip;
+
+		/// Committer time, seconds since epoch
+		uint m_time;
+
+		/// Author name and the first line of message
+		QString m_author;
+		QString m_summary;
+
+		CBranchTipInfo (): m_time (0)
+		{}
+	};
+
+	typedef QVector<CBranchTipInfo> CBranchTipInfoVector;
+
+	/**
+	 * @brief Read-only table data model of local branches of git SCM repository
+	 *
+	 * Branch names are shown at once; details of tip commits and counts of commits ahead and behind
+	 * HEAD branch are read afterwards by jobs on all pool threads and fill the rows as they arrive.
+	 * Details are cached by tip id (counts are memoized by CMergeBaseCache), so reloading the list
+	 * reads only moved tips.
+	 */
+	class CBranchListModel : public QAbstractTableModel
 	{
 		Q_OBJECT
 
-		/// The list of local branch names of git repository
+		/// The list of local branch names of git repository in load order and ids of their tips
 		QList<CGitBranch> m_branches;
+		QVector<CGitOid> m_tips;
+
+		/// Row i shows branch m_order [i]
+		QVector<int> m_order;
+		int m_sort_column;
+		Qt::SortOrder m_sort_order;
 
 		CGitRepository m_repo;
+		QString m_repo_path;
+
+		/// Details of tip commits by tip id
+		QHash<CGitOid, CBranchTipInfo> m_tip_infos;
+
+		/// Commits ahead and behind HEAD branch with specified tip, by tip id
+		CGitOid m_head_tip;
+		QHash<CGitOid, QPair<int, int> > m_ahead_behind;
+
+		/// Current branch list load job and its generation number
+		CBackgroundJobPtr m_load_job;
+		int m_generation;
+
+		/// Jobs reading tip commits
+		QList<CBackgroundJobPtr> m_tip_jobs;
 
 		void showLastGitError ();
 
+		void cancelLoading ();
+
+		/// Start reading details of not cached tips and counts of commits ahead and behind HEAD branch
+		void startTipLoading ();
+
+		/// Index of branch shown in specified row
+		int branchAt (int _row) const;
+
+		/// Sort rows according to current sort column keeping persistent indices on their branches
+		void reorder ();
+
+	private Q_SLOTS:
+		/// Receive branch list from load job
+		void setBranches (int _generation, const CGitBranchList& _branches, const QString& _error);
+
+		/// Receive details of next tip commits from tip job
+		void addTipInfos (int _generation, const CBranchTipInfoVector& _infos);
+
+		/// Receive counts of commits of next tips ahead and behind HEAD branch from tip job
+		void addAheadBehind (int _generation, const CGitOidVector& _tips, const QVector<int>& _ahead,
+							 const QVector<int>& _behind);
+
+	Q_SIGNALS:
+		/// Branch list was loaded
+		void loadingFinished ();
+
 	public:
+		/// Columns: branch name, date, author and summary of tip commit, commits ahead and behind HEAD branch
+		enum { _NameColumn = 0, _DateColumn, _AuthorColumn, _AheadBehindColumn, _SummaryColumn, _ColumnCount };
+
+		/// Count of tips read by one job at once
+		enum { INFO_BATCH_SIZE = 256 };
+
+		/// Count of tips compared with HEAD branch by one job at once
+		enum { COUNT_BATCH_SIZE = 8 };
+
 		CBranchListModel (QObject* _parent = 0);
 		~CBranchListModel ();
 
-		/// Load the list of local branches of specified git repository
+		/// Start loading the list of local branches of specified git repository in background
 		void loadFromGit (const QString& _repo_path);
 
 		/// Check for existance of at least one branch in git repository
 		bool empty () const;
 
+		/// Check whether branch list is still being loaded
+		bool isLoading () const;
+
+		/// Return branch shown in specified row
+		const CGitBranch& branch (int _row) const;
+
+		/// Row of branch with specified short name or -1
+		int rowOf (const QString& _shorthand_name) const;
+
 		/// Creates the new branch pointing to specified commit (to HEAD by default)
 		//bool createBranch (const QString& _name, const QString& _commit_id = QString ());
 
@@ -44,9 +138,19 @@ namespace QGitRepoViewer
 		/// @name Implementation of QAbstractItemModel interface
 		/** @{*/
 		int rowCount (const QModelIndex& _parent = QModelIndex ()) const;
+		int columnCount (const QModelIndex& _parent = QModelIndex ()) const;
 		QVariant data (const QModelIndex& _index, int _role = Qt::DisplayRole) const;
+		QVariant headerData (int _section, Qt::Orientation _orientation, int _role = Qt::DisplayRole) const;
+
+		/// Sort by name, by recency (date column) or by commits ahead and behind HEAD branch; other columns sort by name
+		void sort (int _column, Qt::SortOrder _order = Qt::AscendingOrder);
 		/** @}*/
+
+		int sortColumn () const;
+		Qt::SortOrder sortOrder () const;
 	};
 }
 
+Q_DECLARE_METATYPE (QGitRepoViewer::CBranchTipInfoVector)
+
 #endif // __QGITREPOVIEWER_CBRANCHMODEL_H
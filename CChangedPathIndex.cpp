@@ -0,0 +1,688 @@
+/**
+ * @file
+ * @brief Changed-path Bloom filters of commits implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CChangedPathIndex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSet>
+#include <QtEndian>
+
+#include <algorithm>
+#include <string.h>
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+/// Viewer's filter file in the git directory
+#define FILTER_FILE "qgitrepoviewer-paths.idx"
+
+/// Viewer's filter file signature "QPBF"
+#define FILTER_SIGNATURE 0x46425051
+
+/// Header: signature, version, count of commits and count of hashes
+#define FILTER_HEADER_SIZE 16
+
+/// Commit-graph signature "CGPH", header size and chunk table entry size
+#define GRAPH_SIGNATURE 0x43475048
+#define GRAPH_HEADER_SIZE 8
+#define GRAPH_CHUNK_ENTRY_SIZE 12
+
+/// Commit-graph chunks: OID fanout, OID lookup, Bloom filter index and data
+#define GRAPH_CHUNK_OIDF 0x4f494446
+#define GRAPH_CHUNK_OIDL 0x4f49444c
+#define GRAPH_CHUNK_BIDX 0x42494458
+#define GRAPH_CHUNK_BDAT 0x42444154
+
+/// BDAT chunk header: version, count of hashes and bits per entry
+#define GRAPH_BDAT_HEADER_SIZE 12
+
+/// Seeds of the two murmur3 hashes combined into all filter hashes (same as git)
+#define BLOOM_SEED_0 0x293ae76f
+#define BLOOM_SEED_1 0x7e646e2c
+
+namespace
+{
+	inline quint32 readUInt32 (const uchar* _data)
+	{
+		return qFromLittleEndian<quint32> (_data);
+	}
+
+	/// Commit-graph is big-endian
+	inline quint32 readGraphUInt32 (const uchar* _data)
+	{
+		return qFromBigEndian<quint32> (_data);
+	}
+
+	inline quint64 readGraphUInt64 (const uchar* _data)
+	{
+		return qFromBigEndian<quint64> (_data);
+	}
+
+	inline void appendUInt32 (QByteArray& _bytes, quint32 _value)
+	{
+		uchar bytes [4];
+		qToLittleEndian (_value, bytes);
+		_bytes.append (reinterpret_cast<const char*> (bytes), 4);
+	}
+
+	inline quint32 rotateLeft (quint32 _value, int _count)
+	{
+		return (_value << _count) | (_value >> (32 - _count));
+	}
+
+	/// Byte as git reads it: version 1 filters were built with sign-extended chars
+	inline quint32 hashByte (char _c, bool _v2)
+	{
+		return _v2 ? quint32 (uchar (_c)) : quint32 (qint32 ((signed char) _c));
+	}
+
+	/// Seeded 32-bit murmur3 of git's changed-path filters
+	quint32 murmur3 (quint32 _seed, const QByteArray& _data, bool _v2)
+	{
+		const quint32 c1 = 0xcc9e2d51;
+		const quint32 c2 = 0x1b873593;
+		const char* data = _data.constData ();
+		const int length = _data.size ();
+		const int blocks = length / 4;
+
+		for (int i = 0; i < blocks; ++i)
+		{
+			quint32 k = hashByte (data [4 * i], _v2) | (hashByte (data [4 * i + 1], _v2) << 8)
+						| (hashByte (data [4 * i + 2], _v2) << 16) | (hashByte (data [4 * i + 3], _v2) << 24);
+			k *= c1;
+			k = rotateLeft (k, 15);
+			k *= c2;
+
+			_seed ^= k;
+			_seed = rotateLeft (_seed, 13) * 5 + 0xe6546b64;
+		}
+
+		const char* tail = data + blocks * 4;
+		quint32 k = 0;
+		switch (length & 3)
+		{
+			case 3:
+				k ^= hashByte (tail [2], _v2) << 16;
+				// fall through
+			case 2:
+				k ^= hashByte (tail [1], _v2) << 8;
+				// fall through
+			case 1:
+				k ^= hashByte (tail [0], _v2);
+				k *= c1;
+				k = rotateLeft (k, 15);
+				k *= c2;
+				_seed ^= k;
+		}
+
+		_seed ^= quint32 (length);
+		_seed ^= _seed >> 16;
+		_seed *= 0x85ebca6b;
+		_seed ^= _seed >> 13;
+		_seed *= 0xc2b2ae35;
+		_seed ^= _seed >> 16;
+		return _seed;
+	}
+
+	inline QPair<quint32, quint32> bloomKey (const QByteArray& _path, bool _v2)
+	{
+		return qMakePair (murmur3 (BLOOM_SEED_0, _path, _v2), murmur3 (BLOOM_SEED_1, _path, _v2));
+	}
+
+	/// The path and all its leading directories: "a", "a/b", "a/b/c"
+	QList<QByteArray> pathPrefixes (const QString& _path)
+	{
+		QString path = QDir::fromNativeSeparators (_path);
+		while (path.endsWith ('/'))
+			path.chop (1);
+
+		QList<QByteArray> prefixes;
+		const QByteArray bytes = path.toUtf8 ();
+		for (int i = 0; i < bytes.size (); ++i)
+			if ((bytes [i] == '/') && (i > 0))
+				prefixes.append (bytes.left (i));
+		if (! bytes.isEmpty ())
+			prefixes.append (bytes);
+
+		return prefixes;
+	}
+
+	/// Binary search of the id in sorted table of raw ids; returns position or -1
+	int findOid (const uchar* _oids, quint32 _low, quint32 _high, const CGitOid& _id)
+	{
+		while (_low < _high)
+		{
+			const quint32 middle = _low + (_high - _low) / 2;
+			const int cmp = memcmp (_oids + qint64 (middle) * CGitOid::RAW_SIZE, _id.m_id, CGitOid::RAW_SIZE);
+			if (cmp == 0)
+				return int (middle);
+
+			if (cmp < 0)
+				_low = middle + 1;
+			else
+				_high = middle;
+		}
+
+		return -1;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CChangedPathIndex::CChangedPathIndex ():
+	m_graph_file (NULL),
+	m_graph_count (0),
+	m_graph_fanout (NULL),
+	m_graph_oids (NULL),
+	m_graph_index (NULL),
+	m_graph_filters (NULL),
+	m_graph_filters_size (0),
+	m_graph_hash_count (0),
+	m_graph_v2 (false),
+	m_file (NULL),
+	m_count (0),
+	m_oids (NULL),
+	m_ends (NULL),
+	m_filters (NULL),
+	m_filters_size (0)
+{}
+
+CChangedPathIndex::~CChangedPathIndex ()
+{
+	close ();
+}
+
+QString
+CChangedPathIndex::filePath (const QString& _git_dir)
+{
+	return _git_dir + FILTER_FILE;
+}
+
+bool
+CChangedPathIndex::open (const QString& _git_dir)
+{
+	close ();
+
+	// Missing or invalid files just give no filters
+	const bool graph = openGraph (_git_dir + "objects/info/commit-graph");
+	if (! graph)
+	{
+		delete m_graph_file;
+		m_graph_file = NULL;
+	}
+
+	const bool file = openFile (filePath (_git_dir));
+	if (! file)
+	{
+		delete m_file;
+		m_file = NULL;
+	}
+
+	return graph || file;
+}
+
+bool
+CChangedPathIndex::openGraph (const QString& _path)
+{
+	m_graph_file = new QFile (_path);
+	if (! m_graph_file->open (QIODevice::ReadOnly) || (m_graph_file->size () < GRAPH_HEADER_SIZE))
+		return false;
+
+	const quint64 size = quint64 (m_graph_file->size ());
+	const uchar* data = m_graph_file->map (0, m_graph_file->size ());
+
+	//
+	// Only a standalone SHA-1 graph: version 1, hash version 1, no base graphs
+	//
+	if (! data || (readGraphUInt32 (data) != GRAPH_SIGNATURE) || (data [4] != 1) || (data [5] != 1) || (data [7] != 0))
+		return false;
+
+	const int chunk_count = data [6];
+	if (GRAPH_HEADER_SIZE + quint64 (chunk_count + 1) * GRAPH_CHUNK_ENTRY_SIZE > size)
+		return false;
+
+	const uchar* fanout = NULL;
+	const uchar* oids = NULL;
+	const uchar* index = NULL;
+	const uchar* filters = NULL;
+	quint64 oids_size = 0;
+	quint64 index_size = 0;
+	quint64 filters_size = 0;
+	for (int i = 0; i < chunk_count; ++i)
+	{
+		const uchar* entry = data + GRAPH_HEADER_SIZE + i * GRAPH_CHUNK_ENTRY_SIZE;
+		const quint32 id = readGraphUInt32 (entry);
+		const quint64 offset = readGraphUInt64 (entry + 4);
+		const quint64 end = readGraphUInt64 (entry + GRAPH_CHUNK_ENTRY_SIZE + 4);
+		if ((offset > end) || (end > size))
+			return false;
+
+		switch (id)
+		{
+			case GRAPH_CHUNK_OIDF:
+				if (end - offset == 256 * 4)
+					fanout = data + offset;
+				break;
+
+			case GRAPH_CHUNK_OIDL:
+				oids = data + offset;
+				oids_size = end - offset;
+				break;
+
+			case GRAPH_CHUNK_BIDX:
+				index = data + offset;
+				index_size = end - offset;
+				break;
+
+			case GRAPH_CHUNK_BDAT:
+				filters = data + offset;
+				filters_size = end - offset;
+				break;
+		}
+	}
+
+	// Graph written without --changed-paths is of no use here
+	if (! fanout || !oids || !index || !filters || (filters_size < GRAPH_BDAT_HEADER_SIZE))
+		return false;
+
+	const quint32 count = readGraphUInt32 (fanout + 255 * 4);
+	const quint32 version = readGraphUInt32 (filters);
+	const quint32 hash_count = readGraphUInt32 (filters + 4);
+	if ((oids_size != quint64 (count) * CGitOid::RAW_SIZE) || (index_size != quint64 (count) * 4)
+		|| ((version != 1) && (version != 2)) || (hash_count == 0))
+		return false;
+
+	m_graph_count = count;
+	m_graph_fanout = fanout;
+	m_graph_oids = oids;
+	m_graph_index = index;
+	m_graph_filters = filters + GRAPH_BDAT_HEADER_SIZE;
+	m_graph_filters_size = filters_size - GRAPH_BDAT_HEADER_SIZE;
+	m_graph_hash_count = hash_count;
+	m_graph_v2 = (version == 2);
+	return true;
+}
+
+bool
+CChangedPathIndex::openFile (const QString& _path)
+{
+	m_file = new QFile (_path);
+	if (! m_file->open (QIODevice::ReadOnly) || (m_file->size () < FILTER_HEADER_SIZE))
+		return false;
+
+	const uchar* data = m_file->map (0, m_file->size ());
+	if (! data || (readUInt32 (data) != FILTER_SIGNATURE) || (readUInt32 (data + 4) != FILE_VERSION)
+		|| (readUInt32 (data + 12) != HASH_COUNT))
+		return false;
+
+	//
+	// Sorted ids, end offsets of filters and filters must fit exactly into the file
+	//
+	const quint64 count = readUInt32 (data + 8);
+	const quint64 tables_size = FILTER_HEADER_SIZE + count * (CGitOid::RAW_SIZE + 4);
+	if (tables_size > quint64 (m_file->size ()))
+		return false;
+
+	const uchar* ends = data + FILTER_HEADER_SIZE + count * CGitOid::RAW_SIZE;
+	const quint64 filters_size = (count > 0) ? readUInt32 (ends + (count - 1) * 4) : 0;
+	if (tables_size + filters_size != quint64 (m_file->size ()))
+		return false;
+
+	m_count = quint32 (count);
+	m_oids = data + FILTER_HEADER_SIZE;
+	m_ends = ends;
+	m_filters = data + tables_size;
+	m_filters_size = filters_size;
+	return true;
+}
+
+void
+CChangedPathIndex::close ()
+{
+	// Deleting file unmaps it
+	delete m_graph_file;
+	m_graph_file = NULL;
+	m_graph_count = 0;
+	m_graph_fanout = m_graph_oids = m_graph_index = m_graph_filters = NULL;
+	m_graph_filters_size = 0;
+	m_graph_hash_count = 0;
+	m_graph_v2 = false;
+
+	delete m_file;
+	m_file = NULL;
+	m_count = 0;
+	m_oids = m_ends = m_filters = NULL;
+	m_filters_size = 0;
+
+	m_new_filters.clear ();
+}
+
+void
+CChangedPathIndex::unmap ()
+{
+	const QHash<CGitOid, QByteArray> added = m_new_filters;
+	close ();
+	m_new_filters = added;
+}
+
+bool
+CChangedPathIndex::remap (const QString& _git_dir)
+{
+	const QHash<CGitOid, QByteArray> added = m_new_filters;
+	const bool opened = open (_git_dir);
+
+	// Filters written meanwhile (by this job's previous checkpoint too) must not be saved twice
+	for (QHash<CGitOid, QByteArray>::const_iterator iAdded = added.constBegin (); iAdded != added.constEnd (); ++iAdded)
+	{
+		if (! contains (iAdded.key ()))
+			m_new_filters.insert (iAdded.key (), iAdded.value ());
+	}
+
+	return opened;
+}
+
+const uchar*
+CChangedPathIndex::findFilter (const CGitOid& _commit, quint32& _size, quint32& _hash_count, bool& _v2) const
+{
+	//
+	// Commit-graph first: fanout narrows the search to ids with the same first byte
+	//
+	if (m_graph_count > 0)
+	{
+		const uchar first = _commit.m_id [0];
+		const quint32 low = (first > 0) ? readGraphUInt32 (m_graph_fanout + (first - 1) * 4) : 0;
+		const quint32 high = qMin (readGraphUInt32 (m_graph_fanout + first * 4), m_graph_count);
+		const int position = findOid (m_graph_oids, low, high, _commit);
+		if (position >= 0)
+		{
+			const quint32 end = readGraphUInt32 (m_graph_index + position * 4);
+			const quint32 start = (position > 0) ? readGraphUInt32 (m_graph_index + (position - 1) * 4) : 0;
+			if ((start > end) || (end > m_graph_filters_size))
+				return NULL;
+
+			_size = end - start;
+			_hash_count = m_graph_hash_count;
+			_v2 = m_graph_v2;
+			return m_graph_filters + start;
+		}
+	}
+
+	_hash_count = HASH_COUNT;
+	_v2 = true;
+
+	const int position = findOid (m_oids, 0, m_count, _commit);
+	if (position >= 0)
+	{
+		const quint32 end = readUInt32 (m_ends + position * 4);
+		const quint32 start = (position > 0) ? readUInt32 (m_ends + (position - 1) * 4) : 0;
+		if ((start > end) || (end > m_filters_size))
+			return NULL;
+
+		_size = end - start;
+		return m_filters + start;
+	}
+
+	QHash<CGitOid, QByteArray>::const_iterator iAdded = m_new_filters.constFind (_commit);
+	if (iAdded != m_new_filters.constEnd ())
+	{
+		_size = quint32 (iAdded.value ().size ());
+		return reinterpret_cast<const uchar*> (iAdded.value ().constData ());
+	}
+
+	return NULL;
+}
+
+bool
+CChangedPathIndex::contains (const CGitOid& _commit) const
+{
+	quint32 size = 0;
+	quint32 hash_count = 0;
+	bool v2 = false;
+	return findFilter (_commit, size, hash_count, v2) != NULL;
+}
+
+void
+CChangedPathIndex::setPath (const QString& _path)
+{
+	m_keys_v1.clear ();
+	m_keys_v2.clear ();
+
+	foreach (const QByteArray& prefix, pathPrefixes (_path))
+	{
+		m_keys_v1.append (bloomKey (prefix, false));
+		m_keys_v2.append (bloomKey (prefix, true));
+	}
+}
+
+int
+CChangedPathIndex::mayChange (const CGitOid& _commit) const
+{
+	quint32 size = 0;
+	quint32 hash_count = 0;
+	bool v2 = false;
+	const uchar* filter = findFilter (_commit, size, hash_count, v2);
+	if (! filter)
+		return NO_FILTER;
+
+	// Git writes empty filter when it didn't compute one
+	if ((size == 0) || m_keys_v2.isEmpty ())
+		return MAYBE_CHANGED;
+
+	//
+	// The path and every its leading directory must be in the filter
+	//
+	const quint64 bits = quint64 (size) * 8;
+	const QVector<QPair<quint32, quint32> >& keys = v2 ? m_keys_v2 : m_keys_v1;
+	for (int key = 0; key < keys.size (); ++key)
+		for (quint32 i = 0; i < hash_count; ++i)
+		{
+			const quint64 bit = quint32 (keys [key].first + i * keys [key].second) % bits;
+			if (! (filter [bit / 8] & (1 << (bit % 8))))
+				return NOT_CHANGED;
+		}
+
+	return MAYBE_CHANGED;
+}
+
+void
+CChangedPathIndex::add (const CGitOid& _commit, const QStringList& _changed_paths)
+{
+	if (contains (_commit))
+		return;
+
+	QSet<QByteArray> keys;
+	foreach (const QString& path, _changed_paths)
+		foreach (const QByteArray& prefix, pathPrefixes (path))
+			keys.insert (prefix);
+
+	//
+	// Like git: too many changes give a filter with all bits set; no changes give one zero byte
+	//
+	QByteArray filter;
+	if (keys.size () > MAX_CHANGED_PATHS)
+		filter.fill ('\xff', 1);
+	else
+	{
+		filter.fill ('\0', qMax ((keys.size () * BITS_PER_ENTRY + 7) / 8, 1));
+		const quint64 bits = quint64 (filter.size ()) * 8;
+		foreach (const QByteArray& path, keys)
+		{
+			const QPair<quint32, quint32> key = bloomKey (path, true);
+			for (quint32 i = 0; i < HASH_COUNT; ++i)
+			{
+				const quint64 bit = quint32 (key.first + i * key.second) % bits;
+				filter [int (bit / 8)] = char (filter [int (bit / 8)] | (1 << (bit % 8)));
+			}
+		}
+	}
+
+	m_new_filters.insert (_commit, filter);
+}
+
+bool
+CChangedPathIndex::hasChanges () const
+{
+	return ! m_new_filters.isEmpty ();
+}
+
+bool
+CChangedPathIndex::save (const QString& _path) const
+{
+	QFile file (_path);
+	if (! file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QList<CGitOid> added = m_new_filters.keys ();
+	std::sort (added.begin (), added.end ());
+
+	//
+	// Merge mapped and added ids keeping them sorted: positions >= 0 are mapped, < 0 are added
+	//
+	QVector<int> merged;
+	merged.reserve (int (m_count) + added.size ());
+	int mapped = 0;
+	int next_added = 0;
+	while ((mapped < int (m_count)) || (next_added < added.size ()))
+	{
+		if ((next_added == added.size ())
+			|| ((mapped < int (m_count))
+				&& (memcmp (m_oids + qint64 (mapped) * CGitOid::RAW_SIZE, added [next_added].m_id, CGitOid::RAW_SIZE) < 0)))
+			merged.append (mapped++);
+		else
+			merged.append (-1 - next_added++);
+	}
+
+	QByteArray header;
+	appendUInt32 (header, FILTER_SIGNATURE);
+	appendUInt32 (header, FILE_VERSION);
+	appendUInt32 (header, quint32 (merged.size ()));
+	appendUInt32 (header, HASH_COUNT);
+
+	QByteArray oids;
+	QByteArray ends;
+	QByteArray filters;
+	oids.reserve (merged.size () * CGitOid::RAW_SIZE);
+	ends.reserve (merged.size () * 4);
+	foreach (int position, merged)
+	{
+		if (position >= 0)
+		{
+			const quint32 end = readUInt32 (m_ends + position * 4);
+			const quint32 start = (position > 0) ? readUInt32 (m_ends + (position - 1) * 4) : 0;
+			oids.append (reinterpret_cast<const char*> (m_oids) + qint64 (position) * CGitOid::RAW_SIZE, CGitOid::RAW_SIZE);
+			filters.append (reinterpret_cast<const char*> (m_filters) + start, int (end - start));
+		}
+		else
+		{
+			const CGitOid& id = added [-1 - position];
+			oids.append (reinterpret_cast<const char*> (id.m_id), CGitOid::RAW_SIZE);
+			filters.append (m_new_filters.value (id));
+		}
+
+		appendUInt32 (ends, quint32 (filters.size ()));
+	}
+
+	if ((file.write (header) != header.size ()) || (file.write (oids) != oids.size ())
+		|| (file.write (ends) != ends.size ()) || (file.write (filters) != filters.size ()))
+	{
+		file.remove ();
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CChangedPathJob::CChangedPathJob (const QString& _repo_path, const CGitOidVector& _commits,
+								  QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_commits (_commits),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_done (-1),
+	m_next_checkpoint (CHECKPOINT_SIZE)
+{}
+
+void
+CChangedPathJob::saveCheckpoint ()
+{
+	//
+	// Load jobs may map the current file, so the merged one is written aside and swapped by receiver
+	//
+	QString new_path;
+	m_index.remap (m_git_dir);
+	if (m_index.hasChanges ())
+	{
+		new_path = createTemporaryFile (CChangedPathIndex::filePath (m_git_dir));
+		if (! new_path.isEmpty () && !m_index.save (new_path))
+		{
+			QFile::remove (new_path);
+			new_path.clear ();
+		}
+	}
+
+	// Current file must be unmapped before receiver replaces it
+	m_index.unmap ();
+	if (! new_path.isEmpty ())
+		post (m_receiver, "updatePathFilters", Q_ARG (int, m_generation), Q_ARG (QString, new_path));
+}
+
+bool
+CChangedPathJob::step ()
+{
+	if (m_done < 0)
+	{
+		// Filters are optional: without repository there is nothing to add
+		if (! m_repo.open (m_repo_path, true))
+			return false;
+
+		m_git_dir = QFile::decodeName (git_repository_path (m_repo.handle ()));
+
+		//
+		// Commits with filters (saved by a previous job's checkpoints too) are not diffed again
+		//
+		m_index.open (m_git_dir);
+		foreach (const CGitOid& id, m_commits)
+		{
+			if (! m_index.contains (id))
+				m_missing.append (id);
+		}
+		m_index.unmap ();
+		m_commits.clear ();
+		m_done = 0;
+	}
+
+	//
+	// Diff commits missing both in commit-graph and the viewer's file
+	//
+	const int end = qMin (m_done + int (STEP_SIZE), m_missing.size ());
+	for (; m_done < end; ++m_done)
+	{
+		const CGitOid& id = m_missing [m_done];
+
+		CGitCommit commit;
+		commit.m_id = id.toString ();
+		if (m_repo.lookupChangedFiles (commit))
+			m_index.add (id, commit.m_files);
+	}
+
+	if (m_done < m_missing.size ())
+	{
+		// Each checkpoint rewrites the whole file, so they get rarer as the file grows
+		if (m_done >= m_next_checkpoint)
+		{
+			saveCheckpoint ();
+			m_next_checkpoint = m_done + qMax (int (CHECKPOINT_SIZE), m_done / 4);
+		}
+
+		return true;
+	}
+
+	saveCheckpoint ();
+	m_index.close ();
+	return false;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file
+ * @brief Changed-path Bloom filters of commits interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCHANGEDPATHINDEX_H
+#define __QGITREPOVIEWER_CCHANGEDPATHINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+class QFile;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Bloom filters of paths changed by commits compared to their first parents
+	 *
+	 * Filters are read from git's commit-graph file (BIDX/BDAT chunks written by
+	 * "git commit-graph write --changed-paths"), and for commits missing there from the viewer's own file
+	 * in the git directory; both are memory-mapped. Filters use the same hashing as git: a path and all its
+	 * leading directories are added with seeded murmur3, so one lookup rejects most commits which
+	 * don't touch the path without diffing their trees. Split commit-graph chains are not read.
+	 *
+	 * An instance must be used by one thread at a time.
+	 */
+	class CChangedPathIndex
+	{
+		/// Mapped commit-graph with changed-path filters
+		QFile* m_graph_file;
+		quint32 m_graph_count;
+		const uchar* m_graph_fanout;
+		const uchar* m_graph_oids;
+		const uchar* m_graph_index;
+		const uchar* m_graph_filters;
+		quint64 m_graph_filters_size;
+		quint32 m_graph_hash_count;
+		bool m_graph_v2;
+
+		/// Mapped file of filters built by the viewer
+		QFile* m_file;
+		quint32 m_count;
+		const uchar* m_oids;
+		const uchar* m_ends;
+		const uchar* m_filters;
+		quint64 m_filters_size;
+
+		/// Filters built after open()
+		QHash<CGitOid, QByteArray> m_new_filters;
+
+		/// Hash pairs of the looked up path and its leading directories (murmur3 versions 1 and 2)
+		QVector<QPair<quint32, quint32> > m_keys_v1;
+		QVector<QPair<quint32, quint32> > m_keys_v2;
+
+		bool openGraph (const QString& _path);
+		bool openFile (const QString& _path);
+
+		/// Filter of the commit or NULL; _v2 tells the murmur3 version and _hash_count the count of hashes
+		const uchar* findFilter (const CGitOid& _commit, quint32& _size, quint32& _hash_count, bool& _v2) const;
+
+	public:
+		/// Settings of filters built by the viewer: the defaults of git
+		enum { HASH_COUNT = 7, BITS_PER_ENTRY = 10, MAX_CHANGED_PATHS = 512 };
+
+		/// Format version of the viewer's filter file
+		enum { FILE_VERSION = 1 };
+
+		/// Result of mayChange ()
+		enum { NO_FILTER = -1, NOT_CHANGED = 0, MAYBE_CHANGED = 1 };
+
+		CChangedPathIndex ();
+		~CChangedPathIndex ();
+
+		/// Map commit-graph and the viewer's filters of repository with specified git directory
+		bool open (const QString& _git_dir);
+		void close ();
+
+		/// Unmap files keeping filters added since open ()
+		void unmap ();
+
+		/// Map files again keeping added filters which are still missing there (another writer may have replaced them)
+		bool remap (const QString& _git_dir);
+
+		/// Check whether there is a filter for the commit
+		bool contains (const CGitOid& _commit) const;
+
+		/// Set the path (relative to repository root) for mayChange ()
+		void setPath (const QString& _path);
+
+		/// Check the filter of the commit for the path
+		int mayChange (const CGitOid& _commit) const;
+
+		/// Build filter of the commit from paths changed compared to the first parent
+		void add (const CGitOid& _commit, const QStringList& _changed_paths);
+
+		/// Check whether filters were added after open ()
+		bool hasChanges () const;
+
+		/// Write mapped and added viewer's filters into a new file
+		bool save (const QString& _path) const;
+
+		/// Path of the viewer's filter file in the git directory
+		static QString filePath (const QString& _git_dir);
+
+	private:
+		Q_DISABLE_COPY (CChangedPathIndex)
+	};
+
+	/**
+	 * @brief Builds changed-path filters of commits missing in commit-graph and the viewer's file on worker pool
+	 *
+	 * Each commit is diffed with its first parent once. Filters are merged with the current file into a new one
+	 * written next to it at checkpoints, so a job cancelled by the next load loses little work; receiver slot
+	 * updatePathFilters(int,QString) gets the generation and the path of each written file.
+	 * Files are not kept mapped between checkpoints, so receiver can replace them.
+	 */
+	class CChangedPathJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		CGitOidVector m_commits;
+		QObject* m_receiver;
+		int m_generation;
+
+		CGitRepository m_repo;
+		CChangedPathIndex m_index;
+		QString m_git_dir;
+
+		/// Commits without filters when the job started and count of processed ones (-1 before the first step)
+		CGitOidVector m_missing;
+		int m_done;
+
+		/// Count of processed commits to write the next checkpoint at
+		int m_next_checkpoint;
+
+		/// Merge added filters with the current file and post the written file to receiver
+		void saveCheckpoint ();
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of commits diffed per step
+		enum { STEP_SIZE = 256 };
+
+		/// Minimal count of commits diffed between checkpoints; the interval grows with the work done
+		enum { CHECKPOINT_SIZE = 16384 };
+
+		CChangedPathJob (const QString& _repo_path, const CGitOidVector& _commits, QObject* _receiver, int _generation);
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCHANGEDPATHINDEX_H
@@ -0,0 +1,197 @@
+/**
+ * @file
+ * @brief Changed files of the selected commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitDetailsView.h"
+
+#include <QHeaderView>
+
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
+CCommitDetailsJob::CCommitDetailsJob (const QString& _repo_path, const CGitOidVector& _commits,
+									  QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_commits (_commits),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_done (0)
+{}
+
+bool
+CCommitDetailsJob::step ()
+{
+	if (m_done >= m_commits.size ())
+		return false;
+
+	//
+	// View waits for the commit it shows, so it must be told about errors too
+	//
+	CGitRepository* repo = CGitRepository::threadRepository (m_repo_path);
+	if (! repo->isOpened ())
+	{
+		post (m_receiver, "failDetails", Q_ARG (int, m_generation), Q_ARG (QString, m_commits [m_done].toString ()),
+			  Q_ARG (QString, repo->lastError ()));
+		return false;
+	}
+
+	CGitCommit commit;
+	commit.m_id = m_commits [m_done++].toString ();
+	if (repo->lookupChangedFiles (commit, true))
+		post (m_receiver, "addDetails", Q_ARG (int, m_generation), Q_ARG (CGitCommit, commit));
+	else
+		post (m_receiver, "failDetails", Q_ARG (int, m_generation), Q_ARG (QString, commit.m_id),
+			  Q_ARG (QString, repo->lastError ()));
+
+	return m_done < m_commits.size ();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CCommitDetailsView::CCommitDetailsView (QWidget* _parent):
+	QTreeWidget (_parent),
+	m_cache (CACHE_FILE_LIMIT),
+	m_generation (0)
+{
+	qRegisterMetaType<CGitCommit> ("CGitCommit");
+
+	setColumnCount (_ColumnCount);
+	setRootIsDecorated (false);
+	setUniformRowHeights (true);
+	setAlternatingRowColors (true);
+	setHeaderLabels (QStringList () << QString () << tr ("File") << tr ("Added") << tr ("Deleted"));
+	header ()->setStretchLastSection (false);
+#if QT_VERSION >= 0x050000
+	header ()->setSectionResizeMode (_PathColumn, QHeaderView::Stretch);
+#else
+	header ()->setResizeMode (_PathColumn, QHeaderView::Stretch);
+#endif
+}
+
+CCommitDetailsView::~CCommitDetailsView ()
+{
+	cancelJob ();
+}
+
+void
+CCommitDetailsView::cancelJob ()
+{
+	if (m_job)
+	{
+		m_job->cancel ();
+		m_job.clear ();
+	}
+	++m_generation;
+}
+
+void
+CCommitDetailsView::setGitRepo (const QString& _repo_path)
+{
+	cancelJob ();
+	m_repo_path = _repo_path;
+	m_cache.clear ();
+	clearCommit ();
+}
+
+void
+CCommitDetailsView::clearCommit ()
+{
+	m_current = CGitOid ();
+	clear ();
+	headerItem ()->setText (_PathColumn, tr ("File"));
+}
+
+void
+CCommitDetailsView::showCommit (const CGitOid& _commit, const CGitOidVector& _neighbours)
+{
+	if (_commit == m_current)
+		return;
+
+	m_current = _commit;
+	clear ();
+
+	const CGitCommit* cached = m_cache.object (_commit);
+	if (cached)
+		showDetails (*cached);
+	else
+		headerItem ()->setText (_PathColumn, tr ("Loading changed files..."));
+
+	//
+	// Previous selection is not interesting anymore: compute this commit first, then its neighbours
+	//
+	CGitOidVector missing;
+	if (! cached)
+		missing.append (_commit);
+	foreach (const CGitOid& id, _neighbours)
+		if (! m_cache.contains (id) && !missing.contains (id))
+			missing.append (id);
+
+	cancelJob ();
+	if (missing.isEmpty () || m_repo_path.isEmpty ())
+		return;
+
+	m_job = CBackgroundJobPtr (new CCommitDetailsJob (m_repo_path, missing, this, m_generation));
+	m_job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+	CWorkerPool::instance ()->start (m_job);
+}
+
+void
+CCommitDetailsView::addDetails (int _generation, const CGitCommit& _commit)
+{
+	if (_generation != m_generation)
+		return;
+
+	const CGitOid id = CGitOid::fromString (_commit.m_id);
+	m_cache.insert (id, new CGitCommit (_commit), qMax (_commit.m_files.size (), 1));
+
+	if (id == m_current)
+		showDetails (_commit);
+}
+
+void
+CCommitDetailsView::failDetails (int _generation, const QString& _commit_id, const QString& _error)
+{
+	// Neighbours are read only in advance: their errors are shown when they are selected
+	if ((_generation != m_generation) || (CGitOid::fromString (_commit_id) != m_current))
+		return;
+
+	headerItem ()->setText (_PathColumn, tr ("Can't read changed files"));
+	CDiagnostics::instance ()->post (tr ("Changed files"), _error);
+}
+
+void
+CCommitDetailsView::showDetails (const CGitCommit& _commit)
+{
+	clear ();
+
+	int added = 0;
+	int deleted = 0;
+	QList<QTreeWidgetItem*> items;
+	for (int i = 0; i < _commit.m_files.size (); ++i)
+	{
+		const CGitFileStat& stat = _commit.m_file_stats [i];
+		QTreeWidgetItem* item = new QTreeWidgetItem;
+		item->setText (_StatusColumn, QString (QChar::fromLatin1 (stat.m_status)));
+		item->setText (_PathColumn, _commit.m_files [i]);
+		item->setToolTip (_PathColumn, _commit.m_files [i]);
+		if (stat.m_binary)
+			item->setText (_AddedColumn, tr ("binary"));
+		else
+		{
+			item->setText (_AddedColumn, QString ("+%1").arg (stat.m_added));
+			item->setText (_DeletedColumn, QString ("-%1").arg (stat.m_deleted));
+		}
+		item->setTextAlignment (_AddedColumn, Qt::AlignRight | Qt::AlignVCenter);
+		item->setTextAlignment (_DeletedColumn, Qt::AlignRight | Qt::AlignVCenter);
+		items.append (item);
+
+		added += stat.m_added;
+		deleted += stat.m_deleted;
+	}
+	addTopLevelItems (items);
+
+	headerItem ()->setText (_PathColumn, tr ("%n file(s) changed, +%1 -%2", "", _commit.m_files.size ())
+							.arg (added).arg (deleted));
+}
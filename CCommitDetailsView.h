@@ -0,0 +1,94 @@
+/**
+ * @file
+ * @brief Changed files of the selected commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITDETAILSVIEW_H
+#define __QGITREPOVIEWER_CCOMMITDETAILSVIEW_H
+
+#include <QTreeWidget>
+#include <QCache>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Computes changed files and line counts of commits on worker pool
+	 *
+	 * Commits are diffed one per step with their first parents by the thread repository handle,
+	 * so libgit2 keeps tree objects shared by neighbouring commits in its cache between jobs.
+	 * Receiver slot addDetails(int,CGitCommit) gets each commit with m_files and m_file_stats filled.
+	 */
+	class CCommitDetailsJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		CGitOidVector m_commits;
+		QObject* m_receiver;
+		int m_generation;
+		int m_done;
+
+	protected:
+		bool step ();
+
+	public:
+		CCommitDetailsJob (const QString& _repo_path, const CGitOidVector& _commits, QObject* _receiver, int _generation);
+	};
+
+	/**
+	 * @brief List of files changed by the selected commit with added and deleted line counts
+	 *
+	 * Details are computed on demand and kept in a cache bounded by the total count of files;
+	 * neighbours of the selected commit are computed after it, so stepping through the commit list
+	 * finds them ready.
+	 */
+	class CCommitDetailsView : public QTreeWidget
+	{
+		Q_OBJECT
+
+		QString m_repo_path;
+
+		/// Details by commit; cost is the count of changed files
+		QCache<CGitOid, CGitCommit> m_cache;
+
+		/// Commit which details are shown (or awaited)
+		CGitOid m_current;
+
+		CBackgroundJobPtr m_job;
+		int m_generation;
+
+		/// Fill the list from cached details
+		void showDetails (const CGitCommit& _commit);
+
+		void cancelJob ();
+
+	private slots:
+		/// Receive details of the next commit from job
+		void addDetails (int _generation, const CGitCommit& _commit);
+
+		/// Receive the error of reading specified commit from job
+		void failDetails (int _generation, const QString& _commit_id, const QString& _error);
+
+	public:
+		/// Columns: change status, file path, added and deleted lines
+		enum { _StatusColumn = 0, _PathColumn, _AddedColumn, _DeletedColumn, _ColumnCount };
+
+		/// Limit of cached changed files of all commits
+		enum { CACHE_FILE_LIMIT = 50000 };
+
+		explicit CCommitDetailsView (QWidget* _parent = NULL);
+		~CCommitDetailsView ();
+
+		/// Forget cached details and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Show details of the commit and compute missing details of it and then of its neighbours
+		void showCommit (const CGitOid& _commit, const CGitOidVector& _neighbours);
+
+		/// Clear the list
+		void clearCommit ();
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMMITDETAILSVIEW_H
@@ -0,0 +1,366 @@
+/**
+ * @file
+ * @brief Headless streaming export of branches and commits implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitExporter.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+
+#include <stdio.h>
+
+#include "CCommitWalker.h"
+
+using namespace QGitRepoViewer;
+
+/// Escape string as JSON string literal (with quotes)
+static QByteArray jsonString (const QString& _value)
+{
+	QByteArray utf8 = _value.toUtf8 ();
+	QByteArray result;
+	result.reserve (utf8.size () + 2);
+	result += '"';
+	for (int i = 0; i < utf8.size (); ++i)
+	{
+		const char ch = utf8.at (i);
+		switch (ch)
+		{
+			case '"':	result += "\\\"";	break;
+			case '\\':	result += "\\\\";	break;
+			case '\n':	result += "\\n";	break;
+			case '\r':	result += "\\r";	break;
+			case '\t':	result += "\\t";	break;
+			default:
+				if (uchar (ch) < 0x20)
+					result += QByteArray ("\\u00") + QByteArray::number (uchar (ch), 16).rightJustified (2, '0');
+				else
+					result += ch;
+				break;
+		}
+	}
+	result += '"';
+
+	return result;
+}
+
+/// Quote CSV field if it contains separators, quotes or line breaks
+static QByteArray csvField (const QString& _value)
+{
+	QByteArray utf8 = _value.toUtf8 ();
+	if (utf8.contains (',') || utf8.contains ('"') || utf8.contains ('\n') || utf8.contains ('\r'))
+		return '"' + utf8.replace ("\"", "\"\"") + '"';
+
+	return utf8;
+}
+
+namespace QGitRepoViewer
+{
+	/// Worker job: decode and serialize one batch of commits
+	class CDecodeJob : public QRunnable
+	{
+		CCommitExporter* m_exporter;
+		int m_seq;
+		QVector<CGitOid> m_oids;
+
+	public:
+		CDecodeJob (CCommitExporter* _exporter, int _seq, const QVector<CGitOid>& _oids):
+			m_exporter (_exporter), m_seq (_seq), m_oids (_oids)
+		{}
+
+		void run ()
+		{
+			QByteArray text;
+			CGitRepository* repo = CGitRepository::threadRepository (m_exporter->m_repo_path);
+			if (repo->isOpened ())
+			{
+				CGitCommit commit;
+				foreach (const CGitOid& oid, m_oids)
+				{
+					if (repo->lookupCommit (oid, commit))
+						text += CCommitExporter::formatCommit (commit, m_exporter->m_format);
+					else
+						qWarning () << repo->lastError ();
+				}
+			}
+			else
+				qWarning () << repo->lastError ();
+
+			m_exporter->batchDecoded (m_seq, text);
+		}
+	};
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CCommitExporter::CCommitExporter (const QString& _repo_path, Format _format, int _thread_count):
+	m_repo_path (_repo_path),
+	m_format (_format)
+{
+	if (_thread_count > 0)
+		m_pool.setMaxThreadCount (_thread_count);
+}
+
+CCommitExporter::~CCommitExporter ()
+{
+	m_pool.waitForDone ();
+}
+
+QString
+CCommitExporter::lastError () const
+{
+	return m_last_error;
+}
+
+void
+CCommitExporter::batchDecoded (int _seq, const QByteArray& _text)
+{
+	QMutexLocker locker (&m_mutex);
+	m_ready.insert (_seq, _text);
+	m_batch_done.wakeAll ();
+}
+
+bool
+CCommitExporter::writeReady (QIODevice* _out, int& _next_seq, bool _wait)
+{
+	QMutexLocker locker (&m_mutex);
+
+	if (_wait)
+	{
+		while (! m_ready.contains (_next_seq))
+			m_batch_done.wait (&m_mutex);
+	}
+
+	while (m_ready.contains (_next_seq))
+	{
+		QByteArray text = m_ready.take (_next_seq);
+		++_next_seq;
+
+		locker.unlock ();
+		bool ok = (_out->write (text) == text.size ());
+		locker.relock ();
+
+		if (!ok)
+		{
+			m_last_error = QCoreApplication::translate (TR_CONTEXT, "Unable to write export data: %1")
+						   .arg (_out->errorString ());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+QByteArray
+CCommitExporter::formatCommit (const CGitCommit& _commit, Format _format)
+{
+	QStringList parents;
+	foreach (const CGitCommit& parent, _commit.m_parents)
+		parents.append (parent.m_id);
+
+	QByteArray line;
+	if (_format == FORMAT_CSV)
+	{
+		line = _commit.m_id.toLatin1 () + ',' + parents.join (" ").toLatin1 () + ','
+				+ csvField (_commit.m_author) + ',' + csvField (_commit.m_author_email) + ','
+				+ QByteArray::number (_commit.m_time.toTime_t ()) + ',' + csvField (_commit.m_summary);
+	}
+	else
+	{
+		QByteArray parents_json;
+		foreach (const QString& parent, parents)
+		{
+			if (! parents_json.isEmpty ())
+				parents_json += ',';
+			parents_json += '"' + parent.toLatin1 () + '"';
+		}
+
+		line = "{\"id\":\"" + _commit.m_id.toLatin1 () + "\",\"parents\":[" + parents_json + "]"
+				+ ",\"author\":" + jsonString (_commit.m_author)
+				+ ",\"email\":" + jsonString (_commit.m_author_email)
+				+ ",\"time\":" + QByteArray::number (_commit.m_time.toTime_t ())
+				+ ",\"summary\":" + jsonString (_commit.m_summary) + "}";
+	}
+
+	return line + '\n';
+}
+
+bool
+CCommitExporter::exportBranches (QIODevice* _out)
+{
+	CGitRepository repo;
+	if (! repo.open (m_repo_path, true))
+	{
+		m_last_error = repo.lastError ();
+		return false;
+	}
+
+	QList<CGitBranch> branches = repo.enumBranches ();
+	if (! repo.lastError ().isEmpty ())
+	{
+		m_last_error = repo.lastError ();
+		return false;
+	}
+
+	if (m_format == FORMAT_CSV)
+		_out->write ("name,id,head,remote,upstream\n");
+
+	foreach (const CGitBranch& branch, branches)
+	{
+		QByteArray line;
+		if (m_format == FORMAT_CSV)
+		{
+			line = csvField (branch.m_shorthand_name) + ',' + branch.m_id.toLatin1 () + ','
+					+ (branch.m_is_head ? "1" : "0") + ',' + (branch.m_is_remote ? "1" : "0") + ','
+					+ csvField (branch.m_upstream_branch) + '\n';
+		}
+		else
+		{
+			line = "{\"name\":" + jsonString (branch.m_shorthand_name)
+					+ ",\"id\":\"" + branch.m_id.toLatin1 () + "\""
+					+ ",\"head\":" + (branch.m_is_head ? "true" : "false")
+					+ ",\"remote\":" + (branch.m_is_remote ? "true" : "false")
+					+ ",\"upstream\":" + jsonString (branch.m_upstream_branch) + "}\n";
+		}
+
+		_out->write (line);
+	}
+
+	return true;
+}
+
+bool
+CCommitExporter::exportCommits (const QString& _branch_name, QIODevice* _out)
+{
+	CGitRepository repo;
+	if (! repo.open (m_repo_path, true))
+	{
+		m_last_error = repo.lastError ();
+		return false;
+	}
+
+	CCommitWalker walker (repo.handle ());
+	if (! walker.pushBranch (_branch_name))
+	{
+		m_last_error = walker.lastError ();
+		return false;
+	}
+
+	if (m_format == FORMAT_CSV)
+		_out->write ("id,parents,author,email,time,summary\n");
+
+	//
+	// Keep a few batches per decoder thread in flight: enough to hide walk latency,
+	// but bounded so the memory doesn't grow with history length
+	//
+	const int max_in_flight = m_pool.maxThreadCount () * 4;
+	int next_seq = 0;
+	int write_seq = 0;
+	bool ok = true;
+
+	QVector<CGitOid> batch;
+	while (ok && (walker.next (batch, BATCH_SIZE) > 0))
+	{
+		while (ok && (next_seq - write_seq >= max_in_flight))
+			ok = writeReady (_out, write_seq, true);
+
+		m_pool.start (new CDecodeJob (this, next_seq++, batch));
+		batch.clear ();
+
+		if (ok)
+			ok = writeReady (_out, write_seq, false);
+	}
+
+	//
+	// Drain the rest of the pipeline
+	//
+	while (ok && (write_seq < next_seq))
+		ok = writeReady (_out, write_seq, true);
+
+	m_pool.waitForDone ();
+	m_ready.clear ();
+
+	// Walk stopped by an error mustn't pass for the whole history
+	if (ok && walker.hasFailed ())
+	{
+		m_last_error = walker.lastError ();
+		return false;
+	}
+
+	return ok;
+}
+
+int
+CCommitExporter::run (const QStringList& _args)
+{
+	QTextStream err (stderr);
+
+	QString repo_path = QDir::currentPath ();
+	QString branch_name;
+	Format format = FORMAT_JSONL;
+	int thread_count = 0;
+
+	//
+	// Parse command line: --export [--repo PATH] [--branch NAME] [--format jsonl|csv] [--threads N]
+	//
+	for (int i = 1; i < _args.size (); ++i)
+	{
+		const QString& arg = _args.at (i);
+		bool has_value = (i + 1 < _args.size ());
+
+		if (arg == "--export")
+			continue;
+		else if ((arg == "--repo") && has_value)
+			repo_path = _args.at (++i);
+		else if ((arg == "--branch") && has_value)
+			branch_name = _args.at (++i);
+		else if ((arg == "--format") && has_value)
+		{
+			QString format_name = _args.at (++i);
+			if (format_name == "jsonl")
+				format = FORMAT_JSONL;
+			else if (format_name == "csv")
+				format = FORMAT_CSV;
+			else
+			{
+				err << QCoreApplication::translate (TR_CONTEXT, "Unknown export format: %1").arg (format_name) << endl;
+				return 1;
+			}
+		}
+		else if ((arg == "--threads") && has_value)
+			thread_count = _args.at (++i).toInt ();
+		else
+		{
+			err << QCoreApplication::translate (TR_CONTEXT,
+												"Usage: %1 --export [--repo PATH] [--branch NAME] [--format jsonl|csv] [--threads N]\n"
+												"Without --branch the list of local branches is exported.")
+				   .arg (_args.value (0)) << endl;
+			return 1;
+		}
+	}
+
+	QFile out;
+	if (! out.open (stdout, QIODevice::WriteOnly))
+	{
+		err << out.errorString () << endl;
+		return 1;
+	}
+
+	CCommitExporter exporter (repo_path, format, thread_count);
+	bool ok = branch_name.isEmpty () ? exporter.exportBranches (&out)
+									 : exporter.exportCommits (branch_name, &out);
+	out.flush ();
+
+	if (!ok)
+	{
+		err << exporter.lastError () << endl;
+		return 1;
+	}
+
+	return 0;
+}
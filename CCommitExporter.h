@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Headless streaming export of branches and commits interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITEXPORTER_H
+#define __QGITREPOVIEWER_CCOMMITEXPORTER_H
+
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QStringList>
+
+#include "GitHelpers.h"
+
+class QIODevice;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Streams branch list or branch history of git repository to output device without GUI
+	 *
+	 * Commit ids are produced by CCommitWalker on the calling thread, decoded and serialized in batches
+	 * on worker threads (each with its own repository handle) and written back in walk order.
+	 * The number of batches in flight is bounded, so memory usage doesn't depend on history size.
+	 */
+	class CCommitExporter
+	{
+	public:
+		enum Format { FORMAT_JSONL = 0, FORMAT_CSV };
+
+	private:
+		QString m_repo_path;
+		Format m_format;
+		QString m_last_error;
+
+		QMutex m_mutex;
+		QWaitCondition m_batch_done;
+
+		/// Serialized batches which are ready to be written, keyed by their sequence number
+		QMap<int, QByteArray> m_ready;
+
+		/// Decoder threads; declared last so it is destroyed (and joined) first
+		QThreadPool m_pool;
+
+		friend class CDecodeJob;
+		void batchDecoded (int _seq, const QByteArray& _text);
+
+		/// Write all consecutive ready batches starting from _next_seq; optionally wait for the first one
+		bool writeReady (QIODevice* _out, int& _next_seq, bool _wait);
+
+	public:
+		/// Number of commits decoded by one worker job
+		enum { BATCH_SIZE = 256 };
+
+		CCommitExporter (const QString& _repo_path, Format _format = FORMAT_JSONL, int _thread_count = 0);
+		~CCommitExporter ();
+
+		/// Write the list of local branches
+		bool exportBranches (QIODevice* _out);
+
+		/// Write all commits of specified local branch in topological order
+		bool exportCommits (const QString& _branch_name, QIODevice* _out);
+
+		QString lastError () const;
+
+		/// Serialize single commit as one line of the specified format
+		static QByteArray formatCommit (const CGitCommit& _commit, Format _format);
+
+		/// Entry point of "--export" command line mode; returns process exit code
+		static int run (const QStringList& _args);
+
+	private:
+		Q_DISABLE_COPY (CCommitExporter)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMMITEXPORTER_H
@@ -0,0 +1,275 @@
+/**
+ * @file
+ * @brief Commit table item delegate with cached text layouts implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitItemDelegate.h"
+
+#include <QApplication>
+#include <QHeaderView>
+#include <QPainter>
+#include <QDateTime>
+#include <QEvent>
+
+#include "CCommitModel.h"
+#include "CCommitView.h"
+
+using namespace QGitRepoViewer;
+
+/// Space between cell border and its contents
+#define CELL_MARGIN 3
+
+/// Space between tag badge border and tag name
+#define BADGE_PADDING 3
+
+/// Relative dates have minute precision
+#define DATE_UPDATE_INTERVAL_MS (60 * 1000)
+
+namespace
+{
+	/// Prepare static text for painting with specified font
+	QStaticText staticText (const QString& _text, const QFont& _font)
+	{
+		QStaticText result (_text);
+		result.setTextFormat (Qt::PlainText);
+		result.setPerformanceHint (QStaticText::AggressiveCaching);
+		result.prepare (QTransform (), _font);
+		return result;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CCommitItemDelegate::CCommitItemDelegate (CCommitView* _view):
+	QStyledItemDelegate (_view),
+	m_view (_view),
+	m_layouts (MAX_CACHED_CELLS),
+	m_row_height (0)
+{
+	updateRowHeight ();
+
+	//
+	// Font change of the view changes both row height and all text layouts
+	//
+	m_view->installEventFilter (this);
+
+	connect (&m_date_timer, SIGNAL (timeout ()), this, SLOT (invalidate ()));
+	m_date_timer.start (DATE_UPDATE_INTERVAL_MS);
+}
+
+void
+CCommitItemDelegate::install ()
+{
+	m_view->setItemDelegate (this);
+
+	connect (m_view->model (), SIGNAL (modelReset ()), this, SLOT (invalidate ()));
+	connect (m_view->model (), SIGNAL (layoutChanged ()), this, SLOT (invalidate ()));
+	connect (m_view->model (), SIGNAL (rowsRemoved (const QModelIndex&, int, int)), this, SLOT (invalidate ()));
+	connect (m_view->model (), SIGNAL (dataChanged (const QModelIndex&, const QModelIndex&)),
+			 this, SLOT (aboutDataChanged (const QModelIndex&, const QModelIndex&)));
+	connect (m_view->header (), SIGNAL (sectionResized (int, int, int)), this, SLOT (invalidate ()));
+
+	//
+	// All rows have the same height: the view doesn't need to ask each row for its size hint
+	//
+	m_view->setRowHeight (m_row_height);
+}
+
+int
+CCommitItemDelegate::rowHeight () const
+{
+	return m_row_height;
+}
+
+void
+CCommitItemDelegate::updateRowHeight ()
+{
+	m_row_height = m_view->fontMetrics ().height () + 2 * CELL_MARGIN;
+	m_view->setRowHeight (m_row_height);
+}
+
+bool
+CCommitItemDelegate::eventFilter (QObject* _object, QEvent* _event)
+{
+	if ((_object == m_view) && (_event->type () == QEvent::FontChange))
+	{
+		updateRowHeight ();
+		invalidate ();
+	}
+
+	return QStyledItemDelegate::eventFilter (_object, _event);
+}
+
+void
+CCommitItemDelegate::invalidate ()
+{
+	m_layouts.clear ();
+	m_view->viewport ()->update ();
+}
+
+void
+CCommitItemDelegate::aboutDataChanged (const QModelIndex& _top_left, const QModelIndex& _bottom_right)
+{
+	//
+	// Removing single keys is worth only for a few rows
+	//
+	const int rows = _bottom_right.row () - _top_left.row () + 1;
+	if (rows * CCommitTableModel::_ColumntCount >= m_layouts.size ())
+	{
+		m_layouts.clear ();
+		return;
+	}
+
+	for (int row = _top_left.row (); row <= _bottom_right.row (); ++row)
+		for (int column = 0; column < CCommitTableModel::_ColumntCount; ++column)
+			m_layouts.remove (qint64 (row) * CCommitTableModel::_ColumntCount + column);
+}
+
+QString
+CCommitItemDelegate::cellText (const QModelIndex& _index) const
+{
+	switch (_index.column ())
+	{
+		case CCommitTableModel::_ShortLogColumn:
+			// Tags are painted as badges
+			return _index.data (CCommitTableModel::CommitSummaryRole).toString ();
+
+		case CCommitTableModel::_DateColumn:
+		{
+			const uint time = _index.data (CCommitTableModel::CommitTimeRole).toUInt ();
+			const qint64 age = qint64 (QDateTime::currentDateTime ().toTime_t ()) - time;
+			if ((time == 0) || (age < 0) || (age >= RELATIVE_DATE_SECS))
+				break;
+
+			if (age < 60)
+				return tr ("just now");
+			if (age < 3600)
+				return tr ("%n minute(s) ago", 0, int (age / 60));
+			if (age < 24 * 3600)
+				return tr ("%n hour(s) ago", 0, int (age / 3600));
+
+			return tr ("%n day(s) ago", 0, int (age / (24 * 3600)));
+		}
+	}
+
+	return _index.data (Qt::DisplayRole).toString ();
+}
+
+CCommitItemDelegate::CCellLayout*
+CCommitItemDelegate::layout (const QStyleOptionViewItem& _option, const QModelIndex& _index) const
+{
+	const qint64 key = qint64 (_index.row ()) * CCommitTableModel::_ColumntCount + _index.column ();
+	const int width = _option.rect.width ();
+
+	CCellLayout* cached = m_layouts.object (key);
+	if (cached && (cached->m_width == width))
+		return cached;
+
+	CCellLayout* result = new CCellLayout;
+	result->m_width = width;
+
+	const QFontMetrics& metrics = _option.fontMetrics;
+	int available = width - 2 * CELL_MARGIN;
+
+	//
+	// Side of compared commit (as git log --left-right marks it) and tag badges go before the commit summary
+	//
+	if (_index.column () == CCommitTableModel::_ShortLogColumn)
+	{
+		QStringList badges;
+		switch (_index.data (CCommitTableModel::CommitSideRole).toInt ())
+		{
+			case CCompareWalker::SIDE_LEFT:
+				badges.append ("<");
+				result->m_badge_colors.append (QColor (255, 200, 200));
+				break;
+
+			case CCompareWalker::SIDE_RIGHT:
+				badges.append (">");
+				result->m_badge_colors.append (QColor (200, 255, 200));
+				break;
+
+			case CCompareWalker::SIDE_BOTH:
+				badges.append (tr ("merge base"));
+				result->m_badge_colors.append (QColor (170, 210, 255));
+				break;
+
+			default: break;
+		}
+
+		const QStringList tags = _index.data (CCommitTableModel::CommitTagsRole).toStringList ();
+		badges += tags;
+		foreach (const QString& badge, badges)
+		{
+			const int badge_width = metrics.width (badge) + 2 * BADGE_PADDING;
+			result->m_badges.append (staticText (badge, _option.font));
+			result->m_badge_widths.append (badge_width);
+			available -= badge_width + CELL_MARGIN;
+		}
+
+		// Tagged commits were highlighted with yellow color from the beginning
+		while (result->m_badge_colors.size () < badges.size ())
+			result->m_badge_colors.append (Qt::yellow);
+	}
+
+	const QString text = metrics.elidedText (cellText (_index), Qt::ElideRight, qMax (0, available));
+	result->m_text = staticText (text, _option.font);
+
+	m_layouts.insert (key, result);
+	return result;
+}
+
+void
+CCommitItemDelegate::paint (QPainter* _painter, const QStyleOptionViewItem& _option, const QModelIndex& _index) const
+{
+	//
+	// Let the style paint background, selection and focus; the text is painted from cached layout
+	//
+	QStyleOptionViewItemV4 option = _option;
+	initStyleOption (& option, _index);
+	option.text.clear ();
+
+	const QWidget* widget = option.widget;
+	QStyle* style = widget ? widget->style () : QApplication::style ();
+	style->drawControl (QStyle::CE_ItemViewItem, & option, _painter, widget);
+
+	const CCellLayout* cell = layout (option, _index);
+
+	const QPalette::ColorGroup group = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+	const bool selected = (option.state & QStyle::State_Selected);
+
+	_painter->save ();
+
+	const int text_top = option.rect.top () + (option.rect.height () - option.fontMetrics.height ()) / 2;
+	int x = option.rect.left () + CELL_MARGIN;
+
+	for (int i = 0; i < cell->m_badges.size (); ++i)
+	{
+		const QRect badge (x, option.rect.top () + 1, cell->m_badge_widths [i], option.rect.height () - 2);
+
+		_painter->setPen (Qt::darkGray);
+		_painter->setBrush (cell->m_badge_colors [i]);
+		_painter->drawRect (badge.adjusted (0, 0, -1, -1));
+
+		_painter->setPen (Qt::black);
+		_painter->drawStaticText (x + BADGE_PADDING, text_top, cell->m_badges [i]);
+
+		x += badge.width () + CELL_MARGIN;
+	}
+
+	_painter->setPen (option.palette.color (group, selected ? QPalette::HighlightedText : QPalette::Text));
+	_painter->drawStaticText (x, text_top, cell->m_text);
+
+	_painter->restore ();
+}
+
+QSize
+CCommitItemDelegate::sizeHint (const QStyleOptionViewItem& _option, const QModelIndex& _index) const
+{
+	Q_UNUSED (_option);
+
+	//
+	// Column widths are set by the tab, row height is fixed: no need to lay out the text
+	//
+	return QSize (m_view->columnWidth (_index.column ()), m_row_height);
+}
@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Commit table item delegate with cached text layouts interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITITEMDELEGATE_H
+#define __QGITREPOVIEWER_CCOMMITITEMDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QStaticText>
+#include <QCache>
+#include <QVector>
+#include <QTimer>
+#include <QColor>
+
+namespace QGitRepoViewer
+{
+	class CCommitView;
+
+	/**
+	 * @brief Paints commit table cells from cached QStaticText layouts
+	 *
+	 * Layout of a cell (elided text, side of compared commit and tag badges) is prepared once and reused on every repaint
+	 * until column width, font or row data changes. All rows have the same height.
+	 */
+	class CCommitItemDelegate : public QStyledItemDelegate
+	{
+		Q_OBJECT
+
+		/// Prepared layout of one table cell
+		struct CCellLayout
+		{
+			/// Column width the layout was prepared for
+			int m_width;
+
+			QVector<QStaticText> m_badges;
+			QVector<int> m_badge_widths;
+			QVector<QColor> m_badge_colors;
+			QStaticText m_text;
+		};
+
+		/// View painted by the delegate
+		CCommitView* m_view;
+
+		/// Layouts of visible cells, key is (row * column count + column)
+		mutable QCache<qint64, CCellLayout> m_layouts;
+
+		/// Height of every table row
+		int m_row_height;
+
+		/// Relative commit dates ("5 minutes ago") become stale with time
+		QTimer m_date_timer;
+
+		/// Prepare layout of specified cell
+		CCellLayout* layout (const QStyleOptionViewItem& _option, const QModelIndex& _index) const;
+
+		/// Text of the cell: plain summary for log column, relative date for recent commits
+		QString cellText (const QModelIndex& _index) const;
+
+		void updateRowHeight ();
+
+	protected:
+		/// Track font changes of the view
+		bool eventFilter (QObject* _object, QEvent* _event);
+
+	private slots:
+		/// Forget all prepared layouts and repaint the view
+		void invalidate ();
+
+		/// Forget layouts of changed rows
+		void aboutDataChanged (const QModelIndex& _top_left, const QModelIndex& _bottom_right);
+
+	public:
+		/// Count of cell layouts kept in cache (several screens of rows)
+		enum { MAX_CACHED_CELLS = 4096 };
+
+		/// Dates newer than this are shown relative to current time
+		enum { RELATIVE_DATE_SECS = 7 * 24 * 3600 };
+
+		explicit CCommitItemDelegate (CCommitView* _view);
+
+		/// Attach to the view model and header; must be called after model was set
+		void install ();
+
+		/// Fixed height of every table row
+		int rowHeight () const;
+
+		void paint (QPainter* _painter, const QStyleOptionViewItem& _option, const QModelIndex& _index) const;
+		QSize sizeHint (const QStyleOptionViewItem& _option, const QModelIndex& _index) const;
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMMITITEMDELEGATE_H
@@ -0,0 +1,393 @@
+/**
+ * @file
+ * @brief Background loading of branch commit list implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitLoader.h"
+
+#include <QFile>
+#include <QDir>
+
+#include <limits.h>
+
+#include <git2.h>
+
+#include "CCommitWalker.h"
+#include "CCompareWalker.h"
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
+CCommitLoadJob::CCommitLoadJob (const QString& _repo_path, const QStringList& _branch_names,
+								QObject* _receiver, int _generation, const CCommitWalkFilter& _filter, bool _compare):
+	m_repo_path (_repo_path),
+	m_branch_names (_branch_names),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_compare (_compare && (_branch_names.size () == 2)),
+	m_walked (0),
+	m_filter (_filter)
+{
+	QString path = QDir::fromNativeSeparators (m_filter.m_path);
+	while (path.endsWith ('/'))
+		path.chop (1);
+	m_filter_path = path.toUtf8 ();
+}
+
+CCommitLoadJob::~CCommitLoadJob ()
+{}
+
+quint32
+CCommitLoadJob::internBranchSet (const QByteArray& _branches, CCommitKeyBatch& _batch)
+{
+	QHash<QByteArray, quint32>::const_iterator iSet = m_branch_set_ids.constFind (_branches);
+	if (iSet == m_branch_set_ids.constEnd ())
+	{
+		iSet = m_branch_set_ids.insert (_branches, quint32 (m_branch_set_ids.size ()));
+		_batch.m_new_branch_sets.append (_branches);
+	}
+
+	return iSet.value ();
+}
+
+quint32
+CCommitLoadJob::branchSet (const CGitOid& _commit, const CGitOidVector& _parents, CCommitKeyBatch& _batch)
+{
+	//
+	// Topological order: all children were walked, so the set of the commit is complete
+	//
+	const QByteArray branches = m_pending_branches.take (_commit);
+	foreach (const CGitOid& parent, _parents)
+	{
+		QByteArray& parent_branches = m_pending_branches [parent];
+		if (parent_branches.isEmpty ())
+			parent_branches = branches;
+		else
+			for (int i = 0; i < branches.size (); ++i)
+				parent_branches [i] = char (parent_branches [i] | branches [i]);
+	}
+
+	return internBranchSet (branches, _batch);
+}
+
+bool
+CCommitLoadJob::readCommit (const CGitOid& _id, CCommitHeader& _header, QByteArray* _message)
+{
+	if (m_pack_reader.readHeader (_id, _header))
+	{
+		if (_message)
+			*_message = m_pack_reader.lastMessage ();
+
+		return true;
+	}
+
+	git_commit* commit = NULL;
+	if (git_commit_lookup (& commit, m_repo.handle (), _id.raw ()) != GIT_OK)
+		return false;
+
+	const git_signature* author = git_commit_author (commit);
+	if (author)
+		_header.m_author = QString::fromUtf8 (author->name) + " <" + QString::fromUtf8 (author->email) + ">";
+
+	const git_signature* committer = git_commit_committer (commit);
+	if (committer)
+		_header.m_committer = QString::fromUtf8 (committer->name) + " <" + QString::fromUtf8 (committer->email) + ">";
+
+	_header.m_time = uint (git_commit_time (commit));
+
+	_header.m_parents.clear ();
+	const unsigned int parent_count = git_commit_parentcount (commit);
+	for (unsigned int i = 0; i < parent_count; ++i)
+		_header.m_parents.append (CGitOid (git_commit_parent_id (commit, i)));
+
+	if (_message)
+		*_message = QByteArray (git_commit_message (commit));
+
+	git_commit_free (commit);
+	return true;
+}
+
+CGitOid
+CCommitLoadJob::pathEntry (const CGitOid& _commit)
+{
+	CGitOid result;
+
+	git_commit* commit = NULL;
+	git_tree* tree = NULL;
+	git_tree_entry* entry = NULL;
+	if ((git_commit_lookup (& commit, m_repo.handle (), _commit.raw ()) == GIT_OK)
+		&& (git_commit_tree (& tree, commit) == GIT_OK)
+		&& (git_tree_entry_bypath (& entry, tree, m_filter_path.constData ()) == GIT_OK))
+		result = CGitOid (git_tree_entry_id (entry));
+
+	git_tree_entry_free (entry);
+	git_tree_free (tree);
+	git_commit_free (commit);
+	return result;
+}
+
+bool
+CCommitLoadJob::changesPath (const CGitOid& _commit, const CGitOidVector& _parents)
+{
+	//
+	// Most commits don't touch the path, and their filters tell it without trees
+	//
+	if (m_path_index.mayChange (_commit) == CChangedPathIndex::NOT_CHANGED)
+	{
+		m_path_entries.remove (_commit);
+		return false;
+	}
+
+	// Entry of the commit was looked up when its child was walked
+	QHash<CGitOid, CGitOid>::iterator iEntry = m_path_entries.find (_commit);
+	CGitOid entry;
+	if (iEntry != m_path_entries.end ())
+	{
+		entry = iEntry.value ();
+		m_path_entries.erase (iEntry);
+	}
+	else
+		entry = pathEntry (_commit);
+
+	if (_parents.isEmpty ())
+		return ! entry.isNull ();
+
+	//
+	// Like git log: the commit is shown unless the path is the same as in any of its parents
+	//
+	bool changed = true;
+	foreach (const CGitOid& parent, _parents)
+	{
+		iEntry = m_path_entries.find (parent);
+		if (iEntry == m_path_entries.end ())
+			iEntry = m_path_entries.insert (parent, pathEntry (parent));
+
+		if (iEntry.value () == entry)
+			changed = false;
+	}
+
+	return changed;
+}
+
+CCommitKeyBatch
+CCommitLoadJob::sortKeys (CGitOidVector& _batch)
+{
+	CCommitKeyBatch result;
+	result.m_keys.reserve (_batch.size ());
+
+	const bool filtered = ! m_filter.isEmpty ();
+	const bool need_message = ! m_filter.m_message.isEmpty ();
+	const uint date_to = (m_filter.m_date_to > 0) ? m_filter.m_date_to : UINT_MAX;
+
+	int accepted = 0;
+	QByteArray message;
+	for (int i = 0; i < _batch.size (); ++i)
+	{
+		//
+		// Zeroed key would sort unreadable commit as the oldest one by nobody, and without parents
+		// its ancestors would lose branch membership: such commit is not shown
+		//
+		CCommitHeader header;
+		if (! readCommit (_batch [i], header, need_message ? & message : NULL))
+		{
+			CDiagnostics::instance ()->post (QObject::tr ("Commits"),
+											 QObject::tr ("Can't read commit %1, it is not shown").arg (_batch [i].toString ()));
+			continue;
+		}
+
+		QHash<QString, quint32>::const_iterator iAuthor = m_author_ids.constFind (header.m_author);
+		if (iAuthor == m_author_ids.constEnd ())
+		{
+			iAuthor = m_author_ids.insert (header.m_author, quint32 (m_author_ids.size ()));
+			result.m_new_authors.append (header.m_author);
+		}
+
+		CCommitSortKey key;
+		key.m_author = iAuthor.value ();
+		key.m_time = header.m_time;
+
+		// Every commit of single branch belongs to it; membership passes through rejected commits too
+		if (m_compare)
+			key.m_branches = internBranchSet (QByteArray (1, char (m_sides [i])), result);
+		else if (m_branch_names.size () > 1)
+			key.m_branches = branchSet (_batch [i], header.m_parents, result);
+		else
+		{
+			if (m_branch_set_ids.isEmpty ())
+			{
+				m_branch_set_ids.insert (QByteArray (1, '\x01'), 0);
+				result.m_new_branch_sets.append (QByteArray (1, '\x01'));
+			}
+			key.m_branches = 0;
+		}
+
+		if (filtered)
+		{
+			//
+			// Cheap checks first: time, author id, committer; then message and trees
+			//
+			if ((key.m_time < m_filter.m_date_from) || (key.m_time > date_to))
+				continue;
+
+			if (! m_filter.m_author.isEmpty ())
+			{
+				if (int (key.m_author) >= m_author_accepted.size ())
+					m_author_accepted.resize (int (key.m_author) + 1);
+				qint8& author_accepted = m_author_accepted [int (key.m_author)];
+				if (author_accepted == 0)
+					author_accepted = header.m_author.contains (m_filter.m_author, Qt::CaseInsensitive) ? 1 : -1;
+				if (author_accepted < 0)
+					continue;
+			}
+
+			if (! m_filter.m_committer.isEmpty ())
+			{
+				QHash<QString, bool>::const_iterator iCommitter = m_committer_accepted.constFind (header.m_committer);
+				if (iCommitter == m_committer_accepted.constEnd ())
+					iCommitter = m_committer_accepted.insert (header.m_committer,
+															  header.m_committer.contains (m_filter.m_committer, Qt::CaseInsensitive));
+				if (! iCommitter.value ())
+					continue;
+			}
+
+			if (need_message && !QString::fromUtf8 (message.constData (), message.size ()).contains (m_filter.m_message))
+				continue;
+
+			if (! m_filter_path.isEmpty () && !changesPath (_batch [i], header.m_parents))
+				continue;
+		}
+
+		_batch [accepted++] = _batch [i];
+		result.m_keys.append (key);
+	}
+
+	_batch.resize (accepted);
+	return result;
+}
+
+bool
+CCommitLoadJob::startWalk ()
+{
+	if (! m_repo.open (m_repo_path, true))
+	{
+		post (m_receiver, "finishLoading", Q_ARG (int, m_generation), Q_ARG (QString, m_repo.lastError ()));
+		return false;
+	}
+
+	//
+	// Tags are needed to render the very first rows: send them before commits
+	//
+	post (m_receiver, "setTags", Q_ARG (int, m_generation), Q_ARG (CGitTagMap, m_repo.enumCommitTags ()));
+
+	const QString git_dir = QFile::decodeName (git_repository_path (m_repo.handle ()));
+	m_pack_reader.open (git_dir + "objects");
+	if (! m_filter_path.isEmpty ())
+	{
+		m_path_index.open (git_dir);
+		m_path_index.setPath (m_filter.m_path);
+	}
+
+	if (m_compare)
+	{
+		m_compare_walker.reset (new CCompareWalker (m_repo.handle (), & m_pack_reader));
+		if (! m_compare_walker->lookupTip (m_branch_names [0], m_tips [0])
+				|| !m_compare_walker->lookupTip (m_branch_names [1], m_tips [1]))
+		{
+			post (m_receiver, "finishLoading", Q_ARG (int, m_generation), Q_ARG (QString, m_compare_walker->lastError ()));
+			return false;
+		}
+
+		//
+		// Memoized merge bases are shown before the walk reaches them
+		//
+		CMergeBase known;
+		if (CMergeBaseCache::instance ()->find (m_tips [0], m_tips [1], known))
+			post (m_receiver, "setMergeBases", Q_ARG (int, m_generation), Q_ARG (CGitOidVector, known.m_bases),
+				  Q_ARG (int, known.m_left_only), Q_ARG (int, known.m_right_only));
+
+		m_compare_walker->start (m_tips [0], m_tips [1], known.m_bases);
+		return true;
+	}
+
+	m_walker.reset (new CCommitWalker (m_repo.handle ()));
+	for (int branch = 0; branch < m_branch_names.size (); ++branch)
+	{
+		CGitOid tip;
+		if (! m_walker->pushBranch (m_branch_names [branch], & tip))
+		{
+			post (m_receiver, "finishLoading", Q_ARG (int, m_generation), Q_ARG (QString, m_walker->lastError ()));
+			return false;
+		}
+
+		// Tip starts membership of its branch
+		QByteArray& branches = m_pending_branches [tip];
+		if (branches.isEmpty ())
+			branches.fill ('\0', (m_branch_names.size () + 7) / 8);
+		branches [branch / 8] = char (branches [branch / 8] | (1 << (branch % 8)));
+	}
+
+	return true;
+}
+
+bool
+CCommitLoadJob::compareStep ()
+{
+	const int batch_size = (m_walked == 0) ? FIRST_BATCH_SIZE : BATCH_SIZE;
+	CGitOidVector batch;
+	batch.reserve (batch_size);
+	m_sides.clear ();
+	m_walked += m_compare_walker->next (batch, m_sides, batch_size);
+
+	const CCommitKeyBatch keys = sortKeys (batch);
+	if (! batch.isEmpty () || !keys.m_new_authors.isEmpty () || !keys.m_new_branch_sets.isEmpty ())
+		post (m_receiver, "appendCommits", Q_ARG (int, m_generation), Q_ARG (CGitOidVector, batch),
+			  Q_ARG (CCommitKeyBatch, keys));
+
+	if (! m_compare_walker->atEnd ())
+		return true;
+
+	// Counts don't depend on walk filter: the walker counts commits before they are filtered
+	const CMergeBase& result = m_compare_walker->result ();
+	CMergeBaseCache::instance ()->insert (m_tips [0], m_tips [1], result);
+	post (m_receiver, "setMergeBases", Q_ARG (int, m_generation), Q_ARG (CGitOidVector, result.m_bases),
+		  Q_ARG (int, result.m_left_only), Q_ARG (int, result.m_right_only));
+	post (m_receiver, "finishLoading", Q_ARG (int, m_generation), Q_ARG (QString, QString ()));
+	return false;
+}
+
+bool
+CCommitLoadJob::step ()
+{
+	//
+	// Open repository and setup walker on the first step
+	//
+	if (! m_walker && !m_compare_walker && !startWalk ())
+		return false;
+
+	if (m_compare_walker)
+		return compareStep ();
+
+	//
+	// Send next batch of commit ids which passed the filter
+	//
+	const int batch_size = (m_walked == 0) ? FIRST_BATCH_SIZE : BATCH_SIZE;
+	CGitOidVector batch;
+	batch.reserve (batch_size);
+
+	int count = m_walker->next (batch, batch_size);
+	m_walked += count;
+
+	const CCommitKeyBatch keys = sortKeys (batch);
+	if (! batch.isEmpty () || !keys.m_new_authors.isEmpty () || !keys.m_new_branch_sets.isEmpty ())
+		post (m_receiver, "appendCommits", Q_ARG (int, m_generation), Q_ARG (CGitOidVector, batch),
+			  Q_ARG (CCommitKeyBatch, keys));
+
+	if (count < batch_size)
+	{
+		post (m_receiver, "finishLoading", Q_ARG (int, m_generation),
+			  Q_ARG (QString, m_walker->hasFailed () ? m_walker->lastError () : QString ()));
+		return false;
+	}
+
+	return true;
+}
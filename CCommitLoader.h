@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @brief Background loading of branch commit list interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITLOADER_H
+#define __QGITREPOVIEWER_CCOMMITLOADER_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QHash>
+#include <QRegExp>
+
+#include "CWorkerPool.h"
+#include "CPackCommitReader.h"
+#include "CChangedPathIndex.h"
+#include "GitHelpers.h"
+
+namespace QGitRepoViewer
+{
+	class CCommitWalker;
+	class CCompareWalker;
+
+	/// Integer sort keys of one commit; topological index is the position in load order
+	struct CCommitSortKey
+	{
+		/// Interned author ("Name <email>") id
+		quint32 m_author;
+
+		/// Committer time, seconds since epoch
+		quint32 m_time;
+
+		/// Interned set of loaded branches containing the commit
+		quint32 m_branches;
+	};
+
+	typedef QVector<CCommitSortKey> CCommitKeyVector;
+
+	/// Sort keys of one batch of commits and the authors first met in it
+	struct CCommitKeyBatch
+	{
+		CCommitKeyVector m_keys;
+
+		/// Authors interned by this batch; their ids continue the ids of previous batches
+		QStringList m_new_authors;
+
+		/// Branch sets interned by this batch (bit i of byte i / 8 is set for i-th loaded branch)
+		QList<QByteArray> m_new_branch_sets;
+	};
+
+	/// Conditions checked while walking history: rejected commits are not sent to the receiver at all
+	struct CCommitWalkFilter
+	{
+		/// Substrings of author and committer "Name <email>" (case insensitive)
+		QString m_author;
+		QString m_committer;
+
+		/// Pattern searched in full commit message
+		QRegExp m_message;
+
+		/// Committer time range, seconds since epoch (0 means unbounded)
+		uint m_date_from;
+		uint m_date_to;
+
+		/// File or directory changed by commit, relative to repository root
+		QString m_path;
+
+		CCommitWalkFilter (): m_date_from (0), m_date_to (0)
+		{}
+
+		bool isEmpty () const
+		{
+			return m_author.isEmpty () && m_committer.isEmpty () && m_message.isEmpty ()
+					&& (m_date_from == 0) && (m_date_to == 0) && m_path.isEmpty ();
+		}
+	};
+
+	/**
+	 * @brief Walks history of one or several branches on worker pool and streams commit ids to the receiver
+	 *
+	 * Tips of all branches are pushed into one revision walk, so every commit is read once whatever count
+	 * of branches contains it. Branch membership flows from children to parents in topological order.
+	 *
+	 * Commits rejected by walk filter are dropped before they are sent; filter conditions are checked
+	 * from the cheapest (time, interned author) to the most expensive (message, tree lookups for the path).
+	 *
+	 * Receiver must have slots setTags(int,CGitTagMap), appendCommits(int,CGitOidVector,CCommitKeyBatch) and
+	 * finishLoading(int,QString);
+	 * the first argument is the generation passed to constructor, so the receiver can drop
+	 * batches of outdated loads which were queued before cancel().
+	 *
+	 * In compare mode two branches are given and only commits of one of them are loaded (A...B), together
+	 * with their merge bases; branch set of a commit tells its side. Receiver slot
+	 * setMergeBases(int,CGitOidVector,int,int) gets merge bases and counts of commits of each side:
+	 * at once if they are memoized for these tips, and when the walk ends.
+	 */
+	class CCommitLoadJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		QStringList m_branch_names;
+		QObject* m_receiver;
+		int m_generation;
+
+		/// Own repository handle: the walk state moves between pool threads
+		CGitRepository m_repo;
+		QScopedPointer<CCommitWalker> m_walker;
+
+		/// Two-sided walk of compare mode and sides of commits of the current batch
+		bool m_compare;
+		QScopedPointer<CCompareWalker> m_compare_walker;
+		QVector<int> m_sides;
+		CGitOid m_tips [2];
+
+		/// Reads sort keys of packed commits without libgit2 objects
+		CPackCommitReader m_pack_reader;
+
+		/// Author ids assigned so far
+		QHash<QString, quint32> m_author_ids;
+
+		/// Branches containing not yet walked commits whose children were walked (seeded by branch tips)
+		QHash<CGitOid, QByteArray> m_pending_branches;
+
+		/// Branch set ids assigned so far
+		QHash<QByteArray, quint32> m_branch_set_ids;
+
+		/// Id of branch set, adding it to the batch if it is new
+		quint32 internBranchSet (const QByteArray& _branches, CCommitKeyBatch& _batch);
+
+		/// Intern branch set of the walked commit and pass it to parents
+		quint32 branchSet (const CGitOid& _commit, const CGitOidVector& _parents, CCommitKeyBatch& _batch);
+
+		/// Count of walked commits
+		int m_walked;
+
+		/// Walk filter; path is kept in UTF-8 for libgit2
+		CCommitWalkFilter m_filter;
+		QByteArray m_filter_path;
+
+		/// Whether interned author ids pass the filter: 1 if they do, -1 if they don't, 0 if not checked yet
+		QVector<qint8> m_author_accepted;
+
+		/// Whether committers pass the filter
+		QHash<QString, bool> m_committer_accepted;
+
+		/// Ids of filtered path entry in trees of walked commits' parents
+		QHash<CGitOid, CGitOid> m_path_entries;
+
+		/// Changed-path filters rejecting commits which don't touch filtered path without reading trees
+		CChangedPathIndex m_path_index;
+
+		/// Read headers of commit (and its message if asked) from pack or by libgit2
+		bool readCommit (const CGitOid& _id, CCommitHeader& _header, QByteArray* _message);
+
+		/// Id of filtered path entry in the tree of commit (null if there is no such path)
+		CGitOid pathEntry (const CGitOid& _commit);
+
+		/// Check whether the commit changes filtered path compared to all its parents
+		bool changesPath (const CGitOid& _commit, const CGitOidVector& _parents);
+
+		/// Compute sort keys of the batch, interning new authors; commits rejected by the filter are removed
+		CCommitKeyBatch sortKeys (CGitOidVector& _batch);
+
+		/// Setup walker on the first step; false if it failed
+		bool startWalk ();
+
+		/// Send the next batch of compared commits; false at the end
+		bool compareStep ();
+
+	protected:
+		bool step ();
+
+	public:
+		/// First batch is small to show first screen as soon as possible
+		enum { FIRST_BATCH_SIZE = 256, BATCH_SIZE = 8192 };
+
+		CCommitLoadJob (const QString& _repo_path, const QStringList& _branch_names, QObject* _receiver, int _generation,
+						const CCommitWalkFilter& _filter = CCommitWalkFilter (), bool _compare = false);
+		~CCommitLoadJob ();
+	};
+}
+
+Q_DECLARE_TYPEINFO (QGitRepoViewer::CCommitSortKey, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE (QGitRepoViewer::CCommitKeyBatch)
+
+#endif // __QGITREPOVIEWER_CCOMMITLOADER_H
@@ -10,12 +10,25 @@
 #include <QFile>
 #include <QTranslator>
 #include <QDateTime>
-#include <QMessageBox>
+#include <QDataStream>
+#include <QThreadPool>
+#include <QThread>
+#include <QRunnable>
 
+#include <algorithm>
+#include <limits.h>
+#include <string.h>
 #include <git2.h>
 
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
 #define GIT_USER_ERROR 1
 
+/// Message index file name in the git directory
+#define MESSAGE_INDEX_FILE "qgitrepoviewer-messages.idx"
+
 static QString getGitError (int _error_code, const QString& _action)
 {
 	QString git_error_str;
@@ -29,270 +42,1645 @@ static QString getGitError (int _error_code, const QString& _action)
 	}
 	else if (_error_code == GIT_USER_ERROR)
 	{
-		const git_error* error = giterr_last ();
-		git_error_str = QString ("Error during %1:\n %3")
-						.arg (_action)
-						.arg ((error && error->message) ? QString::fromUtf8 (error->message) : "<Unknown>");
+		const git_error* error = giterr_last ();
+		git_error_str = QString ("Error during %1:\n %3")
+						.arg (_action)
+						.arg ((error && error->message) ? QString::fromUtf8 (error->message) : "<Unknown>");
+	}
+
+	return git_error_str;
+}
+
+/// Report the error to diagnostics panel: it never blocks, so it may be called from data()
+static void postGitError (int _error_code, const QString& _action)
+{
+	CDiagnostics::instance ()->post (QTranslator::tr ("Commits"), getGitError (_error_code, _action));
+}
+
+static git_commit* resolveCommit (const CGitOid& _commit_id, git_repository* _repo)
+{
+	git_commit* commit = NULL;
+	int error_code = git_commit_lookup (& commit, _repo, _commit_id.raw ());
+	if (error_code != GIT_OK)
+	{
+		commit = NULL;
+		postGitError (error_code, QTranslator::tr ("looking up commit %1").arg (_commit_id.toString ()));
+	}
+
+	return commit;
+}
+
+/// Returns the short of full changelog of specified commit
+static QString commitLog (git_commit* _commit, bool _short = false)
+{
+	QString commit_log = QString::fromUtf8 (git_commit_message (_commit));
+	commit_log.replace ("\n", "<br>");
+	if (commit_log.right (4) == "<br>")
+		commit_log.remove (commit_log.length() - 4, 4);
+
+	if (_short)
+	{
+		int line_end = commit_log.indexOf ("<br>");
+		if (line_end != -1)
+			commit_log = commit_log.left (line_end);
+	}
+
+	return commit_log;
+}
+
+/// Returns the author (name + email) of specified commit
+static QString commitAuthor (git_commit* _commit)
+{
+	QString commit_author;
+	const git_signature* author = git_commit_author (_commit);
+	if (author)
+		commit_author = QString::fromUtf8 (author->name)
+						+ QString (" <") + QString::fromUtf8 (author->email) + ">";
+
+	return commit_author;
+}
+
+/// Returns the date of commit with specified time
+static QString commitDate (uint _time)
+{
+	QDateTime dateTime;
+	dateTime.setTime_t (_time);
+	return dateTime.toString ();
+}
+
+namespace
+{
+	/// Compares commit indices by precomputed keys; ties are broken by load order
+	struct CCommitLess
+	{
+		const CCommitSortKey* m_keys;
+		const int* m_author_rank;
+		int m_column;
+		bool m_descending;
+
+		bool operator () (int _a, int _b) const
+		{
+			if (m_descending)
+				qSwap (_a, _b);
+
+			switch (m_column)
+			{
+				case CCommitTableModel::_AuthorColumn:
+				{
+					const int a = m_author_rank [m_keys [_a].m_author];
+					const int b = m_author_rank [m_keys [_b].m_author];
+					if (a != b)
+						return a < b;
+
+					break;
+				}
+
+				case CCommitTableModel::_DateColumn:
+					if (m_keys [_a].m_time != m_keys [_b].m_time)
+						return m_keys [_a].m_time < m_keys [_b].m_time;
+
+					break;
+			}
+
+			return _a < _b;
+		}
+	};
+
+	/// Compares interned author ids by author names
+	struct CAuthorLess
+	{
+		const QStringList& m_authors;
+
+		CAuthorLess (const QStringList& _authors): m_authors (_authors)
+		{}
+
+		bool operator () (int _a, int _b) const
+		{
+			const int cmp = QString::compare (m_authors [_a], m_authors [_b], Qt::CaseInsensitive);
+			return (cmp != 0) ? (cmp < 0) : (_a < _b);
+		}
+	};
+
+	/// Compares commit index with timestamp for binary search in time index
+	struct CTimeLess
+	{
+		const CCommitSortKey* m_keys;
+
+		explicit CTimeLess (const CCommitSortKey* _keys): m_keys (_keys)
+		{}
+
+		bool operator () (int _commit, uint _time) const
+		{
+			return m_keys [_commit].m_time < _time;
+		}
+
+		bool operator () (uint _time, int _commit) const
+		{
+			return _time < m_keys [_commit].m_time;
+		}
+	};
+
+	/// Compares commit indices by their SHA-1 ids
+	struct COidLess
+	{
+		const CGitOid* m_oids;
+
+		explicit COidLess (const CGitOid* _oids): m_oids (_oids)
+		{}
+
+		bool operator () (int _a, int _b) const
+		{
+			return m_oids [_a] < m_oids [_b];
+		}
+
+		bool operator () (int _commit, const CGitOid& _oid) const
+		{
+			return m_oids [_commit] < _oid;
+		}
+	};
+
+	/// Parse hexadecimal SHA-1 prefix; returns the count of hex digits or 0 if it is not a valid prefix
+	int parseOidPrefix (const QString& _prefix, CGitOid& _oid)
+	{
+		const int digits = _prefix.length ();
+		if (digits > CGitOid::HEX_SIZE)
+			return 0;
+
+		memset (_oid.m_id, 0, CGitOid::RAW_SIZE);
+		for (int i = 0; i < digits; ++i)
+		{
+			const ushort c = _prefix [i].unicode ();
+			int value = 0;
+			if ((c >= '0') && (c <= '9'))
+				value = c - '0';
+			else if ((c >= 'a') && (c <= 'f'))
+				value = c - 'a' + 10;
+			else if ((c >= 'A') && (c <= 'F'))
+				value = c - 'A' + 10;
+			else
+				return 0;
+
+			_oid.m_id [i / 2] |= uchar ((i % 2) ? value : (value << 4));
+		}
+
+		return digits;
+	}
+
+	/// Check whether the first _digits hex digits of ids are equal
+	bool prefixMatches (const CGitOid& _oid, const CGitOid& _prefix, int _digits)
+	{
+		if (memcmp (_oid.m_id, _prefix.m_id, _digits / 2) != 0)
+			return false;
+
+		return ((_digits % 2) == 0) || ((_oid.m_id [_digits / 2] & 0xf0) == _prefix.m_id [_digits / 2]);
+	}
+
+	/// Rank author ids by name: they are interned in order of appearance
+	void rankAuthors (const QStringList& _authors, QVector<int>& _author_rank)
+	{
+		QVector<int> authors (_authors.size ());
+		for (int id = 0; id < authors.size (); ++id)
+			authors [id] = id;
+		std::sort (authors.begin (), authors.end (), CAuthorLess (_authors));
+
+		_author_rank.resize (authors.size ());
+		for (int rank = 0; rank < authors.size (); ++rank)
+			_author_rank [authors [rank]] = rank;
+	}
+
+	/// Prepare comparator for specified column; author ranks are used only by the author column
+	CCommitLess commitLess (const CCommitKeyVector& _keys, const QVector<int>& _author_rank, int _column, bool _descending)
+	{
+		CCommitLess less;
+		less.m_keys = _keys.constData ();
+		less.m_author_rank = _author_rank.constData ();
+		less.m_column = _column;
+		less.m_descending = _descending;
+		return less;
+	}
+
+	/// Sorts one chunk of commit indices
+	template <class TLess>
+	class CSortTask : public QRunnable
+	{
+		int* m_begin;
+		int* m_end;
+		const TLess& m_less;
+
+	public:
+		CSortTask (int* _begin, int* _end, const TLess& _less):
+			m_begin (_begin), m_end (_end), m_less (_less)
+		{}
+
+		void run ()
+		{
+			std::sort (m_begin, m_end, m_less);
+		}
+	};
+
+	/// Merges two adjacent sorted chunks of source array into the same place of destination one
+	template <class TLess>
+	class CMergeTask : public QRunnable
+	{
+		const int* m_src;
+		int* m_dst;
+		int m_begin;
+		int m_middle;
+		int m_end;
+		const TLess& m_less;
+
+	public:
+		CMergeTask (const int* _src, int* _dst, int _begin, int _middle, int _end, const TLess& _less):
+			m_src (_src), m_dst (_dst), m_begin (_begin), m_middle (_middle), m_end (_end), m_less (_less)
+		{}
+
+		void run ()
+		{
+			std::merge (m_src + m_begin, m_src + m_middle, m_src + m_middle, m_src + m_end, m_dst + m_begin, m_less);
+		}
+	};
+
+	/// Sort chunks on all cores, then merge them pairwise; needs only one temporary buffer
+	template <class TLess>
+	void parallelSort (QVector<int>& _order, const TLess& _less)
+	{
+		const int count = _order.size ();
+		const int threads = qMax (1, QThread::idealThreadCount ());
+		if ((count < CCommitTableModel::PARALLEL_SORT_MIN) || (threads == 1))
+		{
+			std::sort (_order.begin (), _order.end (), _less);
+			return;
+		}
+
+		// Own pool: the worker pool may be busy with loading jobs
+		QThreadPool pool;
+		pool.setMaxThreadCount (threads);
+
+		QVector<int> bounds;
+		for (int i = 0; i <= threads; ++i)
+			bounds.append (int (qint64 (count) * i / threads));
+
+		int* data = _order.data ();
+		for (int i = 0; i < threads; ++i)
+			pool.start (new CSortTask<TLess> (data + bounds [i], data + bounds [i + 1], _less));
+		pool.waitForDone ();
+
+		QVector<int> buffer (count);
+		int* src = data;
+		int* dst = buffer.data ();
+		while (bounds.size () > 2)
+		{
+			QVector<int> merged;
+			for (int i = 0; i + 1 < bounds.size (); i += 2)
+			{
+				merged.append (bounds [i]);
+				if (i + 2 < bounds.size ())
+					pool.start (new CMergeTask<TLess> (src, dst, bounds [i], bounds [i + 1], bounds [i + 2], _less));
+				else
+					// Odd chunk goes to the next level as is
+					memcpy (dst + bounds [i], src + bounds [i], (bounds [i + 1] - bounds [i]) * sizeof (int));
+			}
+			merged.append (count);
+			pool.waitForDone ();
+
+			bounds = merged;
+			qSwap (src, dst);
+		}
+
+		if (src != data)
+			memcpy (data, src, count * sizeof (int));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CCommitTableModel::CCommitTableModel (QObject* _parent):
+	QAbstractTableModel (_parent),
+	m_ordered (false),
+	m_sort_column (-1),
+	m_sort_order (Qt::AscendingOrder),
+	m_author_filter_id (-1),
+	m_date_filter (false),
+	m_date_from (0),
+	m_date_to (0),
+	m_pickaxe_filter (false),
+	m_sorted_rows (0),
+	m_repo (NULL),
+	m_generation (0),
+	m_loading (false),
+	m_active (true),
+	m_compare (false),
+	m_merge_base_known (false),
+	m_snapshot_active (false),
+	m_index_generation (0),
+	m_path_filter_generation (0),
+	m_pickaxe_generation (0),
+	m_pickaxe_running (0),
+	m_pickaxe_total (0),
+	m_pickaxe_checked (0)
+{
+	qRegisterMetaType<CGitOidVector> ("CGitOidVector");
+	qRegisterMetaType<QVector<int> > ("QVector<int>");
+	qRegisterMetaType<CGitTagMap> ("CGitTagMap");
+	qRegisterMetaType<CCommitKeyBatch> ("CCommitKeyBatch");
+
+	m_resort_timer.setSingleShot (true);
+	m_resort_timer.setInterval (RESORT_DELAY_MS);
+	connect (&m_resort_timer, SIGNAL (timeout ()), this, SLOT (resort ()));
+
+	CMemoryBudget::instance ()->registerClient (this);
+}
+
+CCommitTableModel::~CCommitTableModel ()
+{
+	cancelLoading ();
+	if (m_index_job)
+		m_index_job->cancel ();
+	if (m_path_filter_job)
+		m_path_filter_job->cancel ();
+	cancelPickaxeSearch ();
+	CMemoryBudget::instance ()->unregisterClient (this);
+
+	if (m_repo)
+		git_repository_free (m_repo);
+}
+
+void CCommitTableModel::setGitRepo (const QString& _repo_path)
+{
+	cancelLoading ();
+	if (m_repo)
+	{
+		git_repository_free (m_repo);
+		m_repo = NULL;
+	}
+
+	if (m_index_job)
+	{
+		m_index_job->cancel ();
+		m_index_job.clear ();
+	}
+	++m_index_generation;
+	m_message_index.close ();
+	m_message_index_path.clear ();
+
+	if (m_path_filter_job)
+	{
+		m_path_filter_job->cancel ();
+		m_path_filter_job.clear ();
+	}
+	++m_path_filter_generation;
+
+	// Commits searched so far stay shown until the new list replaces them
+	stopPickaxeSearch ();
+
+	m_repo_path = _repo_path;
+	int error_code = git_repository_open_ext (& m_repo, QFile::encodeName (_repo_path),
+											  GIT_REPOSITORY_OPEN_CROSS_FS, NULL);
+	if (error_code != GIT_OK)
+	{
+		postGitError (error_code, tr ("opening repository"));
+		m_pack_reader.close ();
+		return;
+	}
+
+	m_pack_reader.open (QFile::decodeName (git_repository_path (m_repo)) + "objects");
+
+	m_message_index_path = QFile::decodeName (git_repository_path (m_repo)) + MESSAGE_INDEX_FILE;
+	m_message_index.open (m_message_index_path);
+}
+
+int CCommitTableModel::commitIndex (const QString _commit_id, int _from, int _to) const
+{
+	const CGitOid oid = CGitOid::fromString (_commit_id);
+
+	//
+	// Rows of a just inserted batch are scanned: indexing all ids on every batch would be quadratic
+	// over the load
+	//
+	if (_to >= 0)
+	{
+		const int last = qMin (_to, rowCount () - 1);
+		for (int row = qMax (_from, 0); row <= last; ++row)
+		{
+			if (m_commits [commitAt (row)] == oid)
+				return row;
+		}
+
+		return -1;
+	}
+
+	//
+	// Binary search in the index of ids instead of scanning the rows
+	//
+	const QVector<int>& by_oid = oidIndex ();
+	QVector<int>::const_iterator found = std::lower_bound (by_oid.constBegin (), by_oid.constEnd (), oid,
+															COidLess (m_commits.constData ()));
+	if ((found == by_oid.constEnd ()) || (m_commits [*found] != oid))
+		return -1;
+
+	const int row = rowOfCommit (*found);
+	return (row >= qMax (_from, 0)) ? row : -1;
+}
+
+QList<int> CCommitTableModel::commitRowsByPrefix (const QString& _prefix, int _max_count) const
+{
+	QList<int> rows;
+
+	CGitOid prefix;
+	const int digits = parseOidPrefix (_prefix, prefix);
+	if (digits < MIN_PREFIX_LENGTH)
+		return rows;
+
+	//
+	// Ids with the prefix make a contiguous range of the index starting from the zero-padded prefix
+	//
+	const QVector<int>& by_oid = oidIndex ();
+	QVector<int>::const_iterator iCommit = std::lower_bound (by_oid.constBegin (), by_oid.constEnd (), prefix,
+															  COidLess (m_commits.constData ()));
+	for (; (iCommit != by_oid.constEnd ()) && (rows.size () < _max_count); ++iCommit)
+	{
+		if (! prefixMatches (m_commits [*iCommit], prefix, digits))
+			break;
+
+		// Commits hidden by filter are not offered
+		const int row = rowOfCommit (*iCommit);
+		if (row >= 0)
+			rows.append (row);
+	}
+
+	return rows;
+}
+
+const QVector<int>& CCommitTableModel::oidIndex () const
+{
+	//
+	// Commits are only appended (the index is dropped when the list is replaced): merge the new ones in
+	//
+	const int indexed = m_oid_index.size ();
+	if (indexed < m_commits.size ())
+	{
+		m_oid_index.resize (m_commits.size ());
+		for (int commit = indexed; commit < m_commits.size (); ++commit)
+			m_oid_index [commit] = commit;
+
+		const COidLess less (m_commits.constData ());
+		if (indexed == 0)
+			parallelSort (m_oid_index, less);
+		else
+		{
+			std::sort (m_oid_index.begin () + indexed, m_oid_index.end (), less);
+
+			QVector<int> merged (m_oid_index.size ());
+			std::merge (m_oid_index.constBegin (), m_oid_index.constBegin () + indexed,
+						m_oid_index.constBegin () + indexed, m_oid_index.constEnd (), merged.begin (), less);
+			m_oid_index = merged;
+		}
+	}
+
+	return m_oid_index;
+}
+
+void CCommitTableModel::cancelLoading ()
+{
+	if (m_load_job)
+	{
+		m_load_job->cancel ();
+		m_load_job.clear ();
+	}
+
+	m_loading = false;
+}
+
+void CCommitTableModel::setCommitList (const QString& _branch_name)
+{
+	setCommitList (QStringList () << _branch_name);
+}
+
+void CCommitTableModel::setCommitList (const QStringList& _branch_names)
+{
+	startLoading (_branch_names, false);
+}
+
+void CCommitTableModel::setCompareList (const QString& _left_branch, const QString& _right_branch)
+{
+	startLoading (QStringList () << _left_branch << _right_branch, true);
+}
+
+bool CCommitTableModel::isComparison () const
+{
+	return m_compare;
+}
+
+bool CCommitTableModel::mergeBase (CMergeBase& _result) const
+{
+	if (m_merge_base_known)
+		_result = m_merge_base;
+
+	return m_merge_base_known;
+}
+
+void CCommitTableModel::startLoading (const QStringList& _branch_names, bool _compare)
+{
+	cancelLoading ();
+	m_branch_names = _branch_names;
+	m_branch_name = (_branch_names.size () == 1) ? _branch_names.first () : QString ();
+	m_compare = _compare;
+	m_merge_base_known = false;
+	m_merge_base = CMergeBase ();
+
+	// Author and branch set ids are assigned by the load job from scratch
+	m_authors.clear ();
+	m_author_rank.clear ();
+	m_author_filter_id = -1;
+	m_branch_sets.clear ();
+	m_resort_timer.stop ();
+
+	// Pickaxe filter applies to the new list when it is loaded
+	stopPickaxeSearch ();
+	m_pickaxe_matches.clear ();
+	m_pickaxe_total = m_pickaxe_checked = 0;
+
+	// Snapshot rows of the same branch stay visible until the real list confirms or replaces them
+	if (m_snapshot_active && !m_branch_name.isEmpty () && (m_branch_name == m_snapshot_branch))
+	{
+		m_validation.clear ();
+		m_validation_keys.clear ();
+	}
+	else
+	{
+		m_snapshot_active = false;
+		m_snapshot_texts.clear ();
+
+		// Clear current commit ids list and cached texts; sort and filter apply to arriving commits
+		beginResetModel ();
+		m_commits.clear ();
+		m_oid_index.clear ();
+		m_keys.clear ();
+		m_order.clear ();
+		m_ordered = needsResort () || hasFilter ();
+		m_sorted_rows = 0;
+		m_time_index.clear ();
+		m_row_cache.clear ();
+		endResetModel ();
+	}
+
+	if (! m_repo)
+		return;
+
+	// Walk through all branch commits in background; batches older generations are dropped
+	++m_generation;
+	m_loading = true;
+	m_load_job = CBackgroundJobPtr (new CCommitLoadJob (m_repo_path, _branch_names, this, m_generation, m_walk_filter, _compare));
+	m_load_job->setPriority (m_active ? CWorkerPool::PRIORITY_FOREGROUND : CWorkerPool::PRIORITY_BACKGROUND);
+	m_load_job->setPaused (! m_active);
+	CWorkerPool::instance ()->start (m_load_job);
+}
+
+void CCommitTableModel::setTags (int _generation, const CGitTagMap& _tags)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_tags = _tags;
+
+	// Rows rendered before (e.g. on previous load) may have other tags now
+	m_row_cache.clear ();
+	if ((rowCount () > 0) && !m_snapshot_active)
+		emit dataChanged (index (0, 0), index (rowCount () - 1, _ColumntCount - 1));
+}
+
+void CCommitTableModel::appendCommits (int _generation, const CGitOidVector& _oids, const CCommitKeyBatch& _keys)
+{
+	if (_generation != m_generation)
+		return;
+
+	// Batch of commits rejected by walk filter may still intern authors
+	m_authors += _keys.m_new_authors;
+	m_branch_sets += _keys.m_new_branch_sets;
+	if (! m_author_filter.isEmpty () && (m_author_filter_id < 0))
+	{
+		const int new_id = _keys.m_new_authors.indexOf (m_author_filter);
+		if (new_id >= 0)
+			m_author_filter_id = m_authors.size () - _keys.m_new_authors.size () + new_id;
+	}
+
+	if (_oids.isEmpty ())
+		return;
+
+	if (m_snapshot_active)
+	{
+		// Wait until real commits cover all snapshot rows
+		m_validation += _oids;
+		m_validation_keys += _keys.m_keys;
+		if (m_validation.size () >= m_commits.size ())
+			validateSnapshot ();
+
+		return;
+	}
+
+	if (! m_ordered)
+	{
+		beginInsertRows (QModelIndex (), m_commits.size (), m_commits.size () + _oids.size () - 1);
+		m_commits += _oids;
+		m_keys += _keys.m_keys;
+		endInsertRows ();
+		return;
+	}
+
+	//
+	// Sorted or filtered list: accepted commits are appended to the end and sorted later all together
+	//
+	const int first = m_commits.size ();
+	m_commits += _oids;
+	m_keys += _keys.m_keys;
+
+	QVector<int> accepted;
+	for (int commit = first; commit < m_commits.size (); ++commit)
+	{
+		if (acceptsCommit (commit))
+			accepted.append (commit);
+	}
+
+	if (! accepted.isEmpty ())
+	{
+		beginInsertRows (QModelIndex (), m_order.size (), m_order.size () + accepted.size () - 1);
+		m_order += accepted;
+		endInsertRows ();
+	}
+
+	if (needsResort () && !m_resort_timer.isActive ())
+		m_resort_timer.start ();
+}
+
+void CCommitTableModel::finishLoading (int _generation, const QString& _error)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_load_job.clear ();
+	m_loading = false;
+
+	// Put the last batches in order at once
+	if (m_resort_timer.isActive ())
+		resort ();
+
+	// Branch became shorter than snapshot (or failed to load)
+	if (m_snapshot_active)
+		validateSnapshot ();
+
+	if (! _error.isEmpty ())
+		CDiagnostics::instance ()->post (tr ("Commits"), _error);
+	else
+	{
+		startMessageIndexing ();
+		startPathFilterBuilding ();
+
+		// Pickaxe search was given only the commits loaded before
+		if (m_pickaxe_filter && (m_pickaxe_total < m_commits.size ()))
+			startPickaxeSearch (m_pickaxe_total);
+	}
+
+	emit loadingFinished ();
+}
+
+void CCommitTableModel::setMergeBases (int _generation, const CGitOidVector& _bases, int _left_only, int _right_only)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_merge_base_known = true;
+	m_merge_base.m_bases = _bases;
+	m_merge_base.m_left_only = _left_only;
+	m_merge_base.m_right_only = _right_only;
+	emit mergeBasesFound ();
+}
+
+void CCommitTableModel::startMessageIndexing ()
+{
+	if (m_message_index_path.isEmpty () || m_snapshot_active || m_commits.isEmpty ())
+		return;
+
+	//
+	// Job of previous load may be still running: the new one skips everything already saved
+	//
+	if (m_index_job)
+		m_index_job->cancel ();
+
+	m_index_job = CBackgroundJobPtr (new CMessageIndexJob (m_repo_path, m_message_index_path, m_commits,
+														   this, ++m_index_generation));
+	m_index_job->setPriority (CWorkerPool::PRIORITY_BACKGROUND);
+	CWorkerPool::instance ()->start (m_index_job);
+}
+
+void CCommitTableModel::updateMessageIndex (int _generation, const QString& _path)
+{
+	if (_generation != m_index_generation)
+	{
+		QFile::remove (_path);
+		return;
+	}
+
+	m_index_job.clear ();
+
+	// The file can't be replaced while it is mapped; on failure the old one is mapped again
+	QString error;
+	m_message_index.close ();
+	if (! replaceFile (_path, m_message_index_path, error))
+		CDiagnostics::instance ()->post (tr ("Message index"), error);
+
+	m_message_index.open (m_message_index_path);
+}
+
+void CCommitTableModel::startPathFilterBuilding ()
+{
+	// Path-limited walks visit every commit of the branches, so filters are built from unfiltered lists
+	if (! m_repo || m_snapshot_active || hasWalkFilter () || m_commits.isEmpty ())
+		return;
+
+	if (m_path_filter_job)
+		m_path_filter_job->cancel ();
+
+	m_path_filter_job = CBackgroundJobPtr (new CChangedPathJob (m_repo_path, m_commits, this, ++m_path_filter_generation));
+	m_path_filter_job->setPriority (CWorkerPool::PRIORITY_BACKGROUND);
+	CWorkerPool::instance ()->start (m_path_filter_job);
+}
+
+void CCommitTableModel::updatePathFilters (int _generation, const QString& _path)
+{
+	if ((_generation != m_path_filter_generation) || !m_repo)
+	{
+		QFile::remove (_path);
+		return;
+	}
+
+	// Load jobs open the file on start, so it is replaced at once; job may post more checkpoints
+	QString error;
+	const QString filter_path = CChangedPathIndex::filePath (QFile::decodeName (git_repository_path (m_repo)));
+	if (! replaceFile (_path, filter_path, error))
+		CDiagnostics::instance ()->post (tr ("Path filters"), error);
+}
+
+QList<int> CCommitTableModel::messageRows (const QString& _query) const
+{
+	QList<int> rows;
+
+	const QVector<int>& by_oid = oidIndex ();
+	const COidLess less (m_commits.constData ());
+	foreach (const CGitOid& id, m_message_index.find (_query))
+	{
+		// Index covers all branches of the repository
+		QVector<int>::const_iterator found = std::lower_bound (by_oid.constBegin (), by_oid.constEnd (), id, less);
+		if ((found == by_oid.constEnd ()) || (m_commits [*found] != id))
+			continue;
+
+		const int row = rowOfCommit (*found);
+		if (row >= 0)
+			rows.append (row);
+	}
+
+	std::sort (rows.begin (), rows.end ());
+	return rows;
+}
+
+bool CCommitTableModel::empty () const
+{
+	return m_commits.isEmpty ();
+}
+
+bool CCommitTableModel::isLoading () const
+{
+	return m_loading;
+}
+
+void CCommitTableModel::setActive (bool _active)
+{
+	m_active = _active;
+
+	// Background tab doesn't need its commits right now: let the active one use the pool
+	if (m_load_job)
+	{
+		m_load_job->setPriority (_active ? CWorkerPool::PRIORITY_FOREGROUND : CWorkerPool::PRIORITY_BACKGROUND);
+		m_load_job->setPaused (! _active);
+	}
+
+	foreach (const CBackgroundJobPtr& job, m_pickaxe_jobs)
+		job->setPriority (_active ? CWorkerPool::PRIORITY_FOREGROUND : CWorkerPool::PRIORITY_BACKGROUND);
+
+	if (_active)
+		CMemoryBudget::instance ()->setForeground (this);
+	else
+		CMemoryBudget::instance ()->rebalance ();
+}
+
+void CCommitTableModel::validateSnapshot ()
+{
+	const int snapshot_size = m_commits.size ();
+	bool valid = (m_validation.size () >= snapshot_size);
+	for (int row = 0; valid && (row < snapshot_size); ++row)
+		valid = (m_validation [row] == m_commits [row]);
+
+	CGitOidVector received = m_validation;
+	m_validation.clear ();
+	m_snapshot_active = false;
+	m_snapshot_texts.clear ();
+
+	// Keys are known for all received commits, snapshot ones included
+	m_keys = m_validation_keys;
+	m_validation_keys.clear ();
+	m_time_index.clear ();
+
+	if (valid)
+	{
+		// Rows are confirmed: texts will be rendered from repository on demand, append the rest
+		received.remove (0, snapshot_size);
+		if (! received.isEmpty ())
+		{
+			beginInsertRows (QModelIndex (), m_commits.size (), m_commits.size () + received.size () - 1);
+			m_commits += received;
+			endInsertRows ();
+		}
+	}
+	else
+	{
+		// History has changed since the snapshot: replace it with the real rows
+		beginResetModel ();
+		m_commits.clear ();
+		m_oid_index.clear ();
+		m_row_cache.clear ();
+		endResetModel ();
+
+		if (! received.isEmpty ())
+		{
+			beginInsertRows (QModelIndex (), 0, received.size () - 1);
+			m_commits = received;
+			m_oid_index.clear ();
+			endInsertRows ();
+		}
+	}
+
+	// Sort and filter were postponed while snapshot rows were shown
+	if (needsResort () || hasFilter ())
+		rebuildOrder ();
+}
+
+QByteArray CCommitTableModel::snapshot (int _row_count) const
+{
+	QByteArray data;
+	// Filtered list is not restored on next launch
+	if (m_commits.isEmpty () || m_branch_name.isEmpty () || hasWalkFilter ())
+		return data;
+
+	const int row_count = qMin (_row_count, m_commits.size ());
+
+	QDataStream stream (&data, QIODevice::WriteOnly);
+	stream.setVersion (QDataStream::Qt_4_6);
+	stream << quint32 (SNAPSHOT_VERSION) << m_branch_name << qint32 (row_count);
+	for (int row = 0; row < row_count; ++row)
+	{
+		const CCommitRowText& text = rowText (row);
+		stream.writeRawData (reinterpret_cast <const char*> (m_commits [row].m_id), CGitOid::RAW_SIZE);
+		stream << text.m_short_log << text.m_summary << text.m_author << text.m_date << text.m_tags << quint32 (text.m_time);
+	}
+
+	return data;
+}
+
+bool CCommitTableModel::setSnapshot (const QByteArray& _data)
+{
+	QDataStream stream (_data);
+	stream.setVersion (QDataStream::Qt_4_6);
+
+	quint32 version = 0;
+	QString branch_name;
+	qint32 row_count = 0;
+	stream >> version >> branch_name >> row_count;
+	if ((stream.status () != QDataStream::Ok) || (version != SNAPSHOT_VERSION) || (row_count <= 0))
+		return false;
+
+	CGitOidVector oids (row_count);
+	QVector<CCommitRowText> texts (row_count);
+	for (int row = 0; row < row_count; ++row)
+	{
+		stream.readRawData (reinterpret_cast <char*> (oids [row].m_id), CGitOid::RAW_SIZE);
+		quint32 time = 0;
+		stream >> texts [row].m_short_log >> texts [row].m_summary >> texts [row].m_author >> texts [row].m_date
+			   >> texts [row].m_tags >> time;
+		texts [row].m_time = time;
+	}
+
+	if (stream.status () != QDataStream::Ok)
+		return false;
+
+	cancelLoading ();
+
+	beginResetModel ();
+	m_commits = oids;
+	m_oid_index.clear ();
+	m_keys.clear ();
+	m_time_index.clear ();
+	m_order.clear ();
+	m_ordered = false;
+	m_row_cache.clear ();
+	m_snapshot_texts = texts;
+	m_snapshot_branch = branch_name;
+	m_snapshot_active = true;
+	m_validation.clear ();
+	m_validation_keys.clear ();
+	endResetModel ();
+
+	return true;
+}
+
+void CCommitTableModel::discardSnapshot ()
+{
+	if (! m_snapshot_active)
+		return;
+
+	beginResetModel ();
+	m_commits.clear ();
+	m_oid_index.clear ();
+	m_snapshot_texts.clear ();
+	m_snapshot_active = false;
+	m_validation.clear ();
+	m_validation_keys.clear ();
+	endResetModel ();
+}
+
+bool CCommitTableModel::isSnapshot () const
+{
+	return m_snapshot_active;
+}
+
+QString CCommitTableModel::snapshotBranch () const
+{
+	return m_snapshot_active ? m_snapshot_branch : QString ();
+}
+
+CGitOid CCommitTableModel::snapshotTip () const
+{
+	return (m_snapshot_active && !m_commits.isEmpty ()) ? m_commits.first () : CGitOid ();
+}
+
+qint64 CCommitTableModel::cacheCost () const
+{
+	return m_row_cache.totalCost ();
+}
+
+void CCommitTableModel::setCacheLimit (qint64 _max_cost)
+{
+	m_row_cache.setMaxCost (int (qMin (_max_cost, qint64 (INT_MAX))));
+}
+
+const CCommitRowText& CCommitTableModel::rowText (int _commit) const
+{
+	// Snapshot rows were rendered in previous session
+	if (m_snapshot_active && (_commit < m_snapshot_texts.size ()))
+		return m_snapshot_texts [_commit];
+
+	// Cache is keyed by commit index, so sorting doesn't invalidate it
+	CCommitRowText* cached = m_row_cache.object (_commit);
+	if (cached)
+		return *cached;
+
+	// Render all columns of the row with single commit lookup
+	CCommitRowText text;
+	text.m_tags = m_tags.value (m_commits [_commit]);
+
+	//
+	// Take list columns directly from pack file; libgit2 is used for loose and deltified commits
+	//
+	CCommitHeader header;
+	if (m_pack_reader.readHeader (m_commits [_commit], header))
+	{
+		text.m_summary = header.m_summary;
+		text.m_author = header.m_author;
+		text.m_time = header.m_time;
+	}
+	else
+	{
+		git_commit* commit = resolveCommit (m_commits [_commit], m_repo);
+		if (commit)
+		{
+			text.m_summary = commitLog (commit, true);
+			text.m_author = commitAuthor (commit);
+			text.m_time = uint (git_commit_time (commit));
+
+			git_commit_free (commit);
+		}
+	}
+
+	// Show commit short log and tags
+	QString tag_string;
+	foreach (const QString& tag, text.m_tags)
+		tag_string += "[" + tag + "] ";
+
+	text.m_short_log = tag_string + text.m_summary;
+	text.m_date = commitDate (text.m_time);
+
+	const int cost = text.cost ();
+	if (cost <= m_row_cache.maxCost ())
+	{
+		cached = new CCommitRowText (text);
+		m_row_cache.insert (_commit, cached, cost);
+		return *cached;
+	}
+
+	m_uncached_row = text;
+	return m_uncached_row;
+}
+
+QString CCommitTableModel::fullLog (int _commit) const
+{
+	// Rows of snapshot may be not in the repository anymore
+	if (m_snapshot_active && (_commit < m_snapshot_texts.size ()))
+		return m_snapshot_texts [_commit].m_summary;
+
+	//
+	// Full message is needed only for one row at a time: it is not cached
+	//
+	QString full_log;
+	git_commit* commit = resolveCommit (m_commits [_commit], m_repo);
+	if (commit)
+	{
+		full_log = commitLog (commit);
+		git_commit_free (commit);
 	}
 
-	return git_error_str;
+	return full_log;
 }
 
-static void showGitError (QWidget* _parent, int _error_code, const QString& _action)
+int CCommitTableModel::rowCount (const QModelIndex& _parent) const
 {
-	QMessageBox::critical (_parent, QTranslator::tr ("VCS error"), getGitError (_error_code, _action));
+	Q_UNUSED (_parent);
+	return m_ordered ? m_order.size () : m_commits.size ();
 }
 
-static git_commit* resolveCommit (const QString& _commit_id, git_repository* _repo)
+int CCommitTableModel::commitAt (int _row) const
 {
-	git_commit* commit = NULL;
-	git_oid oid;
-	git_oid_fromstr (& oid, QFile::encodeName (_commit_id));
-	int error_code = git_commit_lookup (& commit, _repo, &oid);
-	if (error_code != GIT_OK)
+	return m_ordered ? m_order [_row] : _row;
+}
+
+bool CCommitTableModel::hasFilter () const
+{
+	return m_date_filter || !m_author_filter.isEmpty () || m_pickaxe_filter;
+}
+
+bool CCommitTableModel::acceptsCommit (int _commit) const
+{
+	// Commits not searched yet are not shown
+	if (m_pickaxe_filter && ((_commit >= m_pickaxe_matches.size ()) || !m_pickaxe_matches.testBit (_commit)))
+		return false;
+
+	if (m_date_filter && ((m_keys [_commit].m_time < m_date_from) || (m_keys [_commit].m_time > m_date_to)))
+		return false;
+
+	if (m_author_filter.isEmpty ())
+		return true;
+
+	// Author may be not met yet
+	return (m_author_filter_id >= 0) && (m_keys [_commit].m_author == quint32 (m_author_filter_id));
+}
+
+const QVector<int>& CCommitTableModel::timeIndex () const
+{
+	//
+	// Commits are only appended: sort the new ones by time and merge them in
+	//
+	const int indexed = m_time_index.size ();
+	if (indexed < m_keys.size ())
 	{
-		commit = NULL;
-		showGitError (NULL, error_code, QTranslator::tr ("looking up commit"));
+		m_time_index.resize (m_keys.size ());
+		for (int commit = indexed; commit < m_keys.size (); ++commit)
+			m_time_index [commit] = commit;
+
+		sortByKeys (m_time_index, indexed, _DateColumn, false);
 	}
 
-	return commit;
+	return m_time_index;
 }
 
-/// Returns the short of full changelog of specified commit
-static QString commitLog (const QString& _commit_id, git_repository* _repo, bool _short = false)
+const QVector<int>& CCommitTableModel::authorRank (int _column) const
 {
-	QString commit_log;
+	// Authors are only appended until the list is replaced, so the count tells whether ranks are stale
+	if ((_column == _AuthorColumn) && (m_author_rank.size () != m_authors.size ()))
+		rankAuthors (m_authors, m_author_rank);
 
-	git_commit* commit = resolveCommit (_commit_id, _repo);
-	if (commit)
+	return m_author_rank;
+}
+
+int CCommitTableModel::rowOfCommit (int _commit) const
+{
+	if (! m_ordered)
+		return _commit;
+
+	//
+	// Sorted part of the rows is ordered by comparator of current sort column, the rest is scanned
+	//
+	QVector<int>::const_iterator sorted_end = m_order.constBegin () + m_sorted_rows;
+	QVector<int>::const_iterator found = sorted_end;
+	if (needsResort ())
+	{
+		const CCommitLess less = commitLess (m_keys, authorRank (m_sort_column), m_sort_column,
+											 m_sort_order == Qt::DescendingOrder);
+		found = std::lower_bound (m_order.constBegin (), sorted_end, _commit, less);
+	}
+	else
 	{
-		commit_log = QString::fromUtf8 (git_commit_message (commit));
-		commit_log.replace ("\n", "<br>");
-		if (commit_log.right (4) == "<br>")
-			commit_log.remove (commit_log.length() - 4, 4);
+		// Filtered list in load order
+		sorted_end = m_order.constEnd ();
+		found = std::lower_bound (m_order.constBegin (), sorted_end, _commit);
+	}
 
-		if (_short)
-		{
-			int line_end = commit_log.indexOf ("<br>");
-			if (line_end != -1)
-				commit_log = commit_log.left (line_end);
-		}
+	if ((found != sorted_end) && (*found == _commit))
+		return int (found - m_order.constBegin ());
 
-		git_commit_free (commit);
+	for (int row = int (sorted_end - m_order.constBegin ()); row < m_order.size (); ++row)
+	{
+		if (m_order [row] == _commit)
+			return row;
 	}
 
-	return commit_log;
+	return -1;
 }
 
-/// Returns the author (name + email) of specified commit
-static QString commitAuthor (const QString& _commit_id, git_repository* _repo)
+int CCommitTableModel::rowForDate (uint _time) const
 {
-	QString commit_author;
-	git_commit* commit = resolveCommit (_commit_id, _repo);
-	if (commit)
+	if (m_snapshot_active || m_keys.isEmpty ())
+		return -1;
+
+	//
+	// Take the newest commit made not later than the time (or the oldest one if all are later)
+	//
+	const QVector<int>& by_time = timeIndex ();
+	int position = int (std::upper_bound (by_time.constBegin (), by_time.constEnd (), _time, CTimeLess (m_keys.constData ()))
+						- by_time.constBegin ());
+	position = qMax (0, position - 1);
+
+	// Skip commits hidden by filter, going back in time
+	for (int i = position; i >= 0; --i)
+	{
+		if (acceptsCommit (by_time [i]))
+			return rowOfCommit (by_time [i]);
+	}
+	for (int i = position + 1; i < by_time.size (); ++i)
 	{
-		const git_signature* author = git_commit_author (commit);
-		if (author)
-			commit_author = QString::fromUtf8 (author->name)
-							+ QString (" <") + QString::fromUtf8 (author->email) + ">";
+		if (acceptsCommit (by_time [i]))
+			return rowOfCommit (by_time [i]);
 	}
 
-	return commit_author;
+	return -1;
 }
 
-/// Returns the date of specified commit
-static QString commitDate (const QString& _commit_id, git_repository* _repo)
+bool CCommitTableModel::needsResort () const
 {
-	QString commit_time;
+	// Load order is the natural order of short log column
+	return (m_sort_column > _ShortLogColumn) || (m_sort_order == Qt::DescendingOrder);
+}
 
-	git_commit* commit = resolveCommit (_commit_id, _repo);
-	if (commit)
+void CCommitTableModel::sortCommits (QVector<int>& _order, int _sorted) const
+{
+	sortByKeys (_order, _sorted, m_sort_column, m_sort_order == Qt::DescendingOrder);
+}
+
+void CCommitTableModel::sortByKeys (QVector<int>& _order, int _sorted, int _column, bool _descending) const
+{
+	const CCommitLess less = commitLess (m_keys, authorRank (_column), _column, _descending);
+
+	if ((_sorted <= 0) || (_sorted > _order.size ()))
 	{
-		time_t time = git_commit_time (commit);
-		QDateTime dateTime;
-		dateTime.setTime_t (time);
-		commit_time = dateTime.toString ();
+		parallelSort (_order, less);
+		return;
 	}
 
-	return commit_time;
+	//
+	// Only the appended tail is unsorted: sort it and merge with the sorted head in linear time
+	//
+	std::sort (_order.begin () + _sorted, _order.end (), less);
+
+	QVector<int> merged (_order.size ());
+	std::merge (_order.constBegin (), _order.constBegin () + _sorted, _order.constBegin () + _sorted, _order.constEnd (),
+				merged.begin (), less);
+	_order = merged;
 }
 
-namespace
+void CCommitTableModel::rebuildOrder ()
 {
-	/// gitTagCb parameters structure
-	struct CTagCbContext
+	m_resort_timer.stop ();
+
+	beginResetModel ();
+	m_order.clear ();
+	m_ordered = !m_snapshot_active && (needsResort () || hasFilter ());
+	if (m_ordered && m_date_filter)
 	{
-		git_repository* m_repo;
-		const git_oid* m_commit_oid;
-		QStringList m_commit_tags;
-	};
+		//
+		// Date range is found by binary search in time index; only commits inside it are checked
+		//
+		const QVector<int>& by_time = timeIndex ();
+		const CTimeLess less (m_keys.constData ());
+		QVector<int>::const_iterator first = std::lower_bound (by_time.constBegin (), by_time.constEnd (), m_date_from, less);
+		QVector<int>::const_iterator last = std::upper_bound (first, by_time.constEnd (), m_date_to, less);
+
+		m_order.reserve (int (last - first));
+		for (; first != last; ++first)
+		{
+			if (acceptsCommit (*first))
+				m_order.append (*first);
+		}
+
+		// Range is in time order: restore load order unless other sort is requested
+		if (needsResort ())
+			sortCommits (m_order);
+		else
+			std::sort (m_order.begin (), m_order.end ());
+	}
+	else if (m_ordered)
+	{
+		m_order.reserve (m_commits.size ());
+		for (int commit = 0; commit < m_commits.size (); ++commit)
+		{
+			if (acceptsCommit (commit))
+				m_order.append (commit);
+		}
+
+		if (needsResort ())
+			sortCommits (m_order);
+	}
+	m_sorted_rows = m_order.size ();
+	endResetModel ();
 }
 
-/// Callback for git_tag_foreach function for git commit tags walking
-static int gitTagCb (const char* _name, git_oid* _oid, void* _payload)
+void CCommitTableModel::resort ()
 {
-	CTagCbContext* context = (CTagCbContext*) _payload;
-	Q_ASSERT (context);
+	m_resort_timer.stop ();
+	if (m_snapshot_active)
+		return;
+
+	// Filter is not changed here, so the count of rows stays the same
+	const bool ordered = needsResort () || hasFilter ();
+	if (! ordered && !m_ordered)
+		return;
+
+	emit layoutAboutToBeChanged ();
 
 	//
-	// Если идентификатор коммита равен указанному
+	// Remember commits of persistent indices (current and selected rows)
 	//
-	if (git_oid_cmp (context->m_commit_oid, _oid) == 0)
+	const QModelIndexList old_indices = persistentIndexList ();
+	QVector<int> old_commits;
+	QHash<int, int> new_rows;
+	foreach (const QModelIndex& index, old_indices)
 	{
-		//
-		// Если удалось найти ссылку (а тег это тоже ссылка) с указанным именем
-		//
-		git_reference* ref = NULL;
-		if (git_reference_lookup (& ref, context->m_repo, _name) == GIT_OK)
+		old_commits.append (commitAt (index.row ()));
+		new_rows.insert (old_commits.last (), -1);
+	}
+
+	if (ordered)
+	{
+		if (! m_ordered)
 		{
-			//
-			// Запоминаем тег в переданной структуре
-			//
-			context->m_commit_tags.append (git_reference_shorthand (ref));
+			m_order.resize (m_commits.size ());
+			for (int commit = 0; commit < m_commits.size (); ++commit)
+				m_order [commit] = commit;
+			m_sorted_rows = 0;
+		}
+
+		if (needsResort ())
+			sortCommits (m_order, m_sorted_rows);
+		m_sorted_rows = m_order.size ();
+	}
+	else
+	{
+		m_order.clear ();
+		m_sorted_rows = 0;
+	}
+	m_ordered = ordered;
 
-			git_reference_free (ref);
+	//
+	// Find new rows of remembered commits with one pass over the rows
+	//
+	if (m_ordered && !new_rows.isEmpty ())
+	{
+		for (int row = 0; row < m_order.size (); ++row)
+		{
+			QHash<int, int>::iterator iRow = new_rows.find (m_order [row]);
+			if (iRow != new_rows.end ())
+				iRow.value () = row;
 		}
 	}
 
-	return GIT_OK;
+	QModelIndexList new_indices;
+	for (int i = 0; i < old_indices.size (); ++i)
+	{
+		const int row = m_ordered ? new_rows.value (old_commits [i], -1) : old_commits [i];
+		new_indices.append ((row >= 0) ? index (row, old_indices [i].column ()) : QModelIndex ());
+	}
+	changePersistentIndexList (old_indices, new_indices);
+
+	emit layoutChanged ();
 }
 
-/**
- * @brief Return the list of tags of specified commit
- */
-static QStringList commitTags (const QString& _commit_id, git_repository* _repo)
+void CCommitTableModel::sort (int _column, Qt::SortOrder _order)
 {
-	CTagCbContext context;
-	git_commit* commit = resolveCommit (_commit_id, _repo);
-	if (commit)
+	if ((_column == m_sort_column) && (_order == m_sort_order))
+		return;
+
+	m_sort_column = _column;
+	m_sort_order = _order;
+
+	// Snapshot rows have no keys: the order is applied after validation
+	m_sorted_rows = 0;
+	resort ();
+}
+
+int CCommitTableModel::sortColumn () const
+{
+	return m_sort_column;
+}
+
+Qt::SortOrder CCommitTableModel::sortOrder () const
+{
+	return m_sort_order;
+}
+
+void CCommitTableModel::setAuthorFilter (const QString& _author)
+{
+	if (_author == m_author_filter)
+		return;
+
+	m_author_filter = _author;
+	m_author_filter_id = _author.isEmpty () ? -1 : m_authors.indexOf (_author);
+	if (! m_snapshot_active)
+		rebuildOrder ();
+}
+
+QString CCommitTableModel::authorFilter () const
+{
+	return m_author_filter;
+}
+
+void CCommitTableModel::setDateFilter (uint _from, uint _to)
+{
+	if (m_date_filter && (_from == m_date_from) && (_to == m_date_to))
+		return;
+
+	m_date_filter = true;
+	m_date_from = _from;
+	m_date_to = _to;
+	if (! m_snapshot_active)
+		rebuildOrder ();
+}
+
+void CCommitTableModel::clearDateFilter ()
+{
+	if (! m_date_filter)
+		return;
+
+	m_date_filter = false;
+	if (! m_snapshot_active)
+		rebuildOrder ();
+}
+
+bool CCommitTableModel::hasDateFilter () const
+{
+	return m_date_filter;
+}
+
+void CCommitTableModel::setPickaxeFilter (const CPickaxeQuery& _query)
+{
+	if (! _query.isValid ())
 	{
-		context.m_repo = _repo;
-		context.m_commit_oid = git_commit_id (commit);
-		if (git_tag_foreach (_repo, & gitTagCb, (void*)&context) != GIT_OK)
-			Q_ASSERT (0);
+		clearPickaxeFilter ();
+		return;
 	}
 
-	return context.m_commit_tags;
+	stopPickaxeSearch ();
+	m_pickaxe_filter = true;
+	m_pickaxe_query = _query;
+	m_pickaxe_matches.fill (false, m_commits.size ());
+	m_pickaxe_total = m_pickaxe_checked = 0;
+	m_pickaxe_error.clear ();
+
+	// Rows appear as commits are found
+	rebuildOrder ();
+
+	// Snapshot rows are not searched: the real list is searched when it is loaded
+	if (! m_snapshot_active)
+		startPickaxeSearch (0);
+
+	emit pickaxeProgress (m_pickaxe_checked, m_pickaxe_total);
+	if (! isPickaxeSearching ())
+		emit pickaxeFinished ();
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////
-using namespace QGitRepoViewer;
+void CCommitTableModel::clearPickaxeFilter ()
+{
+	if (! m_pickaxe_filter)
+		return;
 
-CCommitTableModel::CCommitTableModel (QObject* _parent):
-	QAbstractTableModel (_parent),
-	m_repo (NULL)
-{}
+	stopPickaxeSearch ();
+	m_pickaxe_filter = false;
+	m_pickaxe_query = CPickaxeQuery ();
+	m_pickaxe_matches.clear ();
+	m_pickaxe_total = m_pickaxe_checked = 0;
+	if (! m_snapshot_active)
+		rebuildOrder ();
+}
 
-CCommitTableModel::~CCommitTableModel ()
+bool CCommitTableModel::hasPickaxeFilter () const
 {
-	if (m_repo)
-		git_repository_free (m_repo);
+	return m_pickaxe_filter;
 }
 
-void CCommitTableModel::setGitRepo (const QString& _repo_path)
+CPickaxeQuery CCommitTableModel::pickaxeFilter () const
 {
-	int error_code = git_repository_open_ext (& m_repo, QFile::encodeName (_repo_path),
-											  GIT_REPOSITORY_OPEN_CROSS_FS, NULL);
-	if (error_code != GIT_OK)
-		showGitError (NULL, error_code, tr ("opening repository"));
+	return m_pickaxe_query;
 }
 
-int CCommitTableModel::commitIndex (const QString _commit_id) const
+void CCommitTableModel::stopPickaxeSearch ()
 {
-	return m_commits.indexOf (_commit_id);
+	const bool searching = isPickaxeSearching ();
+	cancelPickaxeSearch ();
+	if (searching)
+		emit pickaxeFinished ();
 }
 
-void CCommitTableModel::setCommitList (const QString& _branch_name)
+bool CCommitTableModel::isPickaxeSearching () const
 {
-	// Clear current commit ids list
-	m_commits.clear ();
+	return (m_pickaxe_running > 0);
+}
+
+int CCommitTableModel::pickaxeCheckedCommits () const
+{
+	return m_pickaxe_checked;
+}
+
+int CCommitTableModel::pickaxeTotalCommits () const
+{
+	return m_pickaxe_total;
+}
+
+void CCommitTableModel::cancelPickaxeSearch ()
+{
+	foreach (const CBackgroundJobPtr& job, m_pickaxe_jobs)
+		job->cancel ();
+	m_pickaxe_jobs.clear ();
+	m_pickaxe_running = 0;
+	++m_pickaxe_generation;
+}
+
+void CCommitTableModel::startPickaxeSearch (int _first)
+{
+	m_pickaxe_total = m_commits.size ();
+	m_pickaxe_matches.resize (m_commits.size ());
+	if (m_repo_path.isEmpty () || (_first >= m_commits.size ()))
+		return;
+
+	CPickaxeSearchPtr search (new CPickaxeSearch);
+	search->m_repo_path = m_repo_path;
+	search->m_query = m_pickaxe_query;
+	search->m_commits = m_commits;
+	search->m_first = _first;
 
-	// Search for brach with specified name in git repository
-	git_reference* git_branch = NULL;
-	int error_code = git_branch_lookup (& git_branch, m_repo,
-										QFile::encodeName (_branch_name), GIT_BRANCH_LOCAL);
-	if (error_code == GIT_OK)
+	//
+	// One job per pool thread, all taking batches of commits from the same counter
+	//
+	const int job_count = qMax (1, CWorkerPool::instance ()->maxThreadCount ());
+	for (int i = 0; i < job_count; ++i)
 	{
-		Q_ASSERT (git_reference_type (git_branch) == GIT_REF_OID);
+		CBackgroundJobPtr job (new CPickaxeJob (search, this, m_pickaxe_generation));
+		job->setPriority (m_active ? CWorkerPool::PRIORITY_FOREGROUND : CWorkerPool::PRIORITY_BACKGROUND);
+		m_pickaxe_jobs.append (job);
+		++m_pickaxe_running;
+		CWorkerPool::instance ()->start (job);
+	}
+}
 
-		// Obtain the branch id
-		const git_oid* branch_oid = git_reference_target (git_branch);
-		if (branch_oid)
-		{
-			// Obtain the HEAD commit object
-			git_object* branch_head = NULL;
-			error_code = git_reference_peel (& branch_head, git_branch, GIT_OBJ_COMMIT);
-			if (error_code == GIT_OK)
-			{
-				Q_ASSERT (git_object_type (branch_head) == GIT_OBJ_COMMIT);
+void CCommitTableModel::addPickaxeMatches (int _generation, const QVector<int>& _commits, int _checked)
+{
+	if (_generation != m_pickaxe_generation)
+		return;
 
-				// Obtain the HEAD commit id
-				const git_oid* branch_head_oid = git_object_id (branch_head);
-				Q_ASSERT (branch_head_oid != NULL);
+	m_pickaxe_checked += _checked;
 
-				// Create the commit iterator object
-				git_revwalk* rev_walk = NULL;
-				error_code = git_revwalk_new (& rev_walk, m_repo);
-				if (error_code == GIT_OK)
-				{
-					// Setup the commit iterator
-					git_revwalk_sorting (rev_walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_TIME);
-					error_code = git_revwalk_push (rev_walk, branch_head_oid);
-					if (error_code == GIT_OK)
-					{
-						// Walk through all branch commits
-						git_oid oid;
-						git_commit* wcommit = NULL;
-						while ((git_revwalk_next (&oid, rev_walk)) == GIT_OK)
-						{
-							error_code = git_commit_lookup (& wcommit, m_repo, &oid);
-							if (error_code == GIT_OK)
-							{
-								// Add current commit id to the list
-								char commit_id [41] = {0};
-								git_oid_fmt (commit_id, & oid);
-								m_commits.append (commit_id);
-
-								git_commit_free (wcommit);
-							}
-							else
-								showGitError (NULL, error_code, tr ("looking up commit during revwalk"));
-						}
-					}
-					else
-						showGitError (NULL, error_code, tr ("setting up start commit for revision walking"));
-
-					git_revwalk_free (rev_walk);
-				}
-				else
-					showGitError (NULL, error_code, tr ("allocating libgit2 revision walking object"));
+	//
+	// Rows in load order are inserted in place; other sort orders get them appended and re-sorted later
+	//
+	bool appended = false;
+	foreach (int commit, _commits)
+	{
+		if (commit >= m_pickaxe_matches.size ())
+			continue;
 
-				git_object_free (branch_head);
-			}
-			else
-				showGitError (NULL, error_code, tr ("obtaining HEAD commit of branch"));
+		m_pickaxe_matches.setBit (commit);
+		if (m_snapshot_active || !m_ordered || !acceptsCommit (commit))
+			continue;
+
+		if (needsResort ())
+		{
+			beginInsertRows (QModelIndex (), m_order.size (), m_order.size ());
+			m_order.append (commit);
+			endInsertRows ();
+			appended = true;
 		}
 		else
-			showGitError (NULL, GIT_USER_ERROR, tr ("resolving branch as reference"));
+		{
+			const int row = int (std::lower_bound (m_order.constBegin (), m_order.constEnd (), commit) - m_order.constBegin ());
+			beginInsertRows (QModelIndex (), row, row);
+			m_order.insert (row, commit);
+			endInsertRows ();
+			m_sorted_rows = m_order.size ();
+		}
+	}
+
+	if (appended && !m_resort_timer.isActive ())
+		m_resort_timer.start ();
+
+	emit pickaxeProgress (m_pickaxe_checked, m_pickaxe_total);
+}
+
+void CCommitTableModel::finishPickaxeJob (int _generation, const QString& _error)
+{
+	if (_generation != m_pickaxe_generation)
+		return;
 
-		git_reference_free (git_branch);
+	// Commits which can't be diffed (e.g. parents missing in shallow clone) are reported once
+	if (! _error.isEmpty () && m_pickaxe_error.isEmpty ())
+	{
+		m_pickaxe_error = _error;
+		CDiagnostics::instance ()->post (tr ("Pickaxe"), _error);
 	}
-	else
-		showGitError (NULL, error_code, tr ("looking up local branch"));
 
-	// Reset model data in all attached views
-	reset ();
+	if (--m_pickaxe_running > 0)
+		return;
+
+	m_pickaxe_jobs.clear ();
+	if (m_resort_timer.isActive ())
+		resort ();
+
+	emit pickaxeFinished ();
 }
 
-bool CCommitTableModel::empty () const
+uint CCommitTableModel::commitTime (int _row) const
 {
-	return m_commits.isEmpty ();
+	const int commit = commitAt (_row);
+	if (! m_snapshot_active && (commit < m_keys.size ()))
+		return m_keys [commit].m_time;
+
+	return rowText (commit).m_time;
 }
 
-int CCommitTableModel::rowCount (const QModelIndex& _parent) const
+QStringList CCommitTableModel::branchNames () const
 {
-	Q_UNUSED (_parent);
-	return m_commits.count ();
+	return m_branch_names;
+}
+
+void CCommitTableModel::setWalkFilter (const CCommitWalkFilter& _filter)
+{
+	m_walk_filter = _filter;
+
+	// Filter is applied while walking: the history has to be walked again
+	if (! m_branch_names.isEmpty ())
+	{
+		discardSnapshot ();
+		startLoading (m_branch_names, m_compare);
+	}
+}
+
+CCommitWalkFilter CCommitTableModel::walkFilter () const
+{
+	return m_walk_filter;
+}
+
+bool CCommitTableModel::hasWalkFilter () const
+{
+	return ! m_walk_filter.isEmpty ();
+}
+
+QStringList CCommitTableModel::commitBranches (int _row) const
+{
+	QStringList branches;
+
+	const int commit = commitAt (_row);
+	if (m_snapshot_active || (commit >= m_keys.size ()))
+		return branches;
+
+	const QByteArray set = m_branch_sets.value (int (m_keys [commit].m_branches));
+	for (int branch = 0; branch < m_branch_names.size (); ++branch)
+	{
+		if ((branch / 8 < set.size ()) && (set [branch / 8] & (1 << (branch % 8))))
+			branches.append (m_branch_names [branch]);
+	}
+
+	return branches;
+}
+
+QString CCommitTableModel::authorAt (int _row) const
+{
+	const int commit = commitAt (_row);
+	if (! m_snapshot_active && (commit < m_keys.size ()))
+		return m_authors.value (int (m_keys [commit].m_author));
+
+	return rowText (commit).m_author;
 }
 
 int CCommitTableModel::columnCount (const QModelIndex& _parent) const
@@ -305,47 +1693,59 @@ QVariant CCommitTableModel::data (const QModelIndex& _index, int _role) const
 {
 	if (_index.isValid ())
 	{
-		// Obtain the commit id (SHA-1 hash)
-		const QString& commit_id = m_commits [_index.row ()];
-
-		// Return commit id for the custom role
-		// TODO: unusable?
-		if (_role == Qt::UserRole)
-			return commit_id;
-
+		const int commit = commitAt (_index.row ());
 		switch (_role)
 		{
+			case CommitIdRole:
+				return m_commits [commit].toString ();
+
+			case CommitTagsRole:
+				return rowText (commit).m_tags;
+
+			case CommitSummaryRole:
+				return rowText (commit).m_summary;
+
+			case CommitTimeRole:
+				return rowText (commit).m_time;
+
+			case CommitMessageRole:
+				return fullLog (commit);
+
+			case CommitBranchesRole:
+				return commitBranches (_index.row ());
+
+			case CommitSideRole:
+			{
+				// Bit of a branch is set in the only byte of the set
+				if (! m_compare || m_snapshot_active || (commit >= m_keys.size ()))
+					return 0;
+
+				const QByteArray set = m_branch_sets.value (int (m_keys [commit].m_branches));
+				return set.isEmpty () ? 0 : int (uchar (set [0]));
+			}
+
 			case Qt::DisplayRole:
 				switch (_index.column ())
 				{
 					case _ShortLogColumn:
-					{
-						// Show commit short log and tags
-						QStringList tags = commitTags (commit_id, m_repo);
-						QString tag_string;
-						foreach (const QString& tag, tags)
-							tag_string += "[" + tag + "] ";
-						return (tag_string + commitLog (commit_id, m_repo, true));
-					}
+						return rowText (commit).m_short_log;
 
 					case _AuthorColumn:
-						return commitAuthor (commit_id, m_repo);
+						return rowText (commit).m_author;
 
 					case _DateColumn:
-						return commitDate (commit_id, m_repo);
+						return rowText (commit).m_date;
 				}
 
 			case Qt::ToolTipRole:
-				return commitLog (commit_id, m_repo);
+				if (data (_index, CommitSideRole).toInt () == CCompareWalker::SIDE_BOTH)
+					return fullLog (commit) + "\n\n" + tr ("Merge base of %1 and %2").arg (m_branch_names.value (0), m_branch_names.value (1));
 
-			case Qt::BackgroundRole:
-			{
-				// Change background color to yellow for the tagged commits
-				if ((_index.column () == _ShortLogColumn) && !commitTags (commit_id, m_repo).isEmpty ())
-					return QBrush (Qt::yellow);
+				// Combined list tells where the commit came from
+				if (m_branch_names.size () > 1)
+					return fullLog (commit) + "\n\n" + tr ("Branches: %1").arg (commitBranches (_index.row ()).join (", "));
 
-				break;
-			}
+				return fullLog (commit);
 
 			default: break;
 		}
@@ -379,6 +1779,31 @@ QVariant CCommitTableModel::headerData (int _section, Qt::Orientation _orientati
 QModelIndexList CCommitTableModel::match (const QModelIndex& _start, int _role, const QVariant& _value,
 						  int _hits, Qt::MatchFlags _flags) const
 {
+	//
+	// Words of full messages are looked up in the index; rows from _start go first as in base class
+	//
+	if (_role == CommitMessageRole)
+	{
+		const QList<int> rows = messageRows (_value.toString ());
+		const int start = _start.isValid () ? _start.row () : 0;
+		const int column = _start.isValid () ? _start.column () : 0;
+		const int first = int (std::lower_bound (rows.begin (), rows.end (), start) - rows.begin ());
+
+		QModelIndexList result;
+		for (int i = 0; i < rows.size (); ++i)
+		{
+			if ((_hits >= 0) && (result.size () >= _hits))
+				break;
+
+			if ((first + i >= rows.size ()) && !(_flags & Qt::MatchWrap))
+				break;
+
+			result.append (index (rows [(first + i) % rows.size ()], column));
+		}
+
+		return result;
+	}
+
 	// NOTE: match() from base class due to recursive flag cause stack overflow!
 	// So we forced to remove this flag manually, because table have flat structure and
 	// doesn't need recursion using at all
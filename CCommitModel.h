@@ -8,43 +8,412 @@
 #ifndef __QGITREPOVIEWER_CCOMMITMODEL_H
 #define __QGITREPOVIEWER_CCOMMITMODEL_H
 
+#include <QBitArray>
 #include <QStringList>
 #include <QAbstractTableModel>
+#include <QCache>
+#include <QTimer>
+
+#include "GitHelpers.h"
+#include "CMemoryBudget.h"
+#include "CWorkerPool.h"
+#include "CPackCommitReader.h"
+#include "CCommitLoader.h"
+#include "CMessageIndex.h"
+#include "CPickaxe.h"
+#include "CCompareWalker.h"
 
 struct git_repository;
 
 namespace QGitRepoViewer
 {
+	/// Rendered texts of one commit table row
+	struct CCommitRowText
+	{
+		QString m_short_log;
+		QString m_summary;
+		QString m_author;
+		QString m_date;
+		QStringList m_tags;
+		uint m_time;
+
+		CCommitRowText (): m_time (0)
+		{}
+
+		/// Approximate size of row texts in bytes
+		int cost () const
+		{
+			int size = m_short_log.size () + m_summary.size () + m_author.size () + m_date.size ();
+			foreach (const QString& tag, m_tags)
+				size += tag.size ();
+
+			return int (sizeof (CCommitRowText)) + size * int (sizeof (QChar));
+		}
+	};
+
 	/// Table data model for representing commits of git repository
-	class CCommitTableModel : public QAbstractTableModel
+	class CCommitTableModel : public QAbstractTableModel, public CMemoryBudget::IClient
 	{
 		Q_OBJECT
 
-		/// The list of SHA-1 commit hashes
-		QStringList m_commits;
+		/// The list of commit ids in load (topological) order, filled by background load job
+		CGitOidVector m_commits;
+
+		/// Sort keys of m_commits, names of interned authors and interned branch sets (bitsets of m_branch_names)
+		CCommitKeyVector m_keys;
+		QStringList m_authors;
+		QList<QByteArray> m_branch_sets;
+
+		/**
+		 * @name Sort and filter state
+		 *
+		 * When m_ordered is set, model row i shows commit m_order [i]; otherwise rows are shown in load order.
+		 */
+		/** @{*/
+		bool m_ordered;
+		QVector<int> m_order;
+		int m_sort_column;
+		Qt::SortOrder m_sort_order;
+		QString m_author_filter;
+		int m_author_filter_id;
+
+		/// Commit time range filter (inclusive)
+		bool m_date_filter;
+		uint m_date_from;
+		uint m_date_to;
+
+		/// Pickaxe filter: commits found by search jobs so far (bits by index in m_commits)
+		bool m_pickaxe_filter;
+		CPickaxeQuery m_pickaxe_query;
+		QBitArray m_pickaxe_matches;
+
+		/// Count of leading rows of m_order which are already sorted
+		int m_sorted_rows;
+
+		/// Coalesces re-sorts while batches of commits are arriving
+		QTimer m_resort_timer;
+		/** @}*/
+
+		/// Commit indices ordered by time, for date lookups; extended lazily as commits arrive
+		mutable QVector<int> m_time_index;
+
+		/// Commit indices ordered by SHA-1 id, for id and prefix lookups; extended lazily as commits arrive
+		mutable QVector<int> m_oid_index;
+
+		/// Ranks of author ids by name, for sorting by author; rebuilt lazily when new authors arrive
+		mutable QVector<int> m_author_rank;
+
+		/// Tags of commits of the repository
+		CGitTagMap m_tags;
+
+		/// Rendered row texts, bounded by the global memory budget
+		mutable QCache<int, CCommitRowText> m_row_cache;
+
+		/// Row texts which didn't fit into the cache (cache limit may be zero for background tab)
+		mutable CCommitRowText m_uncached_row;
 
 		/// Pointer to the git repository object
 		git_repository* m_repo;
 
+		/// Fast path for list columns of packed commits
+		mutable CPackCommitReader m_pack_reader;
+
+		QString m_repo_path;
+
+		/// Current commit list load job and its generation number
+		CBackgroundJobPtr m_load_job;
+		int m_generation;
+		bool m_loading;
+
+		/// Is the model shown in the active tab
+		bool m_active;
+
+		/// Name of the branch which commits are shown (empty when several branches are shown)
+		QString m_branch_name;
+
+		/// Names of all branches which commits are shown
+		QStringList m_branch_names;
+
+		/// Conditions checked by load job: only matching commits are loaded
+		CCommitWalkFilter m_walk_filter;
+
+		/// Commits unique to either of two branches are shown; their merge bases once they are known
+		bool m_compare;
+		bool m_merge_base_known;
+		CMergeBase m_merge_base;
+
+		/// Rows restored from previous session snapshot; shown until the real commit list confirms them
+		bool m_snapshot_active;
+		QVector<CCommitRowText> m_snapshot_texts;
+		QString m_snapshot_branch;
+
+		/// Commits of the real list (and their keys) received while snapshot is being validated
+		CGitOidVector m_validation;
+		CCommitKeyVector m_validation_keys;
+
+		/// Full-text index of commit messages kept in the git directory and its update job
+		CMessageIndex m_message_index;
+		QString m_message_index_path;
+		CBackgroundJobPtr m_index_job;
+		int m_index_generation;
+
+		/// Add messages of loaded commits which are not indexed yet
+		void startMessageIndexing ();
+
+		/// Job building changed-path filters of loaded commits for path-limited walks
+		CBackgroundJobPtr m_path_filter_job;
+		int m_path_filter_generation;
+
+		/// Build changed-path filters of loaded commits missing in commit-graph and the viewer's file
+		void startPathFilterBuilding ();
+
+		/// Pickaxe search jobs, their generation and count of running ones
+		QList<CBackgroundJobPtr> m_pickaxe_jobs;
+		int m_pickaxe_generation;
+		int m_pickaxe_running;
+
+		/// Count of commits given to pickaxe search and checked by it; the first error of the search
+		int m_pickaxe_total;
+		int m_pickaxe_checked;
+		QString m_pickaxe_error;
+
+		/// Search loaded commits from specified one with pickaxe query on all pool threads
+		void startPickaxeSearch (int _first);
+		void cancelPickaxeSearch ();
+
+		/// Rows of shown commits which messages contain all words of the query, in row order
+		QList<int> messageRows (const QString& _query) const;
+
+		void cancelLoading ();
+
+		/// Start loading commits of branches (of two branches in compare mode)
+		void startLoading (const QStringList& _branch_names, bool _compare);
+
+		/// Compare snapshot rows with received real commits and replace them if they differ
+		void validateSnapshot ();
+
+		/// Render (or take from cache) texts of specified commit (index in m_commits)
+		const CCommitRowText& rowText (int _commit) const;
+
+		/// Full commit message for tooltip, read by libgit2
+		QString fullLog (int _commit) const;
+
+		/// Index in m_commits of commit shown in specified row
+		int commitAt (int _row) const;
+
+		/// Check whether any filter is set
+		bool hasFilter () const;
+
+		/// Check whether commit passes the author, date and pickaxe filters
+		bool acceptsCommit (int _commit) const;
+
+		/// Index of all loaded commits ordered by time
+		const QVector<int>& timeIndex () const;
+
+		/// Index of all loaded commits ordered by id
+		const QVector<int>& oidIndex () const;
+
+		/// Row showing specified commit or -1 if it is filtered out
+		int rowOfCommit (int _commit) const;
+
+		/// Ranks of author ids by name if sorting by specified column needs them
+		const QVector<int>& authorRank (int _column) const;
+
+		/// Whether rows appended in load order break current sort order
+		bool needsResort () const;
+
+		/// Sort commit indices in place according to current sort column; first _sorted ones are already sorted
+		void sortCommits (QVector<int>& _order, int _sorted = 0) const;
+		void sortByKeys (QVector<int>& _order, int _sorted, int _column, bool _descending) const;
+
+		/// Rebuild m_order from scratch (filter was changed)
+		void rebuildOrder ();
+
+	private Q_SLOTS:
+		/// Receive tags of the repository from load job
+		void setTags (int _generation, const CGitTagMap& _tags);
+
+		/// Receive next batch of commits and their sort keys from load job
+		void appendCommits (int _generation, const CGitOidVector& _oids, const CCommitKeyBatch& _keys);
+
+		/// Re-sort rows keeping persistent indices (selection) on their commits
+		void resort ();
+
+		/// Load job was finished (with error description if it failed)
+		void finishLoading (int _generation, const QString& _error);
+
+		/// Load job in compare mode has found (or recalled) merge bases of the branches
+		void setMergeBases (int _generation, const CGitOidVector& _bases, int _left_only, int _right_only);
+
+		/// Index job has written the updated message index into specified file
+		void updateMessageIndex (int _generation, const QString& _path);
+
+		/// Path filter job has written the updated changed-path filters into specified file (at each checkpoint)
+		void updatePathFilters (int _generation, const QString& _path);
+
+		/// Pickaxe job has checked next commits; matching ones are shown at once
+		void addPickaxeMatches (int _generation, const QVector<int>& _commits, int _checked);
+
+		/// Pickaxe job was finished (with the first error it met, if any)
+		void finishPickaxeJob (int _generation, const QString& _error);
+
+	Q_SIGNALS:
+		/// All commits of the branch were loaded
+		void loadingFinished ();
+
+		/// Merge bases of compared branches are known
+		void mergeBasesFound ();
+
+		/// Pickaxe search has checked more commits
+		void pickaxeProgress (int _checked, int _total);
+
+		/// Pickaxe search has checked all loaded commits (or was stopped)
+		void pickaxeFinished ();
+
 	public:
 		/// Table columns: commit short log, commit author name and email, commit date
 		enum { _ShortLogColumn = 0, _AuthorColumn = 1, _DateColumn, _ColumntCount };
 
+		/// Custom data roles used by commit item delegate
+		enum
+		{
+			CommitIdRole = Qt::UserRole,	///< SHA-1 id (QString)
+			CommitTagsRole,					///< tag names (QStringList)
+			CommitSummaryRole,				///< first line of message without tags (QString)
+			CommitTimeRole,					///< commit time (uint, seconds since epoch)
+			CommitMessageRole,				///< full message (QString); match() looks its words up in message index
+			CommitBranchesRole,				///< names of shown branches containing the commit (QStringList)
+			CommitSideRole					///< side of compared commit (CCompareWalker::Side) or 0 (int)
+		};
+
+		/// Format version of snapshot() data
+		enum { SNAPSHOT_VERSION = 2 };
+
+		/// Delay of re-sorting after new batch of commits
+		enum { RESORT_DELAY_MS = 300 };
+
+		/// Smaller lists are sorted by one thread
+		enum { PARALLEL_SORT_MIN = 1 << 16 };
+
+		/// Shortest SHA-1 prefix accepted by commitRowsByPrefix()
+		enum { MIN_PREFIX_LENGTH = 4 };
+
 		CCommitTableModel (QObject* _parent = 0);
 		~CCommitTableModel ();
 
 		/// Setup the git repository to view
 		void setGitRepo (const QString& _repo_path);
 
-		/// Return row index of commit with specified SHA-1 id or -1 if it was not found
-		int commitIndex (const QString _commit_id) const;
+		/// Return row index of commit with specified SHA-1 id or -1 if it was not found; a row range (_to >= 0) is scanned
+		int commitIndex (const QString _commit_id, int _from = 0, int _to = -1) const;
+
+		/// Rows of at most _max_count shown commits which ids start with specified hex prefix
+		QList<int> commitRowsByPrefix (const QString& _prefix, int _max_count) const;
 
-		/// Load the commit list of specified git repository local branch
+		/// Start loading the commit list of specified git repository local branch in background
 		void setCommitList (const QString& _branch_name);
 
+		/// Show commits of all specified local branches in one list, loaded by one history walk
+		void setCommitList (const QStringList& _branch_names);
+
+		/**
+		 * @brief Show commits unique to either of two local branches (A...B) and their merge bases
+		 *
+		 * History is walked from both tips on worker pool until only shared commits remain, so the cost
+		 * depends on the count of unique commits rather than on the length of the history.
+		 */
+		void setCompareList (const QString& _left_branch, const QString& _right_branch);
+
+		/// Whether commits of two compared branches are shown
+		bool isComparison () const;
+
+		/// Merge bases and counts of commits unique to either side; false until they are known
+		bool mergeBase (CMergeBase& _result) const;
+
+		/// Names of the branches which commits are shown
+		QStringList branchNames () const;
+
+		/// Reload shown branches keeping only commits which pass the filter (empty filter loads all)
+		void setWalkFilter (const CCommitWalkFilter& _filter);
+		CCommitWalkFilter walkFilter () const;
+		bool hasWalkFilter () const;
+
+		/// Names of shown branches containing the commit in specified row
+		QStringList commitBranches (int _row) const;
+
 		/// Check whether at least one commit was found
 		bool empty () const;
 
+		/// Check whether commit list is still being loaded
+		bool isLoading () const;
+
+		/// Active model loads with foreground priority; inactive one pauses loading
+		void setActive (bool _active);
+
+		/// Show only commits of specified author ("Name <email>"); empty string shows all commits
+		void setAuthorFilter (const QString& _author);
+		QString authorFilter () const;
+
+		/// Author of commit shown in specified row
+		QString authorAt (int _row) const;
+
+		/// Show only commits with time in range [_from, _to] (seconds since epoch)
+		void setDateFilter (uint _from, uint _to);
+		void clearDateFilter ();
+		bool hasDateFilter () const;
+
+		/**
+		 * @brief Show only commits changing text like git log -S/-G
+		 *
+		 * Loaded commits are diffed with their first parents on all pool threads; matching ones appear
+		 * as they are found, commits loaded later are searched when loading finishes.
+		 */
+		void setPickaxeFilter (const CPickaxeQuery& _query);
+		void clearPickaxeFilter ();
+		bool hasPickaxeFilter () const;
+		CPickaxeQuery pickaxeFilter () const;
+
+		/// Stop pickaxe search keeping found commits shown
+		void stopPickaxeSearch ();
+		bool isPickaxeSearching () const;
+
+		/// Count of commits checked by pickaxe search and of those given to it
+		int pickaxeCheckedCommits () const;
+		int pickaxeTotalCommits () const;
+
+		/// Row of the newest shown commit made not later than specified time (binary search by time)
+		int rowForDate (uint _time) const;
+
+		/// Commit time of specified row
+		uint commitTime (int _row) const;
+
+		int sortColumn () const;
+		Qt::SortOrder sortOrder () const;
+
+		/**
+		 * @name Warm-start snapshot: first rows of the list saved at exit and shown at once on next launch
+		 */
+		/** @{*/
+		/// Serialize branch name, tip and rendered texts of first _row_count rows
+		QByteArray snapshot (int _row_count) const;
+
+		/// Show rows from snapshot until setCommitList() of the same branch validates them
+		bool setSnapshot (const QByteArray& _data);
+
+		/// Drop snapshot rows which are not validated yet
+		void discardSnapshot ();
+
+		bool isSnapshot () const;
+		QString snapshotBranch () const;
+		CGitOid snapshotTip () const;
+		/** @}*/
+
+		/// @name Implementation of CMemoryBudget::IClient interface
+		/** @{*/
+		qint64 cacheCost () const;
+		void setCacheLimit (qint64 _max_cost);
+		/** @}*/
+
 	public:
 		/**
 		 * @name Implementation of QAbstractItemModel interface
@@ -56,6 +425,10 @@ namespace QGitRepoViewer
 		QVariant data (const QModelIndex& _index, int _role = Qt::DisplayRole) const;
 		QVariant headerData (int _section, Qt::Orientation _orientation, int _role = Qt::DisplayRole) const;
 
+		/// Sort by precomputed keys: load order for short log column, author name, commit time
+		void sort (int _column, Qt::SortOrder _order = Qt::AscendingOrder);
+
+		/// Search in CommitMessageRole uses the message index, other roles are compared row by row
 		QModelIndexList	match (const QModelIndex& _start, int _role, const QVariant& _value, int _hits = 1,
 							   Qt::MatchFlags _flags = Qt::MatchStartsWith | Qt::MatchWrap) const;
 		/** @}*/
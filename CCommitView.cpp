@@ -0,0 +1,442 @@
+/**
+ * @file
+ * @brief Virtualized view of the commit table implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitView.h"
+
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+
+using namespace QGitRepoViewer;
+
+CCommitView::CCommitView (QWidget* _parent):
+	QAbstractItemView (_parent),
+	m_header (new QHeaderView (Qt::Horizontal, this)),
+	m_row_height (DEFAULT_ROW_HEIGHT)
+{
+	//
+	// Header only keeps column geometry; rows are selected as a whole
+	//
+	m_header->setHighlightSections (false);
+	m_header->hide ();
+	connect (m_header, SIGNAL (sectionResized (int, int, int)), this, SLOT (aboutSectionResized ()));
+	connect (m_header, SIGNAL (sectionMoved (int, int, int)), this, SLOT (aboutSectionResized ()));
+
+	setSelectionBehavior (SelectRows);
+	setVerticalScrollMode (ScrollPerItem);
+	setHorizontalScrollMode (ScrollPerPixel);
+}
+
+void
+CCommitView::setModel (QAbstractItemModel* _model)
+{
+	QAbstractItemView::setModel (_model);
+	m_header->setModel (_model);
+}
+
+QHeaderView*
+CCommitView::header () const
+{
+	return m_header;
+}
+
+void
+CCommitView::setHeaderVisible (bool _visible)
+{
+	m_header->setVisible (_visible);
+	updateGeometries ();
+}
+
+void
+CCommitView::setSortingEnabled (bool _enabled)
+{
+	disconnect (m_header, SIGNAL (sortIndicatorChanged (int, Qt::SortOrder)),
+				this, SLOT (aboutSortIndicatorChanged (int, Qt::SortOrder)));
+
+#if QT_VERSION >= 0x050000
+	m_header->setSectionsClickable (_enabled);
+#else
+	m_header->setClickable (_enabled);
+#endif
+	m_header->setSortIndicatorShown (_enabled);
+
+	if (_enabled)
+	{
+		connect (m_header, SIGNAL (sortIndicatorChanged (int, Qt::SortOrder)),
+				 this, SLOT (aboutSortIndicatorChanged (int, Qt::SortOrder)));
+		aboutSortIndicatorChanged (m_header->sortIndicatorSection (), m_header->sortIndicatorOrder ());
+	}
+}
+
+void
+CCommitView::aboutSortIndicatorChanged (int _column, Qt::SortOrder _order)
+{
+	if (model ())
+		model ()->sort (_column, _order);
+}
+
+int
+CCommitView::columnWidth (int _column) const
+{
+	return m_header->sectionSize (_column);
+}
+
+void
+CCommitView::setColumnWidth (int _column, int _width)
+{
+	m_header->resizeSection (_column, _width);
+}
+
+int
+CCommitView::rowHeight () const
+{
+	return m_row_height;
+}
+
+void
+CCommitView::setRowHeight (int _height)
+{
+	m_row_height = qMax (1, _height);
+	updateGeometries ();
+	viewport ()->update ();
+}
+
+int
+CCommitView::rowCount () const
+{
+	return model () ? model ()->rowCount (rootIndex ()) : 0;
+}
+
+int
+CCommitView::firstVisibleRow () const
+{
+	return verticalScrollBar ()->value ();
+}
+
+int
+CCommitView::pageRowCount () const
+{
+	return qMax (1, viewport ()->height () / m_row_height);
+}
+
+int
+CCommitView::rowAt (int _y) const
+{
+	if (_y < 0)
+		return -1;
+
+	const int row = firstVisibleRow () + _y / m_row_height;
+	return (row < rowCount ()) ? row : -1;
+}
+
+void
+CCommitView::selectRow (int _row)
+{
+	if (! model () || !selectionModel ())
+		return;
+
+	const QModelIndex index = model ()->index (_row, 0, rootIndex ());
+	if (index.isValid ())
+		selectionModel ()->setCurrentIndex (index, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
+}
+
+QRect
+CCommitView::visualRect (const QModelIndex& _index) const
+{
+	if (! _index.isValid () || m_header->isSectionHidden (_index.column ()))
+		return QRect ();
+
+	//
+	// Rows far from the viewport still get a rect, just outside of it
+	//
+	const qint64 y = qint64 (_index.row () - firstVisibleRow ()) * m_row_height;
+	return QRect (m_header->sectionViewportPosition (_index.column ()),
+				  int (qBound (qint64 (-QWIDGETSIZE_MAX), y, qint64 (QWIDGETSIZE_MAX))),
+				  m_header->sectionSize (_index.column ()), m_row_height);
+}
+
+void
+CCommitView::scrollTo (const QModelIndex& _index, ScrollHint _hint)
+{
+	if (! _index.isValid ())
+		return;
+
+	const int row = _index.row ();
+	const int first = firstVisibleRow ();
+	const int page = pageRowCount ();
+
+	int target = first;
+	switch (_hint)
+	{
+		case PositionAtTop:
+			target = row;
+			break;
+
+		case PositionAtBottom:
+			target = row - page + 1;
+			break;
+
+		case PositionAtCenter:
+			target = row - page / 2;
+			break;
+
+		default:
+			if (row < first)
+				target = row;
+			else if (row >= first + page)
+				target = row - page + 1;
+			break;
+	}
+	verticalScrollBar ()->setValue (target);
+
+	const int left = m_header->sectionPosition (_index.column ());
+	const int right = left + m_header->sectionSize (_index.column ());
+	const int offset = horizontalScrollBar ()->value ();
+	if (left < offset)
+		horizontalScrollBar ()->setValue (left);
+	else if (right > offset + viewport ()->width ())
+		horizontalScrollBar ()->setValue (qMin (left, right - viewport ()->width ()));
+}
+
+QModelIndex
+CCommitView::indexAt (const QPoint& _point) const
+{
+	const int row = rowAt (_point.y ());
+	const int column = m_header->logicalIndexAt (_point.x ());
+	if ((row < 0) || (column < 0))
+		return QModelIndex ();
+
+	return model ()->index (row, column, rootIndex ());
+}
+
+QModelIndex
+CCommitView::moveCursor (CursorAction _action, Qt::KeyboardModifiers _modifiers)
+{
+	Q_UNUSED (_modifiers);
+
+	const int rows = rowCount ();
+	if (rows == 0)
+		return QModelIndex ();
+
+	const QModelIndex current = currentIndex ();
+	const int column = current.isValid () ? current.column () : m_header->logicalIndex (0);
+	int row = current.isValid () ? current.row () : -1;
+
+	switch (_action)
+	{
+		case MoveUp:
+		case MovePrevious:
+			--row;
+			break;
+
+		case MoveDown:
+		case MoveNext:
+			++row;
+			break;
+
+		case MovePageUp:
+			row -= pageRowCount ();
+			break;
+
+		case MovePageDown:
+			row += pageRowCount ();
+			break;
+
+		case MoveHome:
+			row = 0;
+			break;
+
+		case MoveEnd:
+			row = rows - 1;
+			break;
+
+		default:
+			return current;
+	}
+
+	return model ()->index (qBound (0, row, rows - 1), column, rootIndex ());
+}
+
+int
+CCommitView::horizontalOffset () const
+{
+	return horizontalScrollBar ()->value ();
+}
+
+int
+CCommitView::verticalOffset () const
+{
+	return firstVisibleRow () * m_row_height;
+}
+
+bool
+CCommitView::isIndexHidden (const QModelIndex& _index) const
+{
+	return m_header->isSectionHidden (_index.column ());
+}
+
+void
+CCommitView::setSelection (const QRect& _rect, QItemSelectionModel::SelectionFlags _flags)
+{
+	const int rows = rowCount ();
+	if (! selectionModel () || (rows == 0))
+		return;
+
+	//
+	// Any rectangle selects a single range of whole rows, whatever count of rows it covers
+	//
+	const QRect rect = _rect.normalized ();
+	const int first = firstVisibleRow ();
+	const int top = qBound (0, first + qMax (0, rect.top ()) / m_row_height, rows - 1);
+	const int bottom = qBound (0, first + qMax (0, rect.bottom ()) / m_row_height, rows - 1);
+
+	const QItemSelection selection (model ()->index (top, 0, rootIndex ()),
+									model ()->index (bottom, model ()->columnCount (rootIndex ()) - 1, rootIndex ()));
+	selectionModel ()->select (selection, _flags);
+}
+
+QRegion
+CCommitView::visualRegionForSelection (const QItemSelection& _selection) const
+{
+	const int first = firstVisibleRow ();
+	const int last = first + pageRowCount ();
+
+	QRegion region;
+	foreach (const QItemSelectionRange& range, _selection)
+	{
+		if (! range.isValid ())
+			continue;
+
+		const int top = qMax (range.top (), first);
+		const int bottom = qMin (range.bottom (), last);
+		if (top <= bottom)
+			region += QRect (0, (top - first) * m_row_height, viewport ()->width (), (bottom - top + 1) * m_row_height);
+	}
+
+	return region;
+}
+
+void
+CCommitView::paintEvent (QPaintEvent* _event)
+{
+	if (! model ())
+		return;
+
+	const QRect area = _event->rect ();
+	const int first = firstVisibleRow ();
+	const int top = first + qMax (0, area.top ()) / m_row_height;
+	const int bottom = qMin (rowCount () - 1, first + area.bottom () / m_row_height);
+
+	QPainter painter (viewport ());
+
+	QStyleOptionViewItemV4 option = viewOptions ();
+	const QStyle::State state = option.state;
+	const QModelIndex current = currentIndex ();
+
+	//
+	// Only rows intersecting the dirty area are visited
+	//
+	for (int row = top; row <= bottom; ++row)
+	{
+		const int y = (row - first) * m_row_height;
+		const bool selected = selectionModel () && selectionModel ()->isRowSelected (row, rootIndex ());
+
+		if (alternatingRowColors () && (row & 1))
+			option.features |= QStyleOptionViewItemV2::Alternate;
+		else
+			option.features &= ~QStyleOptionViewItemV2::Alternate;
+
+		for (int section = 0; section < m_header->count (); ++section)
+		{
+			const int column = m_header->logicalIndex (section);
+			if (m_header->isSectionHidden (column))
+				continue;
+
+			option.rect = QRect (m_header->sectionViewportPosition (column), y, m_header->sectionSize (column), m_row_height);
+			if (! option.rect.intersects (area))
+				continue;
+
+			const QModelIndex index = model ()->index (row, column, rootIndex ());
+
+			option.state = state;
+			if (selected)
+				option.state |= QStyle::State_Selected;
+			if (hasFocus () && (index == current))
+				option.state |= QStyle::State_HasFocus;
+
+			itemDelegate (index)->paint (& painter, option, index);
+		}
+	}
+}
+
+void
+CCommitView::scrollContentsBy (int _dx, int _dy)
+{
+	if (_dx != 0)
+		m_header->setOffset (horizontalScrollBar ()->value ());
+
+	//
+	// Vertical scroll bar counts rows, not pixels
+	//
+	if (qAbs (_dy) < pageRowCount ())
+		viewport ()->scroll (_dx, _dy * m_row_height);
+	else
+		viewport ()->update ();
+}
+
+void
+CCommitView::updateGeometries ()
+{
+	if (m_header->isHidden ())
+		setViewportMargins (0, 0, 0, 0);
+	else
+	{
+		const int height = m_header->sizeHint ().height ();
+		setViewportMargins (0, height, 0, 0);
+		m_header->setGeometry (viewport ()->x (), viewport ()->y () - height, viewport ()->width (), height);
+	}
+
+	const int page = pageRowCount ();
+	verticalScrollBar ()->setSingleStep (1);
+	verticalScrollBar ()->setPageStep (page);
+	verticalScrollBar ()->setRange (0, qMax (0, rowCount () - page));
+
+	horizontalScrollBar ()->setSingleStep (m_row_height);
+	horizontalScrollBar ()->setPageStep (viewport ()->width ());
+	horizontalScrollBar ()->setRange (0, qMax (0, m_header->length () - viewport ()->width ()));
+
+	QAbstractItemView::updateGeometries ();
+}
+
+void
+CCommitView::rowsInserted (const QModelIndex& _parent, int _start, int _end)
+{
+	QAbstractItemView::rowsInserted (_parent, _start, _end);
+
+	//
+	// Only the scroll range depends on the row count; repaint if new rows are on screen
+	//
+	updateGeometries ();
+	if (_start <= firstVisibleRow () + pageRowCount ())
+		viewport ()->update ();
+}
+
+void
+CCommitView::rowsAboutToBeRemoved (const QModelIndex& _parent, int _start, int _end)
+{
+	QAbstractItemView::rowsAboutToBeRemoved (_parent, _start, _end);
+
+	// Row count is changed only after this call
+	QMetaObject::invokeMethod (this, "updateGeometries", Qt::QueuedConnection);
+	viewport ()->update ();
+}
+
+void
+CCommitView::aboutSectionResized ()
+{
+	updateGeometries ();
+	viewport ()->update ();
+}
@@ -0,0 +1,95 @@
+/**
+ * @file
+ * @brief Virtualized view of the commit table interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITVIEW_H
+#define __QGITREPOVIEWER_CCOMMITVIEW_H
+
+#include <QAbstractItemView>
+
+class QHeaderView;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Table view for flat models with tens of millions of rows
+	 *
+	 * Unlike QTableView it keeps no per-row state: all rows have the same height, there is no vertical header,
+	 * scrolling and hit testing are arithmetic on the row number and selection is stored as row ranges.
+	 * Only the rows intersecting the viewport are painted.
+	 */
+	class CCommitView : public QAbstractItemView
+	{
+		Q_OBJECT
+
+		/// Horizontal header: keeps column widths and order, hidden by default
+		QHeaderView* m_header;
+
+		/// Height of every row in pixels
+		int m_row_height;
+
+		int rowCount () const;
+
+		/// Index of the topmost (maybe partially) visible row
+		int firstVisibleRow () const;
+
+		/// Count of rows fully fitting into the viewport
+		int pageRowCount () const;
+
+	private slots:
+		void aboutSectionResized ();
+
+		/// User clicked the header: ask the model to sort
+		void aboutSortIndicatorChanged (int _column, Qt::SortOrder _order);
+
+	protected:
+		QModelIndex moveCursor (CursorAction _action, Qt::KeyboardModifiers _modifiers);
+		int horizontalOffset () const;
+		int verticalOffset () const;
+		bool isIndexHidden (const QModelIndex& _index) const;
+		void setSelection (const QRect& _rect, QItemSelectionModel::SelectionFlags _flags);
+		QRegion visualRegionForSelection (const QItemSelection& _selection) const;
+
+		void paintEvent (QPaintEvent* _event);
+		void scrollContentsBy (int _dx, int _dy);
+		void updateGeometries ();
+
+	protected slots:
+		void rowsInserted (const QModelIndex& _parent, int _start, int _end);
+		void rowsAboutToBeRemoved (const QModelIndex& _parent, int _start, int _end);
+
+	public:
+		enum { DEFAULT_ROW_HEIGHT = 20 };
+
+		explicit CCommitView (QWidget* _parent = NULL);
+
+		void setModel (QAbstractItemModel* _model);
+
+		QHeaderView* header () const;
+
+		/// Show horizontal header above the rows
+		void setHeaderVisible (bool _visible);
+
+		/// Sort the model by clicks on header; the model does the sorting itself
+		void setSortingEnabled (bool _enabled);
+
+		int columnWidth (int _column) const;
+		void setColumnWidth (int _column, int _width);
+
+		int rowHeight () const;
+		void setRowHeight (int _height);
+
+		/// Row under specified viewport y coordinate or -1
+		int rowAt (int _y) const;
+
+		/// Make the row current and select it
+		void selectRow (int _row);
+
+		QRect visualRect (const QModelIndex& _index) const;
+		void scrollTo (const QModelIndex& _index, ScrollHint _hint = EnsureVisible);
+		QModelIndex indexAt (const QPoint& _point) const;
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMMITVIEW_H
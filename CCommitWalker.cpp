@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @brief Revision walker shared by commit table model and headless export implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCommitWalker.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+CCommitWalker::CCommitWalker (git_repository* _repo):
+	m_repo (_repo),
+	m_walk (NULL),
+	m_failed (false)
+{}
+
+CCommitWalker::~CCommitWalker ()
+{
+	if (m_walk)
+		git_revwalk_free (m_walk);
+}
+
+void
+CCommitWalker::setLastError (int _code, const QString& _action)
+{
+	m_last_error = gitErrorString (_code, _action);
+}
+
+QString
+CCommitWalker::lastError () const
+{
+	return m_last_error;
+}
+
+bool
+CCommitWalker::pushBranch (const QString& _branch_name, CGitOid* _tip)
+{
+	bool result = false;
+
+	if (!m_repo)
+		return result;
+
+	//
+	// Search for brach with specified name in git repository
+	//
+	git_reference* git_branch = NULL;
+	int error_code = git_branch_lookup (&git_branch, m_repo, QFile::encodeName (_branch_name), GIT_BRANCH_LOCAL);
+	if (error_code != GIT_OK)
+	{
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "looking up local branch"));
+		return result;
+	}
+
+	//
+	// Obtain the HEAD commit object of the branch
+	//
+	git_object* branch_head = NULL;
+	error_code = git_reference_peel (&branch_head, git_branch, GIT_OBJ_COMMIT);
+	if (error_code == GIT_OK)
+	{
+		Q_ASSERT (git_object_type (branch_head) == GIT_OBJ_COMMIT);
+
+		//
+		// Create the commit iterator object on first push
+		//
+		if (!m_walk)
+		{
+			error_code = git_revwalk_new (&m_walk, m_repo);
+			if (error_code == GIT_OK)
+				git_revwalk_sorting (m_walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_TIME);
+			else
+			{
+				m_walk = NULL;
+				setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "allocating libgit2 revision walking object"));
+			}
+		}
+
+		if (m_walk)
+		{
+			error_code = git_revwalk_push (m_walk, git_object_id (branch_head));
+			if (error_code == GIT_OK)
+			{
+				result = true;
+				if (_tip)
+					*_tip = CGitOid (git_object_id (branch_head));
+			}
+			else
+				setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "setting up start commit for revision walking"));
+		}
+
+		git_object_free (branch_head);
+	}
+	else
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "obtaining HEAD commit of branch"));
+
+	git_reference_free (git_branch);
+	return result;
+}
+
+int
+CCommitWalker::next (QVector<CGitOid>& _batch, int _max_count)
+{
+	int count = 0;
+	if (!m_walk || m_failed)
+		return count;
+
+	git_oid oid;
+	while (count < _max_count)
+	{
+		//
+		// Only GIT_ITEROVER ends the history: other errors (missing or corrupt objects) must not
+		// look like a complete one
+		//
+		const int error_code = git_revwalk_next (&oid, m_walk);
+		if (error_code == GIT_ITEROVER)
+			break;
+
+		if (error_code != GIT_OK)
+		{
+			m_failed = true;
+			setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "walking commit history"));
+			break;
+		}
+
+		_batch.append (CGitOid (&oid));
+		++count;
+	}
+
+	return count;
+}
+
+bool
+CCommitWalker::hasFailed () const
+{
+	return m_failed;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @brief Revision walker shared by commit table model and headless export interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMMITWALKER_H
+#define __QGITREPOVIEWER_CCOMMITWALKER_H
+
+#include <QVector>
+
+#include "GitHelpers.h"
+
+struct git_revwalk;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Topological + time ordered walk over branch history, producing commit ids in batches
+	 *
+	 * The walker only yields object ids: decoding of commit objects is left to the caller,
+	 * so it can be done lazily or on worker threads.
+	 */
+	class CCommitWalker
+	{
+		/// Repository to walk (not owned)
+		git_repository* m_repo;
+
+		/// libgit2 revision walking object
+		git_revwalk* m_walk;
+
+		QString m_last_error;
+
+		/// Whether the walk was stopped by an error rather than by the end of history
+		bool m_failed;
+
+		void setLastError (int _code, const QString& _action);
+
+	public:
+		CCommitWalker (git_repository* _repo);
+		~CCommitWalker ();
+
+		/// Start walking from the HEAD commit of specified local branch (can be called for several branches)
+		bool pushBranch (const QString& _branch_name, CGitOid* _tip = NULL);
+
+		/**
+		 * @brief Append at most _max_count next commit ids to _batch
+		 * @return count of appended ids: less than _max_count at the end of history or on error (see hasFailed ())
+		 */
+		int next (QVector<CGitOid>& _batch, int _max_count);
+
+		/// Whether the walk was stopped by an error (an unreadable object, for example); see lastError ()
+		bool hasFailed () const;
+
+		QString lastError () const;
+
+	private:
+		Q_DISABLE_COPY (CCommitWalker)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMMITWALKER_H
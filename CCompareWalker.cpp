@@ -0,0 +1,255 @@
+/**
+ * @file
+ * @brief Two-sided walk over commits unique to either of two branches implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CCompareWalker.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+
+#include <algorithm>
+
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+CMergeBaseCache::CMergeBaseCache ():
+	m_bases (MAX_PAIRS)
+{}
+
+CMergeBaseCache*
+CMergeBaseCache::instance ()
+{
+	static CMergeBaseCache cache;
+	return &cache;
+}
+
+bool
+CMergeBaseCache::find (const CGitOid& _left, const CGitOid& _right, CMergeBase& _result) const
+{
+	QMutexLocker locker (& m_mutex);
+
+	const bool swapped = _right < _left;
+	const CMergeBase* found = m_bases.object (swapped ? qMakePair (_right, _left) : qMakePair (_left, _right));
+	if (! found)
+		return false;
+
+	_result = *found;
+	if (swapped)
+		qSwap (_result.m_left_only, _result.m_right_only);
+
+	return true;
+}
+
+void
+CMergeBaseCache::insert (const CGitOid& _left, const CGitOid& _right, const CMergeBase& _result)
+{
+	QMutexLocker locker (& m_mutex);
+
+	CMergeBase* stored = new CMergeBase (_result);
+	if (_right < _left)
+	{
+		qSwap (stored->m_left_only, stored->m_right_only);
+		m_bases.insert (qMakePair (_right, _left), stored);
+	}
+	else
+		m_bases.insert (qMakePair (_left, _right), stored);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CCompareWalker::CCompareWalker (git_repository* _repo, CPackCommitReader* _reader):
+	m_repo (_repo),
+	m_reader (_reader),
+	m_active (0)
+{}
+
+void
+CCompareWalker::setLastError (int _code, const QString& _action)
+{
+	m_last_error = gitErrorString (_code, _action);
+}
+
+QString
+CCompareWalker::lastError () const
+{
+	return m_last_error;
+}
+
+bool
+CCompareWalker::lookupTip (const QString& _branch_name, CGitOid& _tip)
+{
+	git_reference* branch = NULL;
+	int error_code = git_branch_lookup (& branch, m_repo, QFile::encodeName (_branch_name), GIT_BRANCH_LOCAL);
+	if (error_code != GIT_OK)
+	{
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "looking up local branch"));
+		return false;
+	}
+
+	git_object* head = NULL;
+	error_code = git_reference_peel (& head, branch, GIT_OBJ_COMMIT);
+	if (error_code == GIT_OK)
+		_tip = CGitOid (git_object_id (head));
+	else
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "obtaining HEAD commit of branch"));
+
+	git_object_free (head);
+	git_reference_free (branch);
+	return (error_code == GIT_OK);
+}
+
+bool
+CCompareWalker::readCommit (const CGitOid& _id, uint& _time, CGitOidVector& _parents)
+{
+	CCommitHeader header;
+	if (m_reader && m_reader->readHeader (_id, header))
+	{
+		_time = header.m_time;
+		_parents = header.m_parents;
+		return true;
+	}
+
+	git_commit* commit = NULL;
+	if (git_commit_lookup (& commit, m_repo, _id.raw ()) != GIT_OK)
+		return false;
+
+	_time = uint (git_commit_time (commit));
+	_parents.clear ();
+	const unsigned int parent_count = git_commit_parentcount (commit);
+	for (unsigned int i = 0; i < parent_count; ++i)
+		_parents.append (CGitOid (git_commit_parent_id (commit, i)));
+
+	git_commit_free (commit);
+	return true;
+}
+
+void
+CCompareWalker::paint (const CGitOid& _commit, int _flags)
+{
+	QHash<CGitOid, CPainted>::iterator iPainted = m_painted.find (_commit);
+	if (iPainted != m_painted.end ())
+	{
+		const int flags = iPainted.value ().m_flags | _flags;
+		if (flags == iPainted.value ().m_flags)
+			return;
+
+		//
+		// Queued commit takes new sides with it; already walked one is walked again to pass them
+		// to parents (only when commit dates are skewed)
+		//
+		if (iPainted.value ().m_flags & FLAG_QUEUED)
+		{
+			if (!(iPainted.value ().m_flags & FLAG_STALE) && (flags & FLAG_STALE))
+				--m_active;
+			iPainted.value ().m_flags = flags;
+			return;
+		}
+
+		iPainted.value ().m_flags = flags | FLAG_QUEUED;
+		if (! readCommit (_commit, iPainted.value ().m_time, iPainted.value ().m_parents))
+			iPainted.value ().m_parents.clear ();
+	}
+	else
+	{
+		// Commits missing in shallow clones end the walk of their side
+		CPainted painted;
+		if (! readCommit (_commit, painted.m_time, painted.m_parents))
+			return;
+
+		painted.m_flags = _flags | FLAG_QUEUED;
+		if (m_known_bases.contains (_commit))
+			painted.m_flags |= FLAG_BASE;
+		iPainted = m_painted.insert (_commit, painted);
+	}
+
+	if (!(iPainted.value ().m_flags & FLAG_STALE))
+		++m_active;
+
+	CQueued queued;
+	queued.m_time = iPainted.value ().m_time;
+	queued.m_id = _commit;
+	m_queue.append (queued);
+	std::push_heap (m_queue.begin (), m_queue.end ());
+}
+
+void
+CCompareWalker::start (const CGitOid& _left_tip, const CGitOid& _right_tip, const CGitOidVector& _known_bases)
+{
+	foreach (const CGitOid& base, _known_bases)
+		m_known_bases.insert (base);
+
+	paint (_left_tip, SIDE_LEFT);
+	paint (_right_tip, SIDE_RIGHT);
+}
+
+int
+CCompareWalker::next (CGitOidVector& _batch, QVector<int>& _sides, int _max_count)
+{
+	//
+	// Stale commits are walked only to make queued ones stale: their count per call is limited too,
+	// so a caller may check for cancellation
+	//
+	int count = 0;
+	for (int walked = 0; (count < _max_count) && (walked < 4 * _max_count) && (m_active > 0); ++walked)
+	{
+		std::pop_heap (m_queue.begin (), m_queue.end ());
+		const CGitOid id = m_queue.last ().m_id;
+		m_queue.pop_back ();
+
+		CPainted& painted = m_painted [id];
+		int flags = painted.m_flags & ~FLAG_QUEUED;
+		const CGitOidVector parents = painted.m_parents;
+		painted.m_parents.clear ();
+
+		if (!(flags & FLAG_STALE))
+			--m_active;
+
+		const int side = flags & SIDE_BOTH;
+		int passed = flags & (SIDE_BOTH | FLAG_STALE);
+		if (((side == SIDE_BOTH) || (flags & FLAG_BASE)) && !(flags & FLAG_STALE))
+		{
+			// The first commit of shared history; everything below it is shared too
+			if (!(flags & FLAG_SHOWN))
+			{
+				m_result.m_bases.append (id);
+				_batch.append (id);
+				_sides.append (SIDE_BOTH);
+				++count;
+			}
+			flags |= FLAG_SHOWN;
+			passed = SIDE_BOTH | FLAG_STALE;
+		}
+		else if ((side != SIDE_BOTH) && !(flags & FLAG_SHOWN))
+		{
+			_batch.append (id);
+			_sides.append (side);
+			++count;
+			if (side == SIDE_LEFT)
+				++m_result.m_left_only;
+			else
+				++m_result.m_right_only;
+			flags |= FLAG_SHOWN;
+		}
+		painted.m_flags = flags;
+
+		foreach (const CGitOid& parent, parents)
+			paint (parent, passed);
+	}
+
+	return count;
+}
+
+bool
+CCompareWalker::atEnd () const
+{
+	return (m_active == 0);
+}
+
+const CMergeBase&
+CCompareWalker::result () const
+{
+	return m_result;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file
+ * @brief Two-sided walk over commits unique to either of two branches interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCOMPAREWALKER_H
+#define __QGITREPOVIEWER_CCOMPAREWALKER_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CPackCommitReader.h"
+
+struct git_repository;
+
+namespace QGitRepoViewer
+{
+	/// Merge bases of two commits and counts of commits reachable from only one of them
+	struct CMergeBase
+	{
+		CGitOidVector m_bases;
+		int m_left_only;
+		int m_right_only;
+
+		CMergeBase (): m_left_only (0), m_right_only (0)
+		{}
+	};
+
+	/**
+	 * @brief Merge bases memoized by pair of tips, shared by all tabs and worker threads
+	 *
+	 * History of a commit never changes, so an entry stays valid for as long as both tips exist.
+	 */
+	class CMergeBaseCache
+	{
+		mutable QMutex m_mutex;
+		QCache<QPair<CGitOid, CGitOid>, CMergeBase> m_bases;
+
+		CMergeBaseCache ();
+
+	public:
+		/// Count of memoized pairs
+		enum { MAX_PAIRS = 16384 };
+
+		static CMergeBaseCache* instance ();
+
+		/// Merge bases of the tips; counts are swapped when the pair was stored in another order
+		bool find (const CGitOid& _left, const CGitOid& _right, CMergeBase& _result) const;
+		void insert (const CGitOid& _left, const CGitOid& _right, const CMergeBase& _result);
+
+	private:
+		Q_DISABLE_COPY (CMergeBaseCache)
+	};
+
+	/**
+	 * @brief Walks commits of two branches newest first, like git log --left-right A...B
+	 *
+	 * Every commit is painted with the sides it is reachable from. Commits reachable from one side only
+	 * are yielded with their side; the first commits painted by both sides are merge bases, they are yielded
+	 * as both-sided markers and paint their ancestors stale. The walk ends when only stale commits
+	 * are queued, so the shared history below merge bases is not read.
+	 *
+	 * Commits are read from mapped packs when possible.
+	 */
+	class CCompareWalker
+	{
+		/// Commit painted by the walk: sides, walk state, time and parents (until it is taken from the queue)
+		struct CPainted
+		{
+			int m_flags;
+			uint m_time;
+			CGitOidVector m_parents;
+
+			CPainted (): m_flags (0), m_time (0)
+			{}
+		};
+
+		/// Queue entry; the newest commit is taken first
+		struct CQueued
+		{
+			uint m_time;
+			CGitOid m_id;
+
+			bool operator< (const CQueued& _other) const
+			{
+				return m_time < _other.m_time;
+			}
+		};
+
+		enum
+		{
+			FLAG_STALE = 4,		///< reachable from a merge base
+			FLAG_QUEUED = 8,
+			FLAG_SHOWN = 16,
+			FLAG_BASE = 32		///< merge base known beforehand
+		};
+
+		/// Repository to walk (not owned) and reader of packed commits (not owned, may be NULL)
+		git_repository* m_repo;
+		CPackCommitReader* m_reader;
+
+		QHash<CGitOid, CPainted> m_painted;
+		QVector<CQueued> m_queue;
+
+		/// Count of queued commits which are not stale: the walk ends when there are none
+		int m_active;
+
+		QSet<CGitOid> m_known_bases;
+		CMergeBase m_result;
+
+		QString m_last_error;
+
+		void setLastError (int _code, const QString& _action);
+
+		/// Time and parents of the commit
+		bool readCommit (const CGitOid& _id, uint& _time, CGitOidVector& _parents);
+
+		/// Add sides to the commit, queueing it again if they change
+		void paint (const CGitOid& _commit, int _flags);
+
+	public:
+		enum Side { SIDE_LEFT = 1, SIDE_RIGHT = 2, SIDE_BOTH = SIDE_LEFT | SIDE_RIGHT };
+
+		CCompareWalker (git_repository* _repo, CPackCommitReader* _reader);
+
+		/// Tip commit of local branch
+		bool lookupTip (const QString& _branch_name, CGitOid& _tip);
+
+		/**
+		 * @brief Start from two tips
+		 * @param _known_bases merge bases found before (may be empty): they are marked even if clocks are skewed
+		 */
+		void start (const CGitOid& _left_tip, const CGitOid& _right_tip, const CGitOidVector& _known_bases = CGitOidVector ());
+
+		/**
+		 * @brief Append at most _max_count next commits and their sides
+		 * @return count of appended commits; it may be 0 before the end while stale commits are walked
+		 */
+		int next (CGitOidVector& _batch, QVector<int>& _sides, int _max_count);
+
+		/// Whether all commits unique to either side were yielded
+		bool atEnd () const;
+
+		/// Merge bases and counts of commits yielded so far
+		const CMergeBase& result () const;
+
+		QString lastError () const;
+
+	private:
+		Q_DISABLE_COPY (CCompareWalker)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCOMPAREWALKER_H
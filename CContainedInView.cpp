@@ -0,0 +1,174 @@
+/**
+ * @file
+ * @brief Branches and tags containing the selected commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CContainedInView.h"
+
+#include <QFile>
+
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
+CContainedInView::CContainedInView (QWidget* _parent):
+	QTreeWidget (_parent),
+	m_index_current (false),
+	m_generation (0)
+{
+	setColumnCount (1);
+	setUniformRowHeights (true);
+	setHeaderLabels (QStringList () << tr ("Contained in"));
+}
+
+CContainedInView::~CContainedInView ()
+{
+	cancelJob ();
+}
+
+void
+CContainedInView::cancelJob ()
+{
+	if (m_job)
+	{
+		m_job->cancel ();
+		m_job.clear ();
+	}
+	++m_generation;
+}
+
+void
+CContainedInView::setGitRepo (const QString& _repo_path)
+{
+	cancelJob ();
+	m_index.close ();
+	m_index_current = false;
+	m_repo_path = _repo_path;
+	m_git_dir.clear ();
+
+	CGitRepository* repo = CGitRepository::threadRepository (_repo_path);
+	if (repo->isOpened ())
+	{
+		m_git_dir = repo->path ();
+		m_index.open (m_git_dir);
+	}
+
+	clearCommit ();
+}
+
+void
+CContainedInView::updateIndex ()
+{
+	if (m_git_dir.isEmpty ())
+		return;
+
+	//
+	// Job compares refs with those of the existing index and builds nothing if they are the same
+	//
+	cancelJob ();
+	m_index_current = false;
+	m_job = CBackgroundJobPtr (new CReachabilityJob (m_repo_path, this, m_generation));
+	m_job->setPriority (CWorkerPool::PRIORITY_BACKGROUND);
+	CWorkerPool::instance ()->start (m_job);
+}
+
+void
+CContainedInView::updateReachabilityIndex (int _generation, const QString& _path, const QString& _error)
+{
+	if (_generation != m_generation)
+	{
+		if (! _path.isEmpty ())
+			QFile::remove (_path);
+		return;
+	}
+
+	m_job.clear ();
+	bool current = _error.isEmpty ();
+	if (! _error.isEmpty ())
+		CDiagnostics::instance ()->post (tr ("Contained in"), _error);
+	else if (! _path.isEmpty ())
+	{
+		// The file can't be replaced while it is mapped; on failure the old one is mapped again
+		QString error;
+		m_index.close ();
+		if (! replaceFile (_path, CReachabilityIndex::filePath (m_git_dir), error))
+		{
+			CDiagnostics::instance ()->post (tr ("Contained in"), error);
+			current = false;
+		}
+		m_index.open (m_git_dir);
+	}
+	else if (! m_index.isOpen ())
+		m_index.open (m_git_dir);
+
+	m_index_current = current && m_index.isOpen ();
+	showRefs ();
+}
+
+void
+CContainedInView::clearCommit ()
+{
+	m_current = CGitOid ();
+	clear ();
+	headerItem ()->setText (0, tr ("Contained in"));
+}
+
+void
+CContainedInView::showCommit (const CGitOid& _commit)
+{
+	if (_commit == m_current)
+		return;
+
+	m_current = _commit;
+	showRefs ();
+}
+
+void
+CContainedInView::showRefs ()
+{
+	clear ();
+	if (m_current.isNull ())
+		return;
+
+	QVector<int> found;
+	if (! m_index.isOpen () || !m_index.containingRefs (m_current, found))
+	{
+		headerItem ()->setText (0, m_job ? tr ("Indexing branches and tags...") : tr ("Commit is not reachable from branches and tags"));
+		return;
+	}
+
+	//
+	// Refs are sorted by kind, so each group is a contiguous run of indices
+	//
+	static const char* const GROUP_TITLES [] =
+	{
+		QT_TR_NOOP ("Branches (%1)"),
+		QT_TR_NOOP ("Remote branches (%1)"),
+		QT_TR_NOOP ("Tags (%1)")
+	};
+
+	const CReachabilityRefList& refs = m_index.refs ();
+	for (int first = 0; first < found.size (); )
+	{
+		const int kind = refs.at (found.at (first)).m_kind;
+		QList<QTreeWidgetItem*> children;
+		int last = first;
+		for (; (last < found.size ()) && (refs.at (found.at (last)).m_kind == kind); ++last)
+			children.append (new QTreeWidgetItem (QStringList () << refs.at (found.at (last)).m_name));
+
+		QTreeWidgetItem* group = new QTreeWidgetItem (QStringList () << tr (GROUP_TITLES [kind]).arg (last - first));
+		group->addChildren (children);
+		addTopLevelItem (group);
+
+		// Thousands of tags are collapsed not to hide branches
+		group->setExpanded (kind != CReachabilityRef::Tag);
+		first = last;
+	}
+
+	if (found.isEmpty ())
+		headerItem ()->setText (0, tr ("Commit is not reachable from branches and tags"));
+	else if (! m_index_current)
+		headerItem ()->setText (0, tr ("Contained in (%n ref(s), updating...)", "", found.size ()));
+	else
+		headerItem ()->setText (0, tr ("Contained in (%n ref(s))", "", found.size ()));
+}
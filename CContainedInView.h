@@ -0,0 +1,69 @@
+/**
+ * @file
+ * @brief Branches and tags containing the selected commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CCONTAINEDINVIEW_H
+#define __QGITREPOVIEWER_CCONTAINEDINVIEW_H
+
+#include <QTreeWidget>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+#include "CReachabilityIndex.h"
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Branches, remote branches and tags containing the selected commit
+	 *
+	 * Answers come from the reachability index kept in the git directory, so they don't depend on
+	 * the count of refs or the length of history. The index is rebuilt in background when refs change;
+	 * until then the previous one is used and the answer is marked as possibly outdated.
+	 */
+	class CContainedInView : public QTreeWidget
+	{
+		Q_OBJECT
+
+		QString m_repo_path;
+		QString m_git_dir;
+
+		CReachabilityIndex m_index;
+
+		/// Whether the index is built for the current refs
+		bool m_index_current;
+
+		/// Commit which refs are shown
+		CGitOid m_current;
+
+		CBackgroundJobPtr m_job;
+		int m_generation;
+
+		/// Fill the list from the index
+		void showRefs ();
+
+		void cancelJob ();
+
+	private slots:
+		/// Receive the rebuilt index (or nothing if it is up to date) from job
+		void updateReachabilityIndex (int _generation, const QString& _path, const QString& _error);
+
+	public:
+		explicit CContainedInView (QWidget* _parent = NULL);
+		~CContainedInView ();
+
+		/// Use another repository, mapping its existing index
+		void setGitRepo (const QString& _repo_path);
+
+		/// Rebuild the index in background if refs have changed since it was built
+		void updateIndex ();
+
+		/// Show refs containing the commit
+		void showCommit (const CGitOid& _commit);
+
+		/// Clear the list
+		void clearCommit ();
+	};
+}
+
+#endif // __QGITREPOVIEWER_CCONTAINEDINVIEW_H
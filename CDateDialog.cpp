@@ -0,0 +1,66 @@
+/**
+ * @file
+ * @brief Dialog asking for a date or a range of dates implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CDateDialog.h"
+
+#include "ui_CDateDialog.h"
+
+#include <QDateTime>
+
+using namespace QGitRepoViewer;
+
+CDateDialog::CDateDialog (bool _range, QWidget* _parent):
+	QDialog (_parent),
+	m_ui (new Ui::CDateDialog),
+	m_range (_range)
+{
+	m_ui->setupUi (this);
+
+	if (m_range)
+		setWindowTitle (tr ("Show commits in date range"));
+	else
+	{
+		setWindowTitle (tr ("Go to date"));
+		m_ui->from_label->setText (tr ("Date: "));
+		m_ui->to_label->hide ();
+		m_ui->to_edit->hide ();
+	}
+
+	setDates (QDate::currentDate (), QDate::currentDate ());
+}
+
+CDateDialog::~CDateDialog ()
+{}
+
+void
+CDateDialog::setDates (const QDate& _from, const QDate& _to)
+{
+	m_ui->from_edit->setDate (_from);
+	m_ui->to_edit->setDate (_to.isValid () ? _to : _from);
+}
+
+QDate
+CDateDialog::fromDate () const
+{
+	return m_ui->from_edit->date ();
+}
+
+QDate
+CDateDialog::toDate () const
+{
+	return m_range ? m_ui->to_edit->date () : fromDate ();
+}
+
+uint
+CDateDialog::fromTime () const
+{
+	return QDateTime (fromDate (), QTime (0, 0, 0)).toTime_t ();
+}
+
+uint
+CDateDialog::toTime () const
+{
+	return QDateTime (toDate (), QTime (23, 59, 59)).toTime_t ();
+}
@@ -0,0 +1,46 @@
+/**
+ * @file
+ * @brief Dialog asking for a date or a range of dates interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CDATEDIALOG_H
+#define __QGITREPOVIEWER_CDATEDIALOG_H
+
+#include <QDialog>
+#include <QDate>
+
+namespace Ui
+{
+	class CDateDialog;
+}
+
+namespace QGitRepoViewer
+{
+	/// Asks for one date ("go to date") or for inclusive range of dates (date filter)
+	class CDateDialog : public QDialog
+	{
+		Q_OBJECT
+
+		/// Qt GUI object
+		QScopedPointer<Ui::CDateDialog> m_ui;
+
+		bool m_range;
+
+	public:
+		CDateDialog (bool _range, QWidget* _parent = NULL);
+		~CDateDialog ();
+
+		void setDates (const QDate& _from, const QDate& _to = QDate ());
+
+		QDate fromDate () const;
+		QDate toDate () const;
+
+		/// Beginning of the first day, seconds since epoch
+		uint fromTime () const;
+
+		/// End of the last day (of the only day if range is not asked), seconds since epoch
+		uint toTime () const;
+	};
+}
+
+#endif // __QGITREPOVIEWER_CDATEDIALOG_H
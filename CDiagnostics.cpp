@@ -0,0 +1,93 @@
+/**
+ * @file
+ * @brief Non-blocking collector of errors from worker threads and painting code implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CDiagnostics.h"
+
+#include <time.h>
+
+using namespace QGitRepoViewer;
+
+CDiagnostics::CDiagnostics ():
+	m_head (NULL),
+	m_window (0),
+	m_window_count (0),
+	m_pending (0),
+	m_dropped (0)
+{}
+
+CDiagnostics*
+CDiagnostics::instance ()
+{
+	static CDiagnostics diagnostics;
+	return &diagnostics;
+}
+
+void
+CDiagnostics::post (const QString& _source, const QString& _message)
+{
+	//
+	// Start new rate limiting window each second
+	//
+	const int now = int (::time (NULL));
+	const int window = m_window.fetchAndAddOrdered (0);
+	if ((window != now) && m_window.testAndSetOrdered (window, now))
+		m_window_count.fetchAndStoreOrdered (0);
+
+	if (m_window_count.fetchAndAddOrdered (1) >= MAX_PER_SECOND)
+	{
+		m_dropped.ref ();
+		return;
+	}
+
+	//
+	// Nobody takes the messages (e.g. there is no panel in headless mode): don't grow without bound
+	//
+	if (m_pending.fetchAndAddOrdered (1) >= MAX_PENDING)
+	{
+		m_pending.deref ();
+		m_dropped.ref ();
+		return;
+	}
+
+	CNode* node = new CNode;
+	node->m_diagnostic.m_source = _source;
+	node->m_diagnostic.m_message = _message;
+	node->m_diagnostic.m_time = uint (now);
+
+	//
+	// Push the node to the top of the stack
+	//
+	CNode* head = NULL;
+	do
+	{
+		head = m_head.fetchAndAddOrdered (0);
+		node->m_next = head;
+	}
+	while (! m_head.testAndSetOrdered (head, node));
+}
+
+QList<CDiagnostic>
+CDiagnostics::takeAll (int& _dropped)
+{
+	QList<CDiagnostic> diagnostics;
+
+	//
+	// Detach the whole stack at once and restore posting order
+	//
+	CNode* node = m_head.fetchAndStoreOrdered (NULL);
+	while (node)
+	{
+		diagnostics.prepend (node->m_diagnostic);
+
+		CNode* next = node->m_next;
+		delete node;
+		node = next;
+	}
+
+	m_pending.fetchAndAddOrdered (-diagnostics.size ());
+	_dropped = m_dropped.fetchAndStoreOrdered (0);
+
+	return diagnostics;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file
+ * @brief Non-blocking collector of errors from worker threads and painting code interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CDIAGNOSTICS_H
+#define __QGITREPOVIEWER_CDIAGNOSTICS_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QList>
+#include <QString>
+
+namespace QGitRepoViewer
+{
+	/// One reported problem
+	struct CDiagnostic
+	{
+		/// Subsystem which reported the problem (e.g. "Commits")
+		QString m_source;
+		QString m_message;
+		uint m_time;
+
+		CDiagnostic (): m_time (0)
+		{}
+	};
+
+	/**
+	 * @brief Lock-free, rate-limited queue of diagnostics
+	 *
+	 * post() never blocks and never shows any GUI, so it is safe to call from worker threads and
+	 * from model data() called during painting. Messages exceeding MAX_PER_SECOND or MAX_PENDING are
+	 * only counted as dropped. GUI thread periodically takes all queued messages with takeAll().
+	 */
+	class CDiagnostics
+	{
+		struct CNode
+		{
+			CDiagnostic m_diagnostic;
+			CNode* m_next;
+		};
+
+		/// Top of lock-free stack of posted messages (newest first)
+		QAtomicPointer<CNode> m_head;
+
+		/// Rate limiting window (seconds since epoch) and count of messages posted in it
+		QAtomicInt m_window;
+		QAtomicInt m_window_count;
+
+		QAtomicInt m_pending;
+		QAtomicInt m_dropped;
+
+		CDiagnostics ();
+
+	public:
+		enum { MAX_PER_SECOND = 20, MAX_PENDING = 1000 };
+
+		static CDiagnostics* instance ();
+
+		/// Queue the message (thread-safe, wait-free for the caller except of allocation)
+		void post (const QString& _source, const QString& _message);
+
+		/// Take all queued messages in posting order; _dropped receives count of rejected ones since last call
+		QList<CDiagnostic> takeAll (int& _dropped);
+
+	private:
+		Q_DISABLE_COPY (CDiagnostics)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CDIAGNOSTICS_H
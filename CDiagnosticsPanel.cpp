@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @brief Non-modal panel aggregating reported problems implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CDiagnosticsPanel.h"
+
+#include "ui_CDiagnosticsPanel.h"
+
+#include <QDateTime>
+
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
+CDiagnosticsPanel::CDiagnosticsPanel (QWidget* _parent):
+	QWidget (_parent),
+	m_ui (new Ui::CDiagnosticsPanel),
+	m_total (0),
+	m_dropped (0)
+{
+	m_ui->setupUi (this);
+
+	connect (m_ui->pb_clear, SIGNAL (clicked ()), this, SLOT (clear ()));
+	connect (&m_poll_timer, SIGNAL (timeout ()), this, SLOT (poll ()));
+	m_poll_timer.start (POLL_INTERVAL_MS);
+
+	updateSummary ();
+}
+
+CDiagnosticsPanel::~CDiagnosticsPanel ()
+{}
+
+int
+CDiagnosticsPanel::count () const
+{
+	return m_total;
+}
+
+void
+CDiagnosticsPanel::poll ()
+{
+	int dropped = 0;
+	QList<CDiagnostic> diagnostics = CDiagnostics::instance ()->takeAll (dropped);
+	if (diagnostics.isEmpty () && (dropped == 0))
+		return;
+
+	foreach (const CDiagnostic& diagnostic, diagnostics)
+	{
+		const QString text = diagnostic.m_source + ": " + diagnostic.m_message;
+
+		QHash<QString, CEntry>::iterator iEntry = m_entries.find (text);
+		if (iEntry == m_entries.end ())
+		{
+			CEntry entry;
+			entry.m_item = new QListWidgetItem (text, m_ui->messages);
+			entry.m_count = 1;
+			iEntry = m_entries.insert (text, entry);
+		}
+		else
+		{
+			++iEntry->m_count;
+			iEntry->m_item->setText (QString ("(%1) %2").arg (iEntry->m_count).arg (text));
+		}
+
+		QDateTime time;
+		time.setTime_t (diagnostic.m_time);
+		iEntry->m_item->setToolTip (tr ("Last reported at %1").arg (time.toString ()));
+	}
+
+	m_total += diagnostics.size () + dropped;
+	m_dropped += dropped;
+
+	updateSummary ();
+	emit countChanged (m_total);
+}
+
+void
+CDiagnosticsPanel::clear ()
+{
+	m_ui->messages->clear ();
+	m_entries.clear ();
+	m_total = 0;
+	m_dropped = 0;
+
+	updateSummary ();
+	emit countChanged (m_total);
+}
+
+void
+CDiagnosticsPanel::updateSummary ()
+{
+	if (m_dropped > 0)
+		m_ui->summary->setText (tr ("%1 problem(s), %2 more were dropped (too many at once)").arg (m_total).arg (m_dropped));
+	else
+		m_ui->summary->setText (tr ("%1 problem(s)").arg (m_total));
+}
@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @brief Non-modal panel aggregating reported problems interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CDIAGNOSTICSPANEL_H
+#define __QGITREPOVIEWER_CDIAGNOSTICSPANEL_H
+
+#include <QWidget>
+#include <QHash>
+#include <QTimer>
+
+namespace Ui
+{
+	class CDiagnosticsPanel;
+}
+
+class QListWidgetItem;
+
+namespace QGitRepoViewer
+{
+	/// Shows messages of CDiagnostics; identical messages are collapsed into one line with counter
+	class CDiagnosticsPanel : public QWidget
+	{
+		Q_OBJECT
+
+		/// Qt GUI object
+		QScopedPointer<Ui::CDiagnosticsPanel> m_ui;
+
+		/// Polls diagnostics queue from GUI thread event loop
+		QTimer m_poll_timer;
+
+		/// Shown item and repeat count of each distinct message
+		struct CEntry
+		{
+			QListWidgetItem* m_item;
+			int m_count;
+		};
+		QHash<QString, CEntry> m_entries;
+
+		/// Total count of reported (including dropped) problems
+		int m_total;
+		int m_dropped;
+
+		void updateSummary ();
+
+	private slots:
+		/// Take new messages from diagnostics queue
+		void poll ();
+
+		/// Forget all shown messages
+		void clear ();
+
+	signals:
+		/// Count of reported problems was changed
+		void countChanged (int _count);
+
+	public:
+		enum { POLL_INTERVAL_MS = 500 };
+
+		explicit CDiagnosticsPanel (QWidget* _parent = NULL);
+		~CDiagnosticsPanel ();
+
+		int count () const;
+	};
+}
+
+#endif // __QGITREPOVIEWER_CDIAGNOSTICSPANEL_H
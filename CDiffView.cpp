@@ -0,0 +1,562 @@
+/**
+ * @file
+ * @brief Virtualized view of commit patches of any size implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CDiffView.h"
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QScrollBar>
+#include <QPainter>
+#include <QPaintEvent>
+
+#include <algorithm>
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+/// Lines of the hunks and the headers: tag byte starting each stored line
+#define TAG_FILE 'F'
+#define TAG_HUNK 'H'
+#define TAG_NOTE 'M'
+
+namespace
+{
+	/**
+	 * @brief Streams the patch of a commit against its first parent into a file on worker pool
+	 *
+	 * Every line of the patch is stored with a tag byte: '+', '-' or ' ' for lines of hunks (the tag is
+	 * a part of the shown text), 'F' for file headers, 'H' for hunk headers and 'M' for other notes.
+	 * Lines are written in chunks of about CHUNK_SIZE bytes and each written chunk is announced to the view.
+	 */
+	class CDiffJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		CGitOid m_commit;
+		QString m_file_path;
+		QObject* m_receiver;
+		int m_generation;
+
+		/// Lines of the current chunk, their count and the longest one
+		QByteArray m_buffer;
+		int m_buffer_lines;
+		int m_buffer_width;
+
+		/// Size and count of lines of announced chunks
+		qint64 m_written;
+		int m_lines;
+
+		QFile* m_file;
+
+		/// Append one tagged line
+		void appendLine (char _tag, const char* _text, int _length);
+
+		/// Write the current chunk and announce it
+		bool flushChunk ();
+
+		/// Callback for git_diff_print_patch: store lines of the patch
+		static int diffLineCb (const git_diff_delta* _delta, const git_diff_range* _range, char _origin,
+							   const char* _content, size_t _length, void* _payload);
+
+	protected:
+		bool step ();
+
+	public:
+		/// Approximate size of one chunk of the patch
+		enum { CHUNK_SIZE = 64 * 1024 };
+
+		CDiffJob (const QString& _repo_path, const CGitOid& _commit, const QString& _file_path,
+				  QObject* _receiver, int _generation);
+		~CDiffJob ();
+	};
+}
+
+CDiffJob::CDiffJob (const QString& _repo_path, const CGitOid& _commit, const QString& _file_path,
+					QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_commit (_commit),
+	m_file_path (_file_path),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_buffer_lines (0),
+	m_buffer_width (0),
+	m_written (0),
+	m_lines (0),
+	m_file (NULL)
+{
+	m_buffer.reserve (CHUNK_SIZE + 1024);
+}
+
+CDiffJob::~CDiffJob ()
+{
+	delete m_file;
+}
+
+bool
+CDiffJob::flushChunk ()
+{
+	if (m_buffer.isEmpty ())
+		return true;
+
+	// The view reads the chunk by its own handle as soon as it is announced
+	if ((m_file->write (m_buffer) != m_buffer.size ()) || !m_file->flush ())
+		return false;
+
+	post (m_receiver, "addDiffChunk", Q_ARG (int, m_generation), Q_ARG (qint64, m_written),
+		  Q_ARG (int, m_buffer.size ()), Q_ARG (int, m_buffer_lines), Q_ARG (int, m_buffer_width));
+
+	m_written += m_buffer.size ();
+	m_lines += m_buffer_lines;
+	m_buffer.clear ();
+	m_buffer_lines = 0;
+	m_buffer_width = 0;
+	return true;
+}
+
+void
+CDiffJob::appendLine (char _tag, const char* _text, int _length)
+{
+	m_buffer.append (_tag);
+	m_buffer.append (_text, _length);
+	m_buffer.append ('\n');
+	++m_buffer_lines;
+	m_buffer_width = qMax (m_buffer_width, _length + 1);
+}
+
+int
+CDiffJob::diffLineCb (const git_diff_delta* _delta, const git_diff_range* _range, char _origin,
+					  const char* _content, size_t _length, void* _payload)
+{
+	Q_UNUSED (_range);
+
+	CDiffJob* job = static_cast<CDiffJob*> (_payload);
+	if (job->isCancelled ())
+		return GIT_EUSER;
+
+	char tag = TAG_NOTE;
+	switch (_origin)
+	{
+		case GIT_DIFF_LINE_CONTEXT:
+		case GIT_DIFF_LINE_ADDITION:
+		case GIT_DIFF_LINE_DELETION:
+			tag = _origin;
+			break;
+
+		case GIT_DIFF_LINE_FILE_HDR:
+			job->post (job->m_receiver, "addDiffFile", Q_ARG (int, job->m_generation),
+					   Q_ARG (QString, QString::fromUtf8 (_delta->new_file.path)),
+					   Q_ARG (int, job->m_lines + job->m_buffer_lines));
+			tag = TAG_FILE;
+			break;
+
+		case GIT_DIFF_LINE_BINARY:
+			tag = TAG_FILE;
+			break;
+
+		case GIT_DIFF_LINE_HUNK_HDR:
+			tag = TAG_HUNK;
+			break;
+	}
+
+	//
+	// Headers span several lines; lines of hunks come one by one
+	//
+	const char* line = _content;
+	const char* end = _content + _length;
+	while (line < end)
+	{
+		const char* line_end = static_cast<const char*> (memchr (line, '\n', size_t (end - line)));
+		if (! line_end)
+			line_end = end;
+
+		if ((line_end > line) || (tag != TAG_NOTE))
+			job->appendLine (tag, line, int (line_end - line));
+
+		line = line_end + 1;
+	}
+
+	if ((job->m_buffer.size () >= CHUNK_SIZE) && !job->flushChunk ())
+		return GIT_EUSER;
+
+	return GIT_OK;
+}
+
+bool
+CDiffJob::step ()
+{
+	// View removes the file of cancelled job: don't create it again
+	if (isCancelled ())
+		return false;
+
+	QString error;
+
+	m_file = new QFile (m_file_path);
+	if (! m_file->open (QIODevice::WriteOnly | QIODevice::Append))
+		error = m_file->errorString ();
+
+	CGitRepository* repo = CGitRepository::threadRepository (m_repo_path);
+	if (error.isEmpty () && !repo->isOpened ())
+		error = repo->lastError ();
+
+	//
+	// The whole patch is produced in one step: lines are streamed by the callback, which stops on cancel
+	//
+	git_commit* commit = NULL;
+	git_commit* parent = NULL;
+	git_tree* tree = NULL;
+	git_tree* parent_tree = NULL;
+	git_diff_list* diff = NULL;
+	int error_code = GIT_OK;
+	if (error.isEmpty ())
+	{
+		error_code = git_commit_lookup (& commit, repo->handle (), m_commit.raw ());
+		if ((error_code == GIT_OK) && (git_commit_parentcount (commit) > 0))
+		{
+			error_code = git_commit_parent (& parent, commit, 0);
+			if (error_code == GIT_OK)
+				error_code = git_commit_tree (& parent_tree, parent);
+		}
+		if (error_code == GIT_OK)
+			error_code = git_commit_tree (& tree, commit);
+		if (error_code == GIT_OK)
+			error_code = git_diff_tree_to_tree (& diff, repo->handle (), parent_tree, tree, NULL);
+		if (error_code == GIT_OK)
+			error_code = git_diff_print_patch (diff, & diffLineCb, this);
+
+		if ((error_code != GIT_OK) && !isCancelled ())
+			error = gitErrorString (error_code, QObject::tr ("producing patch of commit %1").arg (m_commit.toString ()));
+	}
+
+	git_diff_list_free (diff);
+	git_tree_free (parent_tree);
+	git_tree_free (tree);
+	git_commit_free (parent);
+	git_commit_free (commit);
+
+	if (error.isEmpty () && !flushChunk ())
+		error = m_file->errorString ();
+
+	if (isCancelled ())
+		m_file->remove ();
+
+	post (m_receiver, "finishDiff", Q_ARG (int, m_generation), Q_ARG (QString, error));
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CDiffView::CDiffView (QWidget* _parent):
+	QAbstractScrollArea (_parent),
+	m_file (NULL),
+	m_chunk_cache (CACHED_CHUNKS),
+	m_line_count (0),
+	m_max_width (0),
+	m_generation (0),
+	m_loading (false)
+{
+	qRegisterMetaType<qint64> ("qint64");
+
+	QFont font ("Monospace");
+	font.setStyleHint (QFont::TypeWriter);
+	setFont (font);
+
+	verticalScrollBar ()->setSingleStep (1);
+	updateScrollBars ();
+}
+
+CDiffView::~CDiffView ()
+{
+	cancelJob ();
+	delete m_file;
+}
+
+void
+CDiffView::cancelJob ()
+{
+	if (m_job)
+	{
+		m_job->cancel ();
+		m_job.clear ();
+	}
+	++m_generation;
+	m_loading = false;
+}
+
+void
+CDiffView::setGitRepo (const QString& _repo_path)
+{
+	m_repo_path = _repo_path;
+	clearCommit ();
+}
+
+void
+CDiffView::clearCommit ()
+{
+	cancelJob ();
+
+	// Running job writes by its own handle; the temporary file is removed with the last handle on POSIX
+	delete m_file;
+	m_file = NULL;
+
+	m_commit = CGitOid ();
+	m_chunks.clear ();
+	m_chunk_cache.clear ();
+	m_file_lines.clear ();
+	m_line_count = 0;
+	m_max_width = 0;
+
+	verticalScrollBar ()->setValue (0);
+	horizontalScrollBar ()->setValue (0);
+	updateScrollBars ();
+	viewport ()->update ();
+}
+
+void
+CDiffView::showCommit (const CGitOid& _commit)
+{
+	if ((_commit == m_commit) && (m_loading || !m_chunks.isEmpty ()))
+		return;
+
+	clearCommit ();
+	if (m_repo_path.isEmpty () || _commit.isNull ())
+		return;
+
+	m_file = new QTemporaryFile (this);
+	if (! m_file->open ())
+	{
+		delete m_file;
+		m_file = NULL;
+		return;
+	}
+
+	m_commit = _commit;
+	m_loading = true;
+	m_job = CBackgroundJobPtr (new CDiffJob (m_repo_path, _commit, m_file->fileName (), this, m_generation));
+	m_job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+	CWorkerPool::instance ()->start (m_job);
+}
+
+bool
+CDiffView::scrollToFile (const QString& _path)
+{
+	QHash<QString, int>::const_iterator iFile = m_file_lines.constFind (_path);
+	if (iFile == m_file_lines.constEnd ())
+		return false;
+
+	verticalScrollBar ()->setValue (iFile.value ());
+	return true;
+}
+
+void
+CDiffView::addDiffChunk (int _generation, qint64 _offset, int _size, int _line_count, int _max_width)
+{
+	if (_generation != m_generation)
+		return;
+
+	CChunkInfo chunk;
+	chunk.m_offset = _offset;
+	chunk.m_size = _size;
+	chunk.m_first_line = m_line_count;
+	chunk.m_line_count = _line_count;
+	m_chunks.append (chunk);
+
+	m_line_count += _line_count;
+	m_max_width = qMax (m_max_width, qMin (_max_width, int (MAX_PAINTED_LINE)));
+	updateScrollBars ();
+
+	// Only repaint if the new lines are visible
+	if (chunk.m_first_line <= verticalScrollBar ()->value () + viewport ()->height () / lineHeight ())
+		viewport ()->update ();
+}
+
+void
+CDiffView::addDiffFile (int _generation, const QString& _path, int _line)
+{
+	if (_generation == m_generation)
+		m_file_lines.insert (_path, _line);
+}
+
+void
+CDiffView::finishDiff (int _generation, const QString& _error)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_job.clear ();
+	m_loading = false;
+	if (! _error.isEmpty ())
+		setToolTip (_error);
+	viewport ()->update ();
+}
+
+int
+CDiffView::lineHeight () const
+{
+	return qMax (1, fontMetrics ().lineSpacing ());
+}
+
+void
+CDiffView::updateScrollBars ()
+{
+	const int page = qMax (1, viewport ()->height () / lineHeight ());
+	verticalScrollBar ()->setPageStep (page);
+	verticalScrollBar ()->setRange (0, qMax (0, m_line_count - page));
+
+	const int width = m_max_width * fontMetrics ().width (QLatin1Char ('m'));
+	horizontalScrollBar ()->setPageStep (viewport ()->width ());
+	horizontalScrollBar ()->setSingleStep (fontMetrics ().width (QLatin1Char ('m')) * 4);
+	horizontalScrollBar ()->setRange (0, qMax (0, width - viewport ()->width ()));
+}
+
+int
+CDiffView::chunkOfLine (int _line) const
+{
+	int low = 0;
+	int high = m_chunks.size ();
+	while (low < high)
+	{
+		const int middle = low + (high - low) / 2;
+		if (m_chunks [middle].m_first_line + m_chunks [middle].m_line_count <= _line)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return (low < m_chunks.size ()) ? low : -1;
+}
+
+const CDiffView::CChunkText*
+CDiffView::chunkText (int _chunk) const
+{
+	CChunkText* text = m_chunk_cache.object (_chunk);
+	if (text)
+		return text;
+
+	const CChunkInfo& chunk = m_chunks [_chunk];
+	if (! m_file || !m_file->seek (chunk.m_offset))
+		return NULL;
+
+	text = new CChunkText;
+	text->m_text = m_file->read (chunk.m_size);
+	if (text->m_text.size () != chunk.m_size)
+	{
+		delete text;
+		return NULL;
+	}
+
+	//
+	// Split the chunk into lines only when it is painted
+	//
+	text->m_line_offsets.reserve (chunk.m_line_count + 1);
+	text->m_line_offsets.append (0);
+	const char* data = text->m_text.constData ();
+	for (int i = 0; i < chunk.m_size; ++i)
+		if (data [i] == '\n')
+			text->m_line_offsets.append (i + 1);
+
+	m_chunk_cache.insert (_chunk, text);
+	return text;
+}
+
+void
+CDiffView::paintEvent (QPaintEvent* _event)
+{
+	QPainter painter (viewport ());
+	const QRect area = _event->rect ();
+	const int height = lineHeight ();
+	const int first = verticalScrollBar ()->value ();
+	const int top = first + qMax (0, area.top ()) / height;
+	const int bottom = qMin (m_line_count - 1, first + area.bottom () / height);
+	const int x = 2 - horizontalScrollBar ()->value ();
+
+	if (m_line_count == 0)
+	{
+		painter.setPen (palette ().color (QPalette::Disabled, QPalette::Text));
+		painter.drawText (viewport ()->rect (), Qt::AlignCenter,
+						  m_loading ? tr ("Loading patch...") : (m_commit.isNull () ? QString () : tr ("No changes")));
+		return;
+	}
+
+	const QColor text_color = palette ().color (QPalette::Text);
+	const QColor note_color = palette ().color (QPalette::Disabled, QPalette::Text);
+	QFont bold_font = font ();
+	bold_font.setBold (true);
+
+	//
+	// Visible lines are taken chunk by chunk and colored by their tags
+	//
+	int chunk_index = chunkOfLine (top);
+	for (int line = top; (line <= bottom) && (chunk_index >= 0) && (chunk_index < m_chunks.size ()); ++chunk_index)
+	{
+		const CChunkInfo& chunk = m_chunks [chunk_index];
+		const CChunkText* text = chunkText (chunk_index);
+		const int chunk_end = qMin (bottom + 1, chunk.m_first_line + chunk.m_line_count);
+		for (; line < chunk_end; ++line)
+		{
+			if (! text)
+				continue;
+
+			const int in_chunk = line - chunk.m_first_line;
+			const int begin = text->m_line_offsets [in_chunk];
+			const int end = text->m_line_offsets [in_chunk + 1] - 1;
+			if (end < begin)
+				continue;
+
+			const char tag = text->m_text [begin];
+			const QRect rect (0, (line - first) * height, viewport ()->width (), height);
+
+			// Tags of header lines are not shown
+			const bool header = (tag == TAG_FILE) || (tag == TAG_HUNK) || (tag == TAG_NOTE);
+			const int text_begin = header ? begin + 1 : begin;
+			const QString line_text = QString::fromUtf8 (text->m_text.constData () + text_begin,
+														 qMin (end - text_begin, int (MAX_PAINTED_LINE)));
+
+			switch (tag)
+			{
+				case '+':
+					painter.fillRect (rect, QColor (0xdd, 0xff, 0xdd));
+					painter.setPen (QColor (0x00, 0x60, 0x00));
+					break;
+
+				case '-':
+					painter.fillRect (rect, QColor (0xff, 0xdd, 0xdd));
+					painter.setPen (QColor (0x80, 0x00, 0x00));
+					break;
+
+				case TAG_HUNK:
+					painter.fillRect (rect, QColor (0xe8, 0xe8, 0xff));
+					painter.setPen (QColor (0x00, 0x00, 0x80));
+					break;
+
+				case TAG_NOTE:
+					painter.setPen (note_color);
+					break;
+
+				default:
+					painter.setPen (text_color);
+					break;
+			}
+
+			painter.setFont ((tag == TAG_FILE) ? bold_font : font ());
+			painter.drawText (rect.adjusted (x, 0, 0, 0), Qt::AlignLeft | Qt::AlignVCenter | Qt::TextExpandTabs, line_text);
+		}
+	}
+}
+
+void
+CDiffView::resizeEvent (QResizeEvent* _event)
+{
+	QAbstractScrollArea::resizeEvent (_event);
+	updateScrollBars ();
+}
+
+void
+CDiffView::scrollContentsBy (int _dx, int _dy)
+{
+	Q_UNUSED (_dx);
+	Q_UNUSED (_dy);
+
+	// Vertical scroll bar counts lines, not pixels
+	viewport ()->update ();
+}
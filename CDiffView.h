@@ -0,0 +1,108 @@
+/**
+ * @file
+ * @brief Virtualized view of commit patches of any size interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CDIFFVIEW_H
+#define __QGITREPOVIEWER_CDIFFVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QHash>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+class QTemporaryFile;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Shows the patch of the selected commit while it is being produced
+	 *
+	 * Only the offsets of patch chunks are kept in memory; chunks intersecting the viewport are read back
+	 * from the patch file, split into lines and colored by the tags of their lines, and a few recently
+	 * painted chunks are cached. So memory and the time to show the first screen don't depend on patch size.
+	 */
+	class CDiffView : public QAbstractScrollArea
+	{
+		Q_OBJECT
+
+		/// Chunk of the patch file
+		struct CChunkInfo
+		{
+			qint64 m_offset;
+			int m_size;
+			int m_first_line;
+			int m_line_count;
+		};
+
+		/// Chunk read back for painting: its text and the offsets of its lines
+		struct CChunkText
+		{
+			QByteArray m_text;
+			QVector<int> m_line_offsets;
+		};
+
+		QString m_repo_path;
+		CGitOid m_commit;
+
+		QTemporaryFile* m_file;
+		QVector<CChunkInfo> m_chunks;
+		mutable QCache<int, CChunkText> m_chunk_cache;
+		int m_line_count;
+		int m_max_width;
+
+		/// First line of each file of the patch
+		QHash<QString, int> m_file_lines;
+
+		CBackgroundJobPtr m_job;
+		int m_generation;
+		bool m_loading;
+
+		int lineHeight () const;
+
+		/// Text of the chunk containing specified line, read from the file if not cached
+		const CChunkText* chunkText (int _chunk) const;
+
+		/// Index of the chunk containing specified line
+		int chunkOfLine (int _line) const;
+
+		void updateScrollBars ();
+		void cancelJob ();
+
+	private slots:
+		void addDiffChunk (int _generation, qint64 _offset, int _size, int _line_count, int _max_width);
+		void addDiffFile (int _generation, const QString& _path, int _line);
+		void finishDiff (int _generation, const QString& _error);
+
+	protected:
+		void paintEvent (QPaintEvent* _event);
+		void resizeEvent (QResizeEvent* _event);
+		void scrollContentsBy (int _dx, int _dy);
+
+	public:
+		/// Count of chunks kept read for painting
+		enum { CACHED_CHUNKS = 16 };
+
+		/// Longer lines are cut when painted
+		enum { MAX_PAINTED_LINE = 4096 };
+
+		explicit CDiffView (QWidget* _parent = NULL);
+		~CDiffView ();
+
+		/// Forget the shown patch and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Start showing the patch of the commit against its first parent
+		void showCommit (const CGitOid& _commit);
+
+		/// Scroll to the header of the file if its part of the patch was already received
+		bool scrollToFile (const QString& _path);
+
+		void clearCommit ();
+	};
+}
+
+#endif // __QGITREPOVIEWER_CDIFFVIEW_H
@@ -0,0 +1,764 @@
+/**
+ * @file
+ * @brief Parallel search of text in files of a commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CGrepModel.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <ctype.h>
+#include <string.h>
+#include <git2.h>
+
+#include "CBlobReader.h"
+
+using namespace QGitRepoViewer;
+
+namespace
+{
+	/// Blob of the tree and all its paths
+	struct CGrepItem
+	{
+		CGitOid m_blob;
+		QStringList m_paths;
+	};
+
+	/// State shared by all jobs of one search
+	struct CGrepSearch
+	{
+		QString m_repo_path;
+		CGitOid m_commit;
+		QRegExp m_pattern;
+
+		/// Literal required by pattern (lowercase if pattern is case insensitive)
+		QByteArray m_literal;
+
+		/// Unique blobs of the tree, listed before search jobs start
+		QVector<CGrepItem> m_items;
+
+		/// Index of the next not taken blob
+		QAtomicInt m_next;
+	};
+
+	typedef QSharedPointer<CGrepSearch> CGrepSearchPtr;
+
+	/**
+	 * @brief Lists the tree of the commit, joining paths with the same blob
+	 *
+	 * Receiver starts search jobs when it gets startGrep(int,int), so the walk doesn't keep them waiting
+	 * on pool threads.
+	 */
+	class CGrepListJob : public CBackgroundJob
+	{
+		CGrepSearchPtr m_search;
+		QObject* m_receiver;
+		int m_generation;
+
+		static int treeWalkCb (const char* _root, const git_tree_entry* _entry, void* _payload);
+
+	protected:
+		bool step ();
+
+	public:
+		CGrepListJob (const CGrepSearchPtr& _search, QObject* _receiver, int _generation);
+	};
+
+	/**
+	 * @brief One of the jobs searching blobs of a commit
+	 *
+	 * Each step takes the next batch of blobs; blobs are read through the per-thread repository handle
+	 * in chunks and only whole lines are searched, so memory doesn't depend on blob size.
+	 */
+	class CGrepJob : public CBackgroundJob
+	{
+		CGrepSearchPtr m_search;
+		QObject* m_receiver;
+		int m_generation;
+
+		/// Reader uses repository handle of the thread which opened it
+		CBlobReader m_reader;
+		CGitRepository* m_reader_repo;
+
+		QRegExp m_pattern;
+		QByteArray m_literal;
+		bool m_lowercase;
+
+		/// Blob data and its lowercase copy for case insensitive prefilter
+		QByteArray m_buffer;
+		QByteArray m_lower;
+
+		CGrepResultList m_results;
+
+		/// Match the line and append results for all paths of the blob
+		void matchLine (const CGrepItem& _item, const char* _line, int _length, int _line_number);
+
+		/// Search lines of the first bytes of buffer; line number is advanced past them
+		void searchLines (const CGrepItem& _item, int _size, int& _line_number);
+
+		/// Search one blob
+		void searchBlob (const CGrepItem& _item);
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of blobs taken at once
+		enum { BATCH_SIZE = 64 };
+
+		/// Size of blob chunk read at once and the limit of line length (longer lines are broken)
+		enum { CHUNK_SIZE = 256 * 1024, MAX_LINE_SIZE = 1024 * 1024 };
+
+		/// Matched line is shown cut to so many characters
+		enum { MAX_SHOWN_LINE = 512 };
+
+		CGrepJob (const CGrepSearchPtr& _search, QObject* _receiver, int _generation);
+	};
+
+	/// Payload of tree walk: blobs by id and their index in the list
+	struct CTreeWalkData
+	{
+		CGrepListJob* m_job;
+		CGrepSearch* m_search;
+		QHash<CGitOid, int> m_indexes;
+	};
+}
+
+CGrepListJob::CGrepListJob (const CGrepSearchPtr& _search, QObject* _receiver, int _generation):
+	m_search (_search),
+	m_receiver (_receiver),
+	m_generation (_generation)
+{}
+
+CGrepJob::CGrepJob (const CGrepSearchPtr& _search, QObject* _receiver, int _generation):
+	m_search (_search),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_reader_repo (NULL),
+	m_pattern (_search->m_pattern),
+	m_literal (_search->m_literal),
+	m_lowercase (_search->m_pattern.caseSensitivity () == Qt::CaseInsensitive)
+{}
+
+int
+CGrepListJob::treeWalkCb (const char* _root, const git_tree_entry* _entry, void* _payload)
+{
+	CTreeWalkData* data = static_cast<CTreeWalkData*> (_payload);
+	if (data->m_job->isCancelled ())
+		return -1;
+
+	// Submodules are commits of other repositories
+	if (git_tree_entry_type (_entry) != GIT_OBJ_BLOB)
+		return 0;
+
+	//
+	// Blob with the same contents is searched once for all its paths
+	//
+	const CGitOid id (git_tree_entry_id (_entry));
+	const QString path = QString::fromUtf8 (_root) + QString::fromUtf8 (git_tree_entry_name (_entry));
+	QHash<CGitOid, int>::const_iterator iIndex = data->m_indexes.constFind (id);
+	if (iIndex != data->m_indexes.constEnd ())
+	{
+		data->m_search->m_items [iIndex.value ()].m_paths.append (path);
+		return 0;
+	}
+
+	CGrepItem item;
+	item.m_blob = id;
+	item.m_paths.append (path);
+	data->m_indexes.insert (id, data->m_search->m_items.size ());
+	data->m_search->m_items.append (item);
+	return 0;
+}
+
+bool
+CGrepListJob::step ()
+{
+	CGitRepository* repo = CGitRepository::threadRepository (m_search->m_repo_path);
+	if (! repo->isOpened ())
+	{
+		post (m_receiver, "finishGrepJob", Q_ARG (int, m_generation), Q_ARG (QString, repo->lastError ()));
+		return false;
+	}
+
+	git_commit* commit = NULL;
+	git_tree* tree = NULL;
+	int error_code = git_commit_lookup (& commit, repo->handle (), m_search->m_commit.raw ());
+	if (error_code == GIT_OK)
+		error_code = git_commit_tree (& tree, commit);
+
+	CTreeWalkData data;
+	data.m_job = this;
+	data.m_search = m_search.data ();
+	if (error_code == GIT_OK)
+		error_code = git_tree_walk (tree, GIT_TREEWALK_PRE, & treeWalkCb, & data);
+
+	git_tree_free (tree);
+	git_commit_free (commit);
+
+	if (error_code == GIT_OK)
+		post (m_receiver, "startGrep", Q_ARG (int, m_generation), Q_ARG (int, m_search->m_items.size ()));
+	else
+		post (m_receiver, "finishGrepJob", Q_ARG (int, m_generation),
+			  Q_ARG (QString, gitErrorString (error_code, QObject::tr ("listing files of commit %1").arg (m_search->m_commit.toString ()))));
+
+	return false;
+}
+
+void
+CGrepJob::matchLine (const CGrepItem& _item, const char* _line, int _length, int _line_number)
+{
+	const QString line = QString::fromUtf8 (_line, _length);
+	if (m_pattern.indexIn (line) < 0)
+		return;
+
+	CGrepResult result;
+	result.m_line = _line_number;
+	result.m_text = line.left (MAX_SHOWN_LINE);
+	foreach (const QString& path, _item.m_paths)
+	{
+		result.m_path = path;
+		m_results.append (result);
+	}
+}
+
+void
+CGrepJob::searchLines (const CGrepItem& _item, int _size, int& _line_number)
+{
+	const char* data = m_buffer.constData ();
+	const char* end = data + _size;
+
+	//
+	// Without required literal every line is matched
+	//
+	if (m_literal.isEmpty ())
+	{
+		for (const char* line = data; line < end; ++_line_number)
+		{
+			const char* line_end = static_cast<const char*> (memchr (line, '\n', size_t (end - line)));
+			if (! line_end)
+				line_end = end;
+
+			matchLine (_item, line, int (line_end - line), _line_number);
+			line = line_end + 1;
+		}
+
+		return;
+	}
+
+	const char* haystack = data;
+	if (m_lowercase)
+	{
+		m_lower.resize (_size);
+		char* lower = m_lower.data ();
+		for (int i = 0; i < _size; ++i)
+			lower [i] = ((data [i] >= 'A') && (data [i] <= 'Z')) ? char (data [i] + ('a' - 'A')) : data [i];
+		haystack = lower;
+	}
+
+	//
+	// Only lines containing the literal are matched; line numbers are counted up to them
+	//
+	const char* counted = data;
+	for (int offset = 0; offset < _size; )
+	{
+		const char* found = CBlobReader::findLiteral (haystack + offset, _size - offset, m_literal);
+		if (! found)
+			break;
+
+		const int position = int (found - haystack);
+		int line_begin = position;
+		while ((line_begin > offset) && (data [line_begin - 1] != '\n'))
+			--line_begin;
+
+		const char* line_end = static_cast<const char*> (memchr (data + position, '\n', size_t (_size - position)));
+		if (! line_end)
+			line_end = end;
+
+		for (const char* p = counted; (p = static_cast<const char*> (memchr (p, '\n', size_t (data + line_begin - p)))); ++p)
+			++_line_number;
+		counted = data + line_begin;
+
+		matchLine (_item, data + line_begin, int (line_end - data - line_begin), _line_number);
+		offset = int (line_end - data) + 1;
+	}
+
+	for (const char* p = counted; (p = static_cast<const char*> (memchr (p, '\n', size_t (end - p)))); ++p)
+		++_line_number;
+}
+
+void
+CGrepJob::searchBlob (const CGrepItem& _item)
+{
+	if (! m_reader.openBlob (_item.m_blob))
+		return;
+
+	//
+	// Chunks are searched up to their last line break, the tail is searched with the next chunk
+	//
+	int line_number = 1;
+	int size = 0;
+	bool first_chunk = true;
+	for (;;)
+	{
+		if (m_buffer.size () < size + CHUNK_SIZE)
+			m_buffer.resize (size + CHUNK_SIZE);
+
+		const int count = m_reader.read (m_buffer.data () + size, CHUNK_SIZE);
+		if (count < 0)
+			break;
+
+		// Binary files are skipped, as git grep does by default
+		if (first_chunk && CBlobReader::isBinary (m_buffer.constData (), count))
+			break;
+		first_chunk = false;
+
+		size += count;
+		if (count == 0)
+		{
+			if (size > 0)
+				searchLines (_item, size, line_number);
+			break;
+		}
+
+		int lines_size = size;
+		while ((lines_size > 0) && (m_buffer [lines_size - 1] != '\n'))
+			--lines_size;
+		if ((lines_size == 0) && (size >= MAX_LINE_SIZE))
+			lines_size = size;
+
+		if (lines_size > 0)
+		{
+			searchLines (_item, lines_size, line_number);
+			memmove (m_buffer.data (), m_buffer.constData () + lines_size, size_t (size - lines_size));
+			size -= lines_size;
+		}
+
+		if (isCancelled ())
+			break;
+	}
+
+	m_reader.closeBlob ();
+}
+
+bool
+CGrepJob::step ()
+{
+	//
+	// Job may continue on another thread: its handle must be used then
+	//
+	QString error;
+	CGitRepository* repo = CGitRepository::threadRepository (m_search->m_repo_path);
+	if (repo != m_reader_repo)
+	{
+		m_reader_repo = repo;
+		if (! m_reader.open (repo))
+			error = m_reader.lastError ();
+	}
+
+	if (! error.isEmpty () || isCancelled ())
+	{
+		post (m_receiver, "finishGrepJob", Q_ARG (int, m_generation), Q_ARG (QString, error));
+		return false;
+	}
+
+	//
+	// Blobs are taken in batches: jobs which get small files take more of them
+	//
+	const int count = m_search->m_items.size ();
+	const int first = m_search->m_next.fetchAndAddOrdered (BATCH_SIZE);
+	const int last = qMin (first + BATCH_SIZE, count);
+	for (int i = first; (i < last) && !isCancelled (); ++i)
+		searchBlob (m_search->m_items.at (i));
+
+	if (last > first)
+	{
+		post (m_receiver, "addGrepResults", Q_ARG (int, m_generation), Q_ARG (CGrepResultList, m_results),
+			  Q_ARG (int, last - first));
+		m_results.clear ();
+	}
+
+	if (last < count)
+		return true;
+
+	post (m_receiver, "finishGrepJob", Q_ARG (int, m_generation), Q_ARG (QString, QString ()));
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CGrepModel::CGrepModel (QObject* _parent):
+	QAbstractTableModel (_parent),
+	m_generation (0),
+	m_running_jobs (0),
+	m_searched (0),
+	m_total (0)
+{
+	qRegisterMetaType<CGrepResultList> ("CGrepResultList");
+}
+
+CGrepModel::~CGrepModel ()
+{
+	cancelJobs ();
+}
+
+void
+CGrepModel::cancelJobs ()
+{
+	foreach (const CBackgroundJobPtr& job, m_jobs)
+		job->cancel ();
+	m_jobs.clear ();
+	m_waiting_jobs.clear ();
+	m_running_jobs = 0;
+	++m_generation;
+}
+
+void
+CGrepModel::setGitRepo (const QString& _repo_path)
+{
+	cancelJobs ();
+	m_repo_path = _repo_path;
+
+	beginResetModel ();
+	m_results.clear ();
+	m_searched = m_total = 0;
+	m_error.clear ();
+	endResetModel ();
+}
+
+QByteArray
+CGrepModel::requiredLiteral (const QRegExp& _pattern)
+{
+	const QString pattern = _pattern.pattern ();
+	QString best;
+
+	switch (_pattern.patternSyntax ())
+	{
+		case QRegExp::FixedString:
+			best = pattern;
+			break;
+
+		case QRegExp::Wildcard:
+		case QRegExp::WildcardUnix:
+			foreach (const QString& part, pattern.split (QRegExp ("\\[[^\\]]*\\]|[*?\\\\]"), QString::SkipEmptyParts))
+				if (part.length () > best.length ())
+					best = part;
+			break;
+
+		default:
+		{
+			// Alternatives have no common literal
+			if (pattern.contains ('|'))
+				break;
+
+			//
+			// Runs of plain characters outside of groups and classes; quantified characters end runs
+			//
+			QString run;
+			int depth = 0;
+			for (int i = 0; i < pattern.length (); ++i)
+			{
+				const QChar c = pattern [i];
+				bool plain = false;
+				QChar literal = c;
+
+				if (c == '\\')
+				{
+					//
+					// Escaped punctuation is a literal; escaped letters and digits are classes, assertions,
+					// back references or character codes, which end the run together with their operands
+					//
+					if (i + 1 < pattern.length ())
+					{
+						literal = pattern [++i];
+						plain = (depth == 0) && !literal.isLetterOrNumber ();
+						if ((literal == 'x') && (i + 1 < pattern.length ()) && (pattern [i + 1] == '{'))
+						{
+							while ((i + 1 < pattern.length ()) && (pattern [i] != '}'))
+								++i;
+						}
+						else if ((literal == 'x') || (literal == 'u'))
+						{
+							for (int digits = 0; (digits < 4) && (i + 1 < pattern.length ()) && isxdigit (uchar (pattern [i + 1].toLatin1 ())); ++digits)
+								++i;
+						}
+						else if (literal == '0')
+						{
+							for (int digits = 0; (digits < 3) && (i + 1 < pattern.length ()) && (pattern [i + 1] >= '0') && (pattern [i + 1] <= '7'); ++digits)
+								++i;
+						}
+					}
+				}
+				else if (c == '[')
+				{
+					// Skip the class, "]" right after "[" or "[^" belongs to it
+					int j = i + 1;
+					if ((j < pattern.length ()) && (pattern [j] == '^'))
+						++j;
+					if ((j < pattern.length ()) && (pattern [j] == ']'))
+						++j;
+					while ((j < pattern.length ()) && (pattern [j] != ']'))
+						j += (pattern [j] == '\\') ? 2 : 1;
+					i = j;
+				}
+				else if (c == '(')
+				{
+					++depth;
+				}
+				else if (c == ')')
+				{
+					--depth;
+				}
+				else if ((c == '?') || (c == '*') || (c == '{'))
+				{
+					// Previous character is optional
+					run.chop (1);
+					if (c == '{')
+						while ((i + 1 < pattern.length ()) && (pattern [i] != '}'))
+							++i;
+				}
+				else
+				{
+					plain = (depth == 0) && (QString (".^$+").indexOf (c) < 0);
+				}
+
+				if (plain)
+				{
+					run.append (literal);
+					continue;
+				}
+
+				if (run.length () > best.length ())
+					best = run;
+				run.clear ();
+			}
+			if (run.length () > best.length ())
+				best = run;
+			break;
+		}
+	}
+
+	//
+	// Case insensitive prefilter compares lowercase ASCII only
+	//
+	QByteArray literal = best.toUtf8 ();
+	if (_pattern.caseSensitivity () == Qt::CaseInsensitive)
+	{
+		for (int i = 0; i < literal.size (); ++i)
+			if (uchar (literal [i]) >= 0x80)
+				return QByteArray ();
+
+		literal = literal.toLower ();
+	}
+
+	return literal;
+}
+
+void
+CGrepModel::search (const CGitOid& _commit, const QRegExp& _pattern)
+{
+	cancelJobs ();
+
+	beginResetModel ();
+	m_results.clear ();
+	m_searched = m_total = 0;
+	m_error.clear ();
+	endResetModel ();
+
+	if (m_repo_path.isEmpty () || _commit.isNull () || !_pattern.isValid () || _pattern.isEmpty ())
+	{
+		emit searchFinished ();
+		return;
+	}
+
+	CGrepSearchPtr search (new CGrepSearch);
+	search->m_repo_path = m_repo_path;
+	search->m_commit = _commit;
+	search->m_pattern = _pattern;
+	search->m_literal = requiredLiteral (_pattern);
+
+	//
+	// One search job per pool thread, each opens its own repository handle; they start when the tree is listed
+	//
+	const int job_count = qMax (1, CWorkerPool::instance ()->maxThreadCount ());
+	for (int i = 0; i < job_count; ++i)
+	{
+		CBackgroundJobPtr job (new CGrepJob (search, this, m_generation));
+		job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+		m_jobs.append (job);
+		m_waiting_jobs.append (job);
+	}
+
+	CBackgroundJobPtr list_job (new CGrepListJob (search, this, m_generation));
+	list_job->setPriority (CWorkerPool::PRIORITY_FOREGROUND);
+	m_jobs.append (list_job);
+
+	m_running_jobs = 1;
+	CWorkerPool::instance ()->start (list_job);
+}
+
+void
+CGrepModel::stop ()
+{
+	const bool searching = isSearching ();
+	cancelJobs ();
+
+	if (searching)
+		emit searchFinished ();
+}
+
+bool
+CGrepModel::isSearching () const
+{
+	return (m_running_jobs > 0);
+}
+
+int
+CGrepModel::searchedBlobs () const
+{
+	return m_searched;
+}
+
+int
+CGrepModel::totalBlobs () const
+{
+	return m_total;
+}
+
+void
+CGrepModel::startGrep (int _generation, int _total)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_total = _total;
+	emit progressChanged (m_searched, m_total);
+
+	// List job is done, search jobs take its place
+	m_running_jobs = m_waiting_jobs.size ();
+	foreach (const CBackgroundJobPtr& job, m_waiting_jobs)
+		CWorkerPool::instance ()->start (job);
+	m_waiting_jobs.clear ();
+}
+
+void
+CGrepModel::addGrepResults (int _generation, const CGrepResultList& _results, int _searched)
+{
+	if (_generation != m_generation)
+		return;
+
+	m_searched += _searched;
+	if (! _results.isEmpty ())
+	{
+		const int count = qMin (_results.size (), int (MAX_RESULTS) - m_results.size ());
+		if (count > 0)
+		{
+			beginInsertRows (QModelIndex (), m_results.size (), m_results.size () + count - 1);
+			m_results.append (_results.mid (0, count));
+			endInsertRows ();
+		}
+	}
+
+	emit progressChanged (m_searched, m_total);
+
+	if (m_results.size () >= MAX_RESULTS)
+	{
+		m_error = tr ("Search was stopped after %1 matches").arg (int (MAX_RESULTS));
+		stop ();
+	}
+}
+
+void
+CGrepModel::finishGrepJob (int _generation, const QString& _error)
+{
+	if (_generation != m_generation)
+		return;
+
+	if (! _error.isEmpty ())
+		m_error = _error;
+
+	if (--m_running_jobs > 0)
+		return;
+
+	m_jobs.clear ();
+	emit searchFinished ();
+}
+
+const CGrepResult&
+CGrepModel::result (int _row) const
+{
+	Q_ASSERT ((_row >= 0) && (_row < m_results.size ()));
+	return m_results [_row];
+}
+
+QString
+CGrepModel::lastError () const
+{
+	return m_error;
+}
+
+int
+CGrepModel::rowCount (const QModelIndex& _parent) const
+{
+	return _parent.isValid () ? 0 : m_results.size ();
+}
+
+int
+CGrepModel::columnCount (const QModelIndex& _parent) const
+{
+	return _parent.isValid () ? 0 : _ColumnCount;
+}
+
+QVariant
+CGrepModel::data (const QModelIndex& _index, int _role) const
+{
+	if (! _index.isValid () || (_index.row () >= m_results.size ()))
+		return QVariant ();
+
+	const CGrepResult& grep_result = m_results [_index.row ()];
+	switch (_role)
+	{
+		case Qt::DisplayRole:
+			switch (_index.column ())
+			{
+				case _PathColumn:
+					return grep_result.m_path;
+
+				case _LineColumn:
+					return grep_result.m_line;
+
+				case _TextColumn:
+					return grep_result.m_text.trimmed ();
+			}
+			break;
+
+		case Qt::ToolTipRole:
+			return QString ("%1:%2").arg (grep_result.m_path).arg (grep_result.m_line);
+	}
+
+	return QVariant ();
+}
+
+QVariant
+CGrepModel::headerData (int _section, Qt::Orientation _orientation, int _role) const
+{
+	if ((_orientation != Qt::Horizontal) || (_role != Qt::DisplayRole))
+		return QVariant ();
+
+	switch (_section)
+	{
+		case _PathColumn:
+			return tr ("File");
+
+		case _LineColumn:
+			return tr ("Line");
+
+		case _TextColumn:
+			return tr ("Text");
+	}
+
+	return QVariant ();
+}
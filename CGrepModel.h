@@ -0,0 +1,118 @@
+/**
+ * @file
+ * @brief Parallel search of text in files of a commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CGREPMODEL_H
+#define __QGITREPOVIEWER_CGREPMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QRegExp>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+
+namespace QGitRepoViewer
+{
+	/// Line of a file matching the searched pattern
+	struct CGrepResult
+	{
+		QString m_path;
+		int m_line;		// 1-based
+		QString m_text;
+
+		CGrepResult (): m_line (0)
+		{}
+	};
+
+	typedef QList<CGrepResult> CGrepResultList;
+
+	/**
+	 * @brief Lines of files of a commit matching a regular expression
+	 *
+	 * Search runs on all threads of worker pool: one job lists the tree of the commit, joining paths
+	 * with the same blob, then search jobs take batches of blobs from the shared list until it ends, so busy
+	 * workers are helped by idle ones. Lines are first looked up by the longest literal the pattern
+	 * requires, only lines containing it are matched by regular expression. Matches are appended as they come.
+	 */
+	class CGrepModel : public QAbstractTableModel
+	{
+		Q_OBJECT
+
+		QString m_repo_path;
+		CGrepResultList m_results;
+
+		QList<CBackgroundJobPtr> m_jobs;
+
+		/// Search jobs waiting for the tree to be listed
+		QList<CBackgroundJobPtr> m_waiting_jobs;
+		int m_generation;
+		int m_running_jobs;
+
+		/// Searched and all blobs of the commit
+		int m_searched;
+		int m_total;
+
+		QString m_error;
+
+		void cancelJobs ();
+
+	private Q_SLOTS:
+		void startGrep (int _generation, int _total);
+		void addGrepResults (int _generation, const CGrepResultList& _results, int _searched);
+		void finishGrepJob (int _generation, const QString& _error);
+
+	Q_SIGNALS:
+		/// Count of searched blobs changed
+		void progressChanged (int _searched, int _total);
+
+		/// Search was completed or stopped (due to error or results limit)
+		void searchFinished ();
+
+	public:
+		enum Columns { _PathColumn = 0, _LineColumn, _TextColumn, _ColumnCount };
+
+		/// Search stops after so many matches
+		enum { MAX_RESULTS = 100000 };
+
+		CGrepModel (QObject* _parent = 0);
+		~CGrepModel ();
+
+		/// Stop the search and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Start searching files of the commit, replacing current results
+		void search (const CGitOid& _commit, const QRegExp& _pattern);
+
+		/// Stop the search keeping found results
+		void stop ();
+
+		bool isSearching () const;
+
+		/// Count of searched and all unique blobs of the commit (0 until the tree is listed)
+		int searchedBlobs () const;
+		int totalBlobs () const;
+
+		const CGrepResult& result (int _row) const;
+
+		/// Error of the last search, if any
+		QString lastError () const;
+
+		/// Literal which any match of the pattern must contain (empty if there is none)
+		static QByteArray requiredLiteral (const QRegExp& _pattern);
+
+	public:
+		/// @name Implementation of QAbstractItemModel interface
+		/** @{*/
+		int rowCount (const QModelIndex& _parent = QModelIndex ()) const;
+		int columnCount (const QModelIndex& _parent = QModelIndex ()) const;
+		QVariant data (const QModelIndex& _index, int _role = Qt::DisplayRole) const;
+		QVariant headerData (int _section, Qt::Orientation _orientation, int _role = Qt::DisplayRole) const;
+		/** @}*/
+	};
+}
+
+Q_DECLARE_METATYPE (QGitRepoViewer::CGrepResultList)
+
+#endif // __QGITREPOVIEWER_CGREPMODEL_H
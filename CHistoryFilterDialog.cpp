@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @brief Dialog asking for conditions of history walk filter implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CHistoryFilterDialog.h"
+
+#include "ui_CHistoryFilterDialog.h"
+
+#include <QDateTime>
+#include <QPushButton>
+
+using namespace QGitRepoViewer;
+
+CHistoryFilterDialog::CHistoryFilterDialog (QWidget* _parent):
+	QDialog (_parent),
+	m_ui (new Ui::CHistoryFilterDialog)
+{
+	m_ui->setupUi (this);
+
+	m_ui->from_edit->setDate (QDate::currentDate ().addYears (-1));
+	m_ui->to_edit->setDate (QDate::currentDate ());
+
+	connect (m_ui->message_edit, SIGNAL (textChanged (const QString&)), this, SLOT (aboutMessageChanged ()));
+}
+
+CHistoryFilterDialog::~CHistoryFilterDialog ()
+{}
+
+void
+CHistoryFilterDialog::setFilter (const CCommitWalkFilter& _filter)
+{
+	m_ui->author_edit->setText (_filter.m_author);
+	m_ui->committer_edit->setText (_filter.m_committer);
+	m_ui->message_edit->setText (_filter.m_message.pattern ());
+	m_ui->path_edit->setText (_filter.m_path);
+
+	m_ui->from_check->setChecked (_filter.m_date_from > 0);
+	if (_filter.m_date_from > 0)
+	{
+		QDateTime from;
+		from.setTime_t (_filter.m_date_from);
+		m_ui->from_edit->setDate (from.date ());
+	}
+
+	m_ui->to_check->setChecked (_filter.m_date_to > 0);
+	if (_filter.m_date_to > 0)
+	{
+		QDateTime to;
+		to.setTime_t (_filter.m_date_to);
+		m_ui->to_edit->setDate (to.date ());
+	}
+}
+
+CCommitWalkFilter
+CHistoryFilterDialog::filter () const
+{
+	CCommitWalkFilter result;
+	result.m_author = m_ui->author_edit->text ().trimmed ();
+	result.m_committer = m_ui->committer_edit->text ().trimmed ();
+	result.m_path = m_ui->path_edit->text ().trimmed ();
+
+	if (! m_ui->message_edit->text ().isEmpty ())
+		result.m_message = QRegExp (m_ui->message_edit->text (), Qt::CaseInsensitive);
+
+	if (m_ui->from_check->isChecked ())
+		result.m_date_from = QDateTime (m_ui->from_edit->date (), QTime (0, 0, 0)).toTime_t ();
+	if (m_ui->to_check->isChecked ())
+		result.m_date_to = QDateTime (m_ui->to_edit->date (), QTime (23, 59, 59)).toTime_t ();
+
+	return result;
+}
+
+void
+CHistoryFilterDialog::aboutMessageChanged ()
+{
+	const bool valid = QRegExp (m_ui->message_edit->text ()).isValid ();
+	m_ui->buttons->button (QDialogButtonBox::Ok)->setEnabled (valid);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file
+ * @brief Dialog asking for conditions of history walk filter interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CHISTORYFILTERDIALOG_H
+#define __QGITREPOVIEWER_CHISTORYFILTERDIALOG_H
+
+#include <QDialog>
+
+#include "CCommitLoader.h"
+
+namespace Ui
+{
+	class CHistoryFilterDialog;
+}
+
+namespace QGitRepoViewer
+{
+	/// Asks for author, committer, message pattern, date range and path which commits must match
+	class CHistoryFilterDialog : public QDialog
+	{
+		Q_OBJECT
+
+		/// Qt GUI object
+		QScopedPointer<Ui::CHistoryFilterDialog> m_ui;
+
+	private slots:
+		/// Disable OK button while message pattern is invalid
+		void aboutMessageChanged ();
+
+	public:
+		explicit CHistoryFilterDialog (QWidget* _parent = NULL);
+		~CHistoryFilterDialog ();
+
+		void setFilter (const CCommitWalkFilter& _filter);
+		CCommitWalkFilter filter () const;
+	};
+}
+
+#endif // __QGITREPOVIEWER_CHISTORYFILTERDIALOG_H
@@ -8,27 +8,26 @@
 
 #include "CMainWindow.h"
 
-#include "CCommitModel.h"
-#include "CBranchModel.h"
+#include "CRepoTab.h"
 
 #include <QDir>
 #include <QFileDialog>
 #include <QSettings>
+#include <QTimer>
+#include <QToolButton>
 
 using namespace QGitRepoViewer;
 
 #define GEOMETRY_KEY "ui/geometry"
-#define GIT_REPO_KEY "repos/last"
-#define BRANCH_KEY "ui/branch-index"
-#define COMMIT_KEY "ui/commit-index"
-#define FILTER_KEY "ui/filter-index"
+#define TABS_KEY "repos/tabs"
+#define CURRENT_TAB_KEY "repos/current-tab"
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
 CMainWindow::CMainWindow (QWidget* _parent):
 	QMainWindow (_parent),
-	m_branch_model (NULL),
-	m_commit_model (NULL)
+	m_restored (false),
+	m_problems_button (NULL)
 {
 	//
 	// Initialize window GUI from Qt *.ui file
@@ -36,27 +35,21 @@ CMainWindow::CMainWindow (QWidget* _parent):
 	m_ui.setupUi (this);
 
 	//
-	// Connect git repository local branches model to appropriate combobox
+	// Problems are collected without interrupting user: panel is hidden until he asks for it
 	//
-	m_branch_model = new CBranchListModel (this);
-	m_ui.branch_list->setModel (m_branch_model);
+	m_ui.diagnostics_dock->hide ();
+	m_problems_button = new QToolButton (this);
+	m_problems_button->setAutoRaise (true);
+	m_problems_button->hide ();
+	m_ui.statusBar->addPermanentWidget (m_problems_button);
+	connect (m_problems_button, SIGNAL (clicked ()), m_ui.diagnostics_dock->toggleViewAction (), SLOT (trigger ()));
+	connect (m_ui.diagnostics, SIGNAL (countChanged (int)), this, SLOT (aboutProblemsCountChanged (int)));
 
 	//
-	// Connect git repository commits model to appropriate tableview
+	// Only active repository tab loads data with full priority and keeps big caches
 	//
-	m_commit_model = new CCommitTableModel (this);
-	m_ui.commit_list->setModel (m_commit_model);
-
-	//
-	// Handle user click on commit: show commit hash in appropriate text field
-	//
-	connect (m_ui.commit_list->selectionModel (), SIGNAL (currentChanged (const QModelIndex&, const QModelIndex&)),
-			 this, SLOT (aboutCommitSelected (const QModelIndex&, const QModelIndex&)));
-
-	//
-	// Connect search widget to commits table (can search by brief commit description/author/date)
-	//
-	m_ui.commit_search->setView (m_ui.commit_list);
+	connect (m_ui.repo_tabs, SIGNAL (currentChanged (int)), this, SLOT (aboutTabChanged (int)));
+	connect (m_ui.repo_tabs, SIGNAL (tabCloseRequested (int)), this, SLOT (aboutTabCloseRequested (int)));
 
 	//
 	// Restore window geometry (position on the screen + size) from settings
@@ -72,30 +65,44 @@ CMainWindow::CMainWindow (QWidget* _parent):
 CMainWindow::~CMainWindow ()
 {
 	//
-	// Disconnect commit search widget from commit table
-	//
-	m_ui.commit_search->setView (NULL);
-
-	//
-	// Save last discovered git repository path if one presents in settings
+	// Save opened repositories together with user selection in each of them
 	//
 	QSettings settings ("SpectrumSoft", "qpiket");
-	settings.setValue (GIT_REPO_KEY, m_repo_path);
+	settings.beginWriteArray (TABS_KEY, m_ui.repo_tabs->count ());
+	for (int i = 0; i < m_ui.repo_tabs->count (); ++i)
+	{
+		settings.setArrayIndex (i);
+		repoTab (i)->saveState (settings);
+	}
+	settings.endArray ();
 
-	//
-	// Save last user-selected branch of git repository
-	//
-	settings.setValue (BRANCH_KEY, m_ui.branch_list->currentIndex ());
+	settings.setValue (CURRENT_TAB_KEY, m_ui.repo_tabs->currentIndex ());
+}
 
-	//
-	// Save last user-selected commit
-	//
-	settings.setValue (COMMIT_KEY, m_ui.commit_list->currentIndex ().row ());
+CRepoTab*
+CMainWindow::repoTab (int _index) const
+{
+	QWidget* tab = (_index < 0) ? m_ui.repo_tabs->currentWidget () : m_ui.repo_tabs->widget (_index);
+	return qobject_cast <CRepoTab*> (tab);
+}
 
-	//
-	// Save last user-selected filter index
-	//
-	settings.setValue (FILTER_KEY, m_ui.filter_criteria->currentIndex ());
+CRepoTab*
+CMainWindow::addRepoTab ()
+{
+	CRepoTab* tab = new CRepoTab (m_ui.repo_tabs);
+	m_ui.repo_tabs->setCurrentIndex (m_ui.repo_tabs->addTab (tab, tr ("Repository")));
+	return tab;
+}
+
+void
+CMainWindow::updateTabTitle (CRepoTab* _tab)
+{
+	int index = m_ui.repo_tabs->indexOf (_tab);
+	m_ui.repo_tabs->setTabText (index, QDir (_tab->repoPath ()).dirName ());
+	m_ui.repo_tabs->setTabToolTip (index, _tab->repoPath ());
+
+	if (index == m_ui.repo_tabs->currentIndex ())
+		setWindowTitle ("QGitRepoViewer: " + _tab->repoPath ());
 }
 
 void
@@ -116,129 +123,93 @@ CMainWindow::showEvent (QShowEvent* _ev)
 	QMainWindow::showEvent (_ev);
 
 	//
-	// Restore last discovered git repository path if one presents in settings
+	// Window is shown again after minimizing: repositories are already opened
 	//
-	QSettings settings ("SpectrumSoft", "qpiket");
-	QVariant repo_path_var = settings.value (GIT_REPO_KEY);
-	if (!repo_path_var.isNull () && repo_path_var.canConvert <QString> ())
-	{
-		QString path = repo_path_var.toString ();
-		if (QDir (path).exists ())
-			m_repo_path = path;
-	}
-
-	if (! m_repo_path.isEmpty ())
-	{
-		//
-		// Connect custom table model to git repository using its path
-		//
-		m_commit_model->setGitRepo (m_repo_path);
-
-		//
-		// Load the list of git repository branches
-		//
-		m_branch_model->loadFromGit (m_repo_path);
-
-		setWindowTitle ("QGitRepoViewer: " + m_repo_path);
-
-		//
-		// Restore last user-selected branch
-		//
-		QVariant branch_as_var = settings.value (BRANCH_KEY);
-		if (! branch_as_var.isNull () && branch_as_var.canConvert <int> ())
-		{
-			bool ok = false;
-			int branch_index = branch_as_var.toInt (& ok);
-			if (ok && (branch_index >= 0) && (branch_index < m_ui.branch_list->count ()))
-				m_ui.branch_list->setCurrentIndex (branch_index);
-		}
-
-		//
-		// Restore last user-selected commit
-		//
-		QVariant commit_idx_var = settings.value (COMMIT_KEY);
-		if (!commit_idx_var.isNull () && commit_idx_var.canConvert <int> ())
-		{
-			bool ok = false;
-			int commit_index = commit_idx_var.toInt (& ok);
-			if (ok && (commit_index >= 0) && (commit_index < m_commit_model->rowCount ()))
-				m_ui.commit_list->setCurrentIndex (m_commit_model->index (commit_index, 0));
-		}
+	if (m_restored)
+		return;
+	m_restored = true;
 
-		//
-		// Restore last user-selected filter index
-		//
-		QVariant filter_idx_var = settings.value (FILTER_KEY, m_ui.filter_criteria->currentIndex ());
-		if (! filter_idx_var.isNull () && filter_idx_var.canConvert <int> ())
-		{
-			bool ok = false;
-			int filter_index = filter_idx_var.toInt (& ok);
-			if (ok && (filter_index >= 0) && (filter_index < m_ui.filter_criteria->count ()))
-				m_ui.filter_criteria->setCurrentIndex (filter_index);
-		}
-	}
+	//
+	// Let the window paint itself first: repositories are restored by the event loop
+	//
+	QTimer::singleShot (0, this, SLOT (restoreSession ()));
 }
 
 void
-CMainWindow::aboutBranchSelected (const QString& _item)
+CMainWindow::restoreSession ()
 {
 	//
-	// Obtain new selected branch name
+	// Restore repositories opened in previous session
 	//
-	QString current_branch = _item;
-	if (current_branch.isEmpty () || current_branch.size () < 3)
-		return;
-	if (current_branch.at (0) == '*')
-		current_branch.remove (0, 2);
-	else
-		current_branch = current_branch.trimmed ();
+	QSettings settings ("SpectrumSoft", "qpiket");
+	const bool has_tabs = settings.contains (TABS_KEY "/size");
+	int tab_count = settings.beginReadArray (TABS_KEY);
+	for (int i = 0; i < tab_count; ++i)
+	{
+		settings.setArrayIndex (i);
 
-	//
-	// Fill the table with new branch commit list and select first of them
-	//
-	m_commit_model->setCommitList (current_branch);
-	if (! m_commit_model->empty ())
-		m_ui.commit_list->selectRow (0);
+		CRepoTab* tab = addRepoTab ();
+		if (tab->restoreState (settings))
+			updateTabTitle (tab);
+		else
+			delete tab;
+	}
+	settings.endArray ();
 
 	//
-	// Setup default column sizes as 60%, 20%, 20% (because such sizes looks fine)
+	// Settings of single-repository version are stored without array: they are read once and
+	// dropped, so closing all tabs is remembered too
 	//
-	int table_width = m_ui.commit_list->width () - 15;
-	m_ui.commit_list->setColumnWidth (CCommitTableModel::_ShortLogColumn, (table_width) * 0.6);
-	m_ui.commit_list->setColumnWidth (CCommitTableModel::_AuthorColumn, (table_width) * 0.2);
-	m_ui.commit_list->setColumnWidth (CCommitTableModel::_DateColumn, (table_width) * 0.2);
+	if (! has_tabs)
+	{
+		CRepoTab* tab = addRepoTab ();
+		if (tab->restoreState (settings))
+			updateTabTitle (tab);
+		else
+			delete tab;
+
+		CRepoTab::removeState (settings);
+	}
+
+	bool ok = false;
+	int current_tab = settings.value (CURRENT_TAB_KEY).toInt (&ok);
+	if (ok && (current_tab >= 0) && (current_tab < m_ui.repo_tabs->count ()))
+		m_ui.repo_tabs->setCurrentIndex (current_tab);
 }
 
 void
-CMainWindow::aboutCommitSelected (const QModelIndex& _current, const QModelIndex& _previous)
+CMainWindow::aboutTabChanged (int _index)
 {
-	Q_UNUSED (_previous);
+	//
+	// Background tabs pause loading and give up their caches first
+	//
+	for (int i = 0; i < m_ui.repo_tabs->count (); ++i)
+	{
+		if (i != _index)
+			repoTab (i)->setActive (false);
+	}
 
-	if (_current.isValid ())
-		m_ui.commit_hash->setText (selectedCommitId ());
+	CRepoTab* tab = repoTab (_index);
+	if (tab)
+	{
+		tab->setActive (true);
+		setWindowTitle ("QGitRepoViewer: " + tab->repoPath ());
+	}
+	else
+		setWindowTitle ("QGitRepoViewer");
 }
 
 void
-CMainWindow::aboutFilterChanged (int _column_idx)
+CMainWindow::aboutTabCloseRequested (int _index)
 {
-	m_ui.commit_search->setSearchColumn (_column_idx);
+	delete repoTab (_index);
 }
 
-QString
-CMainWindow::selectedCommitId () const
+void
+CMainWindow::aboutProblemsCountChanged (int _count)
 {
-	//
-	// Obtain the ID of user selected commit
-	//
-	QString result;
-	if (m_ui.commit_list->selectionModel ()->hasSelection ())
-	{
-		QModelIndexList commits_idx = m_ui.commit_list->selectionModel ()->selectedIndexes ();
-		if (commits_idx.size () >= 1)
-			result = m_commit_model->data (commits_idx.first (), Qt::UserRole).toString ();
-	}
-
-	return result;
+	m_problems_button->setText (tr ("%1 problem(s)").arg (_count));
+	m_problems_button->setVisible (_count > 0);
 }
 
 void
@@ -250,23 +221,20 @@ QGitRepoViewer::CMainWindow::on_action_open_repo_triggered ()
 	QString repo_dir = QFileDialog::getExistingDirectory (this, "Select directory with git repository");
 	if (! repo_dir.isEmpty ())
 	{
-		m_repo_path = repo_dir;
-
-		//
-		// Connect custom table model to git repository using its path
 		//
-		m_commit_model->setGitRepo (m_repo_path);
-		setWindowTitle ("QGitRepoViewer: " + m_repo_path);
-
-		//
-		// Load the list of git repository branches
+		// Open the repository in a new tab
 		//
-		m_branch_model->loadFromGit (m_repo_path);
-		if (! m_branch_model->empty ())
-			m_ui.branch_list->setCurrentIndex (0);
+		CRepoTab* tab = addRepoTab ();
+		tab->openRepository (repo_dir);
+		updateTabTitle (tab);
 	}
 }
 
+void QGitRepoViewer::CMainWindow::on_action_close_repo_triggered ()
+{
+	delete repoTab ();
+}
+
 void QGitRepoViewer::CMainWindow::on_action_exit_triggered()
 {
 	//
@@ -15,15 +15,14 @@
 
 #include "ui_CMainWindow.h"
 
-struct git_repository;
+class QToolButton;
 
 namespace QGitRepoViewer
 {
-	class CCommitTableModel;
-	class CBranchListModel;
+	class CRepoTab;
 
 	/**
-	 * @brief Main window of QGitRepoViewer application: contain branch and commit view controls
+	 * @brief Main window of QGitRepoViewer application: contain one tab per opened git repository
 	 */
 	class CMainWindow : public QMainWindow
 	{
@@ -35,24 +34,29 @@ namespace QGitRepoViewer
 		Ui::CMainWindow m_ui;
 
 		/**
-		  * @brief Custom data model for list of local branches of git repository
+		  * @brief Opened repositories were restored from settings
 		  */
-		CBranchListModel* m_branch_model;
+		bool m_restored;
 
 		/**
-		  * @brief Custom data model for list of commits of git repository
+		  * @brief Status bar indicator of reported problems, toggles the problems panel
 		  */
-		CCommitTableModel* m_commit_model;
+		QToolButton* m_problems_button;
 
 		/**
-		  * @brief The path to the git repository (dir with .git folder or any it's subfolder)
-		  */
-		QString m_repo_path;
+		 * @brief Return the tab of specified index (current one by default)
+		 */
+		CRepoTab* repoTab (int _index = -1) const;
 
 		/**
-		 * @brief Return the SHA-1 id of selected in list commit
+		 * @brief Create new empty repository tab and make it current
 		 */
-		QString selectedCommitId () const;
+		CRepoTab* addRepoTab ();
+
+		/**
+		 * @brief Show repository name of the tab in its title
+		 */
+		void updateTabTitle (CRepoTab* _tab);
 
 		/**
 		  * @brief Save some application settings on window hide event
@@ -66,25 +70,35 @@ namespace QGitRepoViewer
 
 	private	Q_SLOTS:
 		/**
-		  * @brief Selected local branch was changed
+		  * @brief Reopen repositories of previous session (called after the window is shown)
 		  */
-		void aboutBranchSelected (const QString& _item);
+		void restoreSession ();
 
 		/**
-		 * @brief Selected commit was changed
-		 */
-		void aboutCommitSelected (const QModelIndex& _current, const QModelIndex& _previous);
+		  * @brief Active repository tab was changed
+		  */
+		void aboutTabChanged (int _index);
 
 		/**
-		  * @brief Filter search column index was changed
+		  * @brief User requested to close repository tab
 		  */
-		void aboutFilterChanged (int _column_idx);
+		void aboutTabCloseRequested (int _index);
+
+		/**
+		  * @brief Count of problems reported by background jobs or models was changed
+		  */
+		void aboutProblemsCountChanged (int _count);
 
 		/**
 		 * @brief Open repository
 		 */
 		void on_action_open_repo_triggered ();
 
+		/**
+		 * @brief Close repository of the current tab
+		 */
+		void on_action_close_repo_triggered ();
+
 		/**
 		 * @brief Quit from the program
 		 */
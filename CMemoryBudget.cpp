@@ -0,0 +1,87 @@
+/**
+ * @file
+ * @brief Global memory budget for caches of all opened repositories implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CMemoryBudget.h"
+
+using namespace QGitRepoViewer;
+
+CMemoryBudget::CMemoryBudget ():
+	m_budget (qint64 (DEFAULT_BUDGET_MB) * 1024 * 1024)
+{}
+
+CMemoryBudget*
+CMemoryBudget::instance ()
+{
+	static CMemoryBudget budget;
+	return &budget;
+}
+
+qint64
+CMemoryBudget::budget () const
+{
+	return m_budget;
+}
+
+void
+CMemoryBudget::setBudget (qint64 _bytes)
+{
+	m_budget = _bytes;
+	rebalance ();
+}
+
+void
+CMemoryBudget::registerClient (IClient* _client)
+{
+	Q_ASSERT (_client);
+
+	//
+	// New client is not shown yet, so it becomes the most recent background one
+	//
+	if (! m_clients.contains (_client))
+		m_clients.insert (m_clients.isEmpty () ? 0 : 1, _client);
+
+	rebalance ();
+}
+
+void
+CMemoryBudget::unregisterClient (IClient* _client)
+{
+	m_clients.removeAll (_client);
+	rebalance ();
+}
+
+void
+CMemoryBudget::setForeground (IClient* _client)
+{
+	m_clients.removeAll (_client);
+	m_clients.prepend (_client);
+
+	rebalance ();
+}
+
+void
+CMemoryBudget::rebalance ()
+{
+	if (m_clients.isEmpty ())
+		return;
+
+	//
+	// Background clients keep what they have in most-recently-active order
+	// while it fits into non-guaranteed part of the budget
+	//
+	qint64 background_budget = m_budget * (100 - FOREGROUND_SHARE) / 100;
+	qint64 background_used = 0;
+	for (int i = 1; i < m_clients.size (); ++i)
+	{
+		qint64 limit = qMin (m_clients.at (i)->cacheCost (), background_budget - background_used);
+		m_clients.at (i)->setCacheLimit (limit);
+		background_used += limit;
+	}
+
+	//
+	// Foreground client may use everything else
+	//
+	m_clients.first ()->setCacheLimit (m_budget - background_used);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file
+ * @brief Global memory budget for caches of all opened repositories interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CMEMORYBUDGET_H
+#define __QGITREPOVIEWER_CMEMORYBUDGET_H
+
+#include <QList>
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Distributes one cache memory budget between repository tabs
+	 *
+	 * Foreground client is always guaranteed FOREGROUND_SHARE of the budget; the rest is kept by
+	 * background clients in most-recently-active order, so the longest inactive tabs are trimmed first.
+	 * Used from GUI thread only.
+	 */
+	class CMemoryBudget
+	{
+	public:
+		/// Owner of trimmable cache
+		class IClient
+		{
+		public:
+			virtual ~IClient () {}
+
+			/// Return approximate size of cached data in bytes
+			virtual qint64 cacheCost () const = 0;
+
+			/// Shrink the cache to _max_cost bytes and keep it within this limit
+			virtual void setCacheLimit (qint64 _max_cost) = 0;
+		};
+
+		/// Default budget (bytes) and guaranteed foreground part of it (percents)
+		enum { DEFAULT_BUDGET_MB = 256, FOREGROUND_SHARE = 75 };
+
+	private:
+		/// Clients in most-recently-active order (foreground one is the first)
+		QList<IClient*> m_clients;
+
+		qint64 m_budget;
+
+		CMemoryBudget ();
+
+	public:
+		static CMemoryBudget* instance ();
+
+		qint64 budget () const;
+		void setBudget (qint64 _bytes);
+
+		void registerClient (IClient* _client);
+		void unregisterClient (IClient* _client);
+
+		/// Make specified client foreground one and redistribute budget
+		void setForeground (IClient* _client);
+
+		/// Recalculate cache limits of all clients
+		void rebalance ();
+	};
+}
+
+#endif // __QGITREPOVIEWER_CMEMORYBUDGET_H
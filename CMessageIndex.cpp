@@ -0,0 +1,752 @@
+/**
+ * @file
+ * @brief Persistent full-text index of commit messages implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CMessageIndex.h"
+
+#include <QFile>
+#include <QVarLengthArray>
+#include <QtEndian>
+
+#include <algorithm>
+#include <string.h>
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+/// Index file signature "MQIX"
+#define INDEX_SIGNATURE 0x5849514d
+
+/// Header: signature, version, counts of commits and tokens, sizes of strings and postings sections
+#define INDEX_HEADER_SIZE 32
+
+/// Token table entry: string offset and length, postings offset, size and the last commit number
+#define TOKEN_ENTRY_SIZE 24
+
+/// Size of buffer accumulating small writes
+#define WRITE_BUFFER_SIZE (1 << 20)
+
+namespace
+{
+	inline quint32 readUInt32 (const uchar* _data)
+	{
+		return qFromLittleEndian<quint32> (_data);
+	}
+
+	inline quint64 readUInt64 (const uchar* _data)
+	{
+		return qFromLittleEndian<quint64> (_data);
+	}
+
+	/// Letters, digits, '_' and any byte of multibyte UTF-8 sequence make words
+	inline bool isWordByte (char _c)
+	{
+		const uchar c = uchar (_c);
+		return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z'))
+				|| (c == '_') || (c >= 0x80);
+	}
+
+	/// Characters joining words into one token when they are between words: "jira-1234", "v1.2", "src/main"
+	inline bool isJoinByte (char _c)
+	{
+		return (_c == '-') || (_c == '.') || (_c == '/');
+	}
+
+	/// Lowercase ASCII copy of the token; longer tokens are skipped
+	void appendToken (QList<QByteArray>& _tokens, const char* _begin, const char* _end)
+	{
+		const int length = int (_end - _begin);
+		if ((length <= 0) || (length > CMessageIndex::MAX_TOKEN_LENGTH))
+			return;
+
+		QByteArray token (_begin, length);
+		char* data = token.data ();
+		for (int i = 0; i < length; ++i)
+			if ((data [i] >= 'A') && (data [i] <= 'Z'))
+				data [i] = char (data [i] - 'A' + 'a');
+
+		_tokens.append (token);
+	}
+
+	/// Compare tokens bytewise, shorter one first when one is a prefix of another
+	inline int compareTokens (const char* _a, int _a_size, const char* _b, int _b_size)
+	{
+		const int cmp = memcmp (_a, _b, qMin (_a_size, _b_size));
+		return (cmp != 0) ? cmp : (_a_size - _b_size);
+	}
+
+	struct CTokenLess
+	{
+		bool operator () (const QByteArray& _a, const QByteArray& _b) const
+		{
+			return compareTokens (_a.constData (), _a.size (), _b.constData (), _b.size ()) < 0;
+		}
+	};
+
+	/// Append commit numbers as base-128 differences from the previous one (starting from _base)
+	void encodePostings (const QVector<quint32>& _docs, quint32 _base, QByteArray& _bytes)
+	{
+		for (int i = 0; i < _docs.size (); ++i)
+		{
+			quint32 delta = _docs [i] - _base;
+			_base = _docs [i];
+
+			while (delta >= 0x80)
+			{
+				_bytes.append (char ((delta & 0x7f) | 0x80));
+				delta >>= 7;
+			}
+			_bytes.append (char (delta));
+		}
+	}
+
+	void decodePostings (const uchar* _data, quint32 _size, QVector<quint32>& _docs)
+	{
+		const uchar* end = _data + _size;
+		quint32 doc = 0;
+		while (_data < end)
+		{
+			quint32 delta = 0;
+			int shift = 0;
+			while ((_data < end) && (*_data & 0x80) && (shift < 32))
+			{
+				delta |= quint32 (*_data++ & 0x7f) << shift;
+				shift += 7;
+			}
+			if (_data < end)
+				delta |= quint32 (*_data++) << shift;
+
+			doc += delta;
+			_docs.append (doc);
+		}
+	}
+
+	/// Buffered little-endian writer
+	class CIndexWriter
+	{
+		QFile& m_file;
+		QByteArray m_buffer;
+		bool m_ok;
+
+	public:
+		explicit CIndexWriter (QFile& _file): m_file (_file), m_ok (true)
+		{
+			m_buffer.reserve (WRITE_BUFFER_SIZE);
+		}
+
+		void write (const void* _data, int _size)
+		{
+			if (m_buffer.size () + _size > WRITE_BUFFER_SIZE)
+				flush ();
+
+			if (_size > WRITE_BUFFER_SIZE)
+				m_ok = m_ok && (m_file.write (static_cast<const char*> (_data), _size) == _size);
+			else
+				m_buffer.append (static_cast<const char*> (_data), _size);
+		}
+
+		void writeUInt32 (quint32 _value)
+		{
+			uchar bytes [4];
+			qToLittleEndian (_value, bytes);
+			write (bytes, 4);
+		}
+
+		void writeUInt64 (quint64 _value)
+		{
+			uchar bytes [8];
+			qToLittleEndian (_value, bytes);
+			write (bytes, 8);
+		}
+
+		bool flush ()
+		{
+			if (! m_buffer.isEmpty ())
+			{
+				m_ok = m_ok && (m_file.write (m_buffer) == m_buffer.size ());
+				m_buffer.clear ();
+			}
+
+			return m_ok;
+		}
+	};
+
+	/// Orders numbers of added commits by their ids
+	struct CAddedDocLess
+	{
+		const CGitOidVector& m_ids;
+
+		explicit CAddedDocLess (const CGitOidVector& _ids): m_ids (_ids)
+		{}
+
+		bool operator () (quint32 _a, quint32 _b) const
+		{
+			return m_ids [int (_a)] < m_ids [int (_b)];
+		}
+	};
+
+	/// Token of the saved index: taken from mapped table, from added commits or from both
+	struct CMergedToken
+	{
+		int m_mapped;
+		int m_added;
+	};
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMessageIndex::CMessageIndex ():
+	m_file (NULL),
+	m_data (NULL),
+	m_doc_count (0),
+	m_token_count (0),
+	m_strings_size (0),
+	m_postings_size (0),
+	m_docs (NULL),
+	m_sorted_docs (NULL),
+	m_tokens (NULL),
+	m_strings (NULL),
+	m_postings (NULL)
+{}
+
+CMessageIndex::~CMessageIndex ()
+{
+	close ();
+}
+
+bool
+CMessageIndex::open (const QString& _path)
+{
+	close ();
+
+	m_file = new QFile (_path);
+	if (! m_file->open (QIODevice::ReadOnly) || (m_file->size () < INDEX_HEADER_SIZE))
+	{
+		close ();
+		return false;
+	}
+
+	m_data = m_file->map (0, m_file->size ());
+	if (! m_data || (readUInt32 (m_data) != INDEX_SIGNATURE) || (readUInt32 (m_data + 4) != FILE_VERSION))
+	{
+		close ();
+		return false;
+	}
+
+	//
+	// All sections must fit exactly into the file
+	//
+	const quint64 doc_count = readUInt32 (m_data + 8);
+	const quint64 token_count = readUInt32 (m_data + 12);
+	const quint64 strings_size = readUInt64 (m_data + 16);
+	const quint64 postings_size = readUInt64 (m_data + 24);
+	const quint64 tables_size = INDEX_HEADER_SIZE + doc_count * (CGitOid::RAW_SIZE + 4) + token_count * TOKEN_ENTRY_SIZE;
+	if ((strings_size > quint64 (m_file->size ())) || (postings_size > quint64 (m_file->size ()))
+		|| (tables_size + strings_size + postings_size != quint64 (m_file->size ())))
+	{
+		close ();
+		return false;
+	}
+
+	m_doc_count = quint32 (doc_count);
+	m_token_count = quint32 (token_count);
+	m_strings_size = strings_size;
+	m_postings_size = postings_size;
+	m_docs = m_data + INDEX_HEADER_SIZE;
+	m_sorted_docs = m_docs + doc_count * CGitOid::RAW_SIZE;
+	m_tokens = m_sorted_docs + doc_count * 4;
+	m_strings = m_tokens + token_count * TOKEN_ENTRY_SIZE;
+	m_postings = m_strings + strings_size;
+	return true;
+}
+
+void
+CMessageIndex::close ()
+{
+	// Deleting file unmaps it
+	delete m_file;
+	m_file = NULL;
+	m_data = NULL;
+
+	m_doc_count = 0;
+	m_token_count = 0;
+	m_strings_size = 0;
+	m_postings_size = 0;
+	m_docs = m_sorted_docs = m_tokens = m_strings = m_postings = NULL;
+
+	m_new_docs.clear ();
+	m_new_doc_set.clear ();
+	m_new_postings.clear ();
+}
+
+int
+CMessageIndex::count () const
+{
+	return int (m_doc_count) + m_new_docs.size ();
+}
+
+CGitOid
+CMessageIndex::docId (quint32 _doc) const
+{
+	if (_doc >= m_doc_count)
+		return m_new_docs [int (_doc - m_doc_count)];
+
+	CGitOid id;
+	memcpy (id.m_id, m_docs + qint64 (_doc) * CGitOid::RAW_SIZE, CGitOid::RAW_SIZE);
+	return id;
+}
+
+bool
+CMessageIndex::contains (const CGitOid& _id) const
+{
+	//
+	// Binary search in commit numbers ordered by id
+	//
+	quint32 low = 0;
+	quint32 high = m_doc_count;
+	while (low < high)
+	{
+		const quint32 middle = low + (high - low) / 2;
+		const quint32 doc = readUInt32 (m_sorted_docs + qint64 (middle) * 4);
+		if (doc >= m_doc_count)
+			break;
+
+		const int cmp = memcmp (m_docs + qint64 (doc) * CGitOid::RAW_SIZE, _id.m_id, CGitOid::RAW_SIZE);
+		if (cmp == 0)
+			return true;
+
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return m_new_doc_set.contains (_id);
+}
+
+void
+CMessageIndex::add (const CGitOid& _id, const QByteArray& _message)
+{
+	if (contains (_id))
+		return;
+
+	const quint32 doc = m_doc_count + quint32 (m_new_docs.size ());
+	m_new_docs.append (_id);
+	m_new_doc_set.insert (_id);
+
+	// Each token is listed once per commit
+	QSet<QByteArray> seen;
+	foreach (const QByteArray& token, tokenize (_message, false))
+	{
+		if (seen.contains (token))
+			continue;
+
+		seen.insert (token);
+		m_new_postings [token].append (doc);
+	}
+}
+
+bool
+CMessageIndex::hasChanges () const
+{
+	return ! m_new_docs.isEmpty ();
+}
+
+int
+CMessageIndex::findToken (const QByteArray& _token) const
+{
+	int low = 0;
+	int high = int (m_token_count);
+	while (low < high)
+	{
+		const int middle = low + (high - low) / 2;
+		const uchar* entry = m_tokens + qint64 (middle) * TOKEN_ENTRY_SIZE;
+		const quint32 offset = readUInt32 (entry);
+		const quint32 length = readUInt32 (entry + 4);
+		if (quint64 (offset) + length > m_strings_size)
+			return -1;
+
+		const int cmp = compareTokens (reinterpret_cast<const char*> (m_strings + offset), int (length),
+									   _token.constData (), _token.size ());
+		if (cmp == 0)
+			return middle;
+
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return -1;
+}
+
+QVector<quint32>
+CMessageIndex::postings (const QByteArray& _token) const
+{
+	QVector<quint32> docs;
+
+	const int mapped = findToken (_token);
+	if (mapped >= 0)
+	{
+		const uchar* entry = m_tokens + qint64 (mapped) * TOKEN_ENTRY_SIZE;
+		const quint64 offset = readUInt64 (entry + 8);
+		const quint32 size = readUInt32 (entry + 16);
+		if (offset + size <= m_postings_size)
+			decodePostings (m_postings + offset, size, docs);
+	}
+
+	// Added commits have greater numbers than mapped ones
+	QHash<QByteArray, QVector<quint32> >::const_iterator iAdded = m_new_postings.constFind (_token);
+	if (iAdded != m_new_postings.constEnd ())
+		docs += iAdded.value ();
+
+	return docs;
+}
+
+CGitOidVector
+CMessageIndex::find (const QString& _query) const
+{
+	CGitOidVector result;
+
+	QList<QByteArray> tokens = tokenize (_query.toUtf8 (), true);
+	if (tokens.isEmpty ())
+		return result;
+
+	//
+	// Intersect posting lists starting from the shortest one
+	//
+	QList<QVector<quint32> > lists;
+	foreach (const QByteArray& token, tokens.toSet ())
+	{
+		const QVector<quint32> docs = postings (token);
+		if (docs.isEmpty ())
+			return result;
+
+		lists.append (docs);
+	}
+
+	int shortest = 0;
+	for (int i = 1; i < lists.size (); ++i)
+		if (lists [i].size () < lists [shortest].size ())
+			shortest = i;
+
+	QVector<quint32> docs = lists.takeAt (shortest);
+	foreach (const QVector<quint32>& other, lists)
+	{
+		QVector<quint32> common (qMin (docs.size (), other.size ()));
+		common.resize (int (std::set_intersection (docs.constBegin (), docs.constEnd (),
+												   other.constBegin (), other.constEnd (), common.begin ())
+							- common.begin ()));
+		docs = common;
+	}
+
+	result.reserve (docs.size ());
+	foreach (quint32 doc, docs)
+		result.append (docId (doc));
+
+	return result;
+}
+
+QList<QByteArray>
+CMessageIndex::tokenize (const QByteArray& _text, bool _query)
+{
+	QList<QByteArray> tokens;
+
+	const char* p = _text.constData ();
+	const char* end = p + _text.size ();
+	QVarLengthArray<const char*, 16> word_begins;
+	QVarLengthArray<const char*, 16> word_ends;
+
+	while (p < end)
+	{
+		if (! isWordByte (*p))
+		{
+			++p;
+			continue;
+		}
+
+		//
+		// Collect the chain of words joined by '-', '.' or '/'
+		//
+		word_begins.clear ();
+		word_ends.clear ();
+		for (;;)
+		{
+			word_begins.append (p);
+			while ((p < end) && isWordByte (*p))
+				++p;
+			word_ends.append (p);
+
+			if ((p + 1 < end) && isJoinByte (*p) && isWordByte (p [1]))
+				++p;
+			else
+				break;
+		}
+
+		const int words = word_begins.size ();
+		const char* chain_begin = word_begins [0];
+		if (_query)
+		{
+			// Query looks up the whole chain; chain too long to be indexed falls back to its words
+			if (p - chain_begin <= MAX_TOKEN_LENGTH)
+				appendToken (tokens, chain_begin, p);
+			else
+				for (int i = 0; i < words; ++i)
+					appendToken (tokens, word_begins [i], word_ends [i]);
+
+			continue;
+		}
+
+		//
+		// Message gets every word and every part of the chain, so "see foo/jira-1234" is found by "jira-1234"
+		//
+		for (int first = 0; first < words; ++first)
+			for (int last = first; last < words; ++last)
+			{
+				if (word_ends [last] - word_begins [first] > MAX_TOKEN_LENGTH)
+					break;
+
+				appendToken (tokens, word_begins [first], word_ends [last]);
+			}
+	}
+
+	return tokens;
+}
+
+bool
+CMessageIndex::save (const QString& _path) const
+{
+	QFile file (_path);
+	if (! file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	//
+	// Merge mapped and added tokens keeping them sorted
+	//
+	QList<QByteArray> added = m_new_postings.keys ();
+	std::sort (added.begin (), added.end (), CTokenLess ());
+
+	QVector<CMergedToken> merged;
+	merged.reserve (int (m_token_count) + added.size ());
+	int mapped = 0;
+	int next_added = 0;
+	while ((mapped < int (m_token_count)) || (next_added < added.size ()))
+	{
+		CMergedToken token = { -1, -1 };
+		if (next_added == added.size ())
+			token.m_mapped = mapped++;
+		else if (mapped == int (m_token_count))
+			token.m_added = next_added++;
+		else
+		{
+			const uchar* entry = m_tokens + qint64 (mapped) * TOKEN_ENTRY_SIZE;
+			const int cmp = compareTokens (reinterpret_cast<const char*> (m_strings + readUInt32 (entry)),
+										   int (readUInt32 (entry + 4)),
+										   added [next_added].constData (), added [next_added].size ());
+			if (cmp <= 0)
+				token.m_mapped = mapped++;
+			if (cmp >= 0)
+				token.m_added = next_added++;
+		}
+		merged.append (token);
+	}
+
+	//
+	// Encode added lists: they continue mapped lists of the same tokens
+	//
+	QVector<QByteArray> encoded (added.size ());
+	quint64 strings_size = 0;
+	quint64 postings_size = 0;
+	foreach (const CMergedToken& token, merged)
+	{
+		quint32 base = 0;
+		if (token.m_mapped >= 0)
+		{
+			const uchar* entry = m_tokens + qint64 (token.m_mapped) * TOKEN_ENTRY_SIZE;
+			strings_size += readUInt32 (entry + 4);
+			postings_size += readUInt32 (entry + 16);
+			base = readUInt32 (entry + 20);
+		}
+
+		if (token.m_added >= 0)
+		{
+			const QByteArray& name = added [token.m_added];
+			encodePostings (m_new_postings.value (name), base, encoded [token.m_added]);
+			postings_size += encoded [token.m_added].size ();
+			if (token.m_mapped < 0)
+				strings_size += name.size ();
+		}
+	}
+
+	CIndexWriter writer (file);
+	const quint32 doc_count = m_doc_count + quint32 (m_new_docs.size ());
+
+	writer.writeUInt32 (INDEX_SIGNATURE);
+	writer.writeUInt32 (FILE_VERSION);
+	writer.writeUInt32 (doc_count);
+	writer.writeUInt32 (quint32 (merged.size ()));
+	writer.writeUInt64 (strings_size);
+	writer.writeUInt64 (postings_size);
+
+	//
+	// Commit ids by number, then numbers ordered by id
+	//
+	if (m_doc_count > 0)
+		writer.write (m_docs, int (m_doc_count) * CGitOid::RAW_SIZE);
+	foreach (const CGitOid& id, m_new_docs)
+		writer.write (id.m_id, CGitOid::RAW_SIZE);
+
+	QVector<quint32> added_docs (m_new_docs.size ());
+	for (int i = 0; i < added_docs.size (); ++i)
+		added_docs [i] = quint32 (i);
+	std::sort (added_docs.begin (), added_docs.end (), CAddedDocLess (m_new_docs));
+
+	int next_doc = 0;
+	for (quint32 i = 0; i < m_doc_count; ++i)
+	{
+		const quint32 doc = readUInt32 (m_sorted_docs + qint64 (i) * 4);
+		const uchar* id = m_docs + qint64 (doc) * CGitOid::RAW_SIZE;
+		for (; (next_doc < added_docs.size ())
+			   && (memcmp (m_new_docs [int (added_docs [next_doc])].m_id, id, CGitOid::RAW_SIZE) < 0); ++next_doc)
+			writer.writeUInt32 (m_doc_count + added_docs [next_doc]);
+
+		writer.writeUInt32 (doc);
+	}
+	for (; next_doc < added_docs.size (); ++next_doc)
+		writer.writeUInt32 (m_doc_count + added_docs [next_doc]);
+
+	//
+	// Token table, token strings and posting lists
+	//
+	quint32 string_offset = 0;
+	quint64 postings_offset = 0;
+	foreach (const CMergedToken& token, merged)
+	{
+		quint32 length = 0;
+		quint32 size = 0;
+		quint32 last = 0;
+		if (token.m_mapped >= 0)
+		{
+			const uchar* entry = m_tokens + qint64 (token.m_mapped) * TOKEN_ENTRY_SIZE;
+			length = readUInt32 (entry + 4);
+			size = readUInt32 (entry + 16);
+			last = readUInt32 (entry + 20);
+		}
+		if (token.m_added >= 0)
+		{
+			length = quint32 (added [token.m_added].size ());
+			size += quint32 (encoded [token.m_added].size ());
+			last = m_new_postings.value (added [token.m_added]).last ();
+		}
+
+		writer.writeUInt32 (string_offset);
+		writer.writeUInt32 (length);
+		writer.writeUInt64 (postings_offset);
+		writer.writeUInt32 (size);
+		writer.writeUInt32 (last);
+
+		string_offset += length;
+		postings_offset += size;
+	}
+
+	foreach (const CMergedToken& token, merged)
+	{
+		if (token.m_mapped >= 0)
+		{
+			const uchar* entry = m_tokens + qint64 (token.m_mapped) * TOKEN_ENTRY_SIZE;
+			writer.write (m_strings + readUInt32 (entry), int (readUInt32 (entry + 4)));
+		}
+		else
+			writer.write (added [token.m_added].constData (), added [token.m_added].size ());
+	}
+
+	foreach (const CMergedToken& token, merged)
+	{
+		if (token.m_mapped >= 0)
+		{
+			const uchar* entry = m_tokens + qint64 (token.m_mapped) * TOKEN_ENTRY_SIZE;
+			writer.write (m_postings + readUInt64 (entry + 8), int (readUInt32 (entry + 16)));
+		}
+		if (token.m_added >= 0)
+			writer.write (encoded [token.m_added].constData (), encoded [token.m_added].size ());
+	}
+
+	if (! writer.flush ())
+	{
+		file.remove ();
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CMessageIndexJob::CMessageIndexJob (const QString& _repo_path, const QString& _index_path,
+									const CGitOidVector& _commits, QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_index_path (_index_path),
+	m_commits (_commits),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_done (-1)
+{}
+
+bool
+CMessageIndexJob::step ()
+{
+	if (m_done < 0)
+	{
+		// Index is optional: without repository there is nothing to add
+		if (! m_repo.open (m_repo_path, true))
+			return false;
+
+		m_pack_reader.open (QFile::decodeName (git_repository_path (m_repo.handle ())) + "objects");
+		m_index.open (m_index_path);
+		m_done = 0;
+	}
+
+	//
+	// Read messages of commits which are not indexed yet
+	//
+	const int end = qMin (m_done + int (STEP_SIZE), m_commits.size ());
+	QByteArray message;
+	for (; m_done < end; ++m_done)
+	{
+		const CGitOid& id = m_commits [m_done];
+		if (m_index.contains (id))
+			continue;
+
+		CGitCommit commit;
+		if (m_pack_reader.readMessage (id, message))
+			m_index.add (id, message);
+		else if (m_repo.lookupCommit (id, commit))
+			m_index.add (id, commit.m_comment.toUtf8 ());
+	}
+
+	if (m_done < m_commits.size ())
+		return true;
+
+	//
+	// Receiver maps the current file, so the merged index is written aside (into a file of its own:
+	// other tabs may index the same repository) and swapped by it
+	//
+	QString new_path;
+	if (m_index.hasChanges ())
+	{
+		new_path = createTemporaryFile (m_index_path);
+		if (! new_path.isEmpty () && !m_index.save (new_path))
+		{
+			QFile::remove (new_path);
+			new_path.clear ();
+		}
+	}
+
+	// Current file must be unmapped before receiver replaces it
+	m_index.close ();
+	if (! new_path.isEmpty ())
+		post (m_receiver, "updateMessageIndex", Q_ARG (int, m_generation), Q_ARG (QString, new_path));
+
+	return false;
+}
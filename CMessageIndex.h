@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @brief Persistent full-text index of commit messages interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CMESSAGEINDEX_H
+#define __QGITREPOVIEWER_CMESSAGEINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+#include "CPackCommitReader.h"
+
+class QFile;
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Inverted index of full commit messages of a repository
+	 *
+	 * Every token of a message (lowercased word, or chain of words joined by '-', '.' or '/' like "jira-1234")
+	 * is mapped to the list of commits containing it. Commits are numbered in the order they were added,
+	 * and the lists keep base-128 encoded differences of these numbers; so commits added later are appended
+	 * to the stored lists without decoding them.
+	 *
+	 * The index file is memory-mapped and searched in place. Added commits are kept in memory
+	 * until save() writes the merged index into a new file.
+	 *
+	 * An instance must be used by one thread at a time.
+	 */
+	class CMessageIndex
+	{
+		QFile* m_file;
+		const uchar* m_data;
+
+		/// Counts of commits and tokens in mapped file
+		quint32 m_doc_count;
+		quint32 m_token_count;
+
+		/// Sizes of variable-length sections of mapped file
+		quint64 m_strings_size;
+		quint64 m_postings_size;
+
+		/// Sections of mapped file
+		const uchar* m_docs;
+		const uchar* m_sorted_docs;
+		const uchar* m_tokens;
+		const uchar* m_strings;
+		const uchar* m_postings;
+
+		/// Commits added after open(); their numbers continue the mapped ones
+		CGitOidVector m_new_docs;
+		QSet<CGitOid> m_new_doc_set;
+		QHash<QByteArray, QVector<quint32> > m_new_postings;
+
+		/// Number of mapped token equal to specified one or -1
+		int findToken (const QByteArray& _token) const;
+
+		/// Id of commit with specified number
+		CGitOid docId (quint32 _doc) const;
+
+		/// Decode numbers of commits containing the token
+		QVector<quint32> postings (const QByteArray& _token) const;
+
+	public:
+		/// Longer tokens (e.g. base64 blobs) are not indexed
+		enum { MAX_TOKEN_LENGTH = 64 };
+
+		/// Format version of index file
+		enum { FILE_VERSION = 1 };
+
+		CMessageIndex ();
+		~CMessageIndex ();
+
+		/// Map existing index file; missing or invalid file gives an empty index
+		bool open (const QString& _path);
+		void close ();
+
+		/// Count of indexed commits
+		int count () const;
+
+		/// Check whether the commit is indexed
+		bool contains (const CGitOid& _id) const;
+
+		/// Index message of the commit
+		void add (const CGitOid& _id, const QByteArray& _message);
+
+		/// Check whether commits were added after open()
+		bool hasChanges () const;
+
+		/// Write mapped and added commits into a new index file
+		bool save (const QString& _path) const;
+
+		/// Commits which messages contain all words of the query
+		CGitOidVector find (const QString& _query) const;
+
+		/// Split UTF-8 text into tokens; query gets only the longest chains, message gets every word too
+		static QList<QByteArray> tokenize (const QByteArray& _text, bool _query);
+
+	private:
+		Q_DISABLE_COPY (CMessageIndex)
+	};
+
+	/**
+	 * @brief Adds messages of not yet indexed commits to the message index on worker pool
+	 *
+	 * The new index is written next to the old one; receiver must have slot updateMessageIndex(int,QString)
+	 * which gets the generation passed to constructor and the path of the written file.
+	 */
+	class CMessageIndexJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		QString m_index_path;
+		CGitOidVector m_commits;
+		QObject* m_receiver;
+		int m_generation;
+
+		CGitRepository m_repo;
+		CPackCommitReader m_pack_reader;
+		CMessageIndex m_index;
+
+		/// Count of processed commits, -1 before the first step
+		int m_done;
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of commits read per step
+		enum { STEP_SIZE = 4096 };
+
+		CMessageIndexJob (const QString& _repo_path, const QString& _index_path, const CGitOidVector& _commits,
+						  QObject* _receiver, int _generation);
+	};
+}
+
+#endif // __QGITREPOVIEWER_CMESSAGEINDEX_H
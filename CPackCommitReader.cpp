@@ -0,0 +1,426 @@
+/**
+ * @file
+ * @brief Reader of commit headers directly from mapped pack files implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CPackCommitReader.h"
+
+#include <QDir>
+#include <QFile>
+
+#include <string.h>
+#include <limits.h>
+#include <zlib.h>
+
+using namespace QGitRepoViewer;
+
+/// Pack index version 2 signature "\377tOc"
+#define IDX_SIGNATURE 0xff744f63
+#define IDX_VERSION 2
+
+/// Size of index header: signature, version and fan-out table of 256 entries
+#define IDX_HEADER_SIZE (8 + 256 * 4)
+
+/// Pack ends with SHA-1 checksum of its contents
+#define PACK_TRAILER_SIZE 20
+
+/// Pack object types of commit and of the last not deltified one (tag); deltas follow
+#define PACK_OBJ_COMMIT 1
+#define PACK_OBJ_TAG 4
+
+namespace
+{
+	inline quint32 readUInt32 (const uchar* _data)
+	{
+		return (quint32 (_data [0]) << 24) | (quint32 (_data [1]) << 16) | (quint32 (_data [2]) << 8) | quint32 (_data [3]);
+	}
+
+	inline int hexValue (char _c)
+	{
+		if ((_c >= '0') && (_c <= '9'))
+			return _c - '0';
+		if ((_c >= 'a') && (_c <= 'f'))
+			return _c - 'a' + 10;
+
+		return -1;
+	}
+
+	/// Parse 40 lowercase hex digits of object id
+	bool parseOid (const char* _begin, const char* _end, CGitOid& _oid)
+	{
+		if (_end - _begin < CGitOid::HEX_SIZE)
+			return false;
+
+		for (int i = 0; i < CGitOid::RAW_SIZE; ++i)
+		{
+			const int high = hexValue (_begin [2 * i]);
+			const int low = hexValue (_begin [2 * i + 1]);
+			if ((high < 0) || (low < 0))
+				return false;
+
+			_oid.m_id [i] = uchar ((high << 4) | low);
+		}
+
+		return true;
+	}
+
+	/// Parse "Name <email> time zone" signature line body
+	bool parseSignature (const char* _begin, const char* _end, QString* _name, uint* _time)
+	{
+		const char* email_begin = static_cast<const char*> (memchr (_begin, '<', _end - _begin));
+		if (! email_begin)
+			return false;
+
+		const char* email_end = email_begin;
+		for (const char* p = _end; p > email_begin; --p)
+			if (p [-1] == '>')
+			{
+				email_end = p - 1;
+				break;
+			}
+		if (email_end == email_begin)
+			return false;
+
+		if (_name)
+		{
+			const char* name_end = email_begin;
+			while ((name_end > _begin) && (name_end [-1] == ' '))
+				--name_end;
+
+			*_name = QString::fromUtf8 (_begin, int (name_end - _begin))
+					 + QString (" <") + QString::fromUtf8 (email_begin + 1, int (email_end - email_begin - 1)) + ">";
+		}
+
+		if (_time)
+		{
+			uint time = 0;
+			const char* p = email_end + 1;
+			while ((p < _end) && (*p == ' '))
+				++p;
+			for (; (p < _end) && (*p >= '0') && (*p <= '9'); ++p)
+				time = time * 10 + uint (*p - '0');
+
+			*_time = time;
+		}
+
+		return true;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CPackCommitReader::CPackCommitReader ():
+	m_scratch_size (0),
+	m_zstream (new z_stream)
+{
+	memset (m_zstream, 0, sizeof (z_stream));
+	if (inflateInit (m_zstream) != Z_OK)
+	{
+		delete m_zstream;
+		m_zstream = NULL;
+	}
+}
+
+CPackCommitReader::~CPackCommitReader ()
+{
+	close ();
+
+	if (m_zstream)
+	{
+		inflateEnd (m_zstream);
+		delete m_zstream;
+	}
+}
+
+bool
+CPackCommitReader::open (const QString& _objects_dir)
+{
+	close ();
+	if (! m_zstream)
+		return false;
+
+	QDir pack_dir (_objects_dir + "/pack");
+	foreach (const QString& idx_name, pack_dir.entryList (QStringList () << "pack-*.idx", QDir::Files))
+		openPack (pack_dir.filePath (idx_name));
+
+	return isOpen ();
+}
+
+bool
+CPackCommitReader::openPack (const QString& _idx_path)
+{
+	CPack pack;
+	pack.m_idx_file = new QFile (_idx_path);
+	pack.m_pack_file = new QFile (_idx_path.left (_idx_path.length () - 4) + ".pack");
+	pack.m_idx = NULL;
+	pack.m_pack = NULL;
+
+	//
+	// Map both files entirely: pages are loaded only when commits are actually read
+	//
+	if (pack.m_idx_file->open (QIODevice::ReadOnly) && (pack.m_idx_file->size () >= IDX_HEADER_SIZE)
+		&& pack.m_pack_file->open (QIODevice::ReadOnly) && (pack.m_pack_file->size () > PACK_TRAILER_SIZE))
+	{
+		pack.m_idx = pack.m_idx_file->map (0, pack.m_idx_file->size ());
+		pack.m_pack = pack.m_pack_file->map (0, pack.m_pack_file->size ());
+	}
+
+	bool valid = pack.m_idx && pack.m_pack
+				 && (readUInt32 (pack.m_idx) == IDX_SIGNATURE) && (readUInt32 (pack.m_idx + 4) == IDX_VERSION);
+	if (valid)
+	{
+		// Last fan-out entry is the count of objects; check that all tables fit into the file
+		pack.m_count = readUInt32 (pack.m_idx + IDX_HEADER_SIZE - 4);
+		pack.m_pack_size = pack.m_pack_file->size ();
+		valid = (IDX_HEADER_SIZE + qint64 (pack.m_count) * (CGitOid::RAW_SIZE + 4 + 4) <= pack.m_idx_file->size ());
+	}
+
+	if (! valid)
+	{
+		delete pack.m_idx_file;
+		delete pack.m_pack_file;
+		return false;
+	}
+
+	m_packs.append (pack);
+	return true;
+}
+
+void
+CPackCommitReader::close ()
+{
+	foreach (const CPack& pack, m_packs)
+	{
+		// Deleting file unmaps it
+		delete pack.m_idx_file;
+		delete pack.m_pack_file;
+	}
+	m_packs.clear ();
+}
+
+bool
+CPackCommitReader::isOpen () const
+{
+	return ! m_packs.isEmpty ();
+}
+
+bool
+CPackCommitReader::findOffset (const CPack& _pack, const CGitOid& _id, quint64& _offset) const
+{
+	//
+	// Fan-out table gives the range of ids starting with the same byte
+	//
+	const uchar* fanout = _pack.m_idx + 8;
+	const uchar first = _id.m_id [0];
+	quint32 low = (first == 0) ? 0 : readUInt32 (fanout + (first - 1) * 4);
+	quint32 high = readUInt32 (fanout + first * 4);
+	if ((high > _pack.m_count) || (low > high))
+		return false;
+
+	const uchar* ids = _pack.m_idx + IDX_HEADER_SIZE;
+	while (low < high)
+	{
+		const quint32 middle = low + (high - low) / 2;
+		const int cmp = memcmp (ids + qint64 (middle) * CGitOid::RAW_SIZE, _id.m_id, CGitOid::RAW_SIZE);
+		if (cmp == 0)
+		{
+			// Skip id and CRC32 tables
+			const uchar* offsets = ids + qint64 (_pack.m_count) * (CGitOid::RAW_SIZE + 4);
+			const quint32 offset = readUInt32 (offsets + qint64 (middle) * 4);
+			if (! (offset & 0x80000000))
+			{
+				_offset = offset;
+				return true;
+			}
+
+			// Offsets above 2 Gb are kept in separate table of 64-bit values
+			const uchar* large = offsets + qint64 (_pack.m_count) * 4 + qint64 (offset & 0x7fffffff) * 8;
+			if (large + 8 > _pack.m_idx + _pack.m_idx_file->size ())
+				return false;
+
+			_offset = (quint64 (readUInt32 (large)) << 32) | readUInt32 (large + 4);
+			return true;
+		}
+
+		if (cmp < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return false;
+}
+
+bool
+CPackCommitReader::parseObjectHeader (const CPack& _pack, quint64 _offset, int& _type, quint64& _size, const uchar*& _data) const
+{
+	const quint64 data_end = quint64 (_pack.m_pack_size - PACK_TRAILER_SIZE);
+	if (_offset >= data_end)
+		return false;
+
+	//
+	// Object header: type in bits 4-6 of first byte, size in the rest as little-endian base-128 number
+	//
+	const uchar* p = _pack.m_pack + _offset;
+	const uchar* end = _pack.m_pack + data_end;
+	uchar c = *p++;
+	_type = (c >> 4) & 7;
+	_size = c & 0x0f;
+	int shift = 4;
+	while ((c & 0x80) && (p < end) && (shift < 64))
+	{
+		c = *p++;
+		_size |= quint64 (c & 0x7f) << shift;
+		shift += 7;
+	}
+
+	_data = p;
+	return (p < end);
+}
+
+bool
+CPackCommitReader::inflateCommit (const CPack& _pack, quint64 _offset)
+{
+	int type = 0;
+	quint64 size = 0;
+	const uchar* p = NULL;
+	const uchar* end = _pack.m_pack + (_pack.m_pack_size - PACK_TRAILER_SIZE);
+
+	// Deltas need the base object: leave them for libgit2
+	if (! parseObjectHeader (_pack, _offset, type, size, p) || (type != PACK_OBJ_COMMIT) || (size > MAX_COMMIT_SIZE))
+		return false;
+
+	if (m_scratch.size () < int (size))
+		m_scratch.resize (int (size));
+	m_scratch_size = 0;
+
+	inflateReset (m_zstream);
+	m_zstream->next_in = const_cast<uchar*> (p);
+	m_zstream->avail_in = uInt (qMin (quint64 (end - p), quint64 (UINT_MAX)));
+	m_zstream->next_out = reinterpret_cast<Bytef*> (m_scratch.data ());
+	m_zstream->avail_out = uInt (size);
+
+	const int result = ::inflate (m_zstream, Z_FINISH);
+	if (((result != Z_STREAM_END) && (result != Z_BUF_ERROR)) || (m_zstream->total_out != size))
+		return false;
+
+	m_scratch_size = int (size);
+	return true;
+}
+
+bool
+CPackCommitReader::parseCommit (const char* _data, int _size, CCommitHeader& _header)
+{
+	const char* p = _data;
+	const char* end = p + _size;
+
+	bool has_author = false;
+	bool has_committer = false;
+	_header.m_parents.clear ();
+
+	//
+	// Headers end with empty line; continuation lines (e.g. of gpgsig) begin with space
+	//
+	while (p < end)
+	{
+		const char* line_end = static_cast<const char*> (memchr (p, '\n', end - p));
+		if (! line_end)
+			line_end = end;
+
+		if (line_end == p)
+		{
+			++p;
+			break;
+		}
+
+		CGitOid parent;
+		if ((line_end - p > 7) && (memcmp (p, "parent ", 7) == 0) && parseOid (p + 7, line_end, parent))
+			_header.m_parents.append (parent);
+		else if ((line_end - p > 7) && (memcmp (p, "author ", 7) == 0))
+			has_author = parseSignature (p + 7, line_end, & _header.m_author, NULL);
+		else if ((line_end - p > 10) && (memcmp (p, "committer ", 10) == 0))
+			has_committer = parseSignature (p + 10, line_end, & _header.m_committer, & _header.m_time);
+
+		p = line_end + 1;
+	}
+
+	if (! has_author || !has_committer)
+		return false;
+
+	// Commit without message
+	if (p > end)
+		p = end;
+
+	const char* summary_end = static_cast<const char*> (memchr (p, '\n', end - p));
+	if (! summary_end)
+		summary_end = end;
+
+	_header.m_summary = QString::fromUtf8 (p, int (summary_end - p));
+	return true;
+}
+
+bool
+CPackCommitReader::inflate (const CGitOid& _id)
+{
+	for (int i = 0; i < m_packs.size (); ++i)
+	{
+		quint64 offset = 0;
+		if (! findOffset (m_packs [i], _id, offset))
+			continue;
+
+		// The same object may be stored in another pack in different form
+		if (inflateCommit (m_packs [i], offset))
+			return true;
+	}
+
+	return false;
+}
+
+bool
+CPackCommitReader::readHeader (const CGitOid& _id, CCommitHeader& _header)
+{
+	return inflate (_id) && parseCommit (m_scratch.constData (), m_scratch_size, _header);
+}
+
+bool
+CPackCommitReader::readMessage (const CGitOid& _id, QByteArray& _message)
+{
+	if (! inflate (_id))
+		return false;
+
+	_message = lastMessage ();
+	return true;
+}
+
+QByteArray
+CPackCommitReader::lastMessage () const
+{
+	//
+	// Message follows the first empty line
+	//
+	const char* data = m_scratch.constData ();
+	for (int i = 0; i + 1 < m_scratch_size; ++i)
+		if ((data [i] == '\n') && (data [i + 1] == '\n'))
+			return QByteArray (data + i + 2, m_scratch_size - i - 2);
+
+	return QByteArray ();
+}
+
+bool
+CPackCommitReader::locateObject (const CGitOid& _id, int& _type, quint64& _size, const uchar*& _data, qint64& _available) const
+{
+	foreach (const CPack& pack, m_packs)
+	{
+		quint64 offset = 0;
+		if (! findOffset (pack, _id, offset))
+			continue;
+
+		if (parseObjectHeader (pack, offset, _type, _size, _data) && (_type >= PACK_OBJ_COMMIT) && (_type <= PACK_OBJ_TAG))
+		{
+			_available = (pack.m_pack + pack.m_pack_size - PACK_TRAILER_SIZE) - _data;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file
+ * @brief Reader of commit headers directly from mapped pack files interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CPACKCOMMITREADER_H
+#define __QGITREPOVIEWER_CPACKCOMMITREADER_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "GitHelpers.h"
+
+class QFile;
+struct z_stream_s;
+
+namespace QGitRepoViewer
+{
+	/// Fields of commit object shown in the commit list
+	struct CCommitHeader
+	{
+		/// First line of commit message
+		QString m_summary;
+
+		/// Author and committer names and emails
+		QString m_author;
+		QString m_committer;
+
+		/// Committer time, seconds since epoch
+		uint m_time;
+
+		/// Ids of parent commits
+		CGitOidVector m_parents;
+
+		CCommitHeader (): m_time (0)
+		{}
+	};
+
+	/**
+	 * @brief Reads commit list columns without creating libgit2 objects
+	 *
+	 * Pack index and pack files of the repository are mapped into memory; a commit is found by binary search
+	 * in the index, inflated into a reusable scratch buffer and only its headers and summary line are parsed.
+	 * Loose objects, deltified commits and packs created after open() are not handled:
+	 * readHeader() returns false for them and the caller falls back to libgit2.
+	 *
+	 * An instance must be used by one thread at a time.
+	 */
+	class CPackCommitReader
+	{
+		/// One mapped pack with its version 2 index
+		struct CPack
+		{
+			QFile* m_idx_file;
+			QFile* m_pack_file;
+			const uchar* m_idx;
+			const uchar* m_pack;
+			qint64 m_pack_size;
+
+			/// Count of objects in pack
+			quint32 m_count;
+		};
+
+		QVector<CPack> m_packs;
+
+		/// Inflated commit object, reused between reads
+		QByteArray m_scratch;
+		int m_scratch_size;
+
+		z_stream_s* m_zstream;
+
+		bool openPack (const QString& _idx_path);
+
+		/// Find offset of object in pack using its index; false if pack doesn't contain it
+		bool findOffset (const CPack& _pack, const CGitOid& _id, quint64& _offset) const;
+
+		/// Parse type and size of the object at specified offset; _data points past the header
+		bool parseObjectHeader (const CPack& _pack, quint64 _offset, int& _type, quint64& _size, const uchar*& _data) const;
+
+		/// Inflate not deltified commit object at specified offset into scratch buffer
+		bool inflateCommit (const CPack& _pack, quint64 _offset);
+
+		/// Parse headers and summary line of inflated commit
+		static bool parseCommit (const char* _data, int _size, CCommitHeader& _header);
+
+		/// Inflate commit into scratch buffer looking it up in all packs
+		bool inflate (const CGitOid& _id);
+
+	public:
+		/// Bigger commits are left for libgit2
+		enum { MAX_COMMIT_SIZE = 1 << 20 };
+
+		CPackCommitReader ();
+		~CPackCommitReader ();
+
+		/// Map all packs of repository objects directory ("<git dir>/objects")
+		bool open (const QString& _objects_dir);
+		void close ();
+
+		bool isOpen () const;
+
+		/// Read list columns of commit; false if the commit is not in a mapped pack or can't be parsed
+		bool readHeader (const CGitOid& _id, CCommitHeader& _header);
+
+		/// Read full message of commit (raw bytes after the headers); false if the commit is not in a mapped pack
+		bool readMessage (const CGitOid& _id, QByteArray& _message);
+
+		/// Full message of the commit read last (by readHeader() or readMessage())
+		QByteArray lastMessage () const;
+
+		/**
+		 * @brief Find not deltified object of any type in mapped packs
+		 * @param _data start of the deflated object data in the mapped pack
+		 * @param _available count of mapped bytes from _data to the end of pack data
+		 * @return false if the object is not in a mapped pack or is stored as delta
+		 */
+		bool locateObject (const CGitOid& _id, int& _type, quint64& _size, const uchar*& _data, qint64& _available) const;
+
+	private:
+		Q_DISABLE_COPY (CPackCommitReader)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CPACKCOMMITREADER_H
@@ -0,0 +1,255 @@
+/**
+ * @file
+ * @brief Parallel search of commits changing text (git log -S/-G) implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CPickaxe.h"
+
+#include <QObject>
+
+#include <string.h>
+#include <git2.h>
+
+#include "CGrepModel.h"
+
+using namespace QGitRepoViewer;
+
+CPickaxeJob::CPickaxeJob (const CPickaxeSearchPtr& _search, QObject* _receiver, int _generation):
+	m_search (_search),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_pattern (_search->m_query.m_pattern),
+	m_lowercase (_search->m_query.m_pattern.caseSensitivity () == Qt::CaseInsensitive),
+	m_reader_repo (NULL)
+{
+	if (_search->m_query.m_mode == CPickaxeQuery::LineMode)
+		m_literal = CGrepModel::requiredLiteral (m_pattern);
+}
+
+int
+CPickaxeJob::countInBlob (const CGitOid& _blob)
+{
+	if (! m_reader.openBlob (_blob))
+		return -1;
+
+	//
+	// Occurrences are counted up to the end of the last one found in the chunk; the tail which may
+	// hold the beginning of the next one is counted with the next chunk
+	//
+	const QByteArray& text = m_search->m_query.m_text;
+	int count = 0;
+	int size = 0;
+	for (;;)
+	{
+		if (m_buffer.size () < size + CHUNK_SIZE)
+			m_buffer.resize (size + CHUNK_SIZE);
+
+		const int read = m_reader.read (m_buffer.data () + size, CHUNK_SIZE);
+		if (read < 0)
+		{
+			count = -1;
+			break;
+		}
+
+		// Tail is shorter than the string
+		if (read == 0)
+			break;
+
+		size += read;
+		const char* data = m_buffer.constData ();
+		const char* end = data + size;
+		const char* next = data;
+		for (const char* found; (found = CBlobReader::findLiteral (next, int (end - next), text)); next = found + text.size ())
+			++count;
+
+		const char* tail = qMax (next, end - (text.size () - 1));
+		size = int (end - tail);
+		memmove (m_buffer.data (), tail, size_t (size));
+
+		if (isCancelled ())
+			break;
+	}
+
+	m_reader.closeBlob ();
+	return count;
+}
+
+bool
+CPickaxeJob::changesCount (git_diff_list* _diff)
+{
+	const size_t delta_count = git_diff_num_deltas (_diff);
+	for (size_t i = 0; (i < delta_count) && !isCancelled (); ++i)
+	{
+		const git_diff_delta* delta = NULL;
+		if (git_diff_get_patch (NULL, & delta, _diff, i) != GIT_OK)
+			continue;
+
+		// Added file has no old blob, deleted one has no new blob; submodules are commits of other repositories
+		const git_diff_file& old_file = delta->old_file;
+		const git_diff_file& new_file = delta->new_file;
+		const bool has_old = !git_oid_iszero (& old_file.oid) && (old_file.mode != GIT_FILEMODE_COMMIT);
+		const bool has_new = !git_oid_iszero (& new_file.oid) && (new_file.mode != GIT_FILEMODE_COMMIT);
+
+		const int old_count = has_old ? countInBlob (CGitOid (& old_file.oid)) : 0;
+		if (old_count < 0)
+			continue;
+
+		const int new_count = has_new ? countInBlob (CGitOid (& new_file.oid)) : 0;
+		if ((new_count >= 0) && (new_count != old_count))
+			return true;
+	}
+
+	return false;
+}
+
+bool
+CPickaxeJob::matchesLine (const char* _line, int _length)
+{
+	if ((_length > 0) && (_line [_length - 1] == '\n'))
+		--_length;
+
+	//
+	// Lines without the literal required by the pattern are not matched by regular expression
+	//
+	if (! m_literal.isEmpty ())
+	{
+		const char* haystack = _line;
+		if (m_lowercase)
+		{
+			m_lower.resize (_length);
+			char* lower = m_lower.data ();
+			for (int i = 0; i < _length; ++i)
+				lower [i] = ((_line [i] >= 'A') && (_line [i] <= 'Z')) ? char (_line [i] + ('a' - 'A')) : _line [i];
+			haystack = lower;
+		}
+
+		if (! CBlobReader::findLiteral (haystack, _length, m_literal))
+			return false;
+	}
+
+	return (m_pattern.indexIn (QString::fromUtf8 (_line, _length)) >= 0);
+}
+
+bool
+CPickaxeJob::changesMatchingLine (git_diff_list* _diff)
+{
+	bool found = false;
+	const size_t delta_count = git_diff_num_deltas (_diff);
+	for (size_t i = 0; (i < delta_count) && !found && !isCancelled (); ++i)
+	{
+		git_diff_patch* patch = NULL;
+		const git_diff_delta* delta = NULL;
+		if (git_diff_get_patch (& patch, & delta, _diff, i) != GIT_OK)
+			continue;
+
+		// Binary files have no lines, as in git
+		const size_t hunk_count = (delta->flags & GIT_DIFF_FLAG_BINARY) ? 0 : git_diff_patch_num_hunks (patch);
+		for (size_t hunk = 0; (hunk < hunk_count) && !found; ++hunk)
+		{
+			const int line_count = git_diff_patch_num_lines_in_hunk (patch, hunk);
+			for (int line = 0; (line < line_count) && !found; ++line)
+			{
+				char origin = 0;
+				const char* content = NULL;
+				size_t length = 0;
+				int old_line = 0;
+				int new_line = 0;
+				if (git_diff_patch_get_line_in_hunk (& origin, & content, & length, & old_line, & new_line,
+													 patch, hunk, size_t (line)) != GIT_OK)
+					break;
+
+				if ((origin == GIT_DIFF_LINE_ADDITION) || (origin == GIT_DIFF_LINE_DELETION))
+					found = matchesLine (content, int (length));
+			}
+		}
+
+		git_diff_patch_free (patch);
+	}
+
+	return found;
+}
+
+bool
+CPickaxeJob::matchCommit (git_repository* _repo, const CGitOid& _commit)
+{
+	//
+	// Commit is compared with its first parent, root commit with the empty tree
+	//
+	git_commit* commit = NULL;
+	git_commit* parent = NULL;
+	git_tree* tree = NULL;
+	git_tree* parent_tree = NULL;
+	git_diff_list* diff = NULL;
+	int error_code = git_commit_lookup (& commit, _repo, _commit.raw ());
+	if ((error_code == GIT_OK) && (git_commit_parentcount (commit) > 0))
+	{
+		error_code = git_commit_parent (& parent, commit, 0);
+		if (error_code == GIT_OK)
+			error_code = git_commit_tree (& parent_tree, parent);
+	}
+	if (error_code == GIT_OK)
+		error_code = git_commit_tree (& tree, commit);
+	if (error_code == GIT_OK)
+		error_code = git_diff_tree_to_tree (& diff, _repo, parent_tree, tree, NULL);
+
+	bool result = false;
+	if (error_code == GIT_OK)
+		result = (m_search->m_query.m_mode == CPickaxeQuery::CountMode) ? changesCount (diff) : changesMatchingLine (diff);
+	else if (m_error.isEmpty ())
+		m_error = gitErrorString (error_code, QObject::tr ("diffing commit %1").arg (_commit.toString ()));
+
+	git_diff_list_free (diff);
+	git_tree_free (parent_tree);
+	git_tree_free (tree);
+	git_commit_free (parent);
+	git_commit_free (commit);
+
+	return result;
+}
+
+bool
+CPickaxeJob::step ()
+{
+	//
+	// Job may continue on another thread: its handle must be used then
+	//
+	CGitRepository* repo = CGitRepository::threadRepository (m_search->m_repo_path);
+	QString error;
+	if (! repo->isOpened ())
+		error = repo->lastError ();
+	else if ((m_search->m_query.m_mode == CPickaxeQuery::CountMode) && (repo != m_reader_repo))
+	{
+		m_reader_repo = repo;
+		if (! m_reader.open (repo))
+			error = m_reader.lastError ();
+	}
+
+	if (! error.isEmpty () || isCancelled ())
+	{
+		post (m_receiver, "finishPickaxeJob", Q_ARG (int, m_generation), Q_ARG (QString, error));
+		return false;
+	}
+
+	//
+	// Commits are taken in batches: jobs which get small commits take more of them
+	//
+	const int count = m_search->m_commits.size ();
+	const int first = m_search->m_first + m_search->m_next.fetchAndAddOrdered (BATCH_SIZE);
+	const int last = qMin (first + BATCH_SIZE, count);
+	QVector<int> matches;
+	for (int i = first; (i < last) && !isCancelled (); ++i)
+	{
+		if (matchCommit (repo->handle (), m_search->m_commits.at (i)))
+			matches.append (i);
+	}
+
+	if (last > first)
+		post (m_receiver, "addPickaxeMatches", Q_ARG (int, m_generation), Q_ARG (QVector<int>, matches),
+			  Q_ARG (int, last - first));
+
+	if (last < count)
+		return true;
+
+	post (m_receiver, "finishPickaxeJob", Q_ARG (int, m_generation), Q_ARG (QString, m_error));
+	return false;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file
+ * @brief Parallel search of commits changing text (git log -S/-G) interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CPICKAXE_H
+#define __QGITREPOVIEWER_CPICKAXE_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QRegExp>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+#include "CBlobReader.h"
+
+struct git_diff_list;
+struct git_repository;
+
+namespace QGitRepoViewer
+{
+	/// What pickaxe search looks for in changes of commits
+	struct CPickaxeQuery
+	{
+		enum Mode
+		{
+			/// Count of occurrences of the string differs in the file before and after commit (-S)
+			CountMode,
+
+			/// Added or deleted line matches the regular expression (-G)
+			LineMode
+		};
+
+		Mode m_mode;
+		QByteArray m_text;
+		QRegExp m_pattern;
+
+		CPickaxeQuery (): m_mode (CountMode)
+		{}
+
+		bool isValid () const
+		{
+			return (m_mode == CountMode) ? !m_text.isEmpty () : (m_pattern.isValid () && !m_pattern.isEmpty ());
+		}
+	};
+
+	/// State shared by all jobs of one pickaxe search
+	struct CPickaxeSearch
+	{
+		QString m_repo_path;
+		CPickaxeQuery m_query;
+
+		/// Commits in load order; those from m_first are searched
+		CGitOidVector m_commits;
+		int m_first;
+
+		/// Index of the next not taken commit
+		QAtomicInt m_next;
+
+		CPickaxeSearch (): m_first (0)
+		{}
+	};
+
+	typedef QSharedPointer<CPickaxeSearch> CPickaxeSearchPtr;
+
+	/**
+	 * @brief One of the jobs diffing commits with their first parents for pickaxe search
+	 *
+	 * All jobs of a search take batches of commits from the shared counter, so they finish together.
+	 * Receiver slot addPickaxeMatches(int,QVector<int>,int) gets indices of matching commits and the count
+	 * of checked ones after every batch, finishPickaxeJob(int,QString) is called once when the job ends.
+	 */
+	class CPickaxeJob : public CBackgroundJob
+	{
+		CPickaxeSearchPtr m_search;
+		QObject* m_receiver;
+		int m_generation;
+
+		QRegExp m_pattern;
+
+		/// Literal required by -G pattern (lowercase if pattern is case insensitive)
+		QByteArray m_literal;
+		bool m_lowercase;
+
+		/// Reader uses repository handle of the thread which opened it
+		CBlobReader m_reader;
+		CGitRepository* m_reader_repo;
+
+		QByteArray m_buffer;
+		QByteArray m_lower;
+
+		/// The first error met; search goes on with other commits
+		QString m_error;
+
+		/// Occurrences of the -S string in the blob; -1 if it can't be read
+		int countInBlob (const CGitOid& _blob);
+
+		/// Whether the commit changes count of -S string in any file
+		bool changesCount (git_diff_list* _diff);
+
+		/// Whether the line (with or without line break) matches -G pattern
+		bool matchesLine (const char* _line, int _length);
+
+		/// Whether the commit adds or deletes a line matching -G pattern
+		bool changesMatchingLine (git_diff_list* _diff);
+
+		/// Whether the commit matches the query; m_error is set if it can't be diffed
+		bool matchCommit (git_repository* _repo, const CGitOid& _commit);
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of commits taken at once
+		enum { BATCH_SIZE = 32 };
+
+		/// Size of blob chunk counted at once
+		enum { CHUNK_SIZE = 256 * 1024 };
+
+		CPickaxeJob (const CPickaxeSearchPtr& _search, QObject* _receiver, int _generation);
+	};
+}
+
+#endif // __QGITREPOVIEWER_CPICKAXE_H
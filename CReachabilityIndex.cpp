@@ -0,0 +1,635 @@
+/**
+ * @file
+ * @brief Reachability index of commits from branches and tags implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CReachabilityIndex.h"
+
+#include <QBitArray>
+#include <QFile>
+#include <QObject>
+#include <QtEndian>
+
+#include <algorithm>
+#include <string.h>
+#include <git2.h>
+
+using namespace QGitRepoViewer;
+
+/// Index file in the git directory
+#define REACHABILITY_FILE "qgitrepoviewer-reach.idx"
+
+/// Index file signature "QRCH"
+#define REACHABILITY_SIGNATURE 0x48435251
+
+/// Header: signature, version, counts of commits, tips, ranges and refs, size of ref names, reserved
+#define REACHABILITY_HEADER_SIZE 32
+
+/// Records: commit position and generation; tip position, generation, first range and count of ranges;
+/// range; ref tip id, tip index and kind
+#define COMMIT_RECORD_SIZE 8
+#define TIP_RECORD_SIZE 16
+#define RANGE_RECORD_SIZE 8
+#define REF_RECORD_SIZE (CGitOid::RAW_SIZE + 8)
+
+namespace
+{
+	inline quint32 readUInt32 (const uchar* _data)
+	{
+		return qFromLittleEndian<quint32> (_data);
+	}
+
+	inline void appendUInt32 (QByteArray& _bytes, quint32 _value)
+	{
+		uchar bytes [4];
+		qToLittleEndian (_value, bytes);
+		_bytes.append (reinterpret_cast<const char*> (bytes), 4);
+	}
+
+	/// Refs are kept sorted by kind and name
+	bool refLessThan (const CReachabilityRef& _left, const CReachabilityRef& _right)
+	{
+		if (_left.m_kind != _right.m_kind)
+			return (_left.m_kind < _right.m_kind);
+
+		return (_left.m_name < _right.m_name);
+	}
+
+	/// Orders indices of commits by their ids
+	struct COidIndexLess
+	{
+		const CGitOidVector& m_commits;
+
+		COidIndexLess (const CGitOidVector& _commits): m_commits (_commits)
+		{}
+
+		bool operator() (int _left, int _right) const
+		{
+			return (m_commits [_left] < m_commits [_right]);
+		}
+	};
+
+	/// Union of two sorted lists of disjoint ranges, joining adjacent ones
+	CPositionRangeList uniteRanges (const CPositionRangeList& _first, const CPositionRangeList& _second)
+	{
+		CPositionRangeList result;
+		result.reserve (_first.size () + _second.size ());
+
+		int i = 0;
+		int j = 0;
+		while ((i < _first.size ()) || (j < _second.size ()))
+		{
+			const bool take_first = (j == _second.size ())
+									|| ((i < _first.size ()) && (_first [i].m_low <= _second [j].m_low));
+			const CPositionRange& range = take_first ? _first [i++] : _second [j++];
+			if (! result.isEmpty () && (range.m_low <= result.last ().m_high + 1))
+				result.last ().m_high = qMax (result.last ().m_high, range.m_high);
+			else
+				result.append (range);
+		}
+
+		return result;
+	}
+}
+
+CReachabilityIndex::CReachabilityIndex ():
+	m_file (NULL),
+	m_commit_count (0),
+	m_tip_count (0),
+	m_range_count (0),
+	m_oids (NULL),
+	m_commits (NULL),
+	m_tips (NULL),
+	m_ranges (NULL)
+{}
+
+CReachabilityIndex::~CReachabilityIndex ()
+{
+	close ();
+}
+
+QString
+CReachabilityIndex::filePath (const QString& _git_dir)
+{
+	return _git_dir + REACHABILITY_FILE;
+}
+
+bool
+CReachabilityIndex::open (const QString& _git_dir)
+{
+	close ();
+
+	m_file = new QFile (filePath (_git_dir));
+	const uchar* data = NULL;
+	if (m_file->open (QIODevice::ReadOnly) && (m_file->size () >= REACHABILITY_HEADER_SIZE))
+		data = m_file->map (0, m_file->size ());
+	if (! data || (readUInt32 (data) != REACHABILITY_SIGNATURE) || (readUInt32 (data + 4) != FILE_VERSION))
+	{
+		close ();
+		return false;
+	}
+
+	//
+	// Tables and ref names must fit exactly into the file
+	//
+	const quint64 commit_count = readUInt32 (data + 8);
+	const quint64 tip_count = readUInt32 (data + 12);
+	const quint64 range_count = readUInt32 (data + 16);
+	const quint64 ref_count = readUInt32 (data + 20);
+	const quint64 names_size = readUInt32 (data + 24);
+	const quint64 tables_size = REACHABILITY_HEADER_SIZE + commit_count * (CGitOid::RAW_SIZE + COMMIT_RECORD_SIZE)
+								+ tip_count * TIP_RECORD_SIZE + range_count * RANGE_RECORD_SIZE + ref_count * REF_RECORD_SIZE;
+	if (tables_size + names_size != quint64 (m_file->size ()))
+	{
+		close ();
+		return false;
+	}
+
+	m_commit_count = quint32 (commit_count);
+	m_tip_count = quint32 (tip_count);
+	m_range_count = quint32 (range_count);
+	m_oids = data + REACHABILITY_HEADER_SIZE;
+	m_commits = m_oids + commit_count * CGitOid::RAW_SIZE;
+	m_tips = m_commits + commit_count * COMMIT_RECORD_SIZE;
+	m_ranges = m_tips + tip_count * TIP_RECORD_SIZE;
+
+	for (quint64 tip = 0; tip < tip_count; ++tip)
+	{
+		const uchar* record = m_tips + tip * TIP_RECORD_SIZE;
+		if (quint64 (readUInt32 (record + 8)) + readUInt32 (record + 12) > range_count)
+		{
+			close ();
+			return false;
+		}
+	}
+
+	//
+	// Refs are few compared to commits: they are parsed at once
+	//
+	const uchar* refs = m_ranges + range_count * RANGE_RECORD_SIZE;
+	const QList<QByteArray> names = QByteArray::fromRawData (reinterpret_cast<const char*> (data + tables_size),
+															 int (names_size)).split ('\0');
+	for (quint64 i = 0; i < ref_count; ++i)
+	{
+		const uchar* record = refs + i * REF_RECORD_SIZE;
+		const quint32 tip = readUInt32 (record + CGitOid::RAW_SIZE);
+		if ((tip >= tip_count) || (int (i) >= names.size ()))
+		{
+			close ();
+			return false;
+		}
+
+		CReachabilityRef ref;
+		ref.m_name = QString::fromUtf8 (names [int (i)]);
+		ref.m_kind = int (readUInt32 (record + CGitOid::RAW_SIZE + 4));
+		memcpy (ref.m_tip.m_id, record, CGitOid::RAW_SIZE);
+		m_refs.append (ref);
+		m_ref_tips.append (int (tip));
+	}
+
+	return true;
+}
+
+void
+CReachabilityIndex::close ()
+{
+	// Deleting file unmaps it
+	delete m_file;
+	m_file = NULL;
+	m_commit_count = m_tip_count = m_range_count = 0;
+	m_oids = m_commits = m_tips = m_ranges = NULL;
+	m_refs.clear ();
+	m_ref_tips.clear ();
+}
+
+bool
+CReachabilityIndex::isOpen () const
+{
+	return (m_file != NULL);
+}
+
+const CReachabilityRefList&
+CReachabilityIndex::refs () const
+{
+	return m_refs;
+}
+
+bool
+CReachabilityIndex::findCommit (const CGitOid& _commit, quint32& _position, quint32& _generation) const
+{
+	quint32 low = 0;
+	quint32 high = m_commit_count;
+	while (low < high)
+	{
+		const quint32 middle = low + (high - low) / 2;
+		const int result = memcmp (m_oids + quint64 (middle) * CGitOid::RAW_SIZE, _commit.m_id, CGitOid::RAW_SIZE);
+		if (result == 0)
+		{
+			const uchar* record = m_commits + quint64 (middle) * COMMIT_RECORD_SIZE;
+			_position = readUInt32 (record);
+			_generation = readUInt32 (record + 4);
+			return true;
+		}
+
+		if (result < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return false;
+}
+
+bool
+CReachabilityIndex::containingRefs (const CGitOid& _commit, QVector<int>& _refs) const
+{
+	_refs.clear ();
+
+	quint32 position = 0;
+	quint32 generation = 0;
+	if (! findCommit (_commit, position, generation))
+		return false;
+
+	QBitArray contained (int (m_tip_count));
+	for (quint32 tip = 0; tip < m_tip_count; ++tip)
+	{
+		//
+		// A tip with lower position or generation than the commit can't be its descendant; others are looked up in ranges
+		//
+		const uchar* record = m_tips + quint64 (tip) * TIP_RECORD_SIZE;
+		if ((readUInt32 (record) < position) || (readUInt32 (record + 4) < generation))
+			continue;
+
+		const uchar* ranges = m_ranges + quint64 (readUInt32 (record + 8)) * RANGE_RECORD_SIZE;
+		quint32 low = 0;
+		quint32 high = readUInt32 (record + 12);
+		while (low < high)
+		{
+			const quint32 middle = low + (high - low) / 2;
+			if (readUInt32 (ranges + quint64 (middle) * RANGE_RECORD_SIZE) <= position)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+
+		// The last range starting not after the position
+		if ((low > 0) && (readUInt32 (ranges + quint64 (low - 1) * RANGE_RECORD_SIZE + 4) >= position))
+			contained.setBit (int (tip));
+	}
+
+	for (int ref = 0; ref < m_refs.size (); ++ref)
+	{
+		if (contained.testBit (m_ref_tips [ref]))
+			_refs.append (ref);
+	}
+
+	return true;
+}
+
+CReachabilityRefList
+CReachabilityIndex::currentRefs (CGitRepository& _repo)
+{
+	CReachabilityRefList refs;
+	foreach (const CGitBranch& branch, _repo.enumBranches (false))
+	{
+		refs.append (CReachabilityRef (branch.m_shorthand_name,
+									   branch.m_is_remote ? CReachabilityRef::RemoteBranch : CReachabilityRef::LocalBranch,
+									   CGitOid::fromString (branch.m_id)));
+	}
+
+	const CGitTagMap tags = _repo.enumCommitTags ();
+	for (CGitTagMap::const_iterator iTag = tags.constBegin (); iTag != tags.constEnd (); ++iTag)
+	{
+		foreach (const QString& name, iTag.value ())
+			refs.append (CReachabilityRef (name, CReachabilityRef::Tag, iTag.key ()));
+	}
+
+	std::sort (refs.begin (), refs.end (), refLessThan);
+	return refs;
+}
+
+bool
+CReachabilityIndex::save (const QString& _path, const CGitOidVector& _commits, const QVector<int>& _positions,
+						  const QVector<int>& _generations, const CReachabilityRefList& _refs,
+						  const QVector<int>& _ref_tips, const QVector<int>& _tip_commits,
+						  const QVector<CPositionRangeList>& _tip_ranges)
+{
+	QFile file (_path);
+	if (! file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+
+	QVector<int> order (_commits.size ());
+	for (int i = 0; i < order.size (); ++i)
+		order [i] = i;
+	std::sort (order.begin (), order.end (), COidIndexLess (_commits));
+
+	QByteArray oids;
+	QByteArray commits;
+	oids.reserve (order.size () * CGitOid::RAW_SIZE);
+	commits.reserve (order.size () * COMMIT_RECORD_SIZE);
+	foreach (int commit, order)
+	{
+		oids.append (reinterpret_cast<const char*> (_commits [commit].m_id), CGitOid::RAW_SIZE);
+		appendUInt32 (commits, quint32 (_positions [commit]));
+		appendUInt32 (commits, quint32 (_generations [commit]));
+	}
+
+	QByteArray tips;
+	QByteArray ranges;
+	quint32 range_count = 0;
+	for (int tip = 0; tip < _tip_commits.size (); ++tip)
+	{
+		const int commit = _tip_commits [tip];
+		appendUInt32 (tips, quint32 (_positions [commit]));
+		appendUInt32 (tips, quint32 (_generations [commit]));
+		appendUInt32 (tips, range_count);
+		appendUInt32 (tips, quint32 (_tip_ranges [tip].size ()));
+		foreach (const CPositionRange& range, _tip_ranges [tip])
+		{
+			appendUInt32 (ranges, range.m_low);
+			appendUInt32 (ranges, range.m_high);
+		}
+		range_count += quint32 (_tip_ranges [tip].size ());
+	}
+
+	QByteArray refs;
+	QByteArray names;
+	for (int ref = 0; ref < _refs.size (); ++ref)
+	{
+		refs.append (reinterpret_cast<const char*> (_refs [ref].m_tip.m_id), CGitOid::RAW_SIZE);
+		appendUInt32 (refs, quint32 (_ref_tips [ref]));
+		appendUInt32 (refs, quint32 (_refs [ref].m_kind));
+		names.append (_refs [ref].m_name.toUtf8 ());
+		names.append ('\0');
+	}
+
+	QByteArray header;
+	appendUInt32 (header, REACHABILITY_SIGNATURE);
+	appendUInt32 (header, FILE_VERSION);
+	appendUInt32 (header, quint32 (order.size ()));
+	appendUInt32 (header, quint32 (_tip_commits.size ()));
+	appendUInt32 (header, range_count);
+	appendUInt32 (header, quint32 (_refs.size ()));
+	appendUInt32 (header, quint32 (names.size ()));
+	appendUInt32 (header, 0);
+
+	if ((file.write (header) != header.size ()) || (file.write (oids) != oids.size ())
+		|| (file.write (commits) != commits.size ()) || (file.write (tips) != tips.size ())
+		|| (file.write (ranges) != ranges.size ()) || (file.write (refs) != refs.size ())
+		|| (file.write (names) != names.size ()))
+	{
+		file.remove ();
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CReachabilityJob::CReachabilityJob (const QString& _repo_path, QObject* _receiver, int _generation):
+	m_repo_path (_repo_path),
+	m_receiver (_receiver),
+	m_generation (_generation),
+	m_phase (PHASE_START),
+	m_read (0),
+	m_next_tip (0),
+	m_next_position (0)
+{}
+
+bool
+CReachabilityJob::start (QString& _error)
+{
+	if (! m_repo.open (m_repo_path, true))
+	{
+		_error = m_repo.lastError ();
+		return false;
+	}
+
+	m_git_dir = QFile::decodeName (git_repository_path (m_repo.handle ()));
+	m_refs = CReachabilityIndex::currentRefs (m_repo);
+
+	CReachabilityIndex existing;
+	if (existing.open (m_git_dir) && (existing.refs () == m_refs))
+		return false;
+
+	//
+	// Refs pointing to the same commit share its tip
+	//
+	m_reader.open (m_git_dir + "objects");
+	foreach (const CReachabilityRef& ref, m_refs)
+	{
+		const int commit = commitIndex (ref.m_tip);
+		QHash<int, int>::const_iterator iTip = m_tip_indices.constFind (commit);
+		if (iTip == m_tip_indices.constEnd ())
+		{
+			iTip = m_tip_indices.insert (commit, m_tip_commits.size ());
+			m_tip_commits.append (commit);
+		}
+		m_ref_tips.append (iTip.value ());
+	}
+	m_tip_ranges.resize (m_tip_commits.size ());
+
+	return true;
+}
+
+int
+CReachabilityJob::commitIndex (const CGitOid& _commit)
+{
+	QHash<CGitOid, int>::const_iterator iCommit = m_commit_indices.constFind (_commit);
+	if (iCommit != m_commit_indices.constEnd ())
+		return iCommit.value ();
+
+	m_commit_indices.insert (_commit, m_commits.size ());
+	m_commits.append (_commit);
+	return m_commits.size () - 1;
+}
+
+void
+CReachabilityJob::readCommits ()
+{
+	CGitOidVector parents;
+	CCommitHeader header;
+	const int end = qMin (m_read + int (STEP_SIZE), m_commits.size ());
+	for (; m_read < end; ++m_read)
+	{
+		//
+		// Packed commits are parsed in place; commits missing in shallow clones become roots
+		//
+		const CGitOid id = m_commits [m_read];
+		parents.clear ();
+		if (m_reader.readHeader (id, header))
+			parents = header.m_parents;
+		else
+		{
+			git_commit* commit = NULL;
+			if (git_commit_lookup (& commit, m_repo.handle (), id.raw ()) == GIT_OK)
+			{
+				const unsigned int parent_count = git_commit_parentcount (commit);
+				for (unsigned int i = 0; i < parent_count; ++i)
+					parents.append (CGitOid (git_commit_parent_id (commit, i)));
+			}
+			git_commit_free (commit);
+		}
+
+		foreach (const CGitOid& parent, parents)
+			m_parents.append (commitIndex (parent));
+		m_parent_ends.append (m_parents.size ());
+	}
+}
+
+void
+CReachabilityJob::leaveCommit (int _commit)
+{
+	const int position = m_next_position++;
+	m_positions [_commit] = position;
+
+	//
+	// Ancestors are the union of ancestors of parents and the walk subtree of the commit
+	//
+	CPositionRangeList ranges;
+	int generation = 1;
+	const int parents_begin = (_commit > 0) ? m_parent_ends [_commit - 1] : 0;
+	for (int i = parents_begin; i < m_parent_ends [_commit]; ++i)
+	{
+		const int parent = m_parents [i];
+		if (m_positions [parent] < 0)
+			continue;
+
+		generation = qMax (generation, m_generations [parent] + 1);
+		ranges = ranges.isEmpty () ? m_ranges [parent] : uniteRanges (ranges, m_ranges [parent]);
+
+		// Ranges of a parent are dropped after its last child, so a list taken from it is extended in place
+		if (--m_children_left [parent] == 0)
+			m_ranges [parent] = CPositionRangeList ();
+	}
+	m_generations [_commit] = generation;
+
+	// All positions from the lowest of the subtree are ancestors, so ranges starting there are absorbed
+	const quint32 low = quint32 (m_low [_commit]);
+	while (! ranges.isEmpty () && (ranges.last ().m_low >= low))
+		ranges.removeLast ();
+	if (! ranges.isEmpty () && (ranges.last ().m_high + 1 >= low))
+		ranges.last ().m_high = quint32 (position);
+	else
+		ranges.append (CPositionRange (low, quint32 (position)));
+
+	if (m_children_left [_commit] > 0)
+		m_ranges [_commit] = ranges;
+
+	QHash<int, int>::const_iterator iTip = m_tip_indices.constFind (_commit);
+	if (iTip != m_tip_indices.constEnd ())
+		m_tip_ranges [iTip.value ()] = ranges;
+}
+
+bool
+CReachabilityJob::numberCommits ()
+{
+	for (int numbered = 0; numbered < STEP_SIZE; )
+	{
+		if (m_stack.isEmpty ())
+		{
+			while ((m_next_tip < m_tip_commits.size ()) && (m_low [m_tip_commits [m_next_tip]] >= 0))
+				++m_next_tip;
+			if (m_next_tip == m_tip_commits.size ())
+				return false;
+
+			const int tip = m_tip_commits [m_next_tip];
+			m_low [tip] = m_next_position;
+			m_stack.append (qMakePair (tip, (tip > 0) ? m_parent_ends [tip - 1] : 0));
+			continue;
+		}
+
+		//
+		// Parents are entered first parent first; a commit is left when all its parents are numbered
+		//
+		const int commit = m_stack.last ().first;
+		const int next_parent = m_stack.last ().second;
+		if (next_parent < m_parent_ends [commit])
+		{
+			++m_stack.last ().second;
+			const int parent = m_parents [next_parent];
+			if (m_low [parent] < 0)
+			{
+				m_low [parent] = m_next_position;
+				m_stack.append (qMakePair (parent, (parent > 0) ? m_parent_ends [parent - 1] : 0));
+			}
+			continue;
+		}
+
+		m_stack.removeLast ();
+		leaveCommit (commit);
+		++numbered;
+	}
+
+	return true;
+}
+
+bool
+CReachabilityJob::step ()
+{
+	QString error;
+	switch (m_phase)
+	{
+		case PHASE_START:
+			if (! start (error))
+			{
+				post (m_receiver, "updateReachabilityIndex", Q_ARG (int, m_generation), Q_ARG (QString, QString ()),
+					  Q_ARG (QString, error));
+				return false;
+			}
+			m_phase = PHASE_READ;
+			return true;
+
+		case PHASE_READ:
+			readCommits ();
+			if (m_read < m_commits.size ())
+				return true;
+
+			m_commit_indices.clear ();
+			m_reader.close ();
+
+			m_low.fill (-1, m_commits.size ());
+			m_positions.fill (-1, m_commits.size ());
+			m_generations.fill (0, m_commits.size ());
+			m_ranges.resize (m_commits.size ());
+			m_children_left.fill (0, m_commits.size ());
+			foreach (int parent, m_parents)
+				++m_children_left [parent];
+
+			m_phase = PHASE_NUMBER;
+			return true;
+
+		case PHASE_NUMBER:
+			if (numberCommits ())
+				return true;
+
+			m_ranges.clear ();
+			m_phase = PHASE_SAVE;
+			return true;
+
+		case PHASE_SAVE:
+		{
+			//
+			// The view maps the current file, so the new one is written aside (into a file of its own:
+			// other tabs may index the same repository) and swapped by receiver
+			//
+			const QString index_path = CReachabilityIndex::filePath (m_git_dir);
+			const QString new_path = createTemporaryFile (index_path);
+			if (new_path.isEmpty ())
+				error = QObject::tr ("Can't write reachability index %1").arg (index_path);
+			else if (! CReachabilityIndex::save (new_path, m_commits, m_positions, m_generations, m_refs,
+												 m_ref_tips, m_tip_commits, m_tip_ranges))
+			{
+				QFile::remove (new_path);
+				error = QObject::tr ("Can't write reachability index %1").arg (new_path);
+			}
+
+			post (m_receiver, "updateReachabilityIndex", Q_ARG (int, m_generation),
+				  Q_ARG (QString, error.isEmpty () ? new_path : QString ()), Q_ARG (QString, error));
+			return false;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file
+ * @brief Reachability index of commits from branches and tags interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CREACHABILITYINDEX_H
+#define __QGITREPOVIEWER_CREACHABILITYINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QVector>
+
+#include "GitHelpers.h"
+#include "CWorkerPool.h"
+#include "CPackCommitReader.h"
+
+class QFile;
+
+namespace QGitRepoViewer
+{
+	/// Branch or tag which commits are indexed
+	struct CReachabilityRef
+	{
+		enum Kind { LocalBranch = 0, RemoteBranch, Tag };
+
+		QString m_name;
+		int m_kind;
+		CGitOid m_tip;
+
+		CReachabilityRef (): m_kind (LocalBranch)
+		{}
+
+		CReachabilityRef (const QString& _name, int _kind, const CGitOid& _tip): m_name (_name), m_kind (_kind), m_tip (_tip)
+		{}
+
+		bool operator== (const CReachabilityRef& _other) const
+		{
+			return (m_kind == _other.m_kind) && (m_tip == _other.m_tip) && (m_name == _other.m_name);
+		}
+	};
+
+	typedef QList<CReachabilityRef> CReachabilityRefList;
+
+	/// Closed range of commit positions
+	struct CPositionRange
+	{
+		quint32 m_low;
+		quint32 m_high;
+
+		CPositionRange (): m_low (0), m_high (0)
+		{}
+
+		CPositionRange (quint32 _low, quint32 _high): m_low (_low), m_high (_high)
+		{}
+	};
+}
+
+Q_DECLARE_TYPEINFO (QGitRepoViewer::CPositionRange, Q_PRIMITIVE_TYPE);
+
+namespace QGitRepoViewer
+{
+	/// Sorted disjoint ranges of positions of commits reachable from one commit
+	typedef QVector<CPositionRange> CPositionRangeList;
+
+	/**
+	 * @brief Which branches and tags contain a commit, answered without walking history
+	 *
+	 * Commits reachable from refs are numbered in post-order of depth-first walk over parents, so all ancestors
+	 * of a commit have smaller positions and most of them form a few contiguous ranges. For every ref tip
+	 * the file keeps the ranges of positions of its ancestors (a run-length reachability bitmap) together
+	 * with its generation number: a tip with lower generation or position can't contain the commit,
+	 * others are checked by binary search in their ranges. The file is written into the git directory
+	 * by CReachabilityJob and memory-mapped.
+	 *
+	 * An instance must be used by one thread at a time.
+	 */
+	class CReachabilityIndex
+	{
+		QFile* m_file;
+
+		quint32 m_commit_count;
+		quint32 m_tip_count;
+		quint32 m_range_count;
+
+		/// Sorted commit ids, their positions and generations, tips and ranges of their ancestors
+		const uchar* m_oids;
+		const uchar* m_commits;
+		const uchar* m_tips;
+		const uchar* m_ranges;
+
+		/// Refs and indices of their tips
+		CReachabilityRefList m_refs;
+		QVector<int> m_ref_tips;
+
+		/// Position and generation of the commit; false if it is not indexed
+		bool findCommit (const CGitOid& _commit, quint32& _position, quint32& _generation) const;
+
+	public:
+		/// Format version of the index file
+		enum { FILE_VERSION = 1 };
+
+		CReachabilityIndex ();
+		~CReachabilityIndex ();
+
+		/// Map the index file of repository with specified git directory
+		bool open (const QString& _git_dir);
+		void close ();
+
+		bool isOpen () const;
+
+		/// Refs (sorted by kind and name) with tips they had when the index was built
+		const CReachabilityRefList& refs () const;
+
+		/**
+		 * @brief Find refs containing the commit
+		 * @param _refs indices of refs() containing the commit
+		 * @return false if the commit is not indexed
+		 */
+		bool containingRefs (const CGitOid& _commit, QVector<int>& _refs) const;
+
+		/// Branches and tags of the repository sorted as refs()
+		static CReachabilityRefList currentRefs (CGitRepository& _repo);
+
+		/// Write the index of commits numbered by the walk
+		static bool save (const QString& _path, const CGitOidVector& _commits, const QVector<int>& _positions,
+						  const QVector<int>& _generations, const CReachabilityRefList& _refs,
+						  const QVector<int>& _ref_tips, const QVector<int>& _tip_commits,
+						  const QVector<CPositionRangeList>& _tip_ranges);
+
+		/// Path of the index file in the git directory
+		static QString filePath (const QString& _git_dir);
+
+	private:
+		Q_DISABLE_COPY (CReachabilityIndex)
+	};
+
+	/**
+	 * @brief Builds reachability index of all branches and tags on worker pool
+	 *
+	 * Nothing is built if the index file has the same refs with the same tips. Otherwise commits reachable
+	 * from the tips are read (from mapped packs when possible), numbered by depth-first walk and ranges
+	 * of ancestors of the tips are merged from ranges of their parents, so each commit is visited once.
+	 * Receiver slot updateReachabilityIndex(int,QString,QString) gets the path of the written file
+	 * (empty if the existing file is up to date) and the error, if any.
+	 */
+	class CReachabilityJob : public CBackgroundJob
+	{
+		QString m_repo_path;
+		QObject* m_receiver;
+		int m_generation;
+
+		CGitRepository m_repo;
+		CPackCommitReader m_reader;
+		QString m_git_dir;
+
+		enum Phase { PHASE_START, PHASE_READ, PHASE_NUMBER, PHASE_SAVE };
+		Phase m_phase;
+
+		CReachabilityRefList m_refs;
+		QVector<int> m_ref_tips;
+		QVector<int> m_tip_commits;
+
+		/// Commits in order of discovery, parents of each of them (as indices) end at m_parent_ends
+		CGitOidVector m_commits;
+		QHash<CGitOid, int> m_commit_indices;
+		QVector<int> m_parents;
+		QVector<int> m_parent_ends;
+		int m_read;
+
+		/// Depth-first walk: commit and its next parent on the stack, next tip to start from, next position
+		QVector<QPair<int, int> > m_stack;
+		int m_next_tip;
+		int m_next_position;
+
+		/// Next position when commit is entered (the lowest one of its walk subtree) and its own position, -1 before
+		QVector<int> m_low;
+		QVector<int> m_positions;
+		QVector<int> m_generations;
+
+		/// Ranges of ancestors of commits which children are not numbered yet, and of the tips
+		QVector<int> m_children_left;
+		QVector<CPositionRangeList> m_ranges;
+		QHash<int, int> m_tip_indices;
+		QVector<CPositionRangeList> m_tip_ranges;
+
+		/// Enumerate refs and their tips; false if the existing file has the same ones
+		bool start (QString& _error);
+
+		/// Index of the commit, adding it to the list of commits to read
+		int commitIndex (const CGitOid& _commit);
+
+		/// Read parents of the next commits
+		void readCommits ();
+
+		/// Number the commit when all its parents are numbered
+		void leaveCommit (int _commit);
+
+		/// Continue depth-first walk; false when all commits are numbered
+		bool numberCommits ();
+
+	protected:
+		bool step ();
+
+	public:
+		/// Count of commits read or numbered per step
+		enum { STEP_SIZE = 4096 };
+
+		CReachabilityJob (const QString& _repo_path, QObject* _receiver, int _generation);
+	};
+}
+
+#endif // __QGITREPOVIEWER_CREACHABILITYINDEX_H
@@ -0,0 +1,1329 @@
+/**
+ * @file
+ * @brief Tab with branches and commits of one git repository implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+
+#include "CRepoTab.h"
+
+#include "CCommitModel.h"
+#include "CBranchModel.h"
+#include "CCommitItemDelegate.h"
+#include "CDateDialog.h"
+#include "CHistoryFilterDialog.h"
+#include "CBlameView.h"
+#include "CTreeModel.h"
+#include "CGrepModel.h"
+#include "CPickaxe.h"
+
+#include <QDir>
+#include <QSettings>
+#include <QHeaderView>
+#include <QAction>
+#include <QDateTime>
+#include <QMenu>
+#include <QActionGroup>
+#include <QToolTip>
+#include <QInputDialog>
+#include <QTreeView>
+#include <QCursor>
+#include <QItemSelectionModel>
+
+using namespace QGitRepoViewer;
+
+#define GIT_REPO_KEY "repos/last"
+#define BRANCH_KEY "ui/branch-index"
+#define COMMIT_KEY "ui/commit-index"
+#define FILTER_KEY "ui/filter-index"
+#define COMMIT_ID_KEY "ui/commit-id"
+#define SNAPSHOT_KEY "ui/snapshot"
+#define SORT_COLUMN_KEY "ui/sort-column"
+#define SORT_ORDER_KEY "ui/sort-order"
+#define BRANCH_NAME_KEY "ui/branch-name"
+#define BRANCH_SORT_KEY "ui/branch-sort-column"
+
+/// Filter criteria item searching full commit messages (the others are commit table columns)
+#define FULL_MESSAGE_FILTER 3
+
+/// Count of ambiguous commits offered for abbreviated SHA-1 id
+#define MAX_PREFIX_MATCHES 16
+
+/// Count of commits on each side of the selected one which details are computed in advance
+#define PREFETCH_NEIGHBOURS 3
+
+/// Bounds of the count of rows saved in warm-start snapshot
+#define SNAPSHOT_MIN_ROWS 64
+#define SNAPSHOT_MAX_ROWS 256
+
+// Branch list popup shows details of tips next to names
+#define BRANCH_POPUP_MIN_WIDTH 720
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CRepoTab::CRepoTab (QWidget* _parent):
+	QWidget (_parent),
+	m_branch_model (NULL),
+	m_commit_model (NULL),
+	m_pending_commit_row (SELECT_NONE),
+	m_pending_branch (0),
+	m_branches_menu (NULL),
+	m_compare_menu (NULL),
+	m_sort_branches_menu (NULL),
+	m_tree_model (NULL),
+	m_blame_view (NULL),
+	m_grep_model (NULL),
+	m_grep_view (NULL)
+{
+	//
+	// Initialize tab GUI from Qt *.ui file
+	//
+	m_ui.setupUi (this);
+
+	//
+	// Connect git repository local branches model to appropriate combobox
+	//
+	m_branch_model = new CBranchListModel (this);
+	m_ui.branch_list->setModel (m_branch_model);
+	connect (m_branch_model, SIGNAL (loadingFinished ()), this, SLOT (aboutBranchesLoaded ()));
+
+	//
+	// Combobox shows branch name; its popup shows details of tip commits filled in as they are read
+	//
+	QTreeView* branch_view = new QTreeView (m_ui.branch_list);
+	branch_view->setRootIsDecorated (false);
+	branch_view->setUniformRowHeights (true);
+	branch_view->setAllColumnsShowFocus (true);
+	branch_view->setMinimumWidth (BRANCH_POPUP_MIN_WIDTH);
+	m_ui.branch_list->setView (branch_view);
+	branch_view->header ()->resizeSection (CBranchListModel::_NameColumn, 200);
+	branch_view->header ()->resizeSection (CBranchListModel::_DateColumn, 120);
+	branch_view->header ()->resizeSection (CBranchListModel::_AuthorColumn, 120);
+	branch_view->header ()->resizeSection (CBranchListModel::_AheadBehindColumn, 130);
+
+	//
+	// Connect git repository commits model to appropriate tableview
+	//
+	m_commit_model = new CCommitTableModel (this);
+	m_ui.commit_list->setModel (m_commit_model);
+
+	//
+	// Paint commit rows from cached text layouts
+	//
+	CCommitItemDelegate* commit_delegate = new CCommitItemDelegate (m_ui.commit_list);
+	commit_delegate->install ();
+
+	//
+	// Model sorts itself by precomputed keys when user clicks the header; load order by default
+	//
+	m_ui.commit_list->setHeaderVisible (true);
+	m_ui.commit_list->header ()->setSortIndicator (CCommitTableModel::_ShortLogColumn, Qt::AscendingOrder);
+	m_ui.commit_list->setSortingEnabled (true);
+
+	//
+	// Filter commits by author of the selected one
+	//
+	QAction* author_filter_action = new QAction (tr ("Show only commits of this author"), m_ui.commit_list);
+	connect (author_filter_action, SIGNAL (triggered ()), this, SLOT (aboutFilterByAuthor ()));
+	QAction* date_filter_action = new QAction (tr ("Show commits in date range..."), m_ui.commit_list);
+	connect (date_filter_action, SIGNAL (triggered ()), this, SLOT (aboutFilterByDate ()));
+	QAction* history_filter_action = new QAction (tr ("Filter history..."), m_ui.commit_list);
+	connect (history_filter_action, SIGNAL (triggered ()), this, SLOT (aboutFilterHistory ()));
+	QAction* file_history_action = new QAction (tr ("Show history of file..."), m_ui.commit_list);
+	connect (file_history_action, SIGNAL (triggered ()), this, SLOT (aboutFileHistory ()));
+	QAction* grep_action = new QAction (tr ("Grep in files of this commit..."), m_ui.commit_list);
+	connect (grep_action, SIGNAL (triggered ()), this, SLOT (aboutGrepCommit ()));
+	QAction* pickaxe_count_action = new QAction (tr ("Find commits changing count of text (-S)..."), m_ui.commit_list);
+	connect (pickaxe_count_action, SIGNAL (triggered ()), this, SLOT (aboutPickaxeCount ()));
+	QAction* pickaxe_lines_action = new QAction (tr ("Find commits changing lines matching (-G)..."), m_ui.commit_list);
+	connect (pickaxe_lines_action, SIGNAL (triggered ()), this, SLOT (aboutPickaxeLines ()));
+	QAction* show_all_action = new QAction (tr ("Show all commits"), m_ui.commit_list);
+	connect (show_all_action, SIGNAL (triggered ()), this, SLOT (aboutShowAllCommits ()));
+
+	//
+	// Jump to the commit made at specified date
+	//
+	QAction* go_to_date_action = new QAction (tr ("Go to date..."), m_ui.commit_list);
+	go_to_date_action->setShortcut (QKeySequence (Qt::CTRL + Qt::Key_G));
+	go_to_date_action->setShortcutContext (Qt::WidgetWithChildrenShortcut);
+	connect (go_to_date_action, SIGNAL (triggered ()), this, SLOT (aboutGoToDate ()));
+
+	m_ui.commit_list->addAction (go_to_date_action);
+	m_ui.commit_list->addAction (author_filter_action);
+	m_ui.commit_list->addAction (date_filter_action);
+	m_ui.commit_list->addAction (history_filter_action);
+	m_ui.commit_list->addAction (file_history_action);
+	m_ui.commit_list->addAction (grep_action);
+	m_ui.commit_list->addAction (pickaxe_count_action);
+	m_ui.commit_list->addAction (pickaxe_lines_action);
+	m_ui.commit_list->addAction (show_all_action);
+	m_ui.commit_list->setContextMenuPolicy (Qt::ActionsContextMenu);
+
+	//
+	// Handle user click on commit: show commit hash in appropriate text field
+	//
+	connect (m_ui.commit_list->selectionModel (), SIGNAL (currentChanged (const QModelIndex&, const QModelIndex&)),
+			 this, SLOT (aboutCommitSelected (const QModelIndex&, const QModelIndex&)));
+
+	//
+	// Commits are loaded in background: select the pending commit when its row arrives
+	//
+	connect (m_commit_model, SIGNAL (rowsInserted (const QModelIndex&, int, int)),
+			 this, SLOT (aboutCommitsInserted (const QModelIndex&, int, int)));
+	connect (m_commit_model, SIGNAL (loadingFinished ()), this, SLOT (aboutCommitsLoaded ()));
+
+	//
+	// Pickaxe search shows its progress above the table while its filter is set
+	//
+	m_ui.pickaxe_bar->hide ();
+	connect (m_commit_model, SIGNAL (pickaxeProgress (int, int)), this, SLOT (aboutPickaxeProgress ()));
+	connect (m_commit_model, SIGNAL (pickaxeFinished ()), this, SLOT (aboutPickaxeProgress ()));
+	connect (m_ui.pickaxe_stop, SIGNAL (clicked ()), this, SLOT (aboutStopPickaxe ()));
+	connect (m_ui.pickaxe_clear, SIGNAL (clicked ()), this, SLOT (aboutClearPickaxe ()));
+
+	//
+	// Comparison of two branches shows counts of their unique commits and merge base
+	//
+	m_ui.compare_bar->hide ();
+	connect (m_commit_model, SIGNAL (mergeBasesFound ()), this, SLOT (aboutCompareProgress ()));
+	connect (m_commit_model, SIGNAL (loadingFinished ()), this, SLOT (aboutCompareProgress ()));
+	connect (m_ui.compare_base, SIGNAL (clicked ()), this, SLOT (aboutGoToMergeBase ()));
+	connect (m_ui.compare_close, SIGNAL (clicked ()), this, SLOT (aboutCloseCompare ()));
+
+	//
+	// Connect search widget to commits table (can search by brief commit description/author/date)
+	//
+	m_ui.commit_search->setView (m_ui.commit_list);
+
+	//
+	// Go to commit by its (abbreviated) SHA-1 id typed into the hash field
+	//
+	connect (m_ui.commit_hash, SIGNAL (returnPressed ()), this, SLOT (aboutCommitHashEntered ()));
+
+	//
+	// Patch of the selected commit scrolls to the file clicked in the list of changed files
+	//
+	connect (m_ui.commit_details, SIGNAL (itemClicked (QTreeWidgetItem*, int)),
+			 this, SLOT (aboutChangedFileSelected (QTreeWidgetItem*)));
+
+	//
+	// Files of the selected commit: directories are read when expanded
+	//
+	m_tree_model = new CTreeModel (this);
+	m_ui.commit_tree->setModel (m_tree_model);
+	m_ui.commit_tree->header ()->setStretchLastSection (false);
+#if QT_VERSION >= 0x050000
+	m_ui.commit_tree->header ()->setSectionResizeMode (CTreeModel::_NameColumn, QHeaderView::Stretch);
+#else
+	m_ui.commit_tree->header ()->setResizeMode (CTreeModel::_NameColumn, QHeaderView::Stretch);
+#endif
+	connect (m_ui.details_tabs, SIGNAL (currentChanged (int)), this, SLOT (aboutDetailsTabChanged (int)));
+	connect (m_ui.commit_tree->selectionModel (), SIGNAL (currentChanged (const QModelIndex&, const QModelIndex&)),
+			 this, SLOT (aboutTreeEntrySelected (const QModelIndex&)));
+
+	//
+	// Blame of a changed file follows the selected commit while its window is shown
+	//
+	QAction* blame_action = new QAction (tr ("Blame this file"), m_ui.commit_details);
+	connect (blame_action, SIGNAL (triggered ()), this, SLOT (aboutBlameFile ()));
+	m_ui.commit_details->addAction (blame_action);
+	m_ui.commit_details->setContextMenuPolicy (Qt::ActionsContextMenu);
+
+	//
+	// Combined log of several branches; filled when branch list is loaded
+	//
+	m_branches_menu = new QMenu (m_ui.branches_button);
+	m_compare_menu = new QMenu (tr ("Compare selected branch with"), m_branches_menu);
+
+	//
+	// Branch list is sorted by name until user chooses another order
+	//
+	m_sort_branches_menu = new QMenu (tr ("Sort branches by"), m_branches_menu);
+	QActionGroup* sort_group = new QActionGroup (m_sort_branches_menu);
+	QAction* sort_name_action = m_sort_branches_menu->addAction (tr ("Name"));
+	sort_name_action->setData (int (CBranchListModel::_NameColumn));
+	QAction* sort_date_action = m_sort_branches_menu->addAction (tr ("Recency"));
+	sort_date_action->setData (int (CBranchListModel::_DateColumn));
+	QAction* sort_ahead_action = m_sort_branches_menu->addAction (tr ("Commits ahead of HEAD"));
+	sort_ahead_action->setData (int (CBranchListModel::_AheadBehindColumn));
+	foreach (QAction* action, m_sort_branches_menu->actions ())
+	{
+		action->setCheckable (true);
+		action->setChecked (action->data ().toInt () == m_branch_model->sortColumn ());
+		sort_group->addAction (action);
+		connect (action, SIGNAL (triggered ()), this, SLOT (aboutSortBranches ()));
+	}
+
+	m_ui.branches_button->setMenu (m_branches_menu);
+	m_ui.branches_button->setEnabled (false);
+}
+
+CRepoTab::~CRepoTab ()
+{
+	//
+	// Disconnect commit search widget from commit table
+	//
+	m_ui.commit_search->setView (NULL);
+}
+
+QString
+CRepoTab::repoPath () const
+{
+	return m_repo_path;
+}
+
+void
+CRepoTab::openRepository (const QString& _path, int _branch_index)
+{
+	m_repo_path = _path;
+	m_pending_branch = _branch_index;
+	m_pending_branch_name.clear ();
+	showPlaceholder (tr ("Loading branches of %1...").arg (_path));
+
+	//
+	// Connect custom table model to git repository using its path
+	//
+	m_commit_model->clearPickaxeFilter ();
+	m_ui.pickaxe_bar->hide ();
+	m_ui.compare_bar->hide ();
+	m_commit_model->setGitRepo (m_repo_path);
+	m_ui.commit_details->setGitRepo (m_repo_path);
+	m_ui.commit_diff->setGitRepo (m_repo_path);
+	m_tree_model->setGitRepo (m_repo_path);
+	m_ui.file_preview->setGitRepo (m_repo_path);
+	m_ui.contained_in->setGitRepo (m_repo_path);
+	if (m_blame_view)
+	{
+		m_blame_view->hide ();
+		m_blame_view->setGitRepo (m_repo_path);
+	}
+	if (m_grep_model)
+	{
+		m_grep_view->hide ();
+		m_grep_model->setGitRepo (m_repo_path);
+	}
+
+	//
+	// Load the list of git repository branches; commits will be loaded after it
+	//
+	m_branch_model->loadFromGit (m_repo_path);
+}
+
+void
+CRepoTab::showPlaceholder (const QString& _text)
+{
+	m_ui.placeholder->setText (_text);
+	m_ui.commit_pages->setCurrentWidget (m_ui.placeholder_page);
+}
+
+void
+CRepoTab::aboutBranchesLoaded ()
+{
+	// Refs may have moved since the index of commits they contain was built
+	m_ui.contained_in->updateIndex ();
+
+	if (m_branch_model->empty ())
+	{
+		showPlaceholder (tr ("There are no branches in repository %1").arg (m_repo_path));
+		return;
+	}
+
+	//
+	// Rows of branches depend on sort order and on details of tips known so far: name is more reliable
+	//
+	int index = ((m_pending_branch >= 0) && (m_pending_branch < m_ui.branch_list->count ())) ? m_pending_branch : 0;
+	if (! m_pending_branch_name.isEmpty ())
+	{
+		const int row = m_branch_model->rowOf (m_pending_branch_name);
+		if (row >= 0)
+			index = row;
+		m_pending_branch_name.clear ();
+	}
+
+	//
+	// Snapshot of another branch or of moved branch tip can't be shown any longer
+	//
+	if (m_commit_model->isSnapshot ())
+	{
+		const CGitBranch& branch = m_branch_model->branch (index);
+		if ((branch.m_shorthand_name != m_commit_model->snapshotBranch ())
+				|| (CGitOid::fromString (branch.m_id) != m_commit_model->snapshotTip ()))
+			m_commit_model->discardSnapshot ();
+	}
+
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+
+	fillBranchesMenu ();
+	selectBranch (index);
+}
+
+void
+CRepoTab::fillBranchesMenu ()
+{
+	m_branches_menu->clear ();
+	m_compare_menu->clear ();
+
+	QAction* all_action = m_branches_menu->addAction (tr ("Show all branches"));
+	connect (all_action, SIGNAL (triggered ()), this, SLOT (aboutShowAllBranches ()));
+	m_branches_menu->addMenu (m_compare_menu);
+	m_branches_menu->addMenu (m_sort_branches_menu);
+	m_branches_menu->addSeparator ();
+
+	for (int row = 0; row < m_branch_model->rowCount (); ++row)
+	{
+		const QString name = m_branch_model->branch (row).m_shorthand_name;
+		QAction* action = m_branches_menu->addAction (name);
+		action->setCheckable (true);
+		action->setData (name);
+		connect (action, SIGNAL (triggered ()), this, SLOT (aboutBranchesChecked ()));
+
+		QAction* compare_action = m_compare_menu->addAction (name);
+		compare_action->setData (name);
+		connect (compare_action, SIGNAL (triggered ()), this, SLOT (aboutCompareBranch ()));
+	}
+
+	m_ui.branches_button->setEnabled (m_branch_model->rowCount () > 1);
+}
+
+void
+CRepoTab::checkSelectedBranch ()
+{
+	const int selected = m_ui.branch_list->currentIndex ();
+	const QString selected_name = (selected >= 0) && (selected < m_branch_model->rowCount ())
+								  ? m_branch_model->branch (selected).m_shorthand_name : QString ();
+
+	foreach (QAction* action, m_branches_menu->actions ())
+	{
+		if (action->isCheckable ())
+			action->setChecked (action->data ().toString () == selected_name);
+	}
+}
+
+void
+CRepoTab::aboutBranchesChecked ()
+{
+	QStringList branch_names;
+	foreach (QAction* action, m_branches_menu->actions ())
+	{
+		if (action->isCheckable () && action->isChecked ())
+			branch_names.append (action->data ().toString ());
+	}
+
+	//
+	// One branch (or none) is the usual log of the branch selected in the list
+	//
+	if (branch_names.size () <= 1)
+	{
+		const int row = branch_names.isEmpty () ? m_ui.branch_list->currentIndex ()
+												: m_branch_model->rowOf (branch_names.first ());
+		selectBranch (qMax (row, 0));
+		return;
+	}
+
+	// Keep selected commit when it is contained in any of checked branches
+	m_pending_commit_id = selectedCommitId ();
+	if (m_pending_commit_id.isEmpty ())
+		m_pending_commit_row = SELECT_FIRST_ROW;
+
+	m_commit_model->setCommitList (branch_names);
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+
+	aboutCompareProgress ();
+}
+
+void
+CRepoTab::aboutCompareBranch ()
+{
+	QAction* action = qobject_cast<QAction*> (sender ());
+	const int selected = m_ui.branch_list->currentIndex ();
+	if (! action || (selected < 0) || (selected >= m_branch_model->rowCount ()))
+		return;
+
+	const QString left = m_branch_model->branch (selected).m_shorthand_name;
+	const QString right = action->data ().toString ();
+	if (left == right)
+		return;
+
+	// Keep selected commit when it is unique to either branch
+	m_pending_commit_id = selectedCommitId ();
+	if (m_pending_commit_id.isEmpty ())
+		m_pending_commit_row = SELECT_FIRST_ROW;
+
+	m_commit_model->setCompareList (left, right);
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+
+	aboutCompareProgress ();
+}
+
+void
+CRepoTab::aboutCompareProgress ()
+{
+	if (! m_commit_model->isComparison ())
+	{
+		m_ui.compare_bar->hide ();
+		return;
+	}
+
+	const QStringList branches = m_commit_model->branchNames ();
+	QString status = QString ("%1...%2").arg (branches.value (0), branches.value (1));
+
+	CMergeBase merge_base;
+	const bool known = m_commit_model->mergeBase (merge_base);
+	if (known)
+	{
+		status += tr (": %n commit(s) only in %1", "", merge_base.m_left_only).arg (branches.value (0));
+		status += tr (", %n commit(s) only in %1", "", merge_base.m_right_only).arg (branches.value (1));
+		status += merge_base.m_bases.isEmpty () ? tr (", no merge base")
+												: tr (", merge base %1").arg (merge_base.m_bases.first ().toString ().left (7));
+	}
+
+	if (m_commit_model->isLoading ())
+		status += tr (" (walking history...)");
+
+	m_ui.compare_status->setText (status);
+	m_ui.compare_base->setEnabled (known && !merge_base.m_bases.isEmpty ());
+	m_ui.compare_bar->show ();
+}
+
+void
+CRepoTab::aboutGoToMergeBase ()
+{
+	CMergeBase merge_base;
+	if (m_commit_model->mergeBase (merge_base) && !merge_base.m_bases.isEmpty ())
+		selectCommit (merge_base.m_bases.first ().toString ());
+}
+
+void
+CRepoTab::aboutCloseCompare ()
+{
+	selectBranch (qMax (m_ui.branch_list->currentIndex (), 0));
+}
+
+void
+CRepoTab::aboutSortBranches ()
+{
+	QAction* action = qobject_cast<QAction*> (sender ());
+	if (! action)
+		return;
+
+	//
+	// The most recent branches and those with the most own commits go first; names go alphabetically
+	//
+	const int column = action->data ().toInt ();
+	m_branch_model->sort (column, (column == CBranchListModel::_NameColumn) ? Qt::AscendingOrder : Qt::DescendingOrder);
+}
+
+void
+CRepoTab::aboutShowAllBranches ()
+{
+	foreach (QAction* action, m_branches_menu->actions ())
+	{
+		if (action->isCheckable ())
+			action->setChecked (true);
+	}
+
+	aboutBranchesChecked ();
+}
+
+void
+CRepoTab::selectBranch (int _index)
+{
+	//
+	// Combobox doesn't notify about selection of already current item
+	//
+	if (m_ui.branch_list->currentIndex () == _index)
+		aboutBranchSelected (m_ui.branch_list->currentText ());
+	else
+		m_ui.branch_list->setCurrentIndex (_index);
+}
+
+void
+CRepoTab::setActive (bool _active)
+{
+	m_commit_model->setActive (_active);
+}
+
+void
+CRepoTab::saveState (QSettings& _settings) const
+{
+	//
+	// Save discovered git repository path
+	//
+	_settings.setValue (GIT_REPO_KEY, m_repo_path);
+
+	//
+	// Save last user-selected branch of git repository
+	//
+	_settings.setValue (BRANCH_KEY, m_ui.branch_list->currentIndex ());
+	_settings.setValue (BRANCH_NAME_KEY, m_ui.branch_list->currentText ());
+	_settings.setValue (BRANCH_SORT_KEY, m_branch_model->sortColumn ());
+
+	//
+	// Save last user-selected commit: by id, because rows move when new commits arrive
+	//
+	_settings.setValue (COMMIT_KEY, m_ui.commit_list->currentIndex ().row ());
+	_settings.setValue (COMMIT_ID_KEY, selectedCommitId ());
+
+	//
+	// Save the first screen of the commit table to show it at once on next launch
+	//
+	int visible_rows = m_ui.commit_list->rowAt (m_ui.commit_list->viewport ()->height () - 1) + 1;
+	if (visible_rows <= 0)
+		visible_rows = m_commit_model->rowCount ();
+	_settings.setValue (SNAPSHOT_KEY, m_commit_model->snapshot (qBound (SNAPSHOT_MIN_ROWS, visible_rows, SNAPSHOT_MAX_ROWS)));
+
+	//
+	// Save last user-selected filter index
+	//
+	_settings.setValue (FILTER_KEY, m_ui.filter_criteria->currentIndex ());
+
+	//
+	// Save commit table sort order
+	//
+	_settings.setValue (SORT_COLUMN_KEY, m_commit_model->sortColumn ());
+	_settings.setValue (SORT_ORDER_KEY, int (m_commit_model->sortOrder ()));
+}
+
+bool
+CRepoTab::restoreState (QSettings& _settings)
+{
+	//
+	// Restore last discovered git repository path if one presents in settings
+	//
+	QString path;
+	QVariant repo_path_var = _settings.value (GIT_REPO_KEY);
+	if (!repo_path_var.isNull () && repo_path_var.canConvert <QString> ())
+		path = repo_path_var.toString ();
+
+	if (path.isEmpty () || !QDir (path).exists ())
+		return false;
+
+	//
+	// Restore last user-selected commit when its row will be loaded
+	// (row index is used only for settings saved without commit id)
+	//
+	m_pending_commit_id = _settings.value (COMMIT_ID_KEY).toString ();
+	QVariant commit_idx_var = _settings.value (COMMIT_KEY);
+	if (m_pending_commit_id.isEmpty () && !commit_idx_var.isNull () && commit_idx_var.canConvert <int> ())
+	{
+		bool ok = false;
+		int commit_index = commit_idx_var.toInt (& ok);
+		if (ok && (commit_index >= 0))
+			m_pending_commit_row = commit_index;
+	}
+
+	//
+	// Restore last user-selected branch
+	//
+	int branch_index = 0;
+	QVariant branch_as_var = _settings.value (BRANCH_KEY);
+	if (! branch_as_var.isNull () && branch_as_var.canConvert <int> ())
+	{
+		bool ok = false;
+		branch_index = branch_as_var.toInt (& ok);
+		if (!ok)
+			branch_index = 0;
+	}
+
+	//
+	// Restore sort order before commits start to arrive
+	//
+	bool sort_ok = false;
+	int sort_column = _settings.value (SORT_COLUMN_KEY).toInt (& sort_ok);
+	if (sort_ok && (sort_column >= 0) && (sort_column < CCommitTableModel::_ColumntCount))
+	{
+		const Qt::SortOrder sort_order = (_settings.value (SORT_ORDER_KEY).toInt () == Qt::DescendingOrder)
+										 ? Qt::DescendingOrder : Qt::AscendingOrder;
+		m_ui.commit_list->header ()->setSortIndicator (sort_column, sort_order);
+	}
+
+	//
+	// Restore branch list sort order; details of tips are cached by the model, so it's applied as they arrive
+	//
+	bool branch_sort_ok = false;
+	const int branch_sort_column = _settings.value (BRANCH_SORT_KEY).toInt (& branch_sort_ok);
+	if (branch_sort_ok)
+	{
+		foreach (QAction* action, m_sort_branches_menu->actions ())
+		{
+			if (action->data ().toInt () == branch_sort_column)
+				action->trigger ();
+		}
+	}
+
+	openRepository (path, branch_index);
+	m_pending_branch_name = _settings.value (BRANCH_NAME_KEY).toString ();
+
+	//
+	// Paint the first screen of previous session at once; it is validated when the branch is loaded
+	//
+	if (m_commit_model->setSnapshot (_settings.value (SNAPSHOT_KEY).toByteArray ()))
+	{
+		m_ui.commit_pages->setCurrentWidget (m_ui.commits_page);
+		resizeColumns ();
+
+		int row = m_commit_model->commitIndex (m_pending_commit_id);
+		if (row >= 0)
+			m_ui.commit_list->setCurrentIndex (m_commit_model->index (row, 0));
+	}
+
+	//
+	// Restore last user-selected filter index
+	//
+	QVariant filter_idx_var = _settings.value (FILTER_KEY, m_ui.filter_criteria->currentIndex ());
+	if (! filter_idx_var.isNull () && filter_idx_var.canConvert <int> ())
+	{
+		bool ok = false;
+		int filter_index = filter_idx_var.toInt (& ok);
+		if (ok && (filter_index >= 0) && (filter_index < m_ui.filter_criteria->count ()))
+			m_ui.filter_criteria->setCurrentIndex (filter_index);
+	}
+
+	return true;
+}
+
+void
+CRepoTab::removeState (QSettings& _settings)
+{
+	const char* const keys [] =
+	{
+		GIT_REPO_KEY, BRANCH_KEY, COMMIT_KEY, FILTER_KEY, COMMIT_ID_KEY, SNAPSHOT_KEY,
+		SORT_COLUMN_KEY, SORT_ORDER_KEY, BRANCH_NAME_KEY, BRANCH_SORT_KEY
+	};
+
+	for (size_t i = 0; i < sizeof (keys) / sizeof (keys [0]); ++i)
+		_settings.remove (keys [i]);
+}
+
+void
+CRepoTab::aboutBranchSelected (const QString& _item)
+{
+	//
+	// Obtain new selected branch name
+	//
+	QString current_branch = _item;
+	if (current_branch.isEmpty () || current_branch.size () < 3)
+		return;
+	if (current_branch.at (0) == '*')
+		current_branch.remove (0, 2);
+	else
+		current_branch = current_branch.trimmed ();
+
+	// Combined log is left
+	checkSelectedBranch ();
+
+	//
+	// Fill the table with new branch commit list and select first of them when it arrives
+	//
+	if ((m_pending_commit_row == SELECT_NONE) && m_pending_commit_id.isEmpty ())
+		m_pending_commit_row = SELECT_FIRST_ROW;
+	m_commit_model->setCommitList (current_branch);
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+
+	aboutCompareProgress ();
+	resizeColumns ();
+}
+
+void
+CRepoTab::resizeColumns ()
+{
+	//
+	// Setup default column sizes as 60%, 20%, 20% (because such sizes looks fine)
+	//
+	int table_width = m_ui.commit_list->width () - 15;
+	m_ui.commit_list->setColumnWidth (CCommitTableModel::_ShortLogColumn, (table_width) * 0.6);
+	m_ui.commit_list->setColumnWidth (CCommitTableModel::_AuthorColumn, (table_width) * 0.2);
+	m_ui.commit_list->setColumnWidth (CCommitTableModel::_DateColumn, (table_width) * 0.2);
+}
+
+void
+CRepoTab::aboutCommitsInserted (const QModelIndex& _parent, int _first, int _last)
+{
+	Q_UNUSED (_parent);
+
+	//
+	// First batch of commits has arrived: replace placeholder with the table
+	//
+	if (m_ui.commit_pages->currentWidget () != m_ui.commits_page)
+		m_ui.commit_pages->setCurrentWidget (m_ui.commits_page);
+
+	//
+	// Saved commit is searched by its id; snapshot rows may still be replaced, so keep waiting for them
+	//
+	if (! m_pending_commit_id.isEmpty ())
+	{
+		int row = m_commit_model->commitIndex (m_pending_commit_id, _first, _last);
+		if (row >= 0)
+		{
+			m_ui.commit_list->setCurrentIndex (m_commit_model->index (row, 0));
+			m_ui.commit_list->scrollTo (m_commit_model->index (row, 0));
+			if (! m_commit_model->isSnapshot ())
+				m_pending_commit_id.clear ();
+		}
+
+		return;
+	}
+
+	if (m_pending_commit_row == SELECT_NONE)
+		return;
+
+	int row = (m_pending_commit_row == SELECT_FIRST_ROW) ? 0 : m_pending_commit_row;
+	if (row <= _last)
+	{
+		m_pending_commit_row = SELECT_NONE;
+		m_ui.commit_list->setCurrentIndex (m_commit_model->index (row, 0));
+		m_ui.commit_list->scrollTo (m_commit_model->index (row, 0));
+	}
+}
+
+void
+CRepoTab::aboutCommitsLoaded ()
+{
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("There are no commits in the selected branch"));
+
+	//
+	// Restored commit is out of range now (e.g. history was rewritten): select the first one
+	//
+	if ((m_pending_commit_row != SELECT_NONE) || !m_pending_commit_id.isEmpty ())
+	{
+		m_pending_commit_row = SELECT_NONE;
+		m_pending_commit_id.clear ();
+		if (! m_commit_model->empty () && !m_ui.commit_list->currentIndex ().isValid ())
+			m_ui.commit_list->selectRow (0);
+	}
+}
+
+void
+CRepoTab::aboutCommitSelected (const QModelIndex& _current, const QModelIndex& _previous)
+{
+	if (! _current.isValid ())
+	{
+		m_ui.commit_details->clearCommit ();
+		m_ui.commit_diff->clearCommit ();
+		m_ui.contained_in->clearCommit ();
+		m_tree_model->setCommit (CGitOid ());
+		return;
+	}
+
+	m_ui.commit_hash->setText (selectedCommitId ());
+
+	//
+	// Details of the next commits in the direction user moves are computed first
+	//
+	const int step = (_previous.isValid () && (_previous.row () > _current.row ())) ? -1 : 1;
+	CGitOidVector neighbours;
+	for (int distance = 1; distance <= PREFETCH_NEIGHBOURS; ++distance)
+	{
+		const int rows [2] = { _current.row () + step * distance, _current.row () - step * distance };
+		for (int i = 0; i < 2; ++i)
+			if ((rows [i] >= 0) && (rows [i] < m_commit_model->rowCount ()))
+				neighbours.append (CGitOid::fromString (m_commit_model->data (m_commit_model->index (rows [i], 0),
+																			  CCommitTableModel::CommitIdRole).toString ()));
+	}
+
+	const QString commit_id = m_commit_model->data (_current.sibling (_current.row (), 0),
+													CCommitTableModel::CommitIdRole).toString ();
+	m_ui.commit_details->showCommit (CGitOid::fromString (commit_id), neighbours);
+	m_ui.commit_diff->showCommit (CGitOid::fromString (commit_id));
+	showCommitTree ();
+	showContainingRefs ();
+
+	// Commits which didn't touch the file reuse the cached blame of the one which changed it last
+	if (m_blame_view && m_blame_view->isVisible ())
+		m_blame_view->showBlame (m_blame_view->path (), CGitOid::fromString (commit_id));
+}
+
+void
+CRepoTab::aboutChangedFileSelected (QTreeWidgetItem* _item)
+{
+	if (_item)
+		m_ui.commit_diff->scrollToFile (_item->text (CCommitDetailsView::_PathColumn));
+}
+
+void
+CRepoTab::collectExpandedPaths (const QModelIndex& _parent, QStringList& _paths) const
+{
+	const int rows = m_tree_model->rowCount (_parent);
+	for (int row = 0; row < rows; ++row)
+	{
+		// Directories go first
+		const QModelIndex index = m_tree_model->index (row, 0, _parent);
+		if (! m_tree_model->hasChildren (index))
+			break;
+
+		if (m_ui.commit_tree->isExpanded (index))
+		{
+			_paths.append (m_tree_model->path (index));
+			collectExpandedPaths (index, _paths);
+		}
+	}
+}
+
+void
+CRepoTab::showCommitTree ()
+{
+	if (m_ui.details_tabs->currentWidget () != m_ui.files_page)
+		return;
+
+	const CGitOid commit = CGitOid::fromString (selectedCommitId ());
+	if (commit == m_tree_model->commit ())
+		return;
+
+	//
+	// Directories of nearby commits are mostly the same tree objects: expanding them again reads nothing
+	//
+	QStringList expanded;
+	collectExpandedPaths (QModelIndex (), expanded);
+	const QString current = m_tree_model->path (m_ui.commit_tree->currentIndex ());
+
+	m_tree_model->setCommit (commit);
+	foreach (const QString& path, expanded)
+	{
+		const QModelIndex index = m_tree_model->index (path);
+		if (index.isValid ())
+			m_ui.commit_tree->expand (index);
+	}
+
+	if (! current.isEmpty ())
+	{
+		const QModelIndex index = m_tree_model->index (current);
+		if (index.isValid ())
+			m_ui.commit_tree->setCurrentIndex (index);
+	}
+}
+
+void
+CRepoTab::aboutDetailsTabChanged (int _index)
+{
+	Q_UNUSED (_index);
+	showCommitTree ();
+	showContainingRefs ();
+}
+
+void
+CRepoTab::showContainingRefs ()
+{
+	if (m_ui.details_tabs->currentWidget () == m_ui.contained_page)
+		m_ui.contained_in->showCommit (CGitOid::fromString (selectedCommitId ()));
+}
+
+void
+CRepoTab::aboutTreeEntrySelected (const QModelIndex& _current)
+{
+	// Directory or no entry: nothing to preview
+	m_ui.file_preview->showBlob (CGitOid::fromString (m_tree_model->data (_current, CTreeModel::BlobIdRole).toString ()));
+}
+
+void
+CRepoTab::aboutGrepCommit ()
+{
+	const QString commit_id = selectedCommitId ();
+	if (commit_id.isEmpty ())
+		return;
+
+	bool ok = false;
+	const QString pattern = QInputDialog::getText (this, tr ("Grep in files of commit"),
+												   tr ("Regular expression:"), QLineEdit::Normal,
+												   m_grep_pattern, &ok);
+	if (! ok || pattern.isEmpty ())
+		return;
+
+	const QRegExp regexp (pattern);
+	if (! regexp.isValid ())
+	{
+		QToolTip::showText (QCursor::pos (), tr ("Invalid regular expression: %1").arg (regexp.errorString ()));
+		return;
+	}
+
+	if (! m_grep_model)
+	{
+		m_grep_model = new CGrepModel (this);
+		m_grep_model->setGitRepo (m_repo_path);
+		connect (m_grep_model, SIGNAL (progressChanged (int, int)), this, SLOT (aboutGrepProgress ()));
+		connect (m_grep_model, SIGNAL (searchFinished ()), this, SLOT (aboutGrepProgress ()));
+
+		m_grep_view = new QTreeView (this);
+		m_grep_view->setWindowFlags (Qt::Window);
+		m_grep_view->setRootIsDecorated (false);
+		m_grep_view->setUniformRowHeights (true);
+		m_grep_view->setModel (m_grep_model);
+		m_grep_view->resize (900, 500);
+		connect (m_grep_view, SIGNAL (activated (const QModelIndex&)), this, SLOT (aboutGrepResultActivated (const QModelIndex&)));
+	}
+
+	m_grep_commit_id = commit_id;
+	m_grep_pattern = pattern;
+	m_grep_model->search (CGitOid::fromString (commit_id), regexp);
+	aboutGrepProgress ();
+
+	m_grep_view->show ();
+	m_grep_view->raise ();
+	m_grep_view->activateWindow ();
+}
+
+void
+CRepoTab::aboutGrepProgress ()
+{
+	QString title = tr ("Grep \"%1\" in %2: %n match(es)", "", m_grep_model->rowCount ())
+					.arg (m_grep_pattern).arg (m_grep_commit_id.left (10));
+	if (m_grep_model->isSearching ())
+		title += tr (", searched %1 of %2 files").arg (m_grep_model->searchedBlobs ()).arg (m_grep_model->totalBlobs ());
+	else if (! m_grep_model->lastError ().isEmpty ())
+		title += " (" + m_grep_model->lastError () + ")";
+
+	m_grep_view->setWindowTitle (title);
+}
+
+void
+CRepoTab::aboutGrepResultActivated (const QModelIndex& _index)
+{
+	if (! _index.isValid ())
+		return;
+
+	//
+	// Open the file in the Files tab of the searched commit
+	//
+	if (selectedCommitId () != m_grep_commit_id)
+		selectCommit (m_grep_commit_id);
+	if (selectedCommitId () != m_grep_commit_id)
+		return;
+
+	m_ui.details_tabs->setCurrentWidget (m_ui.files_page);
+	showCommitTree ();
+
+	const QModelIndex file = m_tree_model->index (m_grep_model->result (_index.row ()).m_path);
+	if (file.isValid ())
+	{
+		m_ui.commit_tree->setCurrentIndex (file);
+		m_ui.commit_tree->scrollTo (file);
+	}
+}
+
+void
+CRepoTab::aboutBlameFile ()
+{
+	QTreeWidgetItem* item = m_ui.commit_details->currentItem ();
+	const QString commit_id = selectedCommitId ();
+	if (! item || commit_id.isEmpty ())
+		return;
+
+	// Deleted file has nothing to blame at this commit
+	if (item->text (CCommitDetailsView::_StatusColumn).startsWith ('D'))
+		return;
+
+	if (! m_blame_view)
+	{
+		m_blame_view = new CBlameView (this);
+		m_blame_view->setWindowFlags (Qt::Window);
+		m_blame_view->resize (900, 600);
+		m_blame_view->setGitRepo (m_repo_path);
+	}
+
+	m_blame_view->showBlame (item->text (CCommitDetailsView::_PathColumn), CGitOid::fromString (commit_id));
+	m_blame_view->show ();
+	m_blame_view->raise ();
+	m_blame_view->activateWindow ();
+}
+
+void
+CRepoTab::aboutFilterChanged (int _column_idx)
+{
+	//
+	// Full message is not a column: its words are looked up in the message index of the model
+	//
+	if (_column_idx == FULL_MESSAGE_FILTER)
+	{
+		m_ui.commit_search->setSearchColumn (CCommitTableModel::_ShortLogColumn);
+		m_ui.commit_search->setSearchRole (CCommitTableModel::CommitMessageRole);
+	}
+	else
+	{
+		m_ui.commit_search->setSearchColumn (_column_idx);
+		m_ui.commit_search->setSearchRole (Qt::DisplayRole);
+	}
+}
+
+void
+CRepoTab::aboutFilterByAuthor ()
+{
+	const QModelIndex current = m_ui.commit_list->currentIndex ();
+	if (! current.isValid ())
+		return;
+
+	const QString commit_id = selectedCommitId ();
+	m_commit_model->setAuthorFilter (m_commit_model->authorAt (current.row ()));
+	selectCommit (commit_id);
+}
+
+void
+CRepoTab::aboutShowAllCommits ()
+{
+	const QString commit_id = selectedCommitId ();
+	m_commit_model->setAuthorFilter (QString ());
+	m_commit_model->clearDateFilter ();
+	m_commit_model->clearPickaxeFilter ();
+	aboutPickaxeProgress ();
+	selectCommit (commit_id);
+
+	// Commits skipped by the walk are loaded again; selection is restored when its row arrives
+	if (m_commit_model->hasWalkFilter ())
+	{
+		m_pending_commit_id = commit_id;
+		m_commit_model->setWalkFilter (CCommitWalkFilter ());
+	}
+}
+
+void
+CRepoTab::aboutFilterHistory ()
+{
+	CHistoryFilterDialog dialog (this);
+	dialog.setFilter (m_commit_model->walkFilter ());
+	if (dialog.exec () != QDialog::Accepted)
+		return;
+
+	m_pending_commit_id = selectedCommitId ();
+	if (m_pending_commit_id.isEmpty ())
+		m_pending_commit_row = SELECT_FIRST_ROW;
+
+	m_commit_model->setWalkFilter (dialog.filter ());
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+}
+
+void
+CRepoTab::aboutFileHistory ()
+{
+	bool ok = false;
+	const QString path = QInputDialog::getText (this, tr ("History of file"),
+												tr ("File or directory path relative to repository root:"),
+												QLineEdit::Normal, m_commit_model->walkFilter ().m_path, &ok).trimmed ();
+	if (! ok || path.isEmpty ())
+		return;
+
+	m_pending_commit_id = selectedCommitId ();
+	if (m_pending_commit_id.isEmpty ())
+		m_pending_commit_row = SELECT_FIRST_ROW;
+
+	// Other conditions of the walk filter stay
+	CCommitWalkFilter filter = m_commit_model->walkFilter ();
+	filter.m_path = path;
+	m_commit_model->setWalkFilter (filter);
+	if (m_commit_model->empty ())
+		showPlaceholder (tr ("Loading commits..."));
+}
+
+void
+CRepoTab::askPickaxeQuery (bool _line_mode)
+{
+	bool ok = false;
+	const QString text = QInputDialog::getText (this, _line_mode ? tr ("Commits changing lines") : tr ("Commits changing text"),
+												_line_mode ? tr ("Regular expression matching added or deleted lines:")
+														   : tr ("Text which count of occurrences is changed:"),
+												QLineEdit::Normal, m_pickaxe_text, &ok);
+	if (! ok || text.isEmpty ())
+		return;
+
+	CPickaxeQuery query;
+	if (_line_mode)
+	{
+		query.m_mode = CPickaxeQuery::LineMode;
+		query.m_pattern = QRegExp (text);
+		if (! query.m_pattern.isValid ())
+		{
+			QToolTip::showText (QCursor::pos (), tr ("Invalid regular expression: %1").arg (query.m_pattern.errorString ()));
+			return;
+		}
+	}
+	else
+	{
+		query.m_text = text.toUtf8 ();
+	}
+
+	m_pickaxe_text = text;
+	m_commit_model->setPickaxeFilter (query);
+	aboutPickaxeProgress ();
+}
+
+void
+CRepoTab::aboutPickaxeCount ()
+{
+	askPickaxeQuery (false);
+}
+
+void
+CRepoTab::aboutPickaxeLines ()
+{
+	askPickaxeQuery (true);
+}
+
+void
+CRepoTab::aboutPickaxeProgress ()
+{
+	if (! m_commit_model->hasPickaxeFilter ())
+	{
+		m_ui.pickaxe_bar->hide ();
+		return;
+	}
+
+	const CPickaxeQuery query = m_commit_model->pickaxeFilter ();
+	QString status = (query.m_mode == CPickaxeQuery::LineMode)
+					 ? tr ("Commits adding or deleting lines matching \"%1\"").arg (query.m_pattern.pattern ())
+					 : tr ("Commits changing count of \"%1\"").arg (QString::fromUtf8 (query.m_text));
+	status += tr (": %n shown", "", m_commit_model->rowCount ());
+	if (m_commit_model->isPickaxeSearching ())
+		status += tr (", checked %1 of %2 commits").arg (m_commit_model->pickaxeCheckedCommits ())
+												  .arg (m_commit_model->pickaxeTotalCommits ());
+
+	m_ui.pickaxe_status->setText (status);
+	m_ui.pickaxe_stop->setEnabled (m_commit_model->isPickaxeSearching ());
+	m_ui.pickaxe_bar->show ();
+}
+
+void
+CRepoTab::aboutStopPickaxe ()
+{
+	m_commit_model->stopPickaxeSearch ();
+	aboutPickaxeProgress ();
+}
+
+void
+CRepoTab::aboutClearPickaxe ()
+{
+	const QString commit_id = selectedCommitId ();
+	m_commit_model->clearPickaxeFilter ();
+	aboutPickaxeProgress ();
+	selectCommit (commit_id);
+}
+
+QDate
+CRepoTab::currentCommitDate () const
+{
+	const QModelIndex current = m_ui.commit_list->currentIndex ();
+	if (! current.isValid ())
+		return QDate::currentDate ();
+
+	QDateTime time;
+	time.setTime_t (m_commit_model->commitTime (current.row ()));
+	return time.date ();
+}
+
+void
+CRepoTab::aboutFilterByDate ()
+{
+	CDateDialog dialog (true, this);
+	dialog.setDates (currentCommitDate ().addMonths (-1), currentCommitDate ());
+	if (dialog.exec () != QDialog::Accepted)
+		return;
+
+	const QString commit_id = selectedCommitId ();
+	m_commit_model->setDateFilter (dialog.fromTime (), dialog.toTime ());
+	selectCommit (commit_id);
+}
+
+void
+CRepoTab::aboutGoToDate ()
+{
+	CDateDialog dialog (false, this);
+	dialog.setDates (currentCommitDate ());
+	if (dialog.exec () != QDialog::Accepted)
+		return;
+
+	goToRow (m_commit_model->rowForDate (dialog.toTime ()));
+}
+
+void
+CRepoTab::aboutCommitHashEntered ()
+{
+	const QString prefix = m_ui.commit_hash->text ().trimmed ();
+	const QPoint tip_pos = m_ui.commit_hash->mapToGlobal (QPoint (0, m_ui.commit_hash->height ()));
+
+	if (! QRegExp ("[0-9a-fA-F]{4,40}").exactMatch (prefix))
+	{
+		QToolTip::showText (tip_pos, tr ("Enter at least %1 hex digits of commit SHA-1 id")
+										  .arg (int (CCommitTableModel::MIN_PREFIX_LENGTH)), m_ui.commit_hash);
+		return;
+	}
+
+	// One more match than offered tells that the list is incomplete
+	const QList<int> rows = m_commit_model->commitRowsByPrefix (prefix, MAX_PREFIX_MATCHES + 1);
+	if (rows.isEmpty ())
+	{
+		QToolTip::showText (tip_pos, tr ("No shown commit id starts with %1").arg (prefix), m_ui.commit_hash);
+		return;
+	}
+
+	if (rows.size () == 1)
+	{
+		goToRow (rows.first ());
+		m_ui.commit_list->setFocus ();
+		return;
+	}
+
+	//
+	// Ambiguous prefix: let user choose one of the commits
+	//
+	QMenu menu (this);
+	for (int i = 0; i < qMin (rows.size (), MAX_PREFIX_MATCHES); ++i)
+	{
+		const QModelIndex index = m_commit_model->index (rows [i], CCommitTableModel::_ShortLogColumn);
+		const QString id = m_commit_model->data (index, CCommitTableModel::CommitIdRole).toString ();
+		const QString summary = m_commit_model->data (index, CCommitTableModel::CommitSummaryRole).toString ();
+
+		QAction* action = menu.addAction (QString ("%1  %2").arg (id.left (prefix.length () + 2), summary));
+		action->setData (rows [i]);
+	}
+	if (rows.size () > MAX_PREFIX_MATCHES)
+		menu.addAction (tr ("More commits match, type a longer prefix"))->setEnabled (false);
+
+	QAction* chosen = menu.exec (tip_pos);
+	if (chosen && chosen->data ().isValid ())
+	{
+		goToRow (chosen->data ().toInt ());
+		m_ui.commit_list->setFocus ();
+	}
+}
+
+void
+CRepoTab::goToRow (int _row)
+{
+	if (_row < 0)
+		return;
+
+	m_ui.commit_list->setCurrentIndex (m_commit_model->index (_row, 0));
+	m_ui.commit_list->scrollTo (m_commit_model->index (_row, 0), QAbstractItemView::PositionAtCenter);
+}
+
+void
+CRepoTab::selectCommit (const QString& _commit_id)
+{
+	const int row = _commit_id.isEmpty () ? -1 : m_commit_model->commitIndex (_commit_id);
+	if (row >= 0)
+		goToRow (row);
+	else if (m_commit_model->rowCount () > 0)
+		m_ui.commit_list->selectRow (0);
+}
+
+QString
+CRepoTab::selectedCommitId () const
+{
+	//
+	// Obtain the ID of user selected commit: the current one, or the first selected
+	// (selectedIndexes () would expand a range of millions of selected rows into cells)
+	//
+	QString result;
+	QItemSelectionModel* selection_model = m_ui.commit_list->selectionModel ();
+	if (selection_model->hasSelection ())
+	{
+		QModelIndex current = m_ui.commit_list->currentIndex ();
+		if (! current.isValid () || !selection_model->isSelected (current))
+			current = m_commit_model->index (selection_model->selection ().first ().top (), 0);
+
+		result = m_commit_model->data (current, CCommitTableModel::CommitIdRole).toString ();
+	}
+
+	return result;
+}
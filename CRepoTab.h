@@ -0,0 +1,384 @@
+/**
+ * @file
+ * @brief Tab with branches and commits of one git repository declaration
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+
+#ifndef __QGITREPOVIEWER_CREPOTAB_H
+#define __QGITREPOVIEWER_CREPOTAB_H
+
+#include <QWidget>
+#include <QDate>
+
+#include "ui_CRepoTab.h"
+
+class QSettings;
+class QMenu;
+class QTreeView;
+
+namespace QGitRepoViewer
+{
+	class CCommitTableModel;
+	class CBranchListModel;
+	class CBlameView;
+	class CTreeModel;
+	class CGrepModel;
+
+	/**
+	 * @brief Repository view: branch selector, commit search and commit table
+	 */
+	class CRepoTab : public QWidget
+	{
+		Q_OBJECT
+
+		/**
+		  * @brief Qt GUI object
+		  */
+		Ui::CRepoTab m_ui;
+
+		/**
+		  * @brief Custom data model for list of local branches of git repository
+		  */
+		CBranchListModel* m_branch_model;
+
+		/**
+		  * @brief Custom data model for list of commits of git repository
+		  */
+		CCommitTableModel* m_commit_model;
+
+		/**
+		  * @brief The path to the git repository (dir with .git folder or any it's subfolder)
+		  */
+		QString m_repo_path;
+
+		/**
+		 * @brief Row of commit to select when it will be loaded (or one of PendingSelection values)
+		 */
+		int m_pending_commit_row;
+
+		enum PendingSelection { SELECT_NONE = -2, SELECT_FIRST_ROW = -1 };
+
+		/**
+		 * @brief SHA-1 id of commit to select when it will be loaded
+		 */
+		QString m_pending_commit_id;
+
+		/**
+		 * @brief Index of branch to select when branch list will be loaded
+		 */
+		int m_pending_branch;
+
+		/**
+		 * @brief Name of branch to select when branch list will be loaded (preferred to its index)
+		 */
+		QString m_pending_branch_name;
+
+		/**
+		 * @brief Checkable branches of the combined log
+		 */
+		QMenu* m_branches_menu;
+
+		/**
+		 * @brief Branches to compare the selected one with
+		 */
+		QMenu* m_compare_menu;
+
+		/**
+		 * @brief Sort orders of the branch list
+		 */
+		QMenu* m_sort_branches_menu;
+
+		/**
+		 * @brief Files of the repository at the selected commit
+		 */
+		CTreeModel* m_tree_model;
+
+		/**
+		 * @brief Window with blame of a changed file, created when first asked for
+		 */
+		CBlameView* m_blame_view;
+
+		/**
+		 * @brief Window with lines matched by grep in files of a commit, created when first asked for
+		 */
+		CGrepModel* m_grep_model;
+		QTreeView* m_grep_view;
+
+		/**
+		 * @brief Pattern and SHA-1 id of the commit searched by grep
+		 */
+		QString m_grep_pattern;
+		QString m_grep_commit_id;
+
+		/**
+		 * @brief Text last asked for by pickaxe search
+		 */
+		QString m_pickaxe_text;
+
+		/**
+		 * @brief Fill the menu of combined log with loaded branches
+		 */
+		void fillBranchesMenu ();
+
+		/**
+		 * @brief Check only the branch selected in branch list
+		 */
+		void checkSelectedBranch ();
+
+		/**
+		 * @brief Show files of the selected commit if their tab is shown, keeping expanded directories
+		 */
+		void showCommitTree ();
+
+		/**
+		 * @brief Show branches and tags containing the selected commit if their tab is shown
+		 */
+		void showContainingRefs ();
+
+		/**
+		 * @brief Collect paths of expanded directories under the index
+		 */
+		void collectExpandedPaths (const QModelIndex& _parent, QStringList& _paths) const;
+
+		/**
+		 * @brief Show placeholder with specified text instead of commit table
+		 */
+		void showPlaceholder (const QString& _text);
+
+		/**
+		 * @brief Return the SHA-1 id of selected in list commit
+		 */
+		QString selectedCommitId () const;
+
+		/**
+		 * @brief Select branch by index and load its commits
+		 */
+		void selectBranch (int _index);
+
+		/**
+		 * @brief Setup default sizes of commit table columns
+		 */
+		void resizeColumns ();
+
+		/**
+		 * @brief Make the commit with specified id current (or the first row if it is not shown)
+		 */
+		void selectCommit (const QString& _commit_id);
+
+		/**
+		 * @brief Make the row current and scroll it to the center of the table
+		 */
+		void goToRow (int _row);
+
+		/**
+		 * @brief Ask for text (-S) or regular expression (-G) and show only commits changing it
+		 */
+		void askPickaxeQuery (bool _line_mode);
+
+		/**
+		 * @brief Date of the current commit (or today), used as default in date dialogs
+		 */
+		QDate currentCommitDate () const;
+
+	private	Q_SLOTS:
+		/**
+		 * @brief Branch list was loaded in background
+		 */
+		void aboutBranchesLoaded ();
+
+		/**
+		  * @brief Selected local branch was changed
+		  */
+		void aboutBranchSelected (const QString& _item);
+
+		/**
+		 * @brief Selected commit was changed
+		 */
+		void aboutCommitSelected (const QModelIndex& _current, const QModelIndex& _previous);
+
+		/**
+		 * @brief User clicked a changed file of the selected commit: scroll its patch into view
+		 */
+		void aboutChangedFileSelected (QTreeWidgetItem* _item);
+
+		/**
+		 * @brief Tab with patch or files of the selected commit was switched
+		 */
+		void aboutDetailsTabChanged (int _index);
+
+		/**
+		 * @brief Current entry of the commit tree was changed: preview it if it is a file
+		 */
+		void aboutTreeEntrySelected (const QModelIndex& _current);
+
+		/**
+		 * @brief Ask for a regular expression and search files of the selected commit for it
+		 */
+		void aboutGrepCommit ();
+
+		/**
+		 * @brief Show progress and state of grep in the title of its window
+		 */
+		void aboutGrepProgress ();
+
+		/**
+		 * @brief Show the file of activated grep result in the files of its commit
+		 */
+		void aboutGrepResultActivated (const QModelIndex& _index);
+
+		/**
+		 * @brief Show only commits changing count of occurrences of a text (git log -S)
+		 */
+		void aboutPickaxeCount ();
+
+		/**
+		 * @brief Show only commits adding or deleting lines matching a regular expression (git log -G)
+		 */
+		void aboutPickaxeLines ();
+
+		/**
+		 * @brief Show state and progress of pickaxe search above the commit table
+		 */
+		void aboutPickaxeProgress ();
+
+		/**
+		 * @brief Stop pickaxe search keeping found commits shown
+		 */
+		void aboutStopPickaxe ();
+
+		/**
+		 * @brief Remove pickaxe filter
+		 */
+		void aboutClearPickaxe ();
+
+		/**
+		 * @brief Show commits unique to the selected branch or to the one chosen in the menu
+		 */
+		void aboutCompareBranch ();
+
+		/**
+		 * @brief Sort the branch list by the column chosen in the menu
+		 */
+		void aboutSortBranches ();
+
+		/**
+		 * @brief Show compared branches, counts of their unique commits and merge base above the commit table
+		 */
+		void aboutCompareProgress ();
+
+		/**
+		 * @brief Select the merge base of compared branches
+		 */
+		void aboutGoToMergeBase ();
+
+		/**
+		 * @brief Show the log of the selected branch instead of comparison
+		 */
+		void aboutCloseCompare ();
+
+		/**
+		 * @brief Show blame of the changed file selected in the list at the selected commit
+		 */
+		void aboutBlameFile ();
+
+		/**
+		 * @brief Next batch of commits was loaded
+		 */
+		void aboutCommitsInserted (const QModelIndex& _parent, int _first, int _last);
+
+		/**
+		 * @brief All commits of the branch were loaded
+		 */
+		void aboutCommitsLoaded ();
+
+		/**
+		  * @brief Filter search column index was changed
+		  */
+		void aboutFilterChanged (int _column_idx);
+
+		/**
+		 * @brief Show only commits of the author of selected commit
+		 */
+		void aboutFilterByAuthor ();
+
+		/**
+		 * @brief Ask for a range of dates and show only commits made in it
+		 */
+		void aboutFilterByDate ();
+
+		/**
+		 * @brief Remove commit author, date and pickaxe filters
+		 */
+		void aboutShowAllCommits ();
+
+		/**
+		 * @brief Ask for author, message, date and path conditions and reload only matching commits
+		 */
+		void aboutFilterHistory ();
+
+		/**
+		 * @brief Ask for a path and reload only commits which change it
+		 */
+		void aboutFileHistory ();
+
+		/**
+		 * @brief Ask for a date and select the newest commit made not later than it
+		 */
+		void aboutGoToDate ();
+
+		/**
+		 * @brief User entered full or abbreviated SHA-1 id: select the commit or offer ambiguous ones
+		 */
+		void aboutCommitHashEntered ();
+
+		/**
+		 * @brief Set of checked branches was changed: show commits of all of them in one list
+		 */
+		void aboutBranchesChecked ();
+
+		/**
+		 * @brief Check all branches and show their combined log
+		 */
+		void aboutShowAllBranches ();
+
+	public:
+		CRepoTab (QWidget* _parent = 0);
+		~CRepoTab ();
+
+		/**
+		 * @brief The path to the git repository shown in the tab
+		 */
+		QString repoPath () const;
+
+		/**
+		 * @brief Load branches of the repository and commits of the specified branch
+		 *
+		 * Loading is staged: branch list is enumerated in background, then commits of the branch
+		 * are streamed into the table; placeholder is shown until the first commits arrive.
+		 */
+		void openRepository (const QString& _path, int _branch_index = 0);
+
+		/**
+		 * @brief Active tab loads its data with priority, inactive one pauses loading and gives up caches
+		 */
+		void setActive (bool _active);
+
+		/**
+		 * @brief Save repository path and user selection into current settings group
+		 */
+		void saveState (QSettings& _settings) const;
+
+		/**
+		 * @brief Open repository and restore user selection from current settings group
+		 * @return false if there is no valid repository in settings
+		 */
+		bool restoreState (QSettings& _settings);
+
+		/**
+		 * @brief Remove repository path and user selection from current settings group
+		 */
+		static void removeState (QSettings& _settings);
+	};
+}
+
+#endif // __QGITREPOVIEWER_CREPOTAB_H
@@ -45,7 +45,8 @@ CSearchLineWidget::CSearchLineWidget (QWidget* _parent) :
 	m_ui (new Ui::CSearchLineWidget),
 	m_view (NULL),
 	m_matched_node (-1),
-	m_column_idx (0)
+	m_column_idx (0),
+	m_role (Qt::DisplayRole)
 {
 	m_ui->setupUi (this);
 }
@@ -111,7 +112,7 @@ void CSearchLineWidget::findMatched ()
 		// Search for m_pattern text in m_column_idx column of view and obtain all matches
 		m_matched_nodes = m_view->model ()->match (
 					m_view->model ()->index (0, m_column_idx),
-					Qt::DisplayRole,
+					m_role,
 					QVariant (m_pattern),
 					-1,
 					Qt::MatchRecursive|Qt::MatchExactly|
@@ -158,3 +159,8 @@ void CSearchLineWidget::setSearchColumn (int _idx)
 
 	m_column_idx = _idx;
 }
+
+void CSearchLineWidget::setSearchRole (int _role)
+{
+	m_role = _role;
+}
@@ -44,6 +44,9 @@ namespace QGitRepoViewer
 		/// Index of column to search in (first by default, i.e. 0)
 		int m_column_idx;
 
+		/// Data role to search in (Qt::DisplayRole by default)
+		int m_role;
+
 	private slots:
 		/// Find all matches of pattern in the view column with first one selection
 		void findMatched (const QString& _pattern);
@@ -67,6 +70,9 @@ namespace QGitRepoViewer
 
 		/// Setup the view column to search in
 		void setSearchColumn (int _idx);
+
+		/// Setup the data role to search in; the model decides how its values match the pattern
+		void setSearchRole (int _role);
 	};
 }
 
@@ -0,0 +1,357 @@
+/**
+ * @file
+ * @brief Lazy item model of repository files at a commit implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CTreeModel.h"
+
+#include <QApplication>
+#include <QStyle>
+#include <QStringList>
+
+#include <algorithm>
+#include <git2.h>
+
+#include "CDiagnostics.h"
+
+using namespace QGitRepoViewer;
+
+namespace
+{
+	/// Directories first, then files, each sorted by name
+	bool entryLessThan (const CTreeEntry& _left, const CTreeEntry& _right)
+	{
+		const bool left_tree = _left.isTree ();
+		if (left_tree != _right.isTree ())
+			return left_tree;
+
+		return (_left.m_name < _right.m_name);
+	}
+}
+
+bool
+CTreeEntry::isTree () const
+{
+	return (m_mode == GIT_FILEMODE_TREE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CTreeModel::CTreeModel (QObject* _parent):
+	QAbstractItemModel (_parent),
+	m_root (NULL),
+	m_cache (CACHE_ENTRY_LIMIT)
+{}
+
+CTreeModel::~CTreeModel ()
+{
+	delete m_root;
+}
+
+void
+CTreeModel::setGitRepo (const QString& _repo_path)
+{
+	beginResetModel ();
+	delete m_root;
+	m_root = NULL;
+	m_commit = CGitOid ();
+	m_cache.clear ();
+
+	m_repo.close ();
+	if (! m_repo.open (_repo_path, true))
+		CDiagnostics::instance ()->post (tr ("Files"), m_repo.lastError ());
+	endResetModel ();
+}
+
+CGitOid
+CTreeModel::commit () const
+{
+	return m_commit;
+}
+
+void
+CTreeModel::setCommit (const CGitOid& _commit)
+{
+	if (_commit == m_commit)
+		return;
+
+	//
+	// Tree of the commit is its root directory; subdirectories are read when expanded
+	//
+	CTreeEntriesPtr entries;
+	git_commit* commit = NULL;
+	if (! _commit.isNull () && m_repo.isOpened ())
+	{
+		const int error_code = git_commit_lookup (& commit, m_repo.handle (), _commit.raw ());
+		if (error_code == GIT_OK)
+			entries = readTree (CGitOid (git_commit_tree_id (commit)));
+		else
+			CDiagnostics::instance ()->post (tr ("Files"),
+											 gitErrorString (error_code, tr ("looking up commit %1").arg (_commit.toString ())));
+		git_commit_free (commit);
+	}
+
+	beginResetModel ();
+	delete m_root;
+	m_root = NULL;
+	m_commit = _commit;
+	if (entries)
+	{
+		m_root = new CNode (NULL, 0);
+		m_root->m_entries = entries;
+	}
+	endResetModel ();
+}
+
+CTreeEntriesPtr
+CTreeModel::readTree (const CGitOid& _tree_id)
+{
+	CTreeEntriesPtr* cached = m_cache.object (_tree_id);
+	if (cached)
+		return *cached;
+
+	git_tree* tree = NULL;
+	const int error_code = git_tree_lookup (& tree, m_repo.handle (), _tree_id.raw ());
+	if (error_code != GIT_OK)
+	{
+		CDiagnostics::instance ()->post (tr ("Files"),
+										 gitErrorString (error_code, tr ("reading tree %1").arg (_tree_id.toString ())));
+		return CTreeEntriesPtr ();
+	}
+
+	const size_t count = git_tree_entrycount (tree);
+	CTreeEntryList* entries = new CTreeEntryList (int (count));
+	for (size_t i = 0; i < count; ++i)
+	{
+		const git_tree_entry* tree_entry = git_tree_entry_byindex (tree, i);
+		CTreeEntry& entry = (*entries) [int (i)];
+		entry.m_name = QString::fromUtf8 (git_tree_entry_name (tree_entry));
+		entry.m_id = CGitOid (git_tree_entry_id (tree_entry));
+		entry.m_mode = uint (git_tree_entry_filemode (tree_entry));
+	}
+	git_tree_free (tree);
+
+	std::stable_sort (entries->begin (), entries->end (), entryLessThan);
+
+	CTreeEntriesPtr result (entries);
+	m_cache.insert (_tree_id, new CTreeEntriesPtr (result), qMax (1, int (count)));
+	return result;
+}
+
+CTreeModel::CNode*
+CTreeModel::childNode (CNode* _parent, int _row) const
+{
+	if (! _parent || !_parent->m_entries || (_row < 0) || (_row >= _parent->m_entries->size ())
+		|| !_parent->m_entries->at (_row).isTree ())
+		return NULL;
+
+	CNode*& child = _parent->m_children [_row];
+	if (! child)
+		child = new CNode (_parent, _row);
+
+	return child;
+}
+
+CTreeModel::CNode*
+CTreeModel::node (const QModelIndex& _index) const
+{
+	if (! _index.isValid ())
+		return m_root;
+
+	return childNode (static_cast<CNode*> (_index.internalPointer ()), _index.row ());
+}
+
+const CTreeEntry*
+CTreeModel::entry (const QModelIndex& _index) const
+{
+	if (! _index.isValid ())
+		return NULL;
+
+	const CNode* parent = static_cast<const CNode*> (_index.internalPointer ());
+	if (! parent->m_entries || (_index.row () >= parent->m_entries->size ()))
+		return NULL;
+
+	return &parent->m_entries->at (_index.row ());
+}
+
+QString
+CTreeModel::path (const QModelIndex& _index) const
+{
+	QStringList parts;
+	for (QModelIndex index = _index; index.isValid (); index = index.parent ())
+	{
+		const CTreeEntry* tree_entry = entry (index);
+		if (tree_entry)
+			parts.prepend (tree_entry->m_name);
+	}
+
+	return parts.join ("/");
+}
+
+QModelIndex
+CTreeModel::index (const QString& _path)
+{
+	QModelIndex result;
+	foreach (const QString& name, _path.split ('/', QString::SkipEmptyParts))
+	{
+		if (canFetchMore (result))
+			fetchMore (result);
+
+		const CNode* parent = node (result);
+		if (! parent || !parent->m_entries)
+			return QModelIndex ();
+
+		int row = 0;
+		while ((row < parent->m_entries->size ()) && (parent->m_entries->at (row).m_name != name))
+			++row;
+		if (row == parent->m_entries->size ())
+			return QModelIndex ();
+
+		result = createIndex (row, 0, const_cast<CNode*> (parent));
+	}
+
+	return result;
+}
+
+QModelIndex
+CTreeModel::index (int _row, int _column, const QModelIndex& _parent) const
+{
+	CNode* parent = node (_parent);
+	if (! parent || !parent->m_entries || (_row < 0) || (_row >= parent->m_entries->size ())
+		|| (_column < 0) || (_column >= _ColumnCount))
+		return QModelIndex ();
+
+	return createIndex (_row, _column, parent);
+}
+
+QModelIndex
+CTreeModel::parent (const QModelIndex& _index) const
+{
+	if (! _index.isValid ())
+		return QModelIndex ();
+
+	CNode* parent = static_cast<CNode*> (_index.internalPointer ());
+	if (parent == m_root)
+		return QModelIndex ();
+
+	return createIndex (parent->m_row, 0, parent->m_parent);
+}
+
+int
+CTreeModel::rowCount (const QModelIndex& _parent) const
+{
+	if (_parent.column () > 0)
+		return 0;
+
+	const CNode* parent = node (_parent);
+	return (parent && parent->m_entries) ? parent->m_entries->size () : 0;
+}
+
+int
+CTreeModel::columnCount (const QModelIndex& _parent) const
+{
+	Q_UNUSED (_parent);
+	return _ColumnCount;
+}
+
+bool
+CTreeModel::hasChildren (const QModelIndex& _parent) const
+{
+	//
+	// Directories are expandable without reading them
+	//
+	if (! _parent.isValid ())
+		return (m_root != NULL) && !m_root->m_entries->isEmpty ();
+
+	const CTreeEntry* tree_entry = entry (_parent);
+	return (_parent.column () == 0) && tree_entry && tree_entry->isTree ();
+}
+
+bool
+CTreeModel::canFetchMore (const QModelIndex& _parent) const
+{
+	const CNode* parent = node (_parent);
+	return parent && !parent->m_entries;
+}
+
+void
+CTreeModel::fetchMore (const QModelIndex& _parent)
+{
+	CNode* parent = node (_parent);
+	const CTreeEntry* tree_entry = entry (_parent);
+	if (! parent || parent->m_entries || !tree_entry)
+		return;
+
+	CTreeEntriesPtr entries = readTree (tree_entry->m_id);
+	if (! entries)
+	{
+		// Don't try again on every paint
+		parent->m_entries = CTreeEntriesPtr (new CTreeEntryList ());
+		return;
+	}
+
+	if (entries->isEmpty ())
+	{
+		parent->m_entries = entries;
+		return;
+	}
+
+	beginInsertRows (_parent, 0, entries->size () - 1);
+	parent->m_entries = entries;
+	endInsertRows ();
+}
+
+QVariant
+CTreeModel::data (const QModelIndex& _index, int _role) const
+{
+	const CTreeEntry* tree_entry = entry (_index);
+	if (! tree_entry)
+		return QVariant ();
+
+	switch (_role)
+	{
+		case Qt::DisplayRole:
+			if (_index.column () == _NameColumn)
+				return tree_entry->m_name;
+			if (_index.column () == _IdColumn)
+				return tree_entry->m_id.toString ().left (10);
+			break;
+
+		case Qt::DecorationRole:
+			if (_index.column () == _NameColumn)
+				return QApplication::style ()->standardIcon (tree_entry->isTree () ? QStyle::SP_DirIcon : QStyle::SP_FileIcon);
+			break;
+
+		case Qt::ToolTipRole:
+			return tree_entry->m_id.toString ();
+
+		case PathRole:
+			return path (_index);
+
+		case BlobIdRole:
+			// Submodule entries are commits of other repositories
+			if (tree_entry->isTree () || (tree_entry->m_mode == GIT_FILEMODE_COMMIT))
+				return QString ();
+			return tree_entry->m_id.toString ();
+	}
+
+	return QVariant ();
+}
+
+QVariant
+CTreeModel::headerData (int _section, Qt::Orientation _orientation, int _role) const
+{
+	if ((_orientation != Qt::Horizontal) || (_role != Qt::DisplayRole))
+		return QVariant ();
+
+	switch (_section)
+	{
+		case _NameColumn:
+			return tr ("Name");
+
+		case _IdColumn:
+			return tr ("Object");
+	}
+
+	return QVariant ();
+}
@@ -0,0 +1,132 @@
+/**
+ * @file
+ * @brief Lazy item model of repository files at a commit interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CTREEMODEL_H
+#define __QGITREPOVIEWER_CTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QCache>
+#include <QHash>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "GitHelpers.h"
+
+namespace QGitRepoViewer
+{
+	/// Entry of git tree object
+	struct CTreeEntry
+	{
+		QString m_name;
+		CGitOid m_id;
+		uint m_mode;
+
+		CTreeEntry (): m_mode (0)
+		{}
+
+		bool isTree () const;
+	};
+
+	/// Entries of one tree object: directories first, then files, each sorted by name
+	typedef QVector<CTreeEntry> CTreeEntryList;
+	typedef QSharedPointer<const CTreeEntryList> CTreeEntriesPtr;
+
+	/**
+	 * @brief Files and directories of the tree of a commit
+	 *
+	 * Only the root directory is read when a commit is set; others are read when a view expands them
+	 * (canFetchMore/fetchMore). Entries of tree objects are cached by object id, and git trees of nearby
+	 * commits share almost all subdirectories, so showing another commit rarely reads anything but the root.
+	 */
+	class CTreeModel : public QAbstractItemModel
+	{
+		Q_OBJECT
+
+		/// Directory shown by the model; its entries are null until fetched
+		struct CNode
+		{
+			CNode* m_parent;
+			int m_row;
+			CTreeEntriesPtr m_entries;
+
+			/// Nodes of subdirectories by row, created when their index is asked for
+			QHash<int, CNode*> m_children;
+
+			CNode (CNode* _parent, int _row): m_parent (_parent), m_row (_row)
+			{}
+
+			~CNode ()
+			{
+				qDeleteAll (m_children);
+			}
+		};
+
+		CGitRepository m_repo;
+		CGitOid m_commit;
+		CNode* m_root;
+
+		/// Entries of trees by object id; cost is the count of entries
+		QCache<CGitOid, CTreeEntriesPtr> m_cache;
+
+		/// Directory node shown by the index (its parent for the rows of files)
+		CNode* node (const QModelIndex& _index) const;
+
+		/// Node of the subdirectory in specified row of the directory
+		CNode* childNode (CNode* _parent, int _row) const;
+
+		/// Entry shown by the index, NULL for the root
+		const CTreeEntry* entry (const QModelIndex& _index) const;
+
+		/// Entries of the tree object, from cache or repository
+		CTreeEntriesPtr readTree (const CGitOid& _tree_id);
+
+	public:
+		enum Columns { _NameColumn = 0, _IdColumn, _ColumnCount };
+
+		enum Roles
+		{
+			/// Path of the entry relative to repository root
+			PathRole = Qt::UserRole + 1,
+
+			/// Full id of blob of file (empty for directories and submodules)
+			BlobIdRole
+		};
+
+		/// Limit of cached tree entries
+		enum { CACHE_ENTRY_LIMIT = 1024 * 1024 };
+
+		CTreeModel (QObject* _parent = 0);
+		~CTreeModel ();
+
+		/// Forget cached trees and use another repository
+		void setGitRepo (const QString& _repo_path);
+
+		/// Show the tree of the commit; only its root directory is read
+		void setCommit (const CGitOid& _commit);
+		CGitOid commit () const;
+
+		/// Path of the entry relative to repository root
+		QString path (const QModelIndex& _index) const;
+
+		/// Index of the entry with specified path, fetching its parent directories; invalid if there is no such path
+		QModelIndex index (const QString& _path);
+
+	public:
+		/// @name Implementation of QAbstractItemModel interface
+		/** @{*/
+		QModelIndex index (int _row, int _column, const QModelIndex& _parent = QModelIndex ()) const;
+		QModelIndex parent (const QModelIndex& _index) const;
+		int rowCount (const QModelIndex& _parent = QModelIndex ()) const;
+		int columnCount (const QModelIndex& _parent = QModelIndex ()) const;
+		bool hasChildren (const QModelIndex& _parent = QModelIndex ()) const;
+		QVariant data (const QModelIndex& _index, int _role = Qt::DisplayRole) const;
+		QVariant headerData (int _section, Qt::Orientation _orientation, int _role = Qt::DisplayRole) const;
+		bool canFetchMore (const QModelIndex& _parent) const;
+		void fetchMore (const QModelIndex& _parent);
+		/** @}*/
+	};
+}
+
+#endif // __QGITREPOVIEWER_CTREEMODEL_H
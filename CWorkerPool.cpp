@@ -0,0 +1,186 @@
+/**
+ * @file
+ * @brief Bounded thread pool shared by all opened repositories implementation
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#include "CWorkerPool.h"
+
+#include <QRunnable>
+#include <QThread>
+
+using namespace QGitRepoViewer;
+
+namespace QGitRepoViewer
+{
+	/// Pool runnable performing a limited number of job steps
+	class CJobSlice : public QRunnable
+	{
+		CBackgroundJobPtr m_job;
+
+	public:
+		CJobSlice (const CBackgroundJobPtr& _job): m_job (_job)
+		{}
+
+		void run ()
+		{
+			for (int i = 0; i < CWorkerPool::STEPS_PER_SLICE; ++i)
+			{
+				if (m_job->isCancelled () || m_job->parkIfPaused ())
+					return;
+
+				if (! m_job->step ())
+					return;
+			}
+
+			//
+			// Let other jobs (e.g. ones of the active tab) run before continuing
+			//
+			CWorkerPool::instance ()->start (m_job);
+		}
+	};
+}
+
+// CBackgroundJob implementation ////////////////////////////////////////////////////////////////////
+
+CBackgroundJob::CBackgroundJob ():
+	m_cancelled (false),
+	m_paused (false),
+	m_parked (false),
+	m_priority (CWorkerPool::PRIORITY_FOREGROUND)
+{}
+
+CBackgroundJob::~CBackgroundJob ()
+{}
+
+bool
+CBackgroundJob::parkIfPaused ()
+{
+	QMutexLocker locker (&m_mutex);
+	if (m_paused && !m_cancelled)
+	{
+		m_parked = true;
+		return true;
+	}
+
+	return false;
+}
+
+bool
+CBackgroundJob::post (QObject* _receiver, const char* _member,
+					  QGenericArgument _arg0, QGenericArgument _arg1, QGenericArgument _arg2,
+					  QGenericArgument _arg3, QGenericArgument _arg4)
+{
+	//
+	// Hold the lock while queueing, so cancel() called from receiver destructor
+	// guarantees that nothing will be queued to the destroyed object
+	//
+	QMutexLocker locker (&m_mutex);
+	if (m_cancelled)
+		return false;
+
+	return QMetaObject::invokeMethod (_receiver, _member, Qt::QueuedConnection, _arg0, _arg1, _arg2, _arg3, _arg4);
+}
+
+void
+CBackgroundJob::cancel ()
+{
+	QMutexLocker locker (&m_mutex);
+	m_cancelled = true;
+}
+
+bool
+CBackgroundJob::isCancelled () const
+{
+	QMutexLocker locker (&m_mutex);
+	return m_cancelled;
+}
+
+void
+CBackgroundJob::setPaused (bool _paused)
+{
+	CBackgroundJobPtr self;
+	{
+		QMutexLocker locker (&m_mutex);
+		m_paused = _paused;
+		if (!_paused && m_parked)
+		{
+			m_parked = false;
+			if (!m_cancelled)
+				self = m_self.toStrongRef ();
+		}
+	}
+
+	if (self)
+		CWorkerPool::instance ()->start (self);
+}
+
+bool
+CBackgroundJob::isPaused () const
+{
+	QMutexLocker locker (&m_mutex);
+	return m_paused;
+}
+
+void
+CBackgroundJob::setPriority (int _priority)
+{
+	QMutexLocker locker (&m_mutex);
+	m_priority = _priority;
+}
+
+int
+CBackgroundJob::priority () const
+{
+	QMutexLocker locker (&m_mutex);
+	return m_priority;
+}
+
+// CWorkerPool implementation ///////////////////////////////////////////////////////////////////////
+
+CWorkerPool::CWorkerPool ()
+{
+	//
+	// Leave one core for the GUI thread
+	//
+	m_pool.setMaxThreadCount (qMax (2, QThread::idealThreadCount () - 1));
+}
+
+CWorkerPool*
+CWorkerPool::instance ()
+{
+	static CWorkerPool pool;
+	return &pool;
+}
+
+void
+CWorkerPool::start (const CBackgroundJobPtr& _job)
+{
+	Q_ASSERT (_job);
+
+	int priority = 0;
+	{
+		QMutexLocker locker (&_job->m_mutex);
+		_job->m_self = _job;
+		priority = _job->m_priority;
+	}
+
+	m_pool.start (new CJobSlice (_job), priority);
+}
+
+int
+CWorkerPool::maxThreadCount () const
+{
+	return m_pool.maxThreadCount ();
+}
+
+void
+CWorkerPool::setMaxThreadCount (int _count)
+{
+	m_pool.setMaxThreadCount (_count);
+}
+
+void
+CWorkerPool::waitForDone ()
+{
+	m_pool.waitForDone ();
+}
@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @brief Bounded thread pool shared by all opened repositories interface
+ * @author Alexander Kamyshnikov <axill777@gmail.com>
+ */
+#ifndef __QGITREPOVIEWER_CWORKERPOOL_H
+#define __QGITREPOVIEWER_CWORKERPOOL_H
+
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QThreadPool>
+
+namespace QGitRepoViewer
+{
+	/**
+	 * @brief Long-running job split into steps, which can be paused and cancelled between them
+	 *
+	 * Paused job doesn't occupy pool thread: it is parked and resubmitted on resume.
+	 * Results are delivered to GUI objects only through post(), which is a no-op after cancel(),
+	 * so the receiver must cancel its jobs before it is destroyed.
+	 */
+	class CBackgroundJob
+	{
+		friend class CWorkerPool;
+		friend class CJobSlice;
+
+		mutable QMutex m_mutex;
+		bool m_cancelled;
+		bool m_paused;
+		bool m_parked;
+		int m_priority;
+
+		/// Reference to itself, used to resubmit parked job
+		QWeakPointer<CBackgroundJob> m_self;
+
+		/// Park the job if it is paused; returns true if the job was parked
+		bool parkIfPaused ();
+
+	protected:
+		/// Perform next portion of work; return false when the job is complete
+		virtual bool step () = 0;
+
+		/// Queue the call of _member slot of _receiver unless the job was cancelled
+		bool post (QObject* _receiver, const char* _member,
+				   QGenericArgument _arg0 = QGenericArgument (), QGenericArgument _arg1 = QGenericArgument (),
+				   QGenericArgument _arg2 = QGenericArgument (), QGenericArgument _arg3 = QGenericArgument (),
+				   QGenericArgument _arg4 = QGenericArgument ());
+
+	public:
+		CBackgroundJob ();
+		virtual ~CBackgroundJob ();
+
+		void cancel ();
+		bool isCancelled () const;
+
+		void setPaused (bool _paused);
+		bool isPaused () const;
+
+		/// Pool priority of the next steps of the job (higher runs first)
+		void setPriority (int _priority);
+		int priority () const;
+
+	private:
+		Q_DISABLE_COPY (CBackgroundJob)
+	};
+
+	typedef QSharedPointer<CBackgroundJob> CBackgroundJobPtr;
+
+	/// Process-wide bounded thread pool; all repository tabs queue their background jobs here
+	class CWorkerPool
+	{
+		QThreadPool m_pool;
+
+		CWorkerPool ();
+
+	public:
+		/// Job priorities: active tab jobs are scheduled before background tab ones
+		enum { PRIORITY_BACKGROUND = 0, PRIORITY_FOREGROUND = 10 };
+
+		/// Number of steps performed before the job yields its thread to other queued jobs
+		enum { STEPS_PER_SLICE = 8 };
+
+		static CWorkerPool* instance ();
+
+		/// Queue the job for execution
+		void start (const CBackgroundJobPtr& _job);
+
+		int maxThreadCount () const;
+		void setMaxThreadCount (int _count);
+
+		void waitForDone ();
+
+	private:
+		Q_DISABLE_COPY (CWorkerPool)
+	};
+}
+
+#endif // __QGITREPOVIEWER_CWORKERPOOL_H
@@ -9,6 +9,12 @@
 #include <QDebug>
 #include <QCoreApplication>
 #include <QFile>
+#include <QHash>
+#include <QTemporaryFile>
+#include <QThreadStorage>
+
+#include <errno.h>
+#include <stdio.h>
 
 #include <git2.h>
 
@@ -17,6 +23,100 @@ using namespace QGitRepoViewer;
 /// Custom user-defined git error code (all standart errors have negative codes)
 #define GIT_USER_ERROR 1
 
+// CGitOid implementation ///////////////////////////////////////////////////////////////////////////
+
+CGitOid::CGitOid (const git_oid* _oid)
+{
+	Q_ASSERT (_oid);
+	memcpy (m_id, _oid->id, RAW_SIZE);
+}
+
+bool
+CGitOid::isNull () const
+{
+	return (git_oid_iszero (raw ()) != 0);
+}
+
+const git_oid*
+CGitOid::raw () const
+{
+	return reinterpret_cast <const git_oid*> (m_id);
+}
+
+QString
+CGitOid::toString () const
+{
+	char hex [HEX_SIZE + 1] = {0};
+	git_oid_fmt (hex, raw ());
+	return QString::fromLatin1 (hex, HEX_SIZE);
+}
+
+CGitOid
+CGitOid::fromString (const QString& _hex)
+{
+	CGitOid oid;
+	if (_hex.length () == HEX_SIZE)
+	{
+		if (git_oid_fromstr (reinterpret_cast <git_oid*> (oid.m_id), _hex.toLatin1 ().constData ()) != GIT_OK)
+			oid = CGitOid ();
+	}
+
+	return oid;
+}
+
+QString
+QGitRepoViewer::gitErrorString (int _code, const QString& _action)
+{
+	const git_error* error = giterr_last ();
+	return QCoreApplication::translate (TR_CONTEXT, "Error with code %1 during %2:\n %3")
+			.arg (_code)
+			.arg (_action)
+			.arg ((error && error->message) ? QString::fromUtf8 (error->message)
+											: QCoreApplication::translate (TR_CONTEXT, "<Unknown>"));
+}
+
+QString
+QGitRepoViewer::createTemporaryFile (const QString& _path)
+{
+	QTemporaryFile file (_path + ".XXXXXX");
+	file.setAutoRemove (false);
+	if (! file.open ())
+		return QString ();
+
+	return file.fileName ();
+}
+
+bool
+QGitRepoViewer::replaceFile (const QString& _new_path, const QString& _path, QString& _error)
+{
+#ifdef Q_OS_WIN
+	//
+	// File can't be renamed over an existing one, and can't be removed while another reader maps it
+	//
+	QFile old_file (_path);
+	bool replaced = ! old_file.exists () || old_file.remove ();
+	QString reason = old_file.errorString ();
+	if (replaced)
+	{
+		QFile new_file (_new_path);
+		replaced = new_file.rename (_path);
+		reason = new_file.errorString ();
+	}
+#else
+	// Atomic: readers which mapped the old file keep it until they unmap it
+	const bool replaced = (::rename (QFile::encodeName (_new_path).constData (), QFile::encodeName (_path).constData ()) == 0);
+	const QString reason = qt_error_string (errno);
+#endif
+
+	if (! replaced)
+	{
+		_error = QCoreApplication::translate (TR_CONTEXT, "Can't replace %1: %2").arg (_path, reason);
+		QFile::remove (_new_path);
+	}
+
+	return replaced;
+}
+
 // CGitReference implementation /////////////////////////////////////////////////////////////////////
 
 // CGitRepository implementation ////////////////////////////////////////////////////////////////////
@@ -34,6 +134,42 @@ CGitRepository::~CGitRepository ()
 	close ();
 }
 
+namespace
+{
+	/// Per-thread set of opened repositories, freed together with the owning thread
+	struct CThreadRepositories
+	{
+		QHash<QString, CGitRepository*> m_repos;
+
+		~CThreadRepositories ()
+		{
+			qDeleteAll (m_repos);
+		}
+	};
+}
+
+CGitRepository*
+CGitRepository::threadRepository (const QString& _path)
+{
+	static QThreadStorage<CThreadRepositories*> storage;
+	if (! storage.hasLocalData ())
+		storage.setLocalData (new CThreadRepositories);
+
+	CGitRepository*& repo = storage.localData ()->m_repos [_path];
+	if (! repo)
+		repo = new CGitRepository ();
+	if (! repo->isOpened ())
+		repo->open (_path, true);
+
+	return repo;
+}
+
+git_repository*
+CGitRepository::handle () const
+{
+	return m_repo;
+}
+
 bool
 CGitRepository::open (const QString& _path, bool _discover)
 {
@@ -282,6 +418,195 @@ QString gitObjectIdAsString (const git_oid* _oid)
 	return commit_id;
 }
 
+bool
+CGitRepository::lookupCommit (const CGitOid& _oid, CGitCommit& _commit)
+{
+	if (!m_repo)
+		return false;
+
+	git_commit* commit = NULL;
+	int error_code = git_commit_lookup (&commit, m_repo, _oid.raw ());
+	if (error_code != GIT_OK)
+	{
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "looking up commit %1").arg (_oid.toString ()));
+		return false;
+	}
+
+	_commit.m_id = _oid.toString ();
+	_commit.m_comment = QString::fromUtf8 (git_commit_message (commit));
+	_commit.m_comment_encoding = QString::fromLatin1 (git_commit_message_encoding (commit));
+	_commit.m_summary = _commit.m_comment.section ('\n', 0, 0);
+
+	const git_signature* author = git_commit_author (commit);
+	if (author)
+	{
+		_commit.m_author = QString::fromUtf8 (author->name);
+		_commit.m_author_email = QString::fromUtf8 (author->email);
+	}
+
+	_commit.m_time.setTime_t (git_commit_time (commit));
+
+	//
+	// Parents are stored as id-only commit objects
+	//
+	_commit.m_parents.clear ();
+	unsigned int parent_count = git_commit_parentcount (commit);
+	for (unsigned int i = 0; i < parent_count; ++i)
+	{
+		CGitCommit parent;
+		parent.m_id = CGitOid (git_commit_parent_id (commit, i)).toString ();
+		_commit.m_parents.append (parent);
+	}
+
+	git_commit_free (commit);
+	return true;
+}
+
+bool
+CGitRepository::lookupChangedFiles (CGitCommit& _commit, bool _line_stats)
+{
+	_commit.m_files.clear ();
+	_commit.m_file_stats.clear ();
+	if (!m_repo)
+		return false;
+
+	git_oid oid;
+	int error_code = git_oid_fromstr (&oid, _commit.m_id.toLatin1 ().constData ());
+
+	//
+	// Root commit is compared to the empty tree
+	//
+	git_commit* commit = NULL;
+	git_commit* parent = NULL;
+	git_tree* tree = NULL;
+	git_tree* parent_tree = NULL;
+	git_diff_list* diff = NULL;
+	if (error_code == GIT_OK)
+		error_code = git_commit_lookup (&commit, m_repo, &oid);
+	if ((error_code == GIT_OK) && (git_commit_parentcount (commit) > 0))
+	{
+		error_code = git_commit_parent (&parent, commit, 0);
+		if (error_code == GIT_OK)
+			error_code = git_commit_tree (&parent_tree, parent);
+	}
+	if (error_code == GIT_OK)
+		error_code = git_commit_tree (&tree, commit);
+	if (error_code == GIT_OK)
+		error_code = git_diff_tree_to_tree (&diff, m_repo, parent_tree, tree, NULL);
+
+	//
+	// Patches (and so blobs) are loaded only when line counts are asked for
+	//
+	const size_t delta_count = (error_code == GIT_OK) ? git_diff_num_deltas (diff) : 0;
+	for (size_t i = 0; i < delta_count; ++i)
+	{
+		git_diff_patch* patch = NULL;
+		const git_diff_delta* delta = NULL;
+		error_code = git_diff_get_patch (_line_stats ? &patch : NULL, &delta, diff, i);
+		if (error_code != GIT_OK)
+			break;
+
+		_commit.m_files.append (QString::fromUtf8 (delta->new_file.path));
+		if (_line_stats)
+		{
+			CGitFileStat stat;
+			switch (delta->status)
+			{
+				case GIT_DELTA_ADDED:
+					stat.m_status = 'A';
+					break;
+				case GIT_DELTA_DELETED:
+					stat.m_status = 'D';
+					break;
+				case GIT_DELTA_TYPECHANGE:
+					stat.m_status = 'T';
+					break;
+				default:
+					break;
+			}
+
+			stat.m_binary = ((delta->flags & GIT_DIFF_FLAG_BINARY) != 0);
+			size_t context = 0;
+			size_t added = 0;
+			size_t deleted = 0;
+			if (patch && (git_diff_patch_line_stats (&context, &added, &deleted, patch) == GIT_OK))
+			{
+				stat.m_added = int (added);
+				stat.m_deleted = int (deleted);
+			}
+			_commit.m_file_stats.append (stat);
+		}
+
+		git_diff_patch_free (patch);
+	}
+
+	git_diff_list_free (diff);
+	git_tree_free (parent_tree);
+	git_tree_free (tree);
+	git_commit_free (parent);
+	git_commit_free (commit);
+
+	if (error_code != GIT_OK)
+	{
+		setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "diffing commit %1").arg (_commit.m_id));
+		return false;
+	}
+
+	return true;
+}
+
+namespace
+{
+	/// gitCommitTagCb parameters structure
+	struct CCommitTagCbContext
+	{
+		git_repository* m_repo;
+		CGitTagMap m_tags;
+	};
+}
+
+/**
+ * @brief Callback for git_tag_foreach: resolve the tag (lightweight or annotated) to commit
+ */
+static int gitCommitTagCb (const char* _name, git_oid* _oid, void* _payload)
+{
+	Q_UNUSED (_oid);
+
+	CCommitTagCbContext* context = static_cast <CCommitTagCbContext*> (_payload);
+	Q_ASSERT (context);
+
+	git_reference* ref = NULL;
+	if (git_reference_lookup (&ref, context->m_repo, _name) == GIT_OK)
+	{
+		git_object* target = NULL;
+		if (git_reference_peel (&target, ref, GIT_OBJ_COMMIT) == GIT_OK)
+		{
+			context->m_tags [CGitOid (git_object_id (target))].append (QString::fromUtf8 (git_reference_shorthand (ref)));
+			git_object_free (target);
+		}
+
+		git_reference_free (ref);
+	}
+
+	return GIT_OK;
+}
+
+CGitTagMap
+CGitRepository::enumCommitTags ()
+{
+	CCommitTagCbContext context;
+	context.m_repo = m_repo;
+
+	if (m_repo)
+	{
+		int error_code = git_tag_foreach (m_repo, &gitCommitTagCb, &context);
+		if (error_code != GIT_OK)
+			setLastError (error_code, QCoreApplication::translate (TR_CONTEXT, "iterating over the git tags"));
+	}
+
+	return context.m_tags;
+}
+
 QList<CGitBranch>
 CGitRepository::enumBranches (bool _local_only)
 {
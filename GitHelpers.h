@@ -9,6 +9,11 @@
 #include <QString>
 #include <QStringList>
 #include <QDateTime>
+#include <QMetaType>
+#include <QVector>
+#include <QHash>
+
+#include <string.h>
 
 #define TR_CONTEXT "QGitRepoViewer"
 #ifdef Q_OS_WIN32
@@ -18,18 +23,94 @@
 #endif
 
 struct git_repository;
+struct git_oid;
 
 namespace QGitRepoViewer
 {
+	/// Compact binary SHA-1 object id, layout-compatible with libgit2 git_oid
+	struct CGitOid
+	{
+		enum { RAW_SIZE = 20, HEX_SIZE = 40 };
+
+		unsigned char m_id [RAW_SIZE];
+
+		CGitOid ()
+		{
+			memset (m_id, 0, RAW_SIZE);
+		}
+
+		explicit CGitOid (const git_oid* _oid);
+
+		bool isNull () const;
+
+		/// Return pointer to the same bytes viewed as libgit2 object id
+		const git_oid* raw () const;
+
+		/// Return full 40-symbol hex representation of object id
+		QString toString () const;
+
+		/// Parse 40-symbol hex string (returns null id on failure)
+		static CGitOid fromString (const QString& _hex);
+
+		bool operator == (const CGitOid& _other) const
+		{
+			return (memcmp (m_id, _other.m_id, RAW_SIZE) == 0);
+		}
+
+		bool operator != (const CGitOid& _other) const
+		{
+			return !(*this == _other);
+		}
+
+		bool operator < (const CGitOid& _other) const
+		{
+			return (memcmp (m_id, _other.m_id, RAW_SIZE) < 0);
+		}
+	};
+
+	/// SHA-1 is uniformly distributed, so the first bytes make a perfect hash
+	inline uint qHash (const CGitOid& _oid)
+	{
+		return (uint (_oid.m_id [0]) << 24) | (uint (_oid.m_id [1]) << 16)
+				| (uint (_oid.m_id [2]) << 8) | uint (_oid.m_id [3]);
+	}
+
+	typedef QVector<CGitOid> CGitOidVector;
+
+	/// Build human-readable description of the last libgit2 error
+	QString gitErrorString (int _code, const QString& _action);
+
+	/// Create an empty file with unique name next to specified one (several tabs may write it at once); empty on failure
+	QString createTemporaryFile (const QString& _path);
+
+	/// Replace file by one written aside; on failure the old file is kept, the new one is removed and _error is set
+	bool replaceFile (const QString& _new_path, const QString& _path, QString& _error);
+
+	/// Lines added and deleted in one file by a commit
+	struct CGitFileStat
+	{
+		int m_added;
+		int m_deleted;
+		char m_status;	// 'A'dded, 'D'eleted, 'M'odified or 'T'ype changed
+		bool m_binary;
+
+		CGitFileStat (): m_added (0), m_deleted (0), m_status ('M'), m_binary (false)
+		{}
+	};
+
 	struct CGitCommit
 	{
 		QString m_id;
+		QString m_summary;	// first line of the message
 		QString m_comment;
 		QString m_comment_encoding;
+		QString m_author;
+		QString m_author_email;
 		QDateTime m_time;
 
 		QList<CGitCommit> m_parents;
 		QStringList m_files;
+		QList<CGitFileStat> m_file_stats;	// parallel to m_files when line stats were asked for
 	};
 
 	struct CGitReference
@@ -61,6 +142,11 @@ namespace QGitRepoViewer
 		{}
 	};
 
+	typedef QList<CGitBranch> CGitBranchList;
+
+	/// Names of tags pointing to each tagged commit
+	typedef QHash<CGitOid, QStringList> CGitTagMap;
+
 	struct CGitTag : public CGitReference
 	{
 		QString m_message;
@@ -97,6 +183,13 @@ namespace QGitRepoViewer
 		CGitRepository (const QString& _path);
 		~CGitRepository ();
 
+		/// Return repository handle cached for the calling thread (libgit2 objects must not be shared
+		/// between threads, so each worker uses its own handle; it is freed on thread exit)
+		static CGitRepository* threadRepository (const QString& _path);
+
+		/// Raw libgit2 handle for code that walks objects directly
+		git_repository* handle () const;
+
 		bool open (const QString& _path, bool _discover = false);
 		bool isOpened () const;
 		bool init (const QString& _path, bool _bare = false);
@@ -138,7 +231,16 @@ namespace QGitRepoViewer
 
 		// commits
 		QList<CGitCommit> enumBranchCommits (const QString& _name);
+		bool lookupCommit (const CGitOid& _oid, CGitCommit& _commit);
+		bool lookupChangedFiles (CGitCommit& _commit, bool _line_stats = false);	// compared to the first parent
+
+		// tags
+		CGitTagMap enumCommitTags ();
 	};
 }
 
+Q_DECLARE_TYPEINFO (QGitRepoViewer::CGitOid, Q_PRIMITIVE_TYPE);
+Q_DECLARE_METATYPE (QGitRepoViewer::CGitOid)
+Q_DECLARE_METATYPE (QGitRepoViewer::CGitCommit)
+
 #endif /* __QGITREPOVIEWER_GITHELPERS_H */
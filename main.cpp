@@ -6,13 +6,52 @@
 
 #include <QApplication>
 
+#include <string.h>
+#include <git2.h>
+
 #include "CMainWindow.h"
+#include "CCommitExporter.h"
+
+/// Check whether application was started in headless export mode
+static bool isExportMode (int argc, char* argv[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp (argv [i], "--export") == 0)
+			return true;
+	}
+
+	return false;
+}
 
 int main (int argc, char* argv[])
 {
-	QApplication app (argc, argv);
-	QGitRepoViewer::CMainWindow wnd;
-	wnd.show ();
+	//
+	// Repository objects are used from worker threads, so libgit2 must be thread-aware
+	//
+	git_threads_init ();
+
+	int result = 0;
+	if (isExportMode (argc, argv))
+	{
+		//
+		// No display server is required in export mode
+		//
+		QCoreApplication app (argc, argv);
+		result = QGitRepoViewer::CCommitExporter::run (app.arguments ());
+	}
+	else
+	{
+		QApplication app (argc, argv);
+		QGitRepoViewer::CMainWindow wnd;
+		wnd.show ();
+
+		result = app.exec ();
+	}
 
-	return app.exec();
+	//
+	// NOTE: git_threads_shutdown() is not called, because idle workers of the shared pool
+	// still own their repository handles until process exit
+	//
+	return result;
 }
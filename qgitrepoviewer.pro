@@ -19,23 +19,84 @@ GIT2ROOT     = $$PROJ_ROOT/libgit2
 INCLUDEPATH += $${GIT2ROOT}/include
 LIBS        += -L$$PROJ_ROOT/libgit2-build -lgit2
 
+#
+# zlib is used to read commits from pack files directly
+#
+LIBS        += -lz
+
 SOURCES += main.cpp\
 	CCommitModel.cpp \
 	CBranchModel.cpp \
     CSearchLineWidget.cpp \
     CMainWindow.cpp \
-    GitHelpers.cpp
+    GitHelpers.cpp \
+    CCommitWalker.cpp \
+    CCommitExporter.cpp \
+    CCommitLoader.cpp \
+    CWorkerPool.cpp \
+    CMemoryBudget.cpp \
+    CRepoTab.cpp \
+    CDiagnostics.cpp \
+    CDiagnosticsPanel.cpp \
+    CCommitItemDelegate.cpp \
+    CCommitView.cpp \
+    CPackCommitReader.cpp \
+    CDateDialog.cpp \
+    CMessageIndex.cpp \
+    CHistoryFilterDialog.cpp \
+    CChangedPathIndex.cpp \
+    CCommitDetailsView.cpp \
+    CDiffView.cpp \
+    CBlameView.cpp \
+    CTreeModel.cpp \
+    CBlobReader.cpp \
+    CBlobView.cpp \
+    CGrepModel.cpp \
+    CPickaxe.cpp \
+    CReachabilityIndex.cpp \
+    CContainedInView.cpp \
+    CCompareWalker.cpp
 
 HEADERS  += \
 	CCommitModel.h \
 	CBranchModel.h \
     CSearchLineWidget.h \
     CMainWindow.h \
-    GitHelpers.h
+    GitHelpers.h \
+    CCommitWalker.h \
+    CCommitExporter.h \
+    CCommitLoader.h \
+    CWorkerPool.h \
+    CMemoryBudget.h \
+    CRepoTab.h \
+    CDiagnostics.h \
+    CDiagnosticsPanel.h \
+    CCommitItemDelegate.h \
+    CCommitView.h \
+    CPackCommitReader.h \
+    CDateDialog.h \
+    CMessageIndex.h \
+    CHistoryFilterDialog.h \
+    CChangedPathIndex.h \
+    CCommitDetailsView.h \
+    CDiffView.h \
+    CBlameView.h \
+    CTreeModel.h \
+    CBlobReader.h \
+    CBlobView.h \
+    CGrepModel.h \
+    CPickaxe.h \
+    CReachabilityIndex.h \
+    CContainedInView.h \
+    CCompareWalker.h
 
 FORMS    += \
     CSearchLineWidget.ui \
-    CMainWindow.ui
+    CMainWindow.ui \
+    CRepoTab.ui \
+    CDiagnosticsPanel.ui \
+    CDateDialog.ui \
+    CHistoryFilterDialog.ui
 
 RESOURCES += \
     qgitrepoviewer.qrc